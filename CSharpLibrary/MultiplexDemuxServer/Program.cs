@@ -0,0 +1,229 @@
+using System.Buffers.Binary;
+using System.Collections.Concurrent;
+using System.Net.WebSockets;
+
+// Reference server side of MultiplexedConnection: accepts the shared socket on any path and gives every logical
+// channel its own upstream WebSocket to --upstream plus the request path, or echoes each channel back without one.
+//
+//   dotnet run -- --port 8080 --upstream ws://localhost:9000
+
+var port = 8080;
+string upstream = null;
+for (var i = 0; i + 1 < args.Length; i += 2)
+{
+    switch (args[i])
+    {
+        case "--port":
+            port = int.Parse(args[i + 1]);
+            break;
+        case "--upstream":
+            upstream = args[i + 1].TrimEnd('/');
+            break;
+    }
+}
+
+var builder = WebApplication.CreateBuilder();
+builder.WebHost.UseUrls($"http://0.0.0.0:{port}");
+var app = builder.Build();
+app.UseWebSockets();
+
+app.Run(async context =>
+{
+    if (!context.WebSockets.IsWebSocketRequest)
+    {
+        context.Response.StatusCode = StatusCodes.Status400BadRequest;
+        return;
+    }
+
+    using var socket = await context.WebSockets.AcceptWebSocketAsync();
+    var session = new Session(socket, upstream is null ? null : new Uri(upstream + context.Request.Path + context.Request.QueryString));
+    await session.RunAsync(context.RequestAborted);
+});
+
+app.Logger.LogInformation("Demultiplexing on port {Port}, {Mode}", port, upstream is null ? "echo mode" : $"upstream {upstream}");
+app.Run();
+
+sealed class Session(WebSocket socket, Uri upstream)
+{
+    private const byte OpOpen = 1;
+    private const byte OpClose = 2;
+    private const byte TypeBinary = 0;
+    private const byte TypeText = 1;
+
+    // [channel uint16][type] in front of every data message; the shared socket itself only carries binary frames, as a
+    // channel id prefix is not valid UTF-8 in general
+    private const int HeaderLength = 3;
+
+    private readonly SemaphoreSlim _sendLock = new(1, 1);
+    private readonly ConcurrentDictionary<ushort, ClientWebSocket> _upstreams = new();
+
+    public async Task RunAsync(CancellationToken cancellationToken)
+    {
+        var buffer = new byte[64 * 1024];
+        var message = new MemoryStream();
+        try
+        {
+            while (socket.State == WebSocketState.Open)
+            {
+                var result = await socket.ReceiveAsync(buffer, cancellationToken);
+                if (result.MessageType == WebSocketMessageType.Close)
+                    break;
+
+                message.Write(buffer, 0, result.Count);
+                if (!result.EndOfMessage)
+                    continue;
+
+                var data = message.ToArray();
+                message.SetLength(0);
+                if (data.Length >= 2)
+                    await DispatchAsync(data, cancellationToken);
+            }
+        }
+        catch (Exception e) when (e is WebSocketException or OperationCanceledException)
+        {
+        }
+        finally
+        {
+            foreach (var channelId in _upstreams.Keys)
+                await CloseUpstreamAsync(channelId);
+
+            if (socket.State is WebSocketState.Open or WebSocketState.CloseReceived)
+                await socket.CloseOutputAsync(WebSocketCloseStatus.NormalClosure, null, CancellationToken.None);
+        }
+    }
+
+    private async Task DispatchAsync(byte[] data, CancellationToken cancellationToken)
+    {
+        var channelId = BinaryPrimitives.ReadUInt16BigEndian(data);
+        if (channelId == 0)
+        {
+            if (data.Length < 5)
+                return;
+
+            var target = BinaryPrimitives.ReadUInt16BigEndian(data.AsSpan(3));
+            switch (data[2])
+            {
+                case OpOpen when upstream is not null:
+                    await OpenUpstreamAsync(target, cancellationToken);
+                    break;
+                case OpClose:
+                    await CloseUpstreamAsync(target);
+                    break;
+            }
+
+            return;
+        }
+
+        if (data.Length < HeaderLength)
+            return;
+
+        if (upstream is null)
+        {
+            await SendAsync(data);
+        }
+        else if (_upstreams.TryGetValue(channelId, out var channel) && channel.State == WebSocketState.Open)
+        {
+            var messageType = data[2] == TypeText ? WebSocketMessageType.Text : WebSocketMessageType.Binary;
+            await channel.SendAsync(data.AsMemory(HeaderLength), messageType, true, cancellationToken);
+        }
+    }
+
+    private async Task OpenUpstreamAsync(ushort channelId, CancellationToken cancellationToken)
+    {
+        var channel = new ClientWebSocket();
+        try
+        {
+            await channel.ConnectAsync(upstream, cancellationToken);
+        }
+        catch (Exception e) when (e is WebSocketException or OperationCanceledException)
+        {
+            channel.Dispose();
+            await SendAsync(ControlFrame(OpClose, channelId));
+            return;
+        }
+
+        _upstreams[channelId] = channel;
+        _ = PumpUpstreamAsync(channelId, channel);
+    }
+
+    private async Task PumpUpstreamAsync(ushort channelId, ClientWebSocket channel)
+    {
+        var buffer = new byte[64 * 1024];
+        var message = new MemoryStream();
+        message.SetLength(HeaderLength);
+        message.Position = HeaderLength;
+        try
+        {
+            while (channel.State == WebSocketState.Open)
+            {
+                var result = await channel.ReceiveAsync(buffer, CancellationToken.None);
+                if (result.MessageType == WebSocketMessageType.Close)
+                    break;
+
+                message.Write(buffer, 0, result.Count);
+                if (!result.EndOfMessage)
+                    continue;
+
+                var frame = message.ToArray();
+                BinaryPrimitives.WriteUInt16BigEndian(frame, channelId);
+                frame[2] = result.MessageType == WebSocketMessageType.Text ? TypeText : TypeBinary;
+                message.SetLength(HeaderLength);
+                await SendAsync(frame);
+            }
+        }
+        catch (WebSocketException)
+        {
+        }
+
+        // Closed by the upstream rather than by the client: tell the client the channel is gone
+        if (_upstreams.TryRemove(new KeyValuePair<ushort, ClientWebSocket>(channelId, channel)))
+        {
+            channel.Dispose();
+            await SendAsync(ControlFrame(OpClose, channelId));
+        }
+    }
+
+    private async Task CloseUpstreamAsync(ushort channelId)
+    {
+        if (!_upstreams.TryRemove(channelId, out var channel))
+            return;
+
+        try
+        {
+            if (channel.State == WebSocketState.Open)
+                await channel.CloseOutputAsync(WebSocketCloseStatus.NormalClosure, null, CancellationToken.None);
+        }
+        catch (WebSocketException)
+        {
+        }
+        finally
+        {
+            channel.Dispose();
+        }
+    }
+
+    private async Task SendAsync(byte[] frame)
+    {
+        await _sendLock.WaitAsync();
+        try
+        {
+            if (socket.State == WebSocketState.Open)
+                await socket.SendAsync(frame, WebSocketMessageType.Binary, true, CancellationToken.None);
+        }
+        catch (WebSocketException)
+        {
+        }
+        finally
+        {
+            _sendLock.Release();
+        }
+    }
+
+    private static byte[] ControlFrame(byte op, ushort channelId)
+    {
+        var frame = new byte[5];
+        frame[2] = op;
+        BinaryPrimitives.WriteUInt16BigEndian(frame.AsSpan(3), channelId);
+        return frame;
+    }
+}
@@ -0,0 +1,354 @@
+using System;
+using System.Collections.Concurrent;
+using System.Diagnostics;
+using System.Globalization;
+using System.IO;
+using System.Net.Sockets;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace WebSocketClientNativeLibrary;
+
+/// <summary>
+/// Dedicated receive thread of the opt-in busy-poll mode (see <see cref="WebSocketClient.SetBusyPoll"/>). The receive
+/// loop runs under this context, so its continuations come back to this thread instead of the thread pool, and while
+/// there is nothing to run the thread spins for SpinMicros before parking on an event. Socket reads issued from this
+/// thread go through <see cref="BusyPollStream"/>, which spins on the socket first, so a message arriving inside the
+/// spin window is read, decrypted and delivered without a single thread switch.
+/// </summary>
+internal sealed class BusyPollLoop : SynchronizationContext
+{
+    [ThreadStatic] private static BusyPollLoop _current;
+
+    private readonly ConcurrentQueue<(SendOrPostCallback Callback, object State)> _work = new();
+    private readonly AutoResetEvent _wake = new(false);
+    private readonly long _spinTicks;
+    private int _parked;
+    private volatile bool _exited;
+
+    // Written by the loop thread only
+    private long _loopSpinHits;
+    private long _socketSpinHits;
+    private long _parks;
+    private long _cpuNanos;
+    private long _startTimestamp;
+    private long _endTimestamp;
+
+    private BusyPollLoop(int spinMicros, int core)
+    {
+        SpinMicros = spinMicros;
+        Core = core;
+        _spinTicks = spinMicros * Stopwatch.Frequency / 1_000_000;
+    }
+
+    /// <summary>
+    /// The loop owning the calling thread, null on any other thread.
+    /// </summary>
+    public static BusyPollLoop CurrentLoop => _current;
+
+    public int SpinMicros { get; }
+
+    public int Core { get; }
+
+    /// <summary>
+    /// Runs body on a new thread pinned to core (-1 leaves it unpinned) until the task it returns completes.
+    /// </summary>
+    public static BusyPollLoop Start(string name, int spinMicros, int core, Func<Task> body, Action<string> log)
+    {
+        var loop = new BusyPollLoop(spinMicros, core);
+        var thread = new Thread(() => loop.Run(body, log))
+        {
+            IsBackground = true,
+            Name = name,
+            Priority = ThreadPriority.AboveNormal
+        };
+        thread.Start();
+        return loop;
+    }
+
+    public override void Post(SendOrPostCallback d, object state)
+    {
+        // Anything posted after the loop ended still has to run somewhere
+        if (_exited)
+        {
+            ThreadPool.QueueUserWorkItem(static item => item.Callback(item.State), (Callback: d, State: state), false);
+            return;
+        }
+
+        _work.Enqueue((d, state));
+        if (_exited && _work.TryDequeue(out var late))
+        {
+            ThreadPool.QueueUserWorkItem(static item => item.Callback(item.State), late, false);
+            return;
+        }
+
+        if (Interlocked.CompareExchange(ref _parked, 0, 1) == 1)
+            _wake.Set();
+    }
+
+    public override SynchronizationContext CreateCopy() => this;
+
+    private void Run(Func<Task> body, Action<string> log)
+    {
+        _current = this;
+        SetSynchronizationContext(this);
+        Pin(log);
+        Volatile.Write(ref _startTimestamp, Stopwatch.GetTimestamp());
+        var cpuStart = ThreadCpuNanos();
+
+        Task task;
+        try
+        {
+            task = body();
+        }
+        catch (Exception ex)
+        {
+            task = Task.FromException(ex);
+        }
+
+        // The body's own continuations come back here, this only covers one completing on another thread
+        task.ContinueWith(_ => _wake.Set(), TaskScheduler.Default);
+
+        var processed = 0;
+        while (true)
+        {
+            if (_work.TryDequeue(out var item))
+            {
+                item.Callback(item.State);
+                if ((++processed & 1023) == 0)
+                    Volatile.Write(ref _cpuNanos, ThreadCpuNanos() - cpuStart);
+                continue;
+            }
+
+            if (task.IsCompleted)
+                break;
+
+            if (SpinFor(static loop => !loop._work.IsEmpty, this))
+            {
+                _loopSpinHits++;
+                continue;
+            }
+
+            // Park: announce it before the last look at the queue, Post wakes us only when it sees the flag
+            Volatile.Write(ref _cpuNanos, ThreadCpuNanos() - cpuStart);
+            Volatile.Write(ref _parks, _parks + 1);
+            Interlocked.Exchange(ref _parked, 1);
+            if (_work.IsEmpty && !task.IsCompleted)
+                _wake.WaitOne();
+            Volatile.Write(ref _parked, 0);
+        }
+
+        _exited = true;
+        while (_work.TryDequeue(out var late))
+            late.Callback(late.State);
+
+        Volatile.Write(ref _cpuNanos, ThreadCpuNanos() - cpuStart);
+        Volatile.Write(ref _endTimestamp, Stopwatch.GetTimestamp());
+        _current = null;
+    }
+
+    /// <summary>
+    /// Spins until socket has bytes waiting or the spin window runs out; true means a read will not block.
+    /// </summary>
+    public bool SpinForSocket(Socket socket)
+    {
+        if (socket.Available > 0 || SpinFor(static s => s.Available > 0, socket))
+        {
+            _socketSpinHits++;
+            return true;
+        }
+
+        return false;
+    }
+
+    private bool SpinFor<T>(Func<T, bool> ready, T state)
+    {
+        var deadline = Stopwatch.GetTimestamp() + _spinTicks;
+        do
+        {
+            if (ready(state))
+                return true;
+
+            Thread.SpinWait(8);
+        } while (Stopwatch.GetTimestamp() < deadline);
+
+        return false;
+    }
+
+    private void Pin(Action<string> log)
+    {
+        if (Core < 0)
+            return;
+
+        if (OperatingSystem.IsWindows())
+        {
+            if (Core >= 64 || SetThreadAffinityMask(GetCurrentThread(), (UIntPtr)(1UL << Core)) == UIntPtr.Zero)
+                log?.Invoke($"Busy-poll: could not pin the receive thread to core {Core}.");
+        }
+        else
+        {
+            // macOS has no hard affinity, THREAD_AFFINITY_POLICY is only a grouping hint (ignored on Apple silicon)
+            log?.Invoke($"Busy-poll: CPU pinning is not supported on this platform, core {Core} ignored.");
+        }
+    }
+
+    /// <summary>
+    /// Spin/park counters and the CPU time the thread burned against its wall time, as JSON.
+    /// </summary>
+    public void AppendJson(StringBuilder builder)
+    {
+        var start = Volatile.Read(ref _startTimestamp);
+        var end = Volatile.Read(ref _endTimestamp);
+        var wallNanos = start == 0 ? 0 : (long)(((end == 0 ? Stopwatch.GetTimestamp() : end) - start) * (1_000_000_000.0 / Stopwatch.Frequency));
+        var cpuNanos = Volatile.Read(ref _cpuNanos);
+        builder.Append(CultureInfo.InvariantCulture,
+            $"{{\"spinMicros\":{SpinMicros},\"core\":{Core},\"running\":{(start != 0 && end == 0 ? "true" : "false")}," +
+            $"\"loopSpinHits\":{Volatile.Read(ref _loopSpinHits)},\"socketSpinHits\":{Volatile.Read(ref _socketSpinHits)},\"parks\":{Volatile.Read(ref _parks)}," +
+            $"\"cpuMs\":{cpuNanos / 1e6:F3},\"wallMs\":{wallNanos / 1e6:F3},\"cpuUtilization\":{(wallNanos > 0 ? (double)cpuNanos / wallNanos : 0):F4}}}");
+    }
+
+    private static long ThreadCpuNanos()
+    {
+        if (OperatingSystem.IsWindows())
+        {
+            // FILETIME units of 100ns
+            return GetThreadTimes(GetCurrentThread(), out _, out _, out var kernel, out var user) ? (kernel + user) * 100 : 0;
+        }
+
+        if (OperatingSystem.IsLinux())
+            return clock_gettime_linux(LinuxClockThreadCpuTimeId, out var linuxTime) == 0 ? linuxTime.Seconds * 1_000_000_000 + linuxTime.Nanoseconds : 0;
+
+        return clock_gettime(ClockThreadCpuTimeId, out var time) == 0 ? time.Seconds * 1_000_000_000 + time.Nanoseconds : 0;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct Timespec
+    {
+        public long Seconds;
+        public long Nanoseconds;
+    }
+
+    // CLOCK_THREAD_CPUTIME_ID in the macOS headers
+    private const int ClockThreadCpuTimeId = 16;
+
+    // CLOCK_THREAD_CPUTIME_ID in the Linux headers
+    private const int LinuxClockThreadCpuTimeId = 3;
+
+    [DllImport("kernel32.dll")]
+    private static extern IntPtr GetCurrentThread();
+
+    [DllImport("kernel32.dll")]
+    private static extern UIntPtr SetThreadAffinityMask(IntPtr thread, UIntPtr mask);
+
+    [DllImport("kernel32.dll")]
+    [return: MarshalAs(UnmanagedType.Bool)]
+    private static extern bool GetThreadTimes(IntPtr thread, out long creation, out long exit, out long kernel, out long user);
+
+    [DllImport("libSystem.dylib")]
+    private static extern int clock_gettime(int clockId, out Timespec time);
+
+    [DllImport("libc", EntryPoint = "clock_gettime")]
+    private static extern int clock_gettime_linux(int clockId, out Timespec time);
+}
+
+/// <summary>
+/// Socket stream handed to SocketsHttpHandler by our ConnectCallback, under TLS. Reads made from a
+/// <see cref="BusyPollLoop"/> thread spin on the socket and take waiting bytes with a non-blocking receive; every
+/// other read is a plain async receive. Either way it stamps when bytes last came off the socket, the start of the
+/// read-to-deliver latency the client reports in both modes.
+/// </summary>
+internal sealed class BusyPollStream : Stream
+{
+    private readonly Socket _socket;
+    private readonly NetworkStream _inner;
+    private long _lastReadTimestamp;
+
+    public BusyPollStream(Socket socket)
+    {
+        _socket = socket;
+        _inner = new NetworkStream(socket, ownsSocket: true);
+    }
+
+    /// <summary>
+    /// Stopwatch timestamp of the last read that returned bytes.
+    /// </summary>
+    public long LastReadTimestamp => Interlocked.Read(ref _lastReadTimestamp);
+
+    public override ValueTask<int> ReadAsync(Memory<byte> buffer, CancellationToken cancellationToken = default)
+    {
+        var loop = BusyPollLoop.CurrentLoop;
+        if (loop != null && loop.SpinForSocket(_socket))
+        {
+            var read = _socket.Receive(buffer.Span, SocketFlags.None);
+            Interlocked.Exchange(ref _lastReadTimestamp, Stopwatch.GetTimestamp());
+            return ValueTask.FromResult(read);
+        }
+
+        return ReadSlowAsync(buffer, cancellationToken);
+    }
+
+    private async ValueTask<int> ReadSlowAsync(Memory<byte> buffer, CancellationToken cancellationToken)
+    {
+        var read = await _inner.ReadAsync(buffer, cancellationToken).ConfigureAwait(false);
+        Interlocked.Exchange(ref _lastReadTimestamp, Stopwatch.GetTimestamp());
+        return read;
+    }
+
+    public override Task<int> ReadAsync(byte[] buffer, int offset, int count, CancellationToken cancellationToken)
+    {
+        return ReadAsync(buffer.AsMemory(offset, count), cancellationToken).AsTask();
+    }
+
+    public override int Read(byte[] buffer, int offset, int count)
+    {
+        var read = _inner.Read(buffer, offset, count);
+        Interlocked.Exchange(ref _lastReadTimestamp, Stopwatch.GetTimestamp());
+        return read;
+    }
+
+    public override ValueTask WriteAsync(ReadOnlyMemory<byte> buffer, CancellationToken cancellationToken = default)
+    {
+        return _inner.WriteAsync(buffer, cancellationToken);
+    }
+
+    public override Task WriteAsync(byte[] buffer, int offset, int count, CancellationToken cancellationToken)
+    {
+        return _inner.WriteAsync(buffer, offset, count, cancellationToken);
+    }
+
+    public override void Write(byte[] buffer, int offset, int count) => _inner.Write(buffer, offset, count);
+
+    public override void Flush() => _inner.Flush();
+
+    public override Task FlushAsync(CancellationToken cancellationToken) => _inner.FlushAsync(cancellationToken);
+
+    public override bool CanRead => true;
+    public override bool CanSeek => false;
+    public override bool CanWrite => true;
+    public override long Length => throw new NotSupportedException();
+
+    public override long Position
+    {
+        get => throw new NotSupportedException();
+        set => throw new NotSupportedException();
+    }
+
+    public override long Seek(long offset, SeekOrigin origin) => throw new NotSupportedException();
+
+    public override void SetLength(long value) => throw new NotSupportedException();
+
+    protected override void Dispose(bool disposing)
+    {
+        if (disposing)
+            _inner.Dispose();
+
+        base.Dispose(disposing);
+    }
+
+    public override ValueTask DisposeAsync()
+    {
+        return _inner.DisposeAsync();
+    }
+}
@@ -0,0 +1,52 @@
+using System.Runtime.InteropServices;
+
+namespace WebSocketClientNativeLibrary;
+
+/// <summary>
+/// Per-connection tuning passed with csharpWebSocketLibrary_connectWithOptions, laid out like WebSocketConnectOptions
+/// in the shims' WebSocketNativeLibrary.h. Zero selects the engine default for every field except TcpNoDelay (1 on,
+/// 0 off) and KeepAliveIntervalMs, where -1 keeps the current interval (0 turns keepalive off).
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct ConnectOptions
+{
+    public int ConnectTimeoutMs;
+    public int AttemptDelayMs;
+    public int DnsTimeoutMs;
+    public int TcpNoDelay;
+    public int SendBufferSize;
+    public int ReceiveBufferSize;
+    public int InitialReceiveBufferSize;
+    public int KeepAliveIntervalMs;
+    public int MaxMessageSize;
+
+    public const int DefaultConnectTimeoutMs = 10_000;
+    public const int DefaultAttemptDelayMs = 250;
+    public const int DefaultDnsTimeoutMs = 250;
+    public const int DefaultInitialReceiveBufferSize = 1024;
+
+    public static ConnectOptions Default => new()
+    {
+        TcpNoDelay = 1,
+        KeepAliveIntervalMs = -1
+    };
+
+    /// <summary>
+    /// Copy with every "engine default" field replaced by the value it stands for, and negative sizes treated as unset.
+    /// </summary>
+    public readonly ConnectOptions Resolve()
+    {
+        return new ConnectOptions
+        {
+            ConnectTimeoutMs = ConnectTimeoutMs > 0 ? ConnectTimeoutMs : DefaultConnectTimeoutMs,
+            AttemptDelayMs = AttemptDelayMs > 0 ? AttemptDelayMs : DefaultAttemptDelayMs,
+            DnsTimeoutMs = DnsTimeoutMs > 0 ? DnsTimeoutMs : DefaultDnsTimeoutMs,
+            TcpNoDelay = TcpNoDelay != 0 ? 1 : 0,
+            SendBufferSize = SendBufferSize > 0 ? SendBufferSize : 0,
+            ReceiveBufferSize = ReceiveBufferSize > 0 ? ReceiveBufferSize : 0,
+            InitialReceiveBufferSize = InitialReceiveBufferSize > 0 ? InitialReceiveBufferSize : DefaultInitialReceiveBufferSize,
+            KeepAliveIntervalMs = KeepAliveIntervalMs >= 0 ? KeepAliveIntervalMs : -1,
+            MaxMessageSize = MaxMessageSize > 0 ? MaxMessageSize : 0
+        };
+    }
+}
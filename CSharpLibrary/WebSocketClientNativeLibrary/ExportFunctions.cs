@@ -1,5 +1,7 @@
 ﻿using System;
 using System.Collections.Concurrent;
+using System.Diagnostics;
+using System.Net.WebSockets;
 using System.Runtime.CompilerServices;
 using System.Runtime.InteropServices;
 using System.Text;
@@ -12,7 +14,7 @@ public static class ExportFunctions
     private delegate void CallBackConnectPointer(IntPtr contextPointer);
 
     [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
-    private delegate void CallBackReceivedMessagePointer(IntPtr contextPointer, IntPtr pointerArray, int length);
+    private delegate void CallBackReceivedMessagePointer(IntPtr contextPointer, IntPtr pointerArray, int length, int messageType, long receivedAgeNanos);
 
     [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
     private delegate void CallBackIoErrorPointer(IntPtr contextPointer, int closeCode, IntPtr pointerMessage);
@@ -20,15 +22,19 @@ public static class ExportFunctions
     [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
     private delegate void CallBackLogPointer(IntPtr pointerMessage);
 
+    [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+    private delegate void CallBackStatusPointer(IntPtr contextPointer, IntPtr pointerCode, IntPtr pointerLevel);
+
     private static CallBackConnectPointer _callbackConnect;
     private static CallBackReceivedMessagePointer _callbackReceivedMessage;
     private static CallBackIoErrorPointer _callbackIoError;
     private static CallBackLogPointer _callbackLog;
+    private static CallBackStatusPointer _callbackStatus;
 
     private static ConcurrentDictionary<Guid, WebSocketClient> _clients = new();
 
     [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_initializerCallbacks", CallConvs = [typeof(CallConvCdecl)])]
-    public static int InitializerCallbacks(IntPtr pointerCallBackConnect, IntPtr pointerCallBackReceivedMessage, IntPtr pointerCallBackIoError, IntPtr pointerCallBackLog)
+    public static int InitializerCallbacks(IntPtr pointerCallBackConnect, IntPtr pointerCallBackReceivedMessage, IntPtr pointerCallBackIoError, IntPtr pointerCallBackLog, IntPtr pointerCallBackStatus)
     {
         var result = -1;
         try
@@ -37,6 +43,7 @@ public static class ExportFunctions
             _callbackReceivedMessage = Marshal.GetDelegateForFunctionPointer<CallBackReceivedMessagePointer>(pointerCallBackReceivedMessage);
             _callbackIoError = Marshal.GetDelegateForFunctionPointer<CallBackIoErrorPointer>(pointerCallBackIoError);
             _callbackLog = Marshal.GetDelegateForFunctionPointer<CallBackLogPointer>(pointerCallBackLog);
+            _callbackStatus = Marshal.GetDelegateForFunctionPointer<CallBackStatusPointer>(pointerCallBackStatus);
             result = 1;
         }
         catch (Exception e)
@@ -47,6 +54,18 @@ public static class ExportFunctions
         return result;
     }
 
+    // The receive buffer is pinned for the duration of the call instead of copied into native memory; the shim copies
+    // the bytes into its own queue before returning. messageType is 1 for text messages, 0 for binary. The receive
+    // stamp crosses over as an age rather than a timestamp, so the shim can rebase it onto its own monotonic clock
+    private static unsafe void DeliverReceivedMessage(IntPtr freContext, ArraySegment<byte> data, WebSocketMessageType messageType, long receivedAt)
+    {
+        var receivedAgeNanos = (long)((Stopwatch.GetTimestamp() - receivedAt) * (1_000_000_000.0 / Stopwatch.Frequency));
+        fixed (byte* pointer = data.AsSpan())
+        {
+            _callbackReceivedMessage(freContext, (IntPtr)pointer, data.Count, messageType == WebSocketMessageType.Text ? 1 : 0, receivedAgeNanos);
+        }
+    }
+
     [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_createWebSocketClient", CallConvs = [typeof(CallConvCdecl)])]
     public static IntPtr CreateWebSocketClient(IntPtr freContext)
     {
@@ -54,14 +73,7 @@ public static class ExportFunctions
         var guidPointer = Marshal.StringToCoTaskMemAnsi(guid.ToString());
         var client = new WebSocketClient(
             () => SafeInvoke(() => _callbackConnect(freContext)),
-            data =>
-                SafeInvoke(() =>
-                {
-                    var ptr = Marshal.AllocCoTaskMem(data.Count);
-                    Marshal.Copy(data.Array!, data.Offset, ptr, data.Count);
-                    _callbackReceivedMessage(freContext, ptr, data.Count);
-                    Marshal.FreeCoTaskMem(ptr);
-                }),
+            (data, messageType, receivedAt) => SafeInvoke(() => DeliverReceivedMessage(freContext, data, messageType, receivedAt)),
             (closeCode, error) =>
                 SafeInvoke(() =>
                 {
@@ -75,13 +87,53 @@ public static class ExportFunctions
                     var ptr = Marshal.StringToCoTaskMemAnsi(log);
                     _callbackLog(ptr);
                     Marshal.FreeCoTaskMem(ptr);
+                }),
+            (code, level) =>
+                SafeInvoke(() =>
+                {
+                    var codePtr = Marshal.StringToCoTaskMemAnsi(code);
+                    var levelPtr = Marshal.StringToCoTaskMemAnsi(level);
+                    _callbackStatus(freContext, codePtr, levelPtr);
+                    Marshal.FreeCoTaskMem(codePtr);
+                    Marshal.FreeCoTaskMem(levelPtr);
                 })
         );
 
         _clients.TryAdd(guid, client);
+        MemoryLedger.ClientCreated();
         return guidPointer;
     }
 
+    /// <summary>
+    /// Counterpart of createWebSocketClient: disposes the client, which silences its callbacks, forgets it and frees
+    /// the guid string handed out at creation. The native side must not use guidPointer afterwards.
+    /// </summary>
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_destroyWebSocketClient", CallConvs = [typeof(CallConvCdecl)])]
+    public static int DestroyWebSocketClient(IntPtr guidPointer)
+    {
+        try
+        {
+            var guidString = Marshal.PtrToStringAnsi(guidPointer);
+            if (!Guid.TryParse(guidString, out var guid) || !_clients.TryRemove(guid, out var client))
+            {
+                return 0;
+            }
+
+            client.Dispose();
+            MemoryLedger.ClientDestroyed();
+            return 1;
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+        finally
+        {
+            Marshal.FreeCoTaskMem(guidPointer);
+        }
+    }
+
     [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_connect", CallConvs = [typeof(CallConvCdecl)])]
     public static int Connect(IntPtr guidPointer, IntPtr pointerUri)
     {
@@ -109,8 +161,57 @@ public static class ExportFunctions
         }
     }
 
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_connectWithOptions", CallConvs = [typeof(CallConvCdecl)])]
+    public static int ConnectWithOptions(IntPtr guidPointer, IntPtr pointerUri, IntPtr optionsPointer)
+    {
+        try
+        {
+            if (!TryGetClient(guidPointer, out var client))
+            {
+                return 0;
+            }
+
+            var uri = Marshal.PtrToStringAnsi(pointerUri);
+            if (optionsPointer == IntPtr.Zero)
+            {
+                client.Connect(uri);
+            }
+            else
+            {
+                client.Connect(uri, Marshal.PtrToStructure<ConnectOptions>(optionsPointer));
+            }
+
+            return 1;
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+    }
+
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_connectShared", CallConvs = [typeof(CallConvCdecl)])]
+    public static int ConnectShared(IntPtr guidPointer, IntPtr pointerUri)
+    {
+        try
+        {
+            if (!TryGetClient(guidPointer, out var client))
+            {
+                return 0;
+            }
+
+            client.ConnectShared(Marshal.PtrToStringAnsi(pointerUri));
+            return 1;
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+    }
+
     [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_sendMessage", CallConvs = [typeof(CallConvCdecl)])]
-    public static int SendMessage(IntPtr guidPointer, IntPtr pointerData, int length)
+    public static int SendMessage(IntPtr guidPointer, IntPtr pointerData, int length, int lane)
     {
         try
         {
@@ -127,8 +228,27 @@ public static class ExportFunctions
 
             var data = new byte[length];
             Marshal.Copy(pointerData, data, 0, length);
-            client.Send(data);
-            return 1;
+            return client.Send(data, lane) ? 1 : 0;
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+    }
+
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_sendMessages", CallConvs = [typeof(CallConvCdecl)])]
+    public static unsafe int SendMessages(IntPtr guidPointer, IntPtr pointerData, int length, int lane)
+    {
+        try
+        {
+            if (!TryGetClient(guidPointer, out var client))
+            {
+                return 0;
+            }
+
+            // Framed straight from the caller's buffer, no intermediate managed copy of the records
+            return client.SendBatch(new ReadOnlySpan<byte>((void*)pointerData, length), lane);
         }
         catch (Exception e)
         {
@@ -154,7 +274,6 @@ public static class ExportFunctions
             }
 
             client.Disconnect(closeCode);
-            client.Dispose();
             return 1;
         }
         catch (Exception e)
@@ -164,6 +283,200 @@ public static class ExportFunctions
         }
     }
 
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_getBufferedAmount", CallConvs = [typeof(CallConvCdecl)])]
+    public static long GetBufferedAmount(IntPtr guidPointer)
+    {
+        try
+        {
+            var guidString = Marshal.PtrToStringAnsi(guidPointer);
+            if (!Guid.TryParse(guidString, out var guid))
+            {
+                return 0;
+            }
+
+            if (!_clients.TryGetValue(guid, out var client))
+            {
+                return 0;
+            }
+
+            return client.BufferedAmount;
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+    }
+
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_setSendWatermarks", CallConvs = [typeof(CallConvCdecl)])]
+    public static int SetSendWatermarks(IntPtr guidPointer, long lowWatermark, long highWatermark)
+    {
+        try
+        {
+            var guidString = Marshal.PtrToStringAnsi(guidPointer);
+            if (!Guid.TryParse(guidString, out var guid))
+            {
+                return 0;
+            }
+
+            if (!_clients.TryGetValue(guid, out var client))
+            {
+                return 0;
+            }
+
+            client.SetSendWatermarks(lowWatermark, highWatermark);
+            return 1;
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+    }
+
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_setReceivePaused", CallConvs = [typeof(CallConvCdecl)])]
+    public static int SetReceivePaused(IntPtr guidPointer, int paused)
+    {
+        try
+        {
+            var guidString = Marshal.PtrToStringAnsi(guidPointer);
+            if (!Guid.TryParse(guidString, out var guid))
+            {
+                return 0;
+            }
+
+            if (!_clients.TryGetValue(guid, out var client))
+            {
+                return 0;
+            }
+
+            client.SetReceivePaused(paused != 0);
+            return 1;
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+    }
+
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_setFragmentSize", CallConvs = [typeof(CallConvCdecl)])]
+    public static int SetFragmentSize(IntPtr guidPointer, int fragmentSize)
+    {
+        try
+        {
+            if (!TryGetClient(guidPointer, out var client))
+            {
+                return 0;
+            }
+
+            client.SetFragmentSize(fragmentSize);
+            return 1;
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+    }
+
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_getSendLaneStats", CallConvs = [typeof(CallConvCdecl)])]
+    public static int GetSendLaneStats(IntPtr guidPointer, IntPtr buffer, int bufferLength)
+    {
+        try
+        {
+            if (!TryGetClient(guidPointer, out var client))
+            {
+                return 0;
+            }
+
+            return CopyToBuffer(client.GetSendLaneStats(), buffer, bufferLength);
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+    }
+
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_setKeepAlive", CallConvs = [typeof(CallConvCdecl)])]
+    public static int SetKeepAlive(IntPtr guidPointer, int intervalMs, int timeoutMs, int statusIntervalMs)
+    {
+        try
+        {
+            if (!TryGetClient(guidPointer, out var client))
+            {
+                return 0;
+            }
+
+            client.SetKeepAlive(intervalMs, timeoutMs, statusIntervalMs);
+            return 1;
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+    }
+
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_getRttStats", CallConvs = [typeof(CallConvCdecl)])]
+    public static int GetRttStats(IntPtr guidPointer, IntPtr buffer, int bufferLength)
+    {
+        try
+        {
+            if (!TryGetClient(guidPointer, out var client))
+            {
+                return 0;
+            }
+
+            return CopyToBuffer(client.GetRttStats(), buffer, bufferLength);
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+    }
+
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_setBusyPoll", CallConvs = [typeof(CallConvCdecl)])]
+    public static int SetBusyPoll(IntPtr guidPointer, int spinMicros, int core)
+    {
+        try
+        {
+            if (!TryGetClient(guidPointer, out var client))
+            {
+                return 0;
+            }
+
+            client.SetBusyPoll(spinMicros, core);
+            return 1;
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+    }
+
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_getIoStats", CallConvs = [typeof(CallConvCdecl)])]
+    public static int GetIoStats(IntPtr guidPointer, IntPtr buffer, int bufferLength)
+    {
+        try
+        {
+            if (!TryGetClient(guidPointer, out var client))
+            {
+                return 0;
+            }
+
+            return CopyToBuffer(client.GetIoStats(), buffer, bufferLength);
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+    }
+
     [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_addStaticHost", CallConvs = [typeof(CallConvCdecl)])]
     public static void AddStaticHost(IntPtr hostPtr, IntPtr ipPtr)
     {
@@ -195,6 +508,133 @@ public static class ExportFunctions
         }
     }
 
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_addHostHint", CallConvs = [typeof(CallConvCdecl)])]
+    public static void AddHostHint(IntPtr hostPtr)
+    {
+        try
+        {
+            var host = Marshal.PtrToStringAnsi(hostPtr);
+
+            WebSocketClient.AddHostHint(host);
+        }
+        catch
+        {
+            // ignored
+        }
+    }
+
+    // Blocks the calling thread, which the shim starts for this, until the warm-up is done
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_warmUp", CallConvs = [typeof(CallConvCdecl)])]
+    public static int WarmUp()
+    {
+        try
+        {
+            WebSocketClient.WarmUpAsync().GetAwaiter().GetResult();
+            return 1;
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+    }
+
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_getStartupTimings", CallConvs = [typeof(CallConvCdecl)])]
+    public static int GetStartupTimings(IntPtr buffer, int bufferLength)
+    {
+        try
+        {
+            return CopyToBuffer(WebSocketClient.GetStartupTimings(), buffer, bufferLength);
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+    }
+
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_getMemoryStats", CallConvs = [typeof(CallConvCdecl)])]
+    public static int GetMemoryStats(IntPtr buffer, int bufferLength)
+    {
+        try
+        {
+            return CopyToBuffer(MemoryLedger.GetStats(), buffer, bufferLength);
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+    }
+
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_setNetworkImpairment", CallConvs = [typeof(CallConvCdecl)])]
+    public static int SetNetworkImpairment(IntPtr configPtr)
+    {
+        try
+        {
+            NetworkImpairment.Configure(Marshal.PtrToStringUTF8(configPtr));
+            return 1;
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+    }
+
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_getNetworkImpairmentStats", CallConvs = [typeof(CallConvCdecl)])]
+    public static int GetNetworkImpairmentStats(IntPtr buffer, int bufferLength)
+    {
+        try
+        {
+            return CopyToBuffer(NetworkImpairment.GetStats(), buffer, bufferLength);
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+    }
+
+    [UnmanagedCallersOnly(EntryPoint = "csharpWebSocketLibrary_getTraceEvents", CallConvs = [typeof(CallConvCdecl)])]
+    public static int GetTraceEvents(double nowMicros, IntPtr buffer, int bufferLength)
+    {
+        try
+        {
+            return CopyToBuffer(Tracing.GetEvents(nowMicros), buffer, bufferLength);
+        }
+        catch (Exception e)
+        {
+            LogException(e);
+            return 0;
+        }
+    }
+
+    private static bool TryGetClient(IntPtr guidPointer, out WebSocketClient client)
+    {
+        client = null;
+        var guidString = Marshal.PtrToStringAnsi(guidPointer);
+        return Guid.TryParse(guidString, out var guid) && _clients.TryGetValue(guid, out client);
+    }
+
+    /// <summary>
+    /// Writes value as a NUL-terminated UTF-8 string into a caller-owned buffer. Returns the size the buffer needs
+    /// (terminator included); when that is larger than bufferLength nothing is written and the caller retries.
+    /// </summary>
+    private static unsafe int CopyToBuffer(string value, IntPtr buffer, int bufferLength)
+    {
+        var required = Encoding.UTF8.GetByteCount(value) + 1;
+        if (buffer == IntPtr.Zero || bufferLength < required)
+        {
+            return required;
+        }
+
+        var span = new Span<byte>((void*)buffer, bufferLength);
+        var written = Encoding.UTF8.GetBytes(value, span);
+        span[written] = 0;
+        return required;
+    }
+
     private static void SafeInvoke(Action action)
     {
         try
@@ -0,0 +1,112 @@
+using System;
+using System.Diagnostics;
+using System.Globalization;
+using System.Numerics;
+using System.Text;
+using System.Threading;
+
+namespace WebSocketClientNativeLibrary;
+
+/// <summary>
+/// Lock-free log-linear histogram of durations in microseconds (8 sub-buckets per power of two, ~12% resolution).
+/// Recording is a couple of interlocked increments, so it can sit on the send/receive hot paths.
+/// </summary>
+public class LatencyHistogram
+{
+    private const int SubBucketBits = 3;
+    private const int SubBuckets = 1 << SubBucketBits;
+    private const int LinearLimit = 2 * SubBuckets;
+    private const int BucketCount = LinearLimit + (64 - SubBucketBits - 1) * SubBuckets;
+
+    private readonly long[] _buckets = new long[BucketCount];
+    private long _count;
+    private long _sum;
+    private long _max;
+
+    public long Count => Interlocked.Read(ref _count);
+
+    public void RecordTicks(long stopwatchTicks)
+    {
+        Record(stopwatchTicks * 1_000_000 / Stopwatch.Frequency);
+    }
+
+    public void Record(long micros)
+    {
+        if (micros < 0)
+            micros = 0;
+
+        Interlocked.Increment(ref _buckets[BucketIndex(micros)]);
+        Interlocked.Increment(ref _count);
+        Interlocked.Add(ref _sum, micros);
+
+        long max;
+        while (micros > (max = Interlocked.Read(ref _max)) && Interlocked.CompareExchange(ref _max, micros, max) != max)
+        {
+        }
+    }
+
+    /// <summary>
+    /// Upper bound, in microseconds, of the bucket holding the given percentile (0-100).
+    /// </summary>
+    public long Percentile(double percentile)
+    {
+        var count = Count;
+        if (count == 0)
+            return 0;
+
+        var target = (long)Math.Ceiling(count * percentile / 100.0);
+        if (target < 1)
+            target = 1;
+
+        long seen = 0;
+        for (var i = 0; i < BucketCount; i++)
+        {
+            seen += Interlocked.Read(ref _buckets[i]);
+            if (seen >= target)
+                return Math.Min(BucketUpperBound(i), Interlocked.Read(ref _max));
+        }
+
+        return Interlocked.Read(ref _max);
+    }
+
+    public void Reset()
+    {
+        for (var i = 0; i < BucketCount; i++)
+            Interlocked.Exchange(ref _buckets[i], 0);
+        Interlocked.Exchange(ref _count, 0);
+        Interlocked.Exchange(ref _sum, 0);
+        Interlocked.Exchange(ref _max, 0);
+    }
+
+    /// <summary>
+    /// Appends {"count":..,"mean":..,"p50":..,"p90":..,"p99":..,"p999":..,"max":..} (microseconds).
+    /// </summary>
+    public void AppendJson(StringBuilder builder)
+    {
+        var count = Count;
+        var mean = count == 0 ? 0 : Interlocked.Read(ref _sum) / count;
+        builder.Append(CultureInfo.InvariantCulture,
+            $"{{\"count\":{count},\"mean\":{mean},\"p50\":{Percentile(50)},\"p90\":{Percentile(90)},\"p99\":{Percentile(99)},\"p999\":{Percentile(99.9)},\"max\":{Interlocked.Read(ref _max)}}}");
+    }
+
+    private static int BucketIndex(long value)
+    {
+        if (value < LinearLimit)
+            return (int)value;
+
+        var exponent = 63 - BitOperations.LeadingZeroCount((ulong)value);
+        var subBucket = (int)(value >> (exponent - SubBucketBits)) & (SubBuckets - 1);
+        return LinearLimit + (exponent - SubBucketBits - 1) * SubBuckets + subBucket;
+    }
+
+    private static long BucketUpperBound(int index)
+    {
+        if (index < LinearLimit)
+            return index;
+
+        var exponent = (index - LinearLimit) / SubBuckets + SubBucketBits + 1;
+        var subBucket = (index - LinearLimit) % SubBuckets;
+        var lower = (1L << exponent) + ((long)subBucket << (exponent - SubBucketBits));
+        return lower + (1L << (exponent - SubBucketBits)) - 1;
+    }
+}
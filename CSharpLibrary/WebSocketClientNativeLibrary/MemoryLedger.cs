@@ -0,0 +1,63 @@
+using System;
+using System.Globalization;
+using System.Threading;
+
+namespace WebSocketClientNativeLibrary;
+
+/// <summary>
+/// Process-wide counts of what the engine holds on behalf of the native side, so a leak across connect/close cycles
+/// shows up as a number that keeps growing: clients created and not yet destroyed, sockets not yet released, bytes
+/// waiting in send queues and receive buffers rented from the shared pool.
+/// </summary>
+public static class MemoryLedger
+{
+    private static long _liveClients;
+    private static long _clientsCreated;
+    private static long _liveConnections;
+    private static long _connectionsOpened;
+    private static long _sendQueueBytes;
+    private static long _rentedReceiveBuffers;
+    private static long _rentedReceiveBytes;
+
+    public static void ClientCreated()
+    {
+        Interlocked.Increment(ref _liveClients);
+        Interlocked.Increment(ref _clientsCreated);
+    }
+
+    public static void ClientDestroyed() => Interlocked.Decrement(ref _liveClients);
+
+    public static void ConnectionOpened()
+    {
+        Interlocked.Increment(ref _liveConnections);
+        Interlocked.Increment(ref _connectionsOpened);
+    }
+
+    public static void ConnectionReleased() => Interlocked.Decrement(ref _liveConnections);
+
+    public static void AddSendQueueBytes(long bytes) => Interlocked.Add(ref _sendQueueBytes, bytes);
+
+    public static void ReceiveBufferRented(int length)
+    {
+        Interlocked.Increment(ref _rentedReceiveBuffers);
+        Interlocked.Add(ref _rentedReceiveBytes, length);
+    }
+
+    public static void ReceiveBufferReturned(int length)
+    {
+        Interlocked.Decrement(ref _rentedReceiveBuffers);
+        Interlocked.Add(ref _rentedReceiveBytes, -length);
+    }
+
+    /// <summary>
+    /// JSON object of the counters plus the managed heap size, which should level off once the counters do.
+    /// </summary>
+    public static string GetStats()
+    {
+        return string.Create(CultureInfo.InvariantCulture,
+            $"{{\"liveClients\":{Interlocked.Read(ref _liveClients)},\"clientsCreated\":{Interlocked.Read(ref _clientsCreated)}," +
+            $"\"liveConnections\":{Interlocked.Read(ref _liveConnections)},\"connectionsOpened\":{Interlocked.Read(ref _connectionsOpened)}," +
+            $"\"sendQueueBytes\":{Interlocked.Read(ref _sendQueueBytes)},\"receiveBuffers\":{Interlocked.Read(ref _rentedReceiveBuffers)}," +
+            $"\"receiveBufferBytes\":{Interlocked.Read(ref _rentedReceiveBytes)},\"managedHeapBytes\":{GC.GetTotalMemory(false)}}}");
+    }
+}
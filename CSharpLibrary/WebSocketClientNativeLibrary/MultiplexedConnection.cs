@@ -0,0 +1,430 @@
+using System;
+using System.Buffers.Binary;
+using System.Collections.Generic;
+using System.Net.WebSockets;
+
+namespace WebSocketClientNativeLibrary;
+
+/// <summary>
+/// One physical WebSocket shared by several engine clients (one per AS3 ExtensionContext) connected with ConnectShared
+/// to the same URI. Every message is a binary frame starting with the logical channel id as a big-endian uint16. Data
+/// messages follow it with the channel message's type, <see cref="TypeBinary"/> or <see cref="TypeText"/>, then the
+/// payload; channel 0 carries control messages [0x0000][op][channel uint16], op <see cref="OpOpen"/> or
+/// <see cref="OpClose"/>, in both directions. MultiplexDemuxServer is the reference server side.
+/// <para>
+/// Sends wait in per-channel queues and are handed to the physical socket by deficit round robin, one quantum of bytes
+/// per channel per turn, and only while the socket's own send queue is under its high watermark, so a bulk upload on
+/// one channel cannot starve the others. Control-lane messages skip the round robin. Received messages go straight to
+/// the channel's own receive queue in the shim; a channel pausing receive pauses the shared socket.
+/// </para>
+/// </summary>
+public sealed class MultiplexedConnection
+{
+    public const byte OpOpen = 1;
+    public const byte OpClose = 2;
+    public const byte TypeBinary = 0;
+    public const byte TypeText = 1;
+
+    // [channel uint16][type] in front of every data message
+    private const int HeaderLength = 3;
+
+    private const int Quantum = 16 * 1024;
+    private const int PhysicalLowWatermark = 16 * 1024;
+    private const int PhysicalHighWatermark = 64 * 1024;
+
+    private static readonly Dictionary<string, MultiplexedConnection> Connections = new();
+
+    private readonly record struct PendingFrame(byte[] Frame, int Lane);
+
+    private sealed class Channel
+    {
+        public WebSocketClient Client;
+        public readonly Queue<PendingFrame> Urgent = new();
+        public readonly Queue<PendingFrame> Pending = new();
+        public int Deficit;
+        public bool Paused;
+    }
+
+    private readonly string _uri;
+    private readonly object _lock = new();
+    private readonly Dictionary<ushort, Channel> _channels = new();
+    private readonly List<ushort> _order = new();
+    private readonly Queue<byte[]> _control = new();
+    private int _next;
+    // Channel whose round-robin turn is in progress, already credited with its quantum; 0 between turns
+    private ushort _turn;
+    private ushort _lastChannelId;
+    private bool _open;
+    private bool _closed;
+
+    public WebSocketClient Physical { get; }
+
+    private MultiplexedConnection(string uri)
+    {
+        _uri = uri;
+        Physical = new WebSocketClient(OnPhysicalConnect, OnPhysicalReceived, OnPhysicalIoError, OnPhysicalLog, OnPhysicalStatus);
+        Physical.SetSendWatermarks(PhysicalLowWatermark, PhysicalHighWatermark);
+    }
+
+    /// <summary>
+    /// Binds client to the shared connection for uri, opening it when this is the first channel, and returns the
+    /// channel id. The client's connect callback runs once the physical socket is open.
+    /// </summary>
+    public static MultiplexedConnection Join(string uri, WebSocketClient client, out ushort channelId)
+    {
+        MultiplexedConnection connection;
+        bool created;
+        bool open;
+        lock (Connections)
+        {
+            // A connection that failed but has not yet unregistered itself takes no channels; it is replaced
+            created = false;
+            if (!Connections.TryGetValue(uri, out connection) || !connection.TryAddChannel(client, out channelId, out open))
+            {
+                connection = new MultiplexedConnection(uri);
+                Connections[uri] = connection;
+                connection.TryAddChannel(client, out channelId, out open);
+                created = true;
+            }
+        }
+
+        if (created)
+        {
+            connection.Physical.Connect(uri);
+        }
+        else if (open)
+        {
+            client.OnSharedConnected();
+        }
+
+        return connection;
+    }
+
+    // open tells whether the physical socket was already open, otherwise the channel is announced once it opens; false
+    // when the physical socket has already failed
+    private bool TryAddChannel(WebSocketClient client, out ushort channelId, out bool open)
+    {
+        lock (_lock)
+        {
+            if (_closed)
+            {
+                channelId = 0;
+                open = false;
+                return false;
+            }
+
+            do
+            {
+                _lastChannelId = (ushort)(_lastChannelId == ushort.MaxValue ? 1 : _lastChannelId + 1);
+            } while (_channels.ContainsKey(_lastChannelId));
+
+            channelId = _lastChannelId;
+            _channels[channelId] = new Channel { Client = client };
+            _order.Add(channelId);
+            open = _open;
+            if (_open)
+            {
+                _control.Enqueue(ControlFrame(OpOpen, channelId));
+                Pump();
+            }
+
+            return true;
+        }
+    }
+
+    /// <summary>
+    /// Queues data on channel; false when the channel is gone. Send watermarks are enforced by the caller per channel.
+    /// </summary>
+    public bool Send(ushort channelId, ReadOnlySpan<byte> data, int lane)
+    {
+        // The engine only sends binary messages
+        var frame = new byte[data.Length + HeaderLength];
+        BinaryPrimitives.WriteUInt16BigEndian(frame, channelId);
+        frame[2] = TypeBinary;
+        data.CopyTo(frame.AsSpan(HeaderLength));
+
+        lock (_lock)
+        {
+            if (!_channels.TryGetValue(channelId, out var channel))
+                return false;
+
+            (lane == 0 ? channel.Urgent : channel.Pending).Enqueue(new PendingFrame(frame, lane));
+
+            Pump();
+            return true;
+        }
+    }
+
+    /// <summary>
+    /// Removes channel, telling the server, and closes the physical socket with the last channel.
+    /// </summary>
+    public void Leave(ushort channelId, int closeCode)
+    {
+        bool last;
+        lock (_lock)
+        {
+            if (!_channels.Remove(channelId))
+                return;
+
+            _order.Remove(channelId);
+            UpdateReceivePausedLocked();
+            last = _channels.Count == 0;
+            if (!last && _open)
+            {
+                _control.Enqueue(ControlFrame(OpClose, channelId));
+                Pump();
+            }
+        }
+
+        if (last)
+        {
+            lock (Connections)
+            {
+                if (Connections.TryGetValue(_uri, out var current) && current == this)
+                    Connections.Remove(_uri);
+            }
+
+            Physical.Disconnect(closeCode);
+        }
+    }
+
+    public void SetChannelPaused(ushort channelId, bool paused)
+    {
+        lock (_lock)
+        {
+            if (_channels.TryGetValue(channelId, out var channel))
+            {
+                channel.Paused = paused;
+                UpdateReceivePausedLocked();
+            }
+        }
+    }
+
+    private void UpdateReceivePausedLocked()
+    {
+        var anyPaused = false;
+        foreach (var channel in _channels.Values)
+            anyPaused |= channel.Paused;
+
+        Physical.SetReceivePaused(anyPaused);
+    }
+
+    // Moves queued frames into the physical send queue while it is under its high watermark: control messages, then
+    // every channel's control-lane messages, then the other lanes round robin. Its "drain" status resumes the pump
+    private void Pump()
+    {
+        if (!_open)
+            return;
+
+        while (_control.TryPeek(out var control))
+        {
+            if (!TrySendPhysical(control, 0))
+                return;
+
+            _control.Dequeue();
+        }
+
+        foreach (var channelId in _order)
+        {
+            var channel = _channels[channelId];
+            while (channel.Urgent.TryPeek(out var urgent))
+            {
+                if (!TrySendPhysical(urgent.Frame, urgent.Lane))
+                    return;
+
+                channel.Urgent.Dequeue();
+                channel.Client.OnSharedSent(urgent.Frame.Length - HeaderLength);
+            }
+        }
+
+        var idle = 0;
+        while (_order.Count > 0 && idle < _order.Count)
+        {
+            _next %= _order.Count;
+            var channelId = _order[_next];
+            var channel = _channels[channelId];
+            if (channel.Pending.Count == 0)
+            {
+                channel.Deficit = 0;
+                _turn = 0;
+                idle++;
+                _next++;
+                continue;
+            }
+
+            idle = 0;
+
+            // A turn starts, and earns its quantum, only once the socket takes data; a turn cut short by a full socket
+            // resumes with what is left, so pumping against a full socket cannot pile up credit
+            if (_turn != channelId)
+            {
+                if (!CanSendPhysical())
+                    return;
+
+                channel.Deficit += Quantum;
+                _turn = channelId;
+            }
+
+            while (channel.Pending.TryPeek(out var pending) && pending.Frame.Length <= channel.Deficit)
+            {
+                if (!TrySendPhysical(pending.Frame, pending.Lane))
+                    return;
+
+                channel.Pending.Dequeue();
+                channel.Deficit -= pending.Frame.Length;
+                channel.Client.OnSharedSent(pending.Frame.Length - HeaderLength);
+            }
+
+            if (channel.Pending.Count == 0)
+                channel.Deficit = 0;
+
+            _turn = 0;
+            _next++;
+        }
+    }
+
+    private bool CanSendPhysical() => Physical.BufferedAmount < PhysicalHighWatermark;
+
+    private bool TrySendPhysical(byte[] frame, int lane)
+    {
+        return CanSendPhysical() && Physical.Send(frame, lane);
+    }
+
+    private static byte[] ControlFrame(byte op, ushort channelId)
+    {
+        var frame = new byte[5];
+        frame[2] = op;
+        BinaryPrimitives.WriteUInt16BigEndian(frame.AsSpan(3), channelId);
+        return frame;
+    }
+
+    private List<WebSocketClient> SnapshotClients()
+    {
+        var clients = new List<WebSocketClient>(_channels.Count);
+        foreach (var channel in _channels.Values)
+            clients.Add(channel.Client);
+        return clients;
+    }
+
+    private void OnPhysicalConnect()
+    {
+        List<WebSocketClient> clients;
+        lock (_lock)
+        {
+            _open = true;
+            foreach (var channelId in _order)
+                _control.Enqueue(ControlFrame(OpOpen, channelId));
+
+            clients = SnapshotClients();
+            Pump();
+        }
+
+        foreach (var client in clients)
+            client.OnSharedConnected();
+    }
+
+    private void OnPhysicalReceived(ArraySegment<byte> data, WebSocketMessageType messageType, long receivedAt)
+    {
+        if (data.Count < 2)
+            return;
+
+        var channelId = BinaryPrimitives.ReadUInt16BigEndian(data);
+        WebSocketClient client;
+        if (channelId == 0)
+        {
+            // The server closed a channel, e.g. because its upstream went away
+            if (data.Count < 5 || data[2] != OpClose)
+                return;
+
+            channelId = BinaryPrimitives.ReadUInt16BigEndian(data.AsSpan(3));
+            lock (_lock)
+            {
+                if (!_channels.Remove(channelId, out var closed))
+                    return;
+
+                _order.Remove(channelId);
+                UpdateReceivePausedLocked();
+                client = closed.Client;
+            }
+
+            client.OnSharedClosed((int)WebSocketCloseStatus.NormalClosure, "Channel closed by the server.");
+            return;
+        }
+
+        if (data.Count < HeaderLength)
+            return;
+
+        lock (_lock)
+        {
+            if (!_channels.TryGetValue(channelId, out var channel))
+                return;
+
+            client = channel.Client;
+        }
+
+        client.DeliverShared(data.Slice(HeaderLength), data[2] == TypeText ? WebSocketMessageType.Text : WebSocketMessageType.Binary, receivedAt);
+    }
+
+    private void OnPhysicalIoError(int closeCode, string reason)
+    {
+        List<WebSocketClient> clients;
+        lock (_lock)
+        {
+            if (_closed)
+                return;
+
+            _closed = true;
+            _open = false;
+            clients = SnapshotClients();
+            _channels.Clear();
+            _order.Clear();
+            _control.Clear();
+        }
+
+        lock (Connections)
+        {
+            if (Connections.TryGetValue(_uri, out var current) && current == this)
+                Connections.Remove(_uri);
+        }
+
+        foreach (var client in clients)
+            client.OnSharedClosed(closeCode, reason);
+    }
+
+    private void OnPhysicalLog(string message)
+    {
+        WebSocketClient client = null;
+        lock (_lock)
+        {
+            foreach (var channel in _channels.Values)
+            {
+                client = channel.Client;
+                break;
+            }
+        }
+
+        client?.LogShared($"[shared {_uri}] {message}");
+    }
+
+    private void OnPhysicalStatus(string code, string level)
+    {
+        if (code == "drain")
+        {
+            lock (_lock)
+            {
+                Pump();
+            }
+
+            return;
+        }
+
+        List<WebSocketClient> clients;
+        lock (_lock)
+        {
+            clients = SnapshotClients();
+        }
+
+        foreach (var client in clients)
+            client.OnSharedStatus(code, level);
+    }
+}
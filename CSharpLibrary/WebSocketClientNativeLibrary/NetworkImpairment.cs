@@ -0,0 +1,496 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Globalization;
+using System.IO;
+using System.Net;
+using System.Net.Sockets;
+using System.Text.Json;
+using System.Text.Json.Serialization;
+using System.Threading;
+using System.Threading.Channels;
+using System.Threading.Tasks;
+
+namespace WebSocketClientNativeLibrary;
+
+/// <summary>
+/// Network conditions applied to connections made to one address. Delays are one-way and apply to each direction.
+/// </summary>
+public sealed class ImpairmentProfile
+{
+    [JsonPropertyName("latencyMs")]
+    public int LatencyMs { get; set; }
+
+    // Uniform in [-jitterMs, +jitterMs] per segment; segments still arrive in order, as over TCP
+    [JsonPropertyName("jitterMs")]
+    public int JitterMs { get; set; }
+
+    // 0 leaves the direction uncapped
+    [JsonPropertyName("downlinkBytesPerSecond")]
+    public long DownlinkBytesPerSecond { get; set; }
+
+    [JsonPropertyName("uplinkBytesPerSecond")]
+    public long UplinkBytesPerSecond { get; set; }
+
+    // TCP hides loss behind retransmission, so a lost segment shows up as that segment, and everything behind it,
+    // arriving retransmitMs late
+    [JsonPropertyName("lossPercent")]
+    public double LossPercent { get; set; }
+
+    [JsonPropertyName("retransmitMs")]
+    public int RetransmitMs { get; set; } = 200;
+
+    // Like a radio stall: the link delivers nothing for stallMs
+    [JsonPropertyName("stallPercent")]
+    public double StallPercent { get; set; }
+
+    [JsonPropertyName("stallMs")]
+    public int StallMs { get; set; }
+
+    // The connection is reset (RST to the server, IOException to the client) once this many bytes crossed it in
+    // either direction, or this long after it opened; 0 never
+    [JsonPropertyName("resetAfterBytes")]
+    public long ResetAfterBytes { get; set; }
+
+    [JsonPropertyName("resetAfterMs")]
+    public int ResetAfterMs { get; set; }
+
+    // Connects never complete, as when SYNs are dropped; only the connect timeout ends them
+    [JsonPropertyName("blackhole")]
+    public bool Blackhole { get; set; }
+
+    // Received bytes held back by the impairment before it stops reading the socket, so the server still sees
+    // backpressure. Also the uplink's send buffer: a write returns once no more than this much is waiting for the link
+    [JsonPropertyName("windowBytes")]
+    public int WindowBytes { get; set; } = 256 * 1024;
+}
+
+public sealed class ImpairmentConfig
+{
+    // Makes the jitter, loss and stall draws repeat from run to run
+    [JsonPropertyName("seed")]
+    public int? Seed { get; set; }
+
+    [JsonPropertyName("default")]
+    public ImpairmentProfile Default { get; set; }
+
+    // By IP address as connected to, e.g. "127.0.0.2" or "::1"; takes precedence over default
+    [JsonPropertyName("addresses")]
+    public Dictionary<string, ImpairmentProfile> Addresses { get; set; }
+}
+
+[JsonSerializable(typeof(ImpairmentConfig))]
+internal partial class ImpairmentConfigContext : JsonSerializerContext
+{
+}
+
+/// <summary>
+/// Process-wide network impairment for testing and benchmarking against a local server, where loopback is otherwise
+/// perfect. Connections opened while a configuration is set run through an <see cref="ImpairedStream"/> under TLS.
+/// With a static host mapped to several loopback addresses (127.0.0.2 and up are loopback on Linux; macOS and Windows
+/// need them aliased) and per-address profiles, the parallel connect races slow and blackholed candidates.
+/// </summary>
+public static class NetworkImpairment
+{
+    private static volatile ImpairmentConfig _config;
+    private static readonly object RandomLock = new();
+    private static Random _random = new();
+    private static long _connections;
+    private static long _blackholed;
+    private static long _losses;
+    private static long _stalls;
+    private static long _resets;
+    private static long _bytesDown;
+    private static long _bytesUp;
+
+    /// <summary>
+    /// Replaces the configuration with json (see <see cref="ImpairmentConfig"/>) and zeroes the counters; null or empty
+    /// turns impairment off. Connections already open keep the profile they started with.
+    /// </summary>
+    public static void Configure(string json)
+    {
+        ImpairmentConfig config = null;
+        if (!string.IsNullOrWhiteSpace(json))
+        {
+            config = JsonSerializer.Deserialize(json, ImpairmentConfigContext.Default.ImpairmentConfig);
+            if (config?.Addresses != null)
+            {
+                var addresses = new Dictionary<string, ImpairmentProfile>();
+                foreach (var (address, profile) in config.Addresses)
+                    addresses[NormalizeAddress(address)] = profile;
+                config.Addresses = addresses;
+            }
+        }
+
+        lock (RandomLock)
+        {
+            _random = config?.Seed is { } seed ? new Random(seed) : new Random();
+        }
+
+        Interlocked.Exchange(ref _connections, 0);
+        Interlocked.Exchange(ref _blackholed, 0);
+        Interlocked.Exchange(ref _losses, 0);
+        Interlocked.Exchange(ref _stalls, 0);
+        Interlocked.Exchange(ref _resets, 0);
+        Interlocked.Exchange(ref _bytesDown, 0);
+        Interlocked.Exchange(ref _bytesUp, 0);
+        _config = config;
+    }
+
+    /// <summary>
+    /// Profile for a connection to host, or null when it goes through unimpaired.
+    /// </summary>
+    public static ImpairmentProfile ProfileFor(string host)
+    {
+        var config = _config;
+        if (config == null)
+            return null;
+
+        if (config.Addresses != null && config.Addresses.TryGetValue(NormalizeAddress(host), out var profile))
+            return profile;
+        return config.Default;
+    }
+
+    /// <summary>
+    /// Stands in for the TCP handshake: one round trip on top of the real connect, or forever for a blackholed address.
+    /// </summary>
+    public static async Task ConnectAsync(ImpairmentProfile profile, CancellationToken cancellationToken)
+    {
+        if (profile.Blackhole)
+        {
+            Interlocked.Increment(ref _blackholed);
+            await Task.Delay(Timeout.Infinite, cancellationToken).ConfigureAwait(false);
+        }
+
+        Interlocked.Increment(ref _connections);
+        var roundTripMs = 2 * profile.LatencyMs + (int)(2 * profile.JitterMs * NextDouble());
+        if (roundTripMs > 0)
+            await Task.Delay(roundTripMs, cancellationToken).ConfigureAwait(false);
+    }
+
+    /// <summary>
+    /// Counters since the last <see cref="Configure"/>, as JSON.
+    /// </summary>
+    public static string GetStats()
+    {
+        return string.Create(CultureInfo.InvariantCulture,
+            $"{{\"enabled\":{(_config != null ? "true" : "false")},\"connections\":{Interlocked.Read(ref _connections)}," +
+            $"\"blackholed\":{Interlocked.Read(ref _blackholed)},\"losses\":{Interlocked.Read(ref _losses)}," +
+            $"\"stalls\":{Interlocked.Read(ref _stalls)},\"resets\":{Interlocked.Read(ref _resets)}," +
+            $"\"bytesDown\":{Interlocked.Read(ref _bytesDown)},\"bytesUp\":{Interlocked.Read(ref _bytesUp)}}}");
+    }
+
+    internal static double NextDouble()
+    {
+        lock (RandomLock)
+        {
+            return _random.NextDouble();
+        }
+    }
+
+    internal static void CountLoss() => Interlocked.Increment(ref _losses);
+
+    internal static void CountStall() => Interlocked.Increment(ref _stalls);
+
+    internal static void CountReset() => Interlocked.Increment(ref _resets);
+
+    internal static void CountBytes(bool downlink, int bytes)
+    {
+        if (downlink)
+            Interlocked.Add(ref _bytesDown, bytes);
+        else
+            Interlocked.Add(ref _bytesUp, bytes);
+    }
+
+    private static string NormalizeAddress(string address)
+    {
+        var trimmed = address.Trim('[', ']');
+        return IPAddress.TryParse(trimmed, out var parsed) ? parsed.ToString() : trimmed;
+    }
+}
+
+/// <summary>
+/// Socket stream that delays, paces, stalls and resets the bytes crossing it according to an
+/// <see cref="ImpairmentProfile"/>. Each direction is a link that puts segments on the wire one after another at its
+/// bandwidth and delivers them latency (plus jitter, loss and stalls) later, in order. Like a socket's send buffer, a
+/// write returns once at most windowBytes are left waiting for the link, which is where a bandwidth cap becomes send
+/// backpressure.
+/// </summary>
+internal sealed class ImpairedStream : Stream
+{
+    private sealed class Link
+    {
+        public long FreeAt;      // Stopwatch timestamp when the link has put everything queued on the wire
+        public long LastArrival; // Arrival of the newest segment, which the next one may not overtake
+    }
+
+    private readonly record struct Segment(byte[] Data, long ArriveAt);
+
+    private readonly Stream _inner;
+    private readonly Socket _socket;
+    private readonly ImpairmentProfile _profile;
+    private readonly CancellationTokenSource _closed = new();
+    private readonly Channel<Segment> _downlink = Channel.CreateUnbounded<Segment>(new UnboundedChannelOptions { SingleReader = true, SingleWriter = true });
+    private readonly Channel<Segment> _uplink = Channel.CreateUnbounded<Segment>(new UnboundedChannelOptions { SingleReader = true, SingleWriter = true });
+    private readonly Link _downlinkState = new();
+    private readonly Link _uplinkState = new();
+    private readonly SemaphoreSlim _windowOpened = new(0);
+    private long _downlinkQueued;
+    private long _transferred;
+    private Segment _current;
+    private int _currentOffset;
+    private bool _hasCurrent;
+    private volatile Exception _broken;
+
+    public ImpairedStream(Stream inner, Socket socket, ImpairmentProfile profile)
+    {
+        _inner = inner;
+        _socket = socket;
+        _profile = profile;
+        _ = PumpDownlinkAsync();
+        _ = PumpUplinkAsync();
+        if (profile.ResetAfterMs > 0)
+            _ = ResetLaterAsync(profile.ResetAfterMs);
+    }
+
+    private (long SentAt, long ArriveAt) Schedule(Link link, int bytes, long bytesPerSecond)
+    {
+        var delayMs = _profile.LatencyMs + _profile.JitterMs * (2 * NetworkImpairment.NextDouble() - 1);
+        if (_profile.LossPercent > 0 && NetworkImpairment.NextDouble() * 100 < _profile.LossPercent)
+        {
+            NetworkImpairment.CountLoss();
+            delayMs += _profile.RetransmitMs;
+        }
+
+        if (_profile.StallPercent > 0 && NetworkImpairment.NextDouble() * 100 < _profile.StallPercent)
+        {
+            NetworkImpairment.CountStall();
+            delayMs += _profile.StallMs;
+        }
+
+        lock (link)
+        {
+            var sentAt = Math.Max(Stopwatch.GetTimestamp(), link.FreeAt);
+            if (bytesPerSecond > 0)
+                sentAt += bytes * Stopwatch.Frequency / bytesPerSecond;
+            link.FreeAt = sentAt;
+
+            var arriveAt = Math.Max(sentAt + (long)(Math.Max(delayMs, 0) * Stopwatch.Frequency / 1000), link.LastArrival);
+            link.LastArrival = arriveAt;
+            return (sentAt, arriveAt);
+        }
+    }
+
+    private static Task DelayUntilAsync(long timestamp, CancellationToken cancellationToken)
+    {
+        var remaining = Stopwatch.GetElapsedTime(Stopwatch.GetTimestamp(), timestamp);
+        return remaining > TimeSpan.Zero ? Task.Delay(remaining, cancellationToken) : Task.CompletedTask;
+    }
+
+    private void CountTransferred(bool downlink, int bytes)
+    {
+        NetworkImpairment.CountBytes(downlink, bytes);
+        if (_profile.ResetAfterBytes > 0 && Interlocked.Add(ref _transferred, bytes) >= _profile.ResetAfterBytes)
+            Reset();
+    }
+
+    private async Task ResetLaterAsync(int delayMs)
+    {
+        try
+        {
+            await Task.Delay(delayMs, _closed.Token).ConfigureAwait(false);
+            Reset();
+        }
+        catch (OperationCanceledException)
+        {
+            // Closed first
+        }
+    }
+
+    private void Reset()
+    {
+        if (_broken != null)
+            return;
+
+        _broken = new IOException("Connection reset by network impairment.");
+        NetworkImpairment.CountReset();
+        try
+        {
+            // Zero linger makes the close an RST, so the server sees a reset rather than a clean FIN
+            _socket.LingerState = new LingerOption(true, 0);
+            _socket.Close();
+        }
+        catch (Exception)
+        {
+            // Already closed
+        }
+
+        _closed.Cancel();
+        _downlink.Writer.TryComplete(_broken);
+        _uplink.Writer.TryComplete();
+    }
+
+    private async Task PumpDownlinkAsync()
+    {
+        var buffer = new byte[16 * 1024];
+        try
+        {
+            while (true)
+            {
+                while (Interlocked.Read(ref _downlinkQueued) >= _profile.WindowBytes)
+                    await _windowOpened.WaitAsync(_closed.Token).ConfigureAwait(false);
+
+                var read = await _inner.ReadAsync(buffer, _closed.Token).ConfigureAwait(false);
+                if (read == 0)
+                {
+                    // The end of the stream arrives behind the last segment
+                    var (_, endAt) = Schedule(_downlinkState, 0, 0);
+                    _downlink.Writer.TryWrite(new Segment([], endAt));
+                    _downlink.Writer.TryComplete();
+                    return;
+                }
+
+                CountTransferred(true, read);
+                var (_, arriveAt) = Schedule(_downlinkState, read, _profile.DownlinkBytesPerSecond);
+                Interlocked.Add(ref _downlinkQueued, read);
+                _downlink.Writer.TryWrite(new Segment(buffer.AsSpan(0, read).ToArray(), arriveAt));
+            }
+        }
+        catch (Exception ex)
+        {
+            _downlink.Writer.TryComplete(_broken ?? (ex as IOException ?? new IOException(ex.Message, ex)));
+        }
+    }
+
+    private async Task PumpUplinkAsync()
+    {
+        try
+        {
+            await foreach (var segment in _uplink.Reader.ReadAllAsync(_closed.Token).ConfigureAwait(false))
+            {
+                await DelayUntilAsync(segment.ArriveAt, _closed.Token).ConfigureAwait(false);
+                await _inner.WriteAsync(segment.Data, _closed.Token).ConfigureAwait(false);
+            }
+        }
+        catch (Exception ex)
+        {
+            _broken ??= ex as IOException ?? new IOException(ex.Message, ex);
+        }
+    }
+
+    public override async ValueTask<int> ReadAsync(Memory<byte> buffer, CancellationToken cancellationToken = default)
+    {
+        if (!_hasCurrent)
+        {
+            try
+            {
+                _current = await _downlink.Reader.ReadAsync(cancellationToken).ConfigureAwait(false);
+            }
+            catch (ChannelClosedException ex)
+            {
+                if (ex.InnerException != null)
+                    throw ex.InnerException;
+                return 0;
+            }
+
+            _currentOffset = 0;
+            _hasCurrent = true;
+            await DelayUntilAsync(_current.ArriveAt, cancellationToken).ConfigureAwait(false);
+        }
+
+        if (_current.Data.Length == 0)
+            return 0;
+
+        var count = Math.Min(buffer.Length, _current.Data.Length - _currentOffset);
+        _current.Data.AsSpan(_currentOffset, count).CopyTo(buffer.Span);
+        _currentOffset += count;
+        if (_currentOffset == _current.Data.Length)
+        {
+            _hasCurrent = false;
+            var queued = Interlocked.Add(ref _downlinkQueued, -_current.Data.Length);
+            if (queued < _profile.WindowBytes && _windowOpened.CurrentCount == 0)
+                _windowOpened.Release();
+        }
+
+        return count;
+    }
+
+    public override Task<int> ReadAsync(byte[] buffer, int offset, int count, CancellationToken cancellationToken)
+    {
+        return ReadAsync(buffer.AsMemory(offset, count), cancellationToken).AsTask();
+    }
+
+    public override int Read(byte[] buffer, int offset, int count)
+    {
+        return ReadAsync(buffer.AsMemory(offset, count)).AsTask().GetAwaiter().GetResult();
+    }
+
+    public override async ValueTask WriteAsync(ReadOnlyMemory<byte> buffer, CancellationToken cancellationToken = default)
+    {
+        if (_broken != null)
+            throw _broken;
+
+        CountTransferred(false, buffer.Length);
+        var bytesPerSecond = _profile.UplinkBytesPerSecond;
+        var (sentAt, arriveAt) = Schedule(_uplinkState, buffer.Length, bytesPerSecond);
+        _uplink.Writer.TryWrite(new Segment(buffer.ToArray(), arriveAt));
+
+        // Holding each writer until its own bytes are sent would idle the link for every timer overshoot, which costs
+        // most of the bandwidth when writes are small fragments
+        if (bytesPerSecond > 0)
+            await DelayUntilAsync(sentAt - _profile.WindowBytes * Stopwatch.Frequency / bytesPerSecond, cancellationToken).ConfigureAwait(false);
+    }
+
+    public override Task WriteAsync(byte[] buffer, int offset, int count, CancellationToken cancellationToken)
+    {
+        return WriteAsync(buffer.AsMemory(offset, count), cancellationToken).AsTask();
+    }
+
+    public override void Write(byte[] buffer, int offset, int count)
+    {
+        WriteAsync(buffer.AsMemory(offset, count)).AsTask().GetAwaiter().GetResult();
+    }
+
+    // Segments go out from the uplink pump on their own schedule
+    public override void Flush()
+    {
+    }
+
+    public override Task FlushAsync(CancellationToken cancellationToken) => Task.CompletedTask;
+
+    public override bool CanRead => true;
+    public override bool CanSeek => false;
+    public override bool CanWrite => true;
+    public override long Length => throw new NotSupportedException();
+
+    public override long Position
+    {
+        get => throw new NotSupportedException();
+        set => throw new NotSupportedException();
+    }
+
+    public override long Seek(long offset, SeekOrigin origin) => throw new NotSupportedException();
+
+    public override void SetLength(long value) => throw new NotSupportedException();
+
+    protected override void Dispose(bool disposing)
+    {
+        if (disposing)
+        {
+            _closed.Cancel();
+            _downlink.Writer.TryComplete();
+            _uplink.Writer.TryComplete();
+            _inner.Dispose();
+        }
+
+        base.Dispose(disposing);
+    }
+
+    public override async ValueTask DisposeAsync()
+    {
+        _closed.Cancel();
+        _downlink.Writer.TryComplete();
+        _uplink.Writer.TryComplete();
+        await _inner.DisposeAsync().ConfigureAwait(false);
+    }
+}
@@ -0,0 +1,142 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Globalization;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading;
+
+namespace WebSocketClientNativeLibrary;
+
+/// <summary>
+/// Scoped hot-path span: <c>using var span = new TraceSpan("name");</c>. Without the WEBSOCKET_ANE_TRACING constant
+/// (build with -p:WebSocketAneTracing=true) the struct is empty and compiles away.
+/// </summary>
+public readonly struct TraceSpan : IDisposable
+{
+#if WEBSOCKET_ANE_TRACING
+    private readonly string _name;
+    private readonly long _start;
+#endif
+
+    public TraceSpan(string name)
+    {
+#if WEBSOCKET_ANE_TRACING
+        _name = name;
+        _start = Stopwatch.GetTimestamp();
+#endif
+    }
+
+    public void Dispose()
+    {
+#if WEBSOCKET_ANE_TRACING
+        Tracing.Record(_name, _start, Stopwatch.GetTimestamp());
+#endif
+    }
+}
+
+/// <summary>
+/// Per-thread rings of the last spans, handed to the shim as Chrome trace events so they merge with its own.
+/// Spans carry the OS thread id, the one the shim records too, so a receive and the shim callback it runs nest
+/// on one track.
+/// </summary>
+public static class Tracing
+{
+#if WEBSOCKET_ANE_TRACING
+    private const int Capacity = 8192;
+
+    private sealed class Ring
+    {
+        public readonly string[] Names = new string[Capacity];
+        public readonly long[] Starts = new long[Capacity];
+        public readonly long[] Durations = new long[Capacity];
+        public long Written;
+        public ulong ThreadId;
+    }
+
+    [ThreadStatic] private static Ring _ring;
+    private static readonly List<Ring> Rings = new();
+
+    [DllImport("kernel32.dll")]
+    private static extern uint GetCurrentThreadId();
+
+    [DllImport("libSystem.dylib")]
+    private static extern int pthread_threadid_np(IntPtr thread, out ulong threadId);
+
+    public static void Record(string name, long start, long end)
+    {
+        var ring = _ring ?? CreateRing();
+        var written = ring.Written;
+        var slot = (int)(written & (Capacity - 1));
+        ring.Names[slot] = name;
+        ring.Starts[slot] = start;
+        ring.Durations[slot] = end - start;
+        Volatile.Write(ref ring.Written, written + 1);
+    }
+
+    private static Ring CreateRing()
+    {
+        var ring = new Ring();
+        if (OperatingSystem.IsWindows())
+        {
+            ring.ThreadId = GetCurrentThreadId();
+        }
+        else if (pthread_threadid_np(IntPtr.Zero, out var threadId) == 0)
+        {
+            ring.ThreadId = threadId;
+        }
+
+        lock (Rings)
+        {
+            Rings.Add(ring);
+        }
+
+        _ring = ring;
+        return ring;
+    }
+#endif
+
+    /// <summary>
+    /// Recorded spans as comma-terminated trace-event objects, timestamps shifted so that now is nowMicros on the
+    /// caller's clock. Empty when tracing is compiled out.
+    /// </summary>
+    public static string GetEvents(double nowMicros)
+    {
+        var json = new StringBuilder();
+#if WEBSOCKET_ANE_TRACING
+        var microsPerTick = 1_000_000.0 / Stopwatch.Frequency;
+        var offset = nowMicros - Stopwatch.GetTimestamp() * microsPerTick;
+        lock (Rings)
+        {
+            foreach (var ring in Rings)
+            {
+                json.Append(CultureInfo.InvariantCulture,
+                    $"{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{ring.ThreadId},\"args\":{{\"name\":\"engine\"}}}},");
+
+                // Slots the owner reused while we were reading are dropped, as in the shim
+                var written = Volatile.Read(ref ring.Written);
+                var first = Math.Max(0, written - Capacity);
+                var names = new string[written - first];
+                var starts = new long[names.Length];
+                var durations = new long[names.Length];
+                for (var i = first; i < written; i++)
+                {
+                    var slot = (int)(i & (Capacity - 1));
+                    names[i - first] = ring.Names[slot];
+                    starts[i - first] = ring.Starts[slot];
+                    durations[i - first] = ring.Durations[slot];
+                }
+
+                var valid = Math.Max(first, Volatile.Read(ref ring.Written) - Capacity);
+                for (var i = valid; i < written; i++)
+                {
+                    var index = (int)(i - first);
+                    json.Append(CultureInfo.InvariantCulture,
+                        $"{{\"name\":\"{names[index]}\",\"cat\":\"engine\",\"ph\":\"X\",\"pid\":1,\"tid\":{ring.ThreadId},\"ts\":{starts[index] * microsPerTick + offset:F3},\"dur\":{durations[index] * microsPerTick:F3}}},");
+                }
+            }
+        }
+#endif
+        return json.ToString();
+    }
+}
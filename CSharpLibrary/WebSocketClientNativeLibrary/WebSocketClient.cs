@@ -1,14 +1,21 @@
 ﻿using System;
 using System.Buffers;
+using System.Buffers.Binary;
 using System.Collections.Concurrent;
 using System.Collections.Generic;
 using System.Diagnostics;
+using System.Globalization;
+using System.IO;
 using System.Linq;
 using System.Net;
 using System.Net.Http;
 using System.Net.Http.Headers;
 using System.Net.Sockets;
 using System.Net.WebSockets;
+using System.Runtime.CompilerServices;
+using System.Security.Cryptography;
+using System.Security.Cryptography.X509Certificates;
+using System.Text;
 using System.Text.Json;
 using System.Threading;
 using System.Threading.Tasks;
@@ -18,15 +25,21 @@ namespace WebSocketClientNativeLibrary;
 
 public class WebSocketClient : IDisposable
 {
-    private static readonly LookupClient DnsClient = new(new LookupClientOptions(NameServer.Cloudflare, NameServer.Cloudflare2, NameServer.GooglePublicDns, NameServer.GooglePublicDns2)
+    // One resolver per DNS timeout in use, see ConnectOptions.DnsTimeoutMs
+    private static readonly ConcurrentDictionary<int, LookupClient> DnsClients = new();
+
+    private static LookupClient GetDnsClient(int timeoutMs)
     {
-        UseCache = true,
-        Timeout = TimeSpan.FromMilliseconds(250),
-        Retries = 1,
-        AutoResolveNameServers = true,
-        CacheFailedResults = false,
-        ContinueOnDnsError = true
-    });
+        return DnsClients.GetOrAdd(timeoutMs, static timeout => new LookupClient(new LookupClientOptions(NameServer.Cloudflare, NameServer.Cloudflare2, NameServer.GooglePublicDns, NameServer.GooglePublicDns2)
+        {
+            UseCache = true,
+            Timeout = TimeSpan.FromMilliseconds(timeout),
+            Retries = 1,
+            AutoResolveNameServers = true,
+            CacheFailedResults = false,
+            ContinueOnDnsError = true
+        }));
+    }
 
     private static readonly HttpClient DohHttpClientCloudFlare = new()
     {
@@ -38,6 +51,11 @@ public class WebSocketClient : IDisposable
     
     private static readonly Dictionary<string, List<IPAddress>> _resolvedHosts = new();
 
+    /// <summary>
+    /// Adds ip to the addresses host falls back to when DoH and DNS fail. A host added after the warm-up started is
+    /// resolved right away in the background, as <see cref="AddHostHint"/> does; the warm-up itself runs before any
+    /// context can add one.
+    /// </summary>
     public static void AddStaticHost(string host, string ip)
     {
         if (!IPAddress.TryParse(ip, out var parsedIp))
@@ -45,13 +63,18 @@ public class WebSocketClient : IDisposable
             return;
         }
 
+        bool added;
         lock (_staticHosts)
         {
-            if (!_staticHosts.ContainsKey(host))
+            added = !_staticHosts.ContainsKey(host);
+            if (added)
                 _staticHosts[host] = new List<IPAddress>();
 
             _staticHosts[host].Add(parsedIp);
         }
+
+        if (added && Volatile.Read(ref _warmUpStarted) == 1)
+            _ = Task.Run(() => ResolveHostAsync(host, ConnectOptions.DefaultDnsTimeoutMs, null));
     }
 
     public static void RemoveStaticHost(string host)
@@ -62,24 +85,233 @@ public class WebSocketClient : IDisposable
         }
     }
 
-    private readonly ConcurrentQueue<byte[]> _sendQueue = new();
+    private static readonly HashSet<string> _hostHints = new();
+
+    // Startup phase durations in milliseconds, see GetStartupTimings
+    private static readonly ConcurrentDictionary<string, double> _startupTimings = new();
+    private static int _warmUpStarted;
+    private static int _firstConnectRecorded;
+
+    /// <summary>
+    /// Registers a host that will be connected to, so the warm-up resolves it ahead of the first connect. Hints added
+    /// after the warm-up are resolved right away in the background.
+    /// </summary>
+    public static void AddHostHint(string host)
+    {
+        lock (_hostHints)
+        {
+            if (!_hostHints.Add(host))
+                return;
+        }
+
+        if (Volatile.Read(ref _warmUpStarted) == 1)
+            _ = Task.Run(() => ResolveHostAsync(host, ConnectOptions.DefaultDnsTimeoutMs, null));
+    }
+
+    /// <summary>
+    /// Pays the one-time costs of the first connect up front: loads the TLS root store, initializes the WebSocket and
+    /// HTTP stacks and resolves the hinted and static hosts, which also opens the pooled TLS connection to the DoH
+    /// server. Runs once; later calls return immediately.
+    /// </summary>
+    public static async Task WarmUpAsync()
+    {
+        if (Interlocked.Exchange(ref _warmUpStarted, 1) == 1)
+            return;
+
+        var start = Stopwatch.GetTimestamp();
+
+        var phase = Stopwatch.GetTimestamp();
+        using (var store = new X509Store(StoreName.Root, StoreLocation.CurrentUser))
+        {
+            store.Open(OpenFlags.ReadOnly);
+            _ = store.Certificates.Count;
+        }
+
+        RecordStartupPhase("rootStore", phase);
+
+        phase = Stopwatch.GetTimestamp();
+        new ClientWebSocket().Dispose();
+        RecordStartupPhase("webSocketStack", phase);
+
+        string[] hosts;
+        lock (_hostHints)
+        lock (_staticHosts)
+        {
+            hosts = _hostHints.Union(_staticHosts.Keys).ToArray();
+        }
+
+        if (hosts.Length > 0)
+        {
+            phase = Stopwatch.GetTimestamp();
+            await Task.WhenAll(hosts.Select(host => ResolveHostAsync(host, ConnectOptions.DefaultDnsTimeoutMs, null)));
+            RecordStartupPhase("resolveHosts", phase);
+        }
+
+        RecordStartupPhase("warmUp", start);
+    }
+
+    /// <summary>
+    /// JSON object of startup phase durations in milliseconds: the warm-up phases and firstConnect, from the first
+    /// Connect call to the open socket.
+    /// </summary>
+    public static string GetStartupTimings()
+    {
+        return "{" + string.Join(",", _startupTimings.Select(timing =>
+            string.Create(CultureInfo.InvariantCulture, $"\"{timing.Key}\":{timing.Value:F3}"))) + "}";
+    }
+
+    private static void RecordStartupPhase(string name, long start)
+    {
+        _startupTimings[name] = (Stopwatch.GetTimestamp() - start) * 1000.0 / Stopwatch.Frequency;
+    }
+
+    // Send lanes, drained strictly by priority at message boundaries: lane 0 (control/input) goes before lane 1 (normal),
+    // which goes before lane 2 (bulk). RFC 6455 lets nothing but control frames in between the fragments of a message,
+    // so a message already on the wire is finished first: lane 0 waits at most for the rest of one lower-lane message,
+    // and bulk senders bound that wait by keeping their messages small
+    public const int SendLaneCount = 3;
+    public const int DefaultSendLane = 1;
+
+    // FramedCount > 0 marks Data as ready-made frames for that many messages, written as-is under the connection stream
+    private readonly record struct PendingSend(byte[] Data, long EnqueuedAt, int FramedCount = 0, int FramedPayload = 0);
+
+    private readonly ConcurrentQueue<PendingSend>[] _sendLanes = [new(), new(), new()];
+    private readonly LatencyHistogram[] _sendLaneLatency = [new(), new(), new()];
+    private readonly long[] _sendLaneBlocked = new long[SendLaneCount]; // Times a lane waited out a lower lane's fragmented message
+    private readonly SemaphoreSlim _sendSignal = new(0);
+    private int _fragmentSize = 16 * 1024;
+    private volatile bool _closing;
     private CancellationTokenSource _cancellationTokenSource;
 
+    // Flow control
+    private long _bufferedAmount;
+    private long _sendLowWatermark = 1024 * 1024;
+    private long _sendHighWatermark = 4 * 1024 * 1024;
+    private volatile bool _sendAboveHighWatermark;
+    private readonly object _receivePauseLock = new();
+    private TaskCompletionSource _receiveResumed;
+
     // Callbacks
     private readonly Action _onConnect;
-    private readonly Action<ArraySegment<byte>> _onReceived;
+    private readonly Action<ArraySegment<byte>, WebSocketMessageType, long> _onReceived;
     private readonly Action<int, string> _onIoError;
     private readonly Action<string> _onLog;
+    private readonly Action<string, string> _onStatus;
+
+    // Keepalive, off until SetKeepAlive or ConnectOptions.KeepAliveIntervalMs turns it on: a short silence timeout tears
+    // down healthy connections of mobile or backgrounded apps, so each app picks its own. The timeout default is meant
+    // for an interval set through ConnectOptions, which carries none
+    private int _keepAliveIntervalMs;
+    private int _keepAliveTimeoutMs = 30000;
+    private int _keepAliveStatusIntervalMs;
+    private ulong _pingId;
+    private TaskCompletionSource<long> _pendingPong;
+    private readonly LatencyHistogram _rttHistogram = new();
+    private readonly object _rttLock = new();
+    private double _smoothedRttMicros = -1;
+    private double _rttVarianceMicros;
+    private long _lastRttMicros;
+    private long _pingsSent;
+    private long _pongsReceived;
+    private long _keepAliveTimeouts;
+
+    // Busy-poll receive mode, see SetBusyPoll
+    private int _busyPollSpinMicros;
+    private int _busyPollCore = -1;
+    private BusyPollLoop _busyPollLoop;
+    private readonly LatencyHistogram _readToDeliver = new();
+
+    // Resolved options of the current connection
+    private ConnectOptions _connectOptions = ConnectOptions.Default.Resolve();
+
+    private sealed class ConnectionAttachment
+    {
+        public WebSocketConnectionStream Stream;
+        public BusyPollStream Socket;
+        public HttpMessageInvoker Invoker;
+    }
+
+    private static readonly ConditionalWeakTable<ClientWebSocket, ConnectionAttachment> ConnectionAttachments = new();
 
     private ClientWebSocket _activeWebSocket;
-    private bool _disposed = false;
+    private ConnectionAttachment _activeConnection;
+
+    // Set while this client is a logical channel of a shared connection, see ConnectShared
+    private MultiplexedConnection _shared;
+    private ushort _channelId;
+    private volatile bool _disposed;
+    private int _closeReported;
+
+    /// <summary>
+    /// onReceived gets each message with the Stopwatch timestamp at which its first frame was read off the socket.
+    /// </summary>
+    public WebSocketClient(Action onConnect, Action<ArraySegment<byte>, WebSocketMessageType, long> onReceived, Action<int, string> onIoError, Action<string> onLog, Action<string, string> onStatus = null)
+    {
+        // Callbacks stop once the client is disposed, so nothing reaches a native client that was already released
+        _onConnect = () =>
+        {
+            if (!_disposed) onConnect?.Invoke();
+        };
+        _onReceived = (data, messageType, receivedAt) =>
+        {
+            if (!_disposed) onReceived?.Invoke(data, messageType, receivedAt);
+        };
+        _onIoError = (closeCode, reason) =>
+        {
+            if (!_disposed) onIoError?.Invoke(closeCode, reason);
+        };
+        _onLog = message => // Log callback
+        {
+            if (!_disposed) onLog?.Invoke(message);
+        };
+        _onStatus = (code, level) => // Generic status events forwarded to AS3 (e.g. "drain")
+        {
+            if (!_disposed) onStatus?.Invoke(code, level);
+        };
+    }
+
+    /// <summary>
+    /// Bytes accepted by <see cref="Send"/> that were not yet written to the socket.
+    /// </summary>
+    public long BufferedAmount => Interlocked.Read(ref _bufferedAmount);
+
+    public void SetSendWatermarks(long lowWatermark, long highWatermark)
+    {
+        if (lowWatermark < 0 || highWatermark <= 0 || lowWatermark > highWatermark)
+        {
+            _onLog?.Invoke($"Invalid send watermarks: low {lowWatermark}, high {highWatermark}");
+            return;
+        }
 
-    public WebSocketClient(Action onConnect, Action<ArraySegment<byte>> onReceived, Action<int, string> onIoError, Action<string> onLog)
+        Interlocked.Exchange(ref _sendLowWatermark, lowWatermark);
+        Interlocked.Exchange(ref _sendHighWatermark, highWatermark);
+    }
+
+    /// <summary>
+    /// Stops issuing socket reads until resumed, so the kernel receive window fills up and TCP flow control
+    /// pushes back on the server. Used by the native layer when its receive queue crosses the high watermark.
+    /// </summary>
+    public void SetReceivePaused(bool paused)
     {
-        _onConnect = onConnect;
-        _onReceived = onReceived;
-        _onIoError = onIoError;
-        _onLog = onLog; // Log callback
+        var shared = _shared;
+        if (shared != null)
+        {
+            shared.SetChannelPaused(_channelId, paused);
+            return;
+        }
+
+        lock (_receivePauseLock)
+        {
+            if (paused)
+            {
+                _receiveResumed ??= new TaskCompletionSource(TaskCreationOptions.RunContinuationsAsynchronously);
+            }
+            else
+            {
+                _receiveResumed?.TrySetResult();
+                _receiveResumed = null;
+            }
+        }
     }
 
     public void Connect(string uri)
@@ -87,11 +319,40 @@ public class WebSocketClient : IDisposable
         _ = Task.Run(async () => await ConnectAsync(uri));
     }
 
-    public async Task ConnectAsync(string uri)
+    public void Connect(string uri, ConnectOptions options)
     {
-        _cancellationTokenSource = new CancellationTokenSource();
+        _ = Task.Run(async () => await ConnectAsync(uri, options));
+    }
 
-        var cts = new CancellationTokenSource(TimeSpan.FromSeconds(10));
+    /// <summary>
+    /// Connects as a logical channel of the one physical connection shared by every client that called ConnectShared
+    /// with the same uri (see <see cref="MultiplexedConnection"/>), instead of opening a socket of its own. The server
+    /// has to speak the channel framing, e.g. through MultiplexDemuxServer.
+    /// </summary>
+    public void ConnectShared(string uri)
+    {
+        if (_shared != null)
+            return;
+
+        _closing = false;
+        _shared = MultiplexedConnection.Join(uri, this, out _channelId);
+    }
+
+    /// <summary>
+    /// Connects with options (see <see cref="ConnectOptions"/>), or the engine defaults without them.
+    /// </summary>
+    public async Task ConnectAsync(string uri, ConnectOptions? options = null)
+    {
+        var connectStart = Stopwatch.GetTimestamp();
+        _cancellationTokenSource = new CancellationTokenSource();
+        _closing = false;
+        Interlocked.Exchange(ref _closeReported, 0);
+        var connectOptions = (options ?? ConnectOptions.Default).Resolve();
+        _connectOptions = connectOptions;
+        if (connectOptions.KeepAliveIntervalMs >= 0)
+            _keepAliveIntervalMs = connectOptions.KeepAliveIntervalMs;
+
+        using var cts = new CancellationTokenSource(TimeSpan.FromMilliseconds(connectOptions.ConnectTimeoutMs));
         using var linkedCts = CancellationTokenSource.CreateLinkedTokenSource(cts.Token, _cancellationTokenSource.Token);
 
         try
@@ -100,62 +361,7 @@ public class WebSocketClient : IDisposable
             var uriObject = new Uri(uri);
             var host = uriObject.Host;
 
-            IPAddress[] ipAddresses = [];
-            
-            lock (_resolvedHosts)
-            {
-                if (_resolvedHosts.TryGetValue(host, out var resolvedHost) && resolvedHost.Count > 0)
-                {
-                    ipAddresses = resolvedHost.ToArray();
-                }
-            }
-
-            // Resolve the host to multiple IPs
-            if (ipAddresses == null || ipAddresses.Length == 0)
-            {
-                var ips4 = await ResolveUsingDoH(host, "A");
-                var ips6 = await ResolveUsingDoH(host, "AAAA");
-                ipAddresses = ips4.Concat(ips6).ToArray();
-                if (ipAddresses.Length > 0)
-                {
-                    lock (_resolvedHosts)
-                    {
-                        _resolvedHosts.Add(host, ipAddresses.ToList());
-                    }
-                }
-            }
-
-            if (ipAddresses.Length == 0)
-            {
-                try
-                {
-                    var queryResult = await DnsClient.GetHostEntryAsync(host);
-                    ipAddresses = queryResult.AddressList;
-                    if (ipAddresses.Length > 0)
-                    {
-                        lock (_resolvedHosts)
-                        {
-                            _resolvedHosts.Add(host, ipAddresses.ToList());
-                        }
-                    }
-                }
-                catch (Exception e)
-                {
-                    _onLog?.Invoke($"Failed to resolve host using DnsClient: {host}\n{e}");
-                }
-            }
-
-            if (ipAddresses.Length == 0)
-            {
-                lock (_staticHosts)
-                {
-                    if (_staticHosts.TryGetValue(host, out var staticIp))
-                    {
-                        ipAddresses = staticIp.ToArray();
-                        _onLog?.Invoke($"Found static host: {host}");
-                    }
-                }
-            }
+            var ipAddresses = await ResolveHostAsync(host, connectOptions.DnsTimeoutMs, _onLog);
 
             if (ipAddresses == null || ipAddresses.Length == 0)
             {
@@ -172,23 +378,37 @@ public class WebSocketClient : IDisposable
             var (webSocket, index) = await ParallelTask(
                 ipAddresses.Length,
                 (i, cancel) => AttemptConnectionAsync(uriObject, ipAddresses[i].ToString(), ctxSource.Token),
-                TimeSpan.FromMilliseconds(250),
+                TimeSpan.FromMilliseconds(connectOptions.AttemptDelayMs),
                 linkedCts.Token);
 
             _activeWebSocket = webSocket;
+            _activeConnection = webSocket != null && ConnectionAttachments.TryGetValue(webSocket, out var attachment) ? attachment : null;
+            if (webSocket != null)
+                MemoryLedger.ConnectionOpened();
 
             await ctxSource.CancelAsync(); // Cancel the other connection attempts
 
             // Check if the connection succeeded
             if (_activeWebSocket is { State: WebSocketState.Open })
             {
+                if (Interlocked.Exchange(ref _firstConnectRecorded, 1) == 0)
+                    RecordStartupPhase("firstConnect", connectStart);
+
                 _onConnect?.Invoke(); // Callback after successful connection
 
                 _onLog?.Invoke($"Connection established to host {host} and ip {ipAddresses[index]}.");
 
                 // Start background tasks for sending and receiving messages
                 _ = Task.Factory.StartNew(() => SendLoopAsync(_cancellationTokenSource.Token), TaskCreationOptions.LongRunning);
-                _ = Task.Factory.StartNew(() => ReceiveLoopAsync(_cancellationTokenSource.Token), TaskCreationOptions.LongRunning);
+                var token = _cancellationTokenSource.Token;
+                if (_busyPollSpinMicros > 0)
+                    _busyPollLoop = BusyPollLoop.Start("WebSocket busy-poll receive", _busyPollSpinMicros, _busyPollCore, () => ReceiveLoopAsync(token), _onLog);
+                else
+                {
+                    _busyPollLoop = null;
+                    _ = Task.Factory.StartNew(() => ReceiveLoopAsync(token), TaskCreationOptions.LongRunning);
+                }
+                _ = KeepAliveLoopAsync(_activeConnection?.Stream, _cancellationTokenSource.Token);
             }
             else
             {
@@ -335,6 +555,8 @@ public class WebSocketClient : IDisposable
                 finally
                 {
                     task.Result.Dispose();
+                    if (ConnectionAttachments.TryGetValue(task.Result, out var secondary))
+                        secondary.Invoker.Dispose();
                 }
             }
         });
@@ -342,6 +564,70 @@ public class WebSocketClient : IDisposable
         return (successTask.Result, allTasks.IndexOf(successTask));
     }
 
+    // Cached DoH answers first, then DoH, then the system resolvers through DnsClient, then the static hosts. Shared by
+    // connects and the warm-up, which may race to fill the cache
+    private static async Task<IPAddress[]> ResolveHostAsync(string host, int dnsTimeoutMs, Action<string> log)
+    {
+        IPAddress[] ipAddresses = [];
+
+        lock (_resolvedHosts)
+        {
+            if (_resolvedHosts.TryGetValue(host, out var resolvedHost) && resolvedHost.Count > 0)
+            {
+                ipAddresses = resolvedHost.ToArray();
+            }
+        }
+
+        // Resolve the host to multiple IPs
+        if (ipAddresses == null || ipAddresses.Length == 0)
+        {
+            var ips4 = await ResolveUsingDoH(host, "A");
+            var ips6 = await ResolveUsingDoH(host, "AAAA");
+            ipAddresses = ips4.Concat(ips6).ToArray();
+            if (ipAddresses.Length > 0)
+            {
+                lock (_resolvedHosts)
+                {
+                    _resolvedHosts[host] = ipAddresses.ToList();
+                }
+            }
+        }
+
+        if (ipAddresses.Length == 0)
+        {
+            try
+            {
+                var queryResult = await GetDnsClient(dnsTimeoutMs).GetHostEntryAsync(host);
+                ipAddresses = queryResult.AddressList;
+                if (ipAddresses.Length > 0)
+                {
+                    lock (_resolvedHosts)
+                    {
+                        _resolvedHosts[host] = ipAddresses.ToList();
+                    }
+                }
+            }
+            catch (Exception e)
+            {
+                log?.Invoke($"Failed to resolve host using DnsClient: {host}\n{e}");
+            }
+        }
+
+        if (ipAddresses.Length == 0)
+        {
+            lock (_staticHosts)
+            {
+                if (_staticHosts.TryGetValue(host, out var staticIp))
+                {
+                    ipAddresses = staticIp.ToArray();
+                    log?.Invoke($"Found static host: {host}");
+                }
+            }
+        }
+
+        return ipAddresses;
+    }
+
     private static async Task<IPAddress[]> ResolveUsingDoH(string host, string type)
     {
         try
@@ -387,6 +673,10 @@ public class WebSocketClient : IDisposable
         }
     }
 
+    // SOL_SOCKET / SO_BUSY_POLL from the Linux headers
+    private const int SolSocket = 1;
+    private const int SoBusyPoll = 46;
+
     private async Task<ClientWebSocket> AttemptConnectionAsync(Uri uri, string ipAddress, CancellationToken ctx)
     {
         try
@@ -396,6 +686,50 @@ public class WebSocketClient : IDisposable
             // Set the 'Host' header to the domain from the original URI
             webSocket.Options.SetRequestHeader("Host", uri.Host);
 
+            // Own the connection so the plaintext stream under the WebSocket can be wrapped for ping/pong tracking
+            var attachment = new ConnectionAttachment();
+            var busyPollMicros = _busyPollSpinMicros;
+            var options = _connectOptions;
+            var handler = new SocketsHttpHandler
+            {
+                // The default connect plus the socket options, and we keep the socket to stamp and (in busy-poll mode) spin on reads
+                ConnectCallback = async (context, cancel) =>
+                {
+                    var socket = new Socket(SocketType.Stream, ProtocolType.Tcp) { NoDelay = options.TcpNoDelay != 0 };
+                    if (options.SendBufferSize > 0)
+                        socket.SendBufferSize = options.SendBufferSize;
+                    if (options.ReceiveBufferSize > 0)
+                        socket.ReceiveBufferSize = options.ReceiveBufferSize;
+
+                    var impairment = NetworkImpairment.ProfileFor(context.DnsEndPoint.Host);
+                    try
+                    {
+                        if (impairment != null)
+                            await NetworkImpairment.ConnectAsync(impairment, cancel);
+                        await socket.ConnectAsync(context.DnsEndPoint, cancel);
+                    }
+                    catch
+                    {
+                        socket.Dispose();
+                        throw;
+                    }
+
+                    // Kernel-side busy polling only exists on Linux; Windows and macOS rely on the spinning receive thread
+                    if (busyPollMicros > 0 && OperatingSystem.IsLinux())
+                        socket.SetRawSocketOption(SolSocket, SoBusyPoll, BitConverter.GetBytes(busyPollMicros));
+
+                    attachment.Socket = new BusyPollStream(socket);
+                    return impairment != null ? new ImpairedStream(attachment.Socket, socket, impairment) : attachment.Socket;
+                },
+                PlaintextStreamFilter = (context, _) =>
+                {
+                    attachment.Stream = new WebSocketConnectionStream(context.PlaintextStream);
+                    return ValueTask.FromResult<Stream>(attachment.Stream);
+                }
+            };
+            attachment.Invoker = new HttpMessageInvoker(handler);
+            ConnectionAttachments.AddOrUpdate(webSocket, attachment);
+
             _onLog?.Invoke($"Attempting connection to {uri} via IP {ipAddress}");
 
             // Create the URI using the IP address but keep the correct path and scheme
@@ -406,7 +740,7 @@ public class WebSocketClient : IDisposable
 
             try
             {
-                await webSocket.ConnectAsync(webSocketUri, ctx);
+                await webSocket.ConnectAsync(webSocketUri, attachment.Invoker, ctx);
                 if (webSocket.State == WebSocketState.Open)
                 {
                     _onLog?.Invoke($"Successfully connected to {ipAddress}.");
@@ -417,6 +751,8 @@ public class WebSocketClient : IDisposable
             {
                 _onLog?.Invoke($"Failed to connect to {ipAddress}: {ex.Message}");
             }
+
+            attachment.Invoker.Dispose();
         }
         catch (Exception ex)
         {
@@ -427,47 +763,514 @@ public class WebSocketClient : IDisposable
     }
 
 
-    public void Send(byte[] data)
+    /// <summary>
+    /// Messages larger than this are sent as several frames, so the pings, pongs and close frames that the socket
+    /// writes between our calls are never stuck behind a whole bulk upload. Data messages on higher lanes still wait
+    /// for the fragmented message to finish.
+    /// </summary>
+    public void SetFragmentSize(int fragmentSize)
+    {
+        if (fragmentSize < 125)
+        {
+            _onLog?.Invoke($"Invalid fragment size: {fragmentSize}");
+            return;
+        }
+
+        Interlocked.Exchange(ref _fragmentSize, fragmentSize);
+        _shared?.Physical.SetFragmentSize(fragmentSize);
+    }
+
+    /// <summary>
+    /// Queue-to-wire latency percentiles and fragmented-message waits per send lane, as JSON.
+    /// </summary>
+    public string GetSendLaneStats()
+    {
+        var builder = new StringBuilder("{\"lanes\":[");
+        for (var lane = 0; lane < SendLaneCount; lane++)
+        {
+            if (lane > 0)
+                builder.Append(',');
+            builder.Append(CultureInfo.InvariantCulture, $"{{\"lane\":{lane},\"queued\":{_sendLanes[lane].Count},\"blockedBehindFragmented\":{Interlocked.Read(ref _sendLaneBlocked[lane])},\"latency\":");
+            _sendLaneLatency[lane].AppendJson(builder);
+            builder.Append('}');
+        }
+
+        builder.Append(CultureInfo.InvariantCulture, $"],\"bufferedAmount\":{BufferedAmount},\"fragmentSize\":{_fragmentSize}}}");
+        return builder.ToString();
+    }
+
+    /// <summary>
+    /// With spinMicros > 0 the next connection receives on a dedicated thread that spins on the socket and on its own
+    /// work for up to spinMicros before parking, pinned to core when core >= 0 (Windows only, macOS has no hard
+    /// affinity). It trades one busy core for not waiting on thread-pool wakeups; 0 restores the default mode.
+    /// Connections shared through ConnectShared keep the default mode.
+    /// </summary>
+    public void SetBusyPoll(int spinMicros, int core)
+    {
+        if (spinMicros < 0 || spinMicros > 1_000_000 || core < -1)
+        {
+            _onLog?.Invoke($"Invalid busy-poll settings: spin {spinMicros}us, core {core}");
+            return;
+        }
+
+        _busyPollSpinMicros = spinMicros;
+        _busyPollCore = core;
+    }
+
+    /// <summary>
+    /// Receive-path cost and latency as JSON: the busy-poll thread's spin/park counts and CPU time when that mode ran,
+    /// and in either mode the time from bytes leaving the socket to the message being handed to the native side.
+    /// </summary>
+    public string GetIoStats()
+    {
+        var shared = _shared;
+        if (shared != null)
+            return shared.Physical.GetIoStats();
+
+        var builder = new StringBuilder();
+        var loop = _busyPollLoop;
+        builder.Append(CultureInfo.InvariantCulture,
+            $"{{\"mode\":\"{(loop != null ? "busyPoll" : "default")}\",\"busyPoll\":");
+        if (loop != null)
+            loop.AppendJson(builder);
+        else
+            builder.Append("null");
+
+        builder.Append(",\"readToDeliver\":");
+        _readToDeliver.AppendJson(builder);
+        builder.Append('}');
+        return builder.ToString();
+    }
+
+    /// <summary>
+    /// Pings every intervalMs (0, the default, disables) and treats the peer as dead when neither the pong nor any other
+    /// byte arrives within timeoutMs. With statusIntervalMs > 0 a "keepaliveStatus" event carrying <see cref="GetRttStats"/> is raised
+    /// at most that often.
+    /// </summary>
+    public void SetKeepAlive(int intervalMs, int timeoutMs, int statusIntervalMs)
+    {
+        if (intervalMs < 0 || timeoutMs <= 0 || statusIntervalMs < 0)
+        {
+            _onLog?.Invoke($"Invalid keepalive settings: interval {intervalMs}, timeout {timeoutMs}, status {statusIntervalMs}");
+            return;
+        }
+
+        _keepAliveIntervalMs = intervalMs;
+        _keepAliveTimeoutMs = timeoutMs;
+        _keepAliveStatusIntervalMs = statusIntervalMs;
+        _shared?.Physical.SetKeepAlive(intervalMs, timeoutMs, statusIntervalMs);
+    }
+
+    /// <summary>
+    /// Smoothed RTT and jitter (RFC 6298 SRTT/RTTVAR) from ping/pong timing plus the RTT histogram, as JSON, in microseconds.
+    /// </summary>
+    public string GetRttStats()
     {
+        var shared = _shared;
+        if (shared != null)
+            return shared.Physical.GetRttStats();
+
+        var builder = new StringBuilder();
+        lock (_rttLock)
+        {
+            builder.Append(CultureInfo.InvariantCulture,
+                $"{{\"srtt\":{(long)Math.Max(_smoothedRttMicros, 0)},\"jitter\":{(long)_rttVarianceMicros},\"lastRtt\":{_lastRttMicros},");
+        }
+
+        builder.Append(CultureInfo.InvariantCulture,
+            $"\"pingsSent\":{Interlocked.Read(ref _pingsSent)},\"pongsReceived\":{Interlocked.Read(ref _pongsReceived)},\"timeouts\":{Interlocked.Read(ref _keepAliveTimeouts)},\"interval\":{_keepAliveIntervalMs},\"timeout\":{_keepAliveTimeoutMs},\"histogram\":");
+        _rttHistogram.AppendJson(builder);
+        builder.Append('}');
+        return builder.ToString();
+    }
+
+    private async Task KeepAliveLoopAsync(WebSocketConnectionStream stream, CancellationToken cancellationToken)
+    {
+        if (stream == null)
+        {
+            _onLog?.Invoke("Keepalive unavailable: connection stream not captured.");
+            return;
+        }
+
+        stream.PongReceived = OnPongReceived;
+        var lastStatus = Stopwatch.GetTimestamp();
+
+        try
+        {
+            while (!cancellationToken.IsCancellationRequested && !_closing)
+            {
+                var interval = _keepAliveIntervalMs;
+                if (interval <= 0)
+                {
+                    await Task.Delay(1000, cancellationToken); // Disabled, re-check the setting later
+                    continue;
+                }
+
+                await Task.Delay(interval, cancellationToken);
+
+                var pong = new TaskCompletionSource<long>(TaskCreationOptions.RunContinuationsAsynchronously);
+                _pendingPong = pong;
+                var id = Interlocked.Increment(ref _pingId);
+                var sentAt = Stopwatch.GetTimestamp();
+                await stream.SendPingAsync(id, cancellationToken);
+                Interlocked.Increment(ref _pingsSent);
+
+                var completed = await Task.WhenAny(pong.Task, Task.Delay(_keepAliveTimeoutMs, cancellationToken));
+                if (completed == pong.Task)
+                {
+                    RecordRtt(pong.Task.Result - sentAt);
+                }
+                else if (stream.LastReadTimestamp < sentAt)
+                {
+                    // Nothing at all arrived since the ping: the peer or the path is gone
+                    Interlocked.Increment(ref _keepAliveTimeouts);
+                    AbortDeadConnection($"Keepalive timeout: no pong within {_keepAliveTimeoutMs} ms.");
+                    return;
+                }
+
+                var statusInterval = _keepAliveStatusIntervalMs;
+                if (statusInterval > 0 && Stopwatch.GetElapsedTime(lastStatus).TotalMilliseconds >= statusInterval)
+                {
+                    lastStatus = Stopwatch.GetTimestamp();
+                    _onStatus?.Invoke("keepaliveStatus", GetRttStats());
+                }
+            }
+        }
+        catch (OperationCanceledException)
+        {
+            // Connection closed
+        }
+        catch (Exception ex)
+        {
+            _onLog?.Invoke($"Keepalive stopped: {ex.Message}");
+        }
+    }
+
+    private void OnPongReceived(ReadOnlyMemory<byte> payload)
+    {
+        var receivedAt = Stopwatch.GetTimestamp();
+        Interlocked.Increment(ref _pongsReceived);
+        if (WebSocketConnectionStream.TryReadPingId(payload.Span, out var id) && id == Interlocked.Read(ref _pingId))
+        {
+            _pendingPong?.TrySetResult(receivedAt);
+        }
+    }
+
+    private void RecordRtt(long elapsedTicks)
+    {
+        var rttMicros = elapsedTicks * 1_000_000 / Stopwatch.Frequency;
+        _rttHistogram.Record(rttMicros);
+
+        lock (_rttLock)
+        {
+            _lastRttMicros = rttMicros;
+            if (_smoothedRttMicros < 0)
+            {
+                _smoothedRttMicros = rttMicros;
+                _rttVarianceMicros = rttMicros / 2.0;
+            }
+            else
+            {
+                _rttVarianceMicros = 0.75 * _rttVarianceMicros + 0.25 * Math.Abs(_smoothedRttMicros - rttMicros);
+                _smoothedRttMicros = 0.875 * _smoothedRttMicros + 0.125 * rttMicros;
+            }
+        }
+    }
+
+    private void AbortDeadConnection(string reason)
+    {
+        if (_closing)
+            return;
+
+        _closing = true;
+        _onLog?.Invoke(reason);
+        _onIoError?.Invoke(1006, reason); // Abnormal closure, no close frame could be exchanged
+        _activeWebSocket?.Abort();
+        _cancellationTokenSource?.Cancel();
+    }
+
+    public bool Send(byte[] data, int lane = DefaultSendLane)
+    {
+        using var span = new TraceSpan("queueSend");
+
+        if (lane < 0 || lane >= SendLaneCount)
+            lane = DefaultSendLane;
+
+        if (!TryReserveSend(data.Length))
+            return false;
+
+        var shared = _shared;
+        if (shared != null)
+        {
+            if (shared.Send(_channelId, data, lane))
+                return true;
+
+            OnSent(data.Length);
+            return false;
+        }
+
         // Synchronous method to add data to the send queue
-        _sendQueue.Enqueue(data);
+        _sendLanes[lane].Enqueue(new PendingSend(data, Stopwatch.GetTimestamp()));
+        _sendSignal.Release();
+        return true;
+    }
+
+    /// <summary>
+    /// Queues every record of a [uint32 big-endian length][payload]... buffer as its own binary message. The records
+    /// are framed and masked into one contiguous buffer that goes out as a single socket write. Returns the number of
+    /// messages queued, or 0 when the buffer is malformed or the send queue is above the high watermark.
+    /// </summary>
+    public int SendBatch(ReadOnlySpan<byte> records, int lane = DefaultSendLane)
+    {
+        using var span = new TraceSpan("queueSendBatch");
+
+        if (lane < 0 || lane >= SendLaneCount)
+            lane = DefaultSendLane;
+
+        var count = 0;
+        var payloadBytes = 0;
+        var framedBytes = 0;
+        for (var offset = 0; offset < records.Length; count++)
+        {
+            if (records.Length - offset < 4)
+            {
+                _onLog?.Invoke("sendMessages: truncated record header.");
+                return 0;
+            }
+
+            var length = BinaryPrimitives.ReadUInt32BigEndian(records[offset..]);
+            if (length > (uint)(records.Length - offset - 4))
+            {
+                _onLog?.Invoke($"sendMessages: record {count} claims {length} bytes past the end of the buffer.");
+                return 0;
+            }
+
+            payloadBytes += (int)length;
+            framedBytes += WebSocketConnectionStream.MaskedFrameLength((int)length);
+            offset += 4 + (int)length;
+        }
+
+        if (count == 0)
+            return 0;
+
+        var shared = _shared;
+        if (shared != null)
+        {
+            if (!TryReserveSend(payloadBytes))
+                return 0;
+
+            for (var offset = 0; offset < records.Length;)
+            {
+                var length = (int)BinaryPrimitives.ReadUInt32BigEndian(records[offset..]);
+                if (!shared.Send(_channelId, records.Slice(offset + 4, length), lane))
+                    OnSent(length);
+                offset += 4 + length;
+            }
+
+            return count;
+        }
+
+        // Without the connection stream (not connected yet) the records are queued one by one; so are batches larger
+        // than a fragment, which would otherwise hold the socket like an unfragmented bulk message
+        if (_activeConnection?.Stream == null || payloadBytes > _fragmentSize)
+        {
+            if (!TryReserveSend(payloadBytes))
+                return 0;
+
+            for (var offset = 0; offset < records.Length;)
+            {
+                var length = (int)BinaryPrimitives.ReadUInt32BigEndian(records[offset..]);
+                _sendLanes[lane].Enqueue(new PendingSend(records.Slice(offset + 4, length).ToArray(), Stopwatch.GetTimestamp()));
+                _sendSignal.Release();
+                offset += 4 + length;
+            }
+
+            return count;
+        }
+
+        if (!TryReserveSend(payloadBytes))
+            return 0;
+
+        var frames = new byte[framedBytes];
+        Span<byte> masks = count * 4 <= 1024 ? stackalloc byte[count * 4] : new byte[count * 4];
+        RandomNumberGenerator.Fill(masks);
+
+        var written = 0;
+        for (int offset = 0, i = 0; offset < records.Length; i++)
+        {
+            var length = (int)BinaryPrimitives.ReadUInt32BigEndian(records[offset..]);
+            written += WebSocketConnectionStream.WriteMaskedFrame(frames.AsSpan(written), WebSocketConnectionStream.OpcodeBinary,
+                records.Slice(offset + 4, length), masks.Slice(i * 4, 4));
+            offset += 4 + length;
+        }
+
+        _sendLanes[lane].Enqueue(new PendingSend(frames, Stopwatch.GetTimestamp(), count, payloadBytes));
+        _sendSignal.Release();
+        return count;
+    }
+
+    // Reject instead of buffering without bound; an empty queue always accepts so oversized messages still go out
+    private bool TryReserveSend(int bytes)
+    {
+        var buffered = Interlocked.Read(ref _bufferedAmount);
+        if (buffered > 0 && buffered + bytes > Interlocked.Read(ref _sendHighWatermark))
+        {
+            _sendAboveHighWatermark = true;
+            _onLog?.Invoke($"Send queue full ({buffered} bytes buffered), message of {bytes} bytes rejected.");
+            return false;
+        }
+
+        MemoryLedger.AddSendQueueBytes(bytes);
+        if (Interlocked.Add(ref _bufferedAmount, bytes) >= Interlocked.Read(ref _sendHighWatermark))
+        {
+            _sendAboveHighWatermark = true;
+        }
+
+        return true;
+    }
+
+    private bool TryDequeueSend(out PendingSend pending, out int lane)
+    {
+        for (lane = 0; lane < SendLaneCount; lane++)
+        {
+            if (_sendLanes[lane].TryDequeue(out pending))
+                return true;
+        }
+
+        pending = default;
+        return false;
+    }
+
+    private void OnSent(int length)
+    {
+        MemoryLedger.AddSendQueueBytes(-length);
+        var buffered = Interlocked.Add(ref _bufferedAmount, -length);
+        if (_sendAboveHighWatermark && buffered <= Interlocked.Read(ref _sendLowWatermark))
+        {
+            _sendAboveHighWatermark = false;
+            _onStatus?.Invoke("drain", buffered.ToString());
+        }
     }
 
     private async Task SendLoopAsync(CancellationToken cancellationToken)
     {
-        while (!cancellationToken.IsCancellationRequested)
+        try
         {
-            if (_sendQueue.TryDequeue(out var data))
+            while (!cancellationToken.IsCancellationRequested && !_closing)
             {
+                await _sendSignal.WaitAsync(cancellationToken);
+
+                if (_closing)
+                {
+                    _sendSignal.Release(); // Leave the signal count matching the queued messages for a reconnect
+                    break;
+                }
+
+                if (!TryDequeueSend(out var pending, out var lane))
+                    continue;
+
+                var data = pending.Data;
                 try
                 {
-                    await _activeWebSocket.SendAsync(new ArraySegment<byte>(data), WebSocketMessageType.Binary, true, cancellationToken);
+                    if (pending.FramedCount > 0)
+                    {
+                        // Ready-made frames bypass ClientWebSocket and are written straight to the connection stream
+                        var stream = _activeConnection?.Stream;
+                        if (stream == null)
+                            throw new InvalidOperationException("Connection stream unavailable for batched send.");
+
+                        using (new TraceSpan("socketWriteFrames"))
+                        {
+                            await stream.WriteFramesAsync(data, cancellationToken);
+                        }
+                        _sendLaneLatency[lane].RecordTicks(Stopwatch.GetTimestamp() - pending.EnqueuedAt);
+                        _onLog?.Invoke($"{pending.FramedCount} messages sent in one write.");
+                        continue;
+                    }
+
+                    var fragmentSize = _fragmentSize;
+                    var offset = 0;
+                    do
+                    {
+                        // A close requested mid-message goes out after the current fragment instead of after the whole message
+                        if (_closing)
+                            return;
+
+                        var count = Math.Min(fragmentSize, data.Length - offset);
+                        var endOfMessage = offset + count == data.Length;
+                        using (new TraceSpan("socketWrite"))
+                        {
+                            await _activeWebSocket.SendAsync(new ArraySegment<byte>(data, offset, count), WebSocketMessageType.Binary, endOfMessage, cancellationToken);
+                        }
+                        offset += count;
+                    } while (offset < data.Length);
+
+                    if (data.Length > fragmentSize)
+                    {
+                        for (var higher = 0; higher < lane; higher++)
+                        {
+                            if (!_sendLanes[higher].IsEmpty)
+                                Interlocked.Increment(ref _sendLaneBlocked[higher]);
+                        }
+                    }
+
+                    _sendLaneLatency[lane].RecordTicks(Stopwatch.GetTimestamp() - pending.EnqueuedAt);
                     _onLog?.Invoke("Message sent.");
                 }
+                catch (OperationCanceledException)
+                {
+                    throw;
+                }
                 catch (Exception ex)
                 {
                     await DisconnectAsync((int)WebSocketCloseStatus.InternalServerError, $"Error during send: {ex.Message}");
                 }
+                finally
+                {
+                    OnSent(pending.FramedCount > 0 ? pending.FramedPayload : data.Length);
+                }
             }
-
-            await Task.Delay(10, cancellationToken); // Avoid busy-waiting
+        }
+        catch (OperationCanceledException)
+        {
+            // Connection closed
         }
     }
 
     private async Task ReceiveLoopAsync(CancellationToken cancellationToken)
     {
         var bufferPool = ArrayPool<byte>.Shared; // ArrayPool for efficient buffer management
-        var buffer = bufferPool.Rent(1024); // Rent a buffer from the pool
+        var maxMessageSize = _connectOptions.MaxMessageSize;
+        var buffer = bufferPool.Rent(_connectOptions.InitialReceiveBufferSize); // Rent a buffer from the pool
+        MemoryLedger.ReceiveBufferRented(buffer.Length);
+        var socket = _activeConnection?.Socket;
         try
         {
             while (!cancellationToken.IsCancellationRequested)
             {
+                var receiveResumed = _receiveResumed;
+                if (receiveResumed != null)
+                {
+                    _onLog?.Invoke("Receive paused by backpressure.");
+                    await receiveResumed.Task.WaitAsync(cancellationToken);
+                    _onLog?.Invoke("Receive resumed.");
+                }
+
                 var totalBytesReceived = 0;
+                long receivedAt = 0;
                 WebSocketReceiveResult result;
 
                 do
                 {
-                    result = await _activeWebSocket.ReceiveAsync(new ArraySegment<byte>(buffer, totalBytesReceived, buffer.Length - totalBytesReceived), cancellationToken);
+                    using (new TraceSpan("socketRead"))
+                    {
+                        result = await _activeWebSocket.ReceiveAsync(new ArraySegment<byte>(buffer, totalBytesReceived, buffer.Length - totalBytesReceived), cancellationToken);
+                    }
+
+                    // Kernel receive timestamps (SO_TIMESTAMPING) are out of reach under ClientWebSocket, so a message
+                    // is stamped when its first frame completes a read. Reads paused by backpressure delay the stamp
+                    if (receivedAt == 0)
+                        receivedAt = Stopwatch.GetTimestamp();
 
                     if (result.MessageType == WebSocketMessageType.Close)
                     {
@@ -477,16 +1280,30 @@ public class WebSocketClient : IDisposable
 
                     totalBytesReceived += result.Count;
 
+                    if (maxMessageSize > 0 && totalBytesReceived > maxMessageSize)
+                    {
+                        await DisconnectAsync((int)WebSocketCloseStatus.MessageTooBig, $"Message exceeds the {maxMessageSize} byte limit.");
+                        return;
+                    }
+
                     if (totalBytesReceived >= buffer.Length)
                     {
                         var newBuffer = bufferPool.Rent(buffer.Length * 2); // Double the buffer size if necessary
+                        MemoryLedger.ReceiveBufferRented(newBuffer.Length);
                         Array.Copy(buffer, newBuffer, buffer.Length);
                         bufferPool.Return(buffer); // Return the old buffer
+                        MemoryLedger.ReceiveBufferReturned(buffer.Length);
                         buffer = newBuffer;
                     }
                 } while (!result.EndOfMessage); // Keep receiving until the end of the message
 
-                _onReceived?.Invoke(new ArraySegment<byte>(buffer, 0, totalBytesReceived));
+                if (socket != null)
+                    _readToDeliver.RecordTicks(Stopwatch.GetTimestamp() - socket.LastReadTimestamp);
+
+                using (new TraceSpan("deliver"))
+                {
+                    _onReceived?.Invoke(new ArraySegment<byte>(buffer, 0, totalBytesReceived), result.MessageType, receivedAt);
+                }
                 _onLog?.Invoke("Message received.");
             }
         }
@@ -497,22 +1314,37 @@ public class WebSocketClient : IDisposable
         finally
         {
             bufferPool.Return(buffer); // Return the buffer to the pool
+            MemoryLedger.ReceiveBufferReturned(buffer.Length);
         }
     }
 
     public void Disconnect(int closeReason)
     {
+        var shared = Interlocked.Exchange(ref _shared, null);
+        if (shared != null)
+        {
+            shared.Leave(_channelId, closeReason);
+            _onIoError?.Invoke(closeReason, "Closing connection gracefully.");
+            return;
+        }
+
         _ = Task.Run(async () => await DisconnectAsync(closeReason));
     }
 
     private async Task DisconnectAsync(int closeReason, string reason = "Closing connection gracefully.")
     {
-        if (_activeWebSocket is { State: WebSocketState.Open or WebSocketState.CloseReceived })
-        {
+        _closing = true;
+        var webSocket = _activeWebSocket;
+
+        // Reported once per connection, including failed connects and aborted sockets that have nothing to close
+        if (Interlocked.Exchange(ref _closeReported, 1) == 0)
             _onIoError?.Invoke(closeReason, reason);
+
+        if (webSocket is { State: WebSocketState.Open or WebSocketState.CloseReceived })
+        {
             try
             {
-                await _activeWebSocket.CloseAsync((WebSocketCloseStatus)closeReason, $"Closing with reason {closeReason}", CancellationToken.None);
+                await webSocket.CloseAsync((WebSocketCloseStatus)closeReason, $"Closing with reason {closeReason}", CancellationToken.None);
                 _onLog?.Invoke($"Connection closed gracefully. Reason: {closeReason}");
             }
             catch (Exception ex)
@@ -522,14 +1354,56 @@ public class WebSocketClient : IDisposable
         }
 
         _cancellationTokenSource?.Cancel();
+        ReleaseConnection(webSocket);
         _onLog?.Invoke($"Connection closed. Reason: {closeReason}");
     }
 
+    // Disposes a finished connection's socket and HTTP handler; a no-op when it was released already or a newer
+    // connection replaced it meanwhile
+    private void ReleaseConnection(ClientWebSocket webSocket)
+    {
+        if (webSocket == null || Interlocked.CompareExchange(ref _activeWebSocket, null, webSocket) != webSocket)
+            return;
+
+        webSocket.Dispose();
+        if (ConnectionAttachments.TryGetValue(webSocket, out var attachment))
+        {
+            Interlocked.CompareExchange(ref _activeConnection, null, attachment);
+            attachment.Invoker.Dispose();
+        }
+
+        MemoryLedger.ConnectionReleased();
+    }
+
     public void Stop()
     {
         _cancellationTokenSource?.Cancel();
     }
 
+    // Called by MultiplexedConnection while this client is one of its channels
+    internal void OnSharedConnected() => _onConnect?.Invoke();
+
+    internal void DeliverShared(ArraySegment<byte> data, WebSocketMessageType messageType, long receivedAt)
+    {
+        using (new TraceSpan("deliver"))
+        {
+            _onReceived?.Invoke(data, messageType, receivedAt);
+        }
+    }
+
+    internal void OnSharedSent(int length) => OnSent(length);
+
+    internal void OnSharedStatus(string code, string level) => _onStatus?.Invoke(code, level);
+
+    internal void LogShared(string message) => _onLog?.Invoke(message);
+
+    internal void OnSharedClosed(int closeCode, string reason)
+    {
+        _shared = null;
+        MemoryLedger.AddSendQueueBytes(-Interlocked.Exchange(ref _bufferedAmount, 0));
+        _onIoError?.Invoke(closeCode, reason);
+    }
+
     public void Dispose()
     {
         Dispose(true);
@@ -540,17 +1414,22 @@ public class WebSocketClient : IDisposable
     {
         if (!_disposed)
         {
+            _onLog?.Invoke("WebSocket client disposed.");
+
+            // Mark as disposed first, which silences the callbacks
+            _disposed = true;
             if (disposing)
             {
                 // Dispose managed resources
+                Interlocked.Exchange(ref _shared, null)?.Leave(_channelId, (int)WebSocketCloseStatus.NormalClosure);
                 _cancellationTokenSource?.Cancel();
                 _cancellationTokenSource?.Dispose();
-                _activeWebSocket?.Dispose();
+                ReleaseConnection(_activeWebSocket);
+                foreach (var lane in _sendLanes)
+                    lane.Clear();
             }
 
-            // Mark as disposed
-            _disposed = true;
-            _onLog?.Invoke("WebSocket client disposed.");
+            MemoryLedger.AddSendQueueBytes(-Interlocked.Exchange(ref _bufferedAmount, 0));
         }
     }
 
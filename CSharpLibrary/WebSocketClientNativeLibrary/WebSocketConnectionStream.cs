@@ -0,0 +1,352 @@
+using System;
+using System.Buffers.Binary;
+using System.Diagnostics;
+using System.IO;
+using System.Runtime.InteropServices;
+using System.Security.Cryptography;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace WebSocketClientNativeLibrary;
+
+/// <summary>
+/// Plaintext connection stream sitting between ClientWebSocket and the socket/TLS stream. It follows the inbound
+/// frame boundaries so pongs can be observed (ClientWebSocket swallows them) and lets the client inject its own
+/// ping frames between the frames ClientWebSocket writes.
+/// </summary>
+internal sealed class WebSocketConnectionStream : Stream
+{
+    private enum ReadState
+    {
+        HttpResponse,
+        FrameHeader,
+        FramePayload
+    }
+
+    public const byte OpcodeBinary = 0x2;
+    private const byte OpcodePing = 0x9;
+    private const byte OpcodePong = 0xA;
+    private const int PingPayloadLength = 8;
+
+    private readonly Stream _inner;
+    private readonly SemaphoreSlim _writeLock = new(1, 1);
+
+    // Inbound frame tracking, only touched by the single reader
+    private ReadState _readState = ReadState.HttpResponse;
+    private int _httpTerminatorMatched;
+    private readonly byte[] _header = new byte[14];
+    private int _headerLength;
+    private int _headerNeeded = 2;
+    private long _payloadRemaining;
+    private bool _isPong;
+    private readonly byte[] _pongPayload = new byte[125];
+    private int _pongLength;
+
+    private long _lastReadTimestamp;
+
+    public WebSocketConnectionStream(Stream inner)
+    {
+        _inner = inner;
+    }
+
+    /// <summary>
+    /// Raised on the read path with the payload of every pong received.
+    /// </summary>
+    public Action<ReadOnlyMemory<byte>> PongReceived { get; set; }
+
+    /// <summary>
+    /// Stopwatch timestamp of the last successful read, used as a liveness signal while large messages are in flight.
+    /// </summary>
+    public long LastReadTimestamp => Interlocked.Read(ref _lastReadTimestamp);
+
+    /// <summary>
+    /// Writes a masked ping frame carrying the given id, serialized with the frames written by ClientWebSocket.
+    /// </summary>
+    public Task SendPingAsync(ulong id, CancellationToken cancellationToken)
+    {
+        Span<byte> payload = stackalloc byte[PingPayloadLength];
+        Span<byte> mask = stackalloc byte[4];
+        BinaryPrimitives.WriteUInt64BigEndian(payload, id);
+        RandomNumberGenerator.Fill(mask);
+
+        var frame = new byte[MaskedFrameLength(PingPayloadLength)];
+        WriteMaskedFrame(frame, OpcodePing, payload, mask);
+        return WriteFramesAsync(frame, cancellationToken);
+    }
+
+    /// <summary>
+    /// Writes already framed and masked bytes as a single write, never splitting a frame ClientWebSocket is writing.
+    /// </summary>
+    public async Task WriteFramesAsync(ReadOnlyMemory<byte> frames, CancellationToken cancellationToken)
+    {
+        await _writeLock.WaitAsync(cancellationToken).ConfigureAwait(false);
+        try
+        {
+            await _inner.WriteAsync(frames, cancellationToken).ConfigureAwait(false);
+            await _inner.FlushAsync(cancellationToken).ConfigureAwait(false);
+        }
+        finally
+        {
+            _writeLock.Release();
+        }
+    }
+
+    /// <summary>
+    /// Size of a single final client frame (header, mask key and payload) carrying payloadLength bytes.
+    /// </summary>
+    public static int MaskedFrameLength(int payloadLength)
+    {
+        return 2 + (payloadLength < 126 ? 0 : payloadLength <= ushort.MaxValue ? 2 : 8) + 4 + payloadLength;
+    }
+
+    /// <summary>
+    /// Writes a final client frame (FIN set, masked as RFC 6455 requires) into destination and returns its size.
+    /// </summary>
+    public static int WriteMaskedFrame(Span<byte> destination, byte opcode, ReadOnlySpan<byte> payload, ReadOnlySpan<byte> mask)
+    {
+        destination[0] = (byte)(0x80 | opcode);
+        var offset = 2;
+        if (payload.Length < 126)
+        {
+            destination[1] = (byte)(0x80 | payload.Length);
+        }
+        else if (payload.Length <= ushort.MaxValue)
+        {
+            destination[1] = 0x80 | 126;
+            BinaryPrimitives.WriteUInt16BigEndian(destination[2..], (ushort)payload.Length);
+            offset += 2;
+        }
+        else
+        {
+            destination[1] = 0x80 | 127;
+            BinaryPrimitives.WriteUInt64BigEndian(destination[2..], (ulong)payload.Length);
+            offset += 8;
+        }
+
+        mask[..4].CopyTo(destination[offset..]);
+        offset += 4;
+
+        var target = destination.Slice(offset, payload.Length);
+        payload.CopyTo(target);
+
+        // XOR eight bytes at a time; the key repeats every four bytes so it lines up with every 8-byte block
+        Span<byte> pattern = stackalloc byte[8];
+        mask[..4].CopyTo(pattern);
+        mask[..4].CopyTo(pattern[4..]);
+        var key = MemoryMarshal.Read<ulong>(pattern);
+        var blocks = MemoryMarshal.Cast<byte, ulong>(target);
+        for (var i = 0; i < blocks.Length; i++)
+            blocks[i] ^= key;
+        for (var i = blocks.Length * 8; i < target.Length; i++)
+            target[i] ^= mask[i & 3];
+
+        return offset + payload.Length;
+    }
+
+    public static bool TryReadPingId(ReadOnlySpan<byte> pongPayload, out ulong id)
+    {
+        if (pongPayload.Length != PingPayloadLength)
+        {
+            id = 0;
+            return false;
+        }
+
+        id = BinaryPrimitives.ReadUInt64BigEndian(pongPayload);
+        return true;
+    }
+
+    public override async ValueTask<int> ReadAsync(Memory<byte> buffer, CancellationToken cancellationToken = default)
+    {
+        var read = await _inner.ReadAsync(buffer, cancellationToken).ConfigureAwait(false);
+        if (read > 0)
+        {
+            Interlocked.Exchange(ref _lastReadTimestamp, Stopwatch.GetTimestamp());
+            Inspect(buffer.Span[..read]);
+        }
+
+        return read;
+    }
+
+    public override Task<int> ReadAsync(byte[] buffer, int offset, int count, CancellationToken cancellationToken)
+    {
+        return ReadAsync(buffer.AsMemory(offset, count), cancellationToken).AsTask();
+    }
+
+    public override int Read(byte[] buffer, int offset, int count)
+    {
+        return Read(buffer.AsSpan(offset, count));
+    }
+
+    public override int Read(Span<byte> buffer)
+    {
+        var read = _inner.Read(buffer);
+        if (read > 0)
+        {
+            Interlocked.Exchange(ref _lastReadTimestamp, Stopwatch.GetTimestamp());
+            Inspect(buffer[..read]);
+        }
+
+        return read;
+    }
+
+    public override async ValueTask WriteAsync(ReadOnlyMemory<byte> buffer, CancellationToken cancellationToken = default)
+    {
+        await _writeLock.WaitAsync(cancellationToken).ConfigureAwait(false);
+        try
+        {
+            await _inner.WriteAsync(buffer, cancellationToken).ConfigureAwait(false);
+        }
+        finally
+        {
+            _writeLock.Release();
+        }
+    }
+
+    public override Task WriteAsync(byte[] buffer, int offset, int count, CancellationToken cancellationToken)
+    {
+        return WriteAsync(buffer.AsMemory(offset, count), cancellationToken).AsTask();
+    }
+
+    public override void Write(byte[] buffer, int offset, int count)
+    {
+        Write(buffer.AsSpan(offset, count));
+    }
+
+    public override void Write(ReadOnlySpan<byte> buffer)
+    {
+        _writeLock.Wait();
+        try
+        {
+            _inner.Write(buffer);
+        }
+        finally
+        {
+            _writeLock.Release();
+        }
+    }
+
+    public override Task FlushAsync(CancellationToken cancellationToken) => _inner.FlushAsync(cancellationToken);
+
+    public override void Flush() => _inner.Flush();
+
+    public override bool CanRead => _inner.CanRead;
+    public override bool CanWrite => _inner.CanWrite;
+    public override bool CanSeek => false;
+    public override long Length => throw new NotSupportedException();
+
+    public override long Position
+    {
+        get => throw new NotSupportedException();
+        set => throw new NotSupportedException();
+    }
+
+    public override long Seek(long offset, SeekOrigin origin) => throw new NotSupportedException();
+
+    public override void SetLength(long value) => throw new NotSupportedException();
+
+    protected override void Dispose(bool disposing)
+    {
+        if (disposing)
+        {
+            _inner.Dispose();
+        }
+
+        base.Dispose(disposing);
+    }
+
+    public override ValueTask DisposeAsync()
+    {
+        return _inner.DisposeAsync();
+    }
+
+    private void Inspect(ReadOnlySpan<byte> data)
+    {
+        while (!data.IsEmpty)
+        {
+            switch (_readState)
+            {
+                case ReadState.HttpResponse:
+                {
+                    // Skip the upgrade response, frames start right after the blank line
+                    var i = 0;
+                    while (i < data.Length && _httpTerminatorMatched < 4)
+                    {
+                        var expected = (_httpTerminatorMatched & 1) == 0 ? (byte)'\r' : (byte)'\n';
+                        if (data[i] == expected)
+                            _httpTerminatorMatched++;
+                        else
+                            _httpTerminatorMatched = data[i] == '\r' ? 1 : 0;
+                        i++;
+                    }
+
+                    data = data[i..];
+                    if (_httpTerminatorMatched == 4)
+                        _readState = ReadState.FrameHeader;
+                    break;
+                }
+                case ReadState.FrameHeader:
+                {
+                    var take = Math.Min(_headerNeeded - _headerLength, data.Length);
+                    data[..take].CopyTo(_header.AsSpan(_headerLength));
+                    _headerLength += take;
+                    data = data[take..];
+
+                    if (_headerLength == 2)
+                    {
+                        var length7 = _header[1] & 0x7F;
+                        _headerNeeded = 2 + (length7 == 126 ? 2 : length7 == 127 ? 8 : 0) + ((_header[1] & 0x80) != 0 ? 4 : 0);
+                    }
+
+                    if (_headerLength < _headerNeeded)
+                        break;
+
+                    var length = _header[1] & 0x7F;
+                    _payloadRemaining = length switch
+                    {
+                        126 => BinaryPrimitives.ReadUInt16BigEndian(_header.AsSpan(2)),
+                        127 => (long)BinaryPrimitives.ReadUInt64BigEndian(_header.AsSpan(2)),
+                        _ => length
+                    };
+                    _isPong = (_header[0] & 0x0F) == OpcodePong;
+                    _pongLength = 0;
+                    _headerLength = 0;
+                    _headerNeeded = 2;
+
+                    if (_payloadRemaining == 0)
+                        CompleteFrame();
+                    else
+                        _readState = ReadState.FramePayload;
+                    break;
+                }
+                case ReadState.FramePayload:
+                {
+                    var take = (int)Math.Min(_payloadRemaining, data.Length);
+                    if (_isPong && _pongLength + take <= _pongPayload.Length)
+                    {
+                        data[..take].CopyTo(_pongPayload.AsSpan(_pongLength));
+                        _pongLength += take;
+                    }
+
+                    _payloadRemaining -= take;
+                    data = data[take..];
+
+                    if (_payloadRemaining == 0)
+                    {
+                        CompleteFrame();
+                        _readState = ReadState.FrameHeader;
+                    }
+
+                    break;
+                }
+            }
+        }
+    }
+
+    private void CompleteFrame()
+    {
+        if (_isPong)
+        {
+            PongReceived?.Invoke(_pongPayload.AsMemory(0, _pongLength));
+        }
+    }
+}
@@ -0,0 +1,107 @@
+using System;
+using System.Buffers.Binary;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using System.Threading;
+using System.Threading.Tasks;
+using WebSocketClientNativeLibrary;
+
+namespace WebSocketClientTest;
+
+/// <summary>
+/// Batched sends (user-030): per-message cost of one csharpWebSocketLibrary_sendMessage call per message, the path
+/// sendMessage takes, against csharpWebSocketLibrary_sendMessages with 64 length-prefixed records per call. Both go
+/// through the engine's exports with native buffers, as the shims call them; what is left out is the FRE crossing and
+/// ByteArray acquire each call also costs in AIR, which only makes the per-message path dearer.
+/// </summary>
+public static class BatchSendBenchmark
+{
+    private const int Messages = 200_000;
+    private const int BatchSize = 64;
+    private const int Lane = 1;
+
+    private static long _received;
+
+    public static async Task RunAsync()
+    {
+        EngineExports.RegisterCallbacks();
+        await using var server = new LoopbackServer(socket => LoopbackServer.ReceiveAllAsync(socket,
+            (_, _, _) => Interlocked.Increment(ref _received), CancellationToken.None));
+
+        var guid = EngineExports.Open(Benchmarks.Uri(server));
+        while (EngineExports.Connects == 0)
+            await Task.Delay(10);
+        EngineExports.SetSendWatermarks(guid, 64L * 1024 * 1024, 256L * 1024 * 1024);
+
+        Console.WriteLine($"{Messages} messages per run, sendMessages batches of {BatchSize}");
+        foreach (var size in new[] { 32, 256 })
+        {
+            // The first pair warms up the JIT and the connection and is not reported
+            await RunOnceAsync(guid, size, batched: false, report: false);
+            await RunOnceAsync(guid, size, batched: true, report: false);
+            await RunOnceAsync(guid, size, batched: false, report: true);
+            await RunOnceAsync(guid, size, batched: true, report: true);
+        }
+
+        EngineExports.Close(guid);
+    }
+
+    private static async Task RunOnceAsync(IntPtr guid, int size, bool batched, bool report)
+    {
+        var target = Interlocked.Read(ref _received) + Messages;
+        var allocated = GC.GetTotalAllocatedBytes(true);
+        var started = Stopwatch.GetTimestamp();
+        var callTicks = SendAll(guid, size, batched);
+        while (Interlocked.Read(ref _received) < target)
+            await Task.Delay(1);
+        var totalTicks = Stopwatch.GetTimestamp() - started;
+        var allocatedPerMessage = (double)(GC.GetTotalAllocatedBytes(true) - allocated) / Messages;
+
+        if (report)
+        {
+            Console.WriteLine($"  {size,3} B, {(batched ? "sendMessages" : "sendMessage "),-12}: " +
+                              $"{Benchmarks.TicksToMicros(callTicks) * 1000 / Messages,7:F1} ns/message in the calls, " +
+                              $"{Messages / (Benchmarks.TicksToMicros(totalTicks) / 1_000_000) / 1000,7:F0} k messages/s delivered, " +
+                              $"{allocatedPerMessage,6:F1} B allocated/message");
+        }
+    }
+
+    // Sends Messages messages of size bytes and returns the ticks spent in the export calls
+    private static unsafe long SendAll(IntPtr guid, int size, bool batched)
+    {
+        var sendMessage = (delegate* unmanaged[Cdecl]<IntPtr, IntPtr, int, int, int>)&ExportFunctions.SendMessage;
+        var sendMessages = (delegate* unmanaged[Cdecl]<IntPtr, IntPtr, int, int, int>)&ExportFunctions.SendMessages;
+
+        // One message, or one batch of BatchSize records, in native memory as the shims hand them over
+        var recordsLength = BatchSize * (4 + size);
+        var buffer = (byte*)NativeMemory.Alloc((nuint)recordsLength);
+        var records = new Span<byte>(buffer, recordsLength);
+        for (var i = 0; i < BatchSize; i++)
+        {
+            BinaryPrimitives.WriteUInt32BigEndian(records[(i * (4 + size))..], (uint)size);
+            records.Slice(i * (4 + size) + 4, size).Fill((byte)i);
+        }
+
+        var started = Stopwatch.GetTimestamp();
+        if (batched)
+        {
+            for (var sent = 0; sent < Messages; sent += BatchSize)
+            {
+                while (sendMessages(guid, (IntPtr)buffer, recordsLength, Lane) == 0)
+                    Thread.Yield();
+            }
+        }
+        else
+        {
+            for (var sent = 0; sent < Messages; sent++)
+            {
+                while (sendMessage(guid, (IntPtr)(buffer + 4), size, Lane) == 0)
+                    Thread.Yield();
+            }
+        }
+
+        var ticks = Stopwatch.GetTimestamp() - started;
+        NativeMemory.Free(buffer);
+        return ticks;
+    }
+}
@@ -0,0 +1,79 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using System.Net.WebSockets;
+using System.Threading.Tasks;
+using WebSocketClientNativeLibrary;
+
+namespace WebSocketClientTest;
+
+/// <summary>
+/// Engine-side benchmarks against an in-process loopback server: dotnet run -- bench &lt;name&gt;. They drive
+/// WebSocketClient directly, so FRE crossings and the shims are not part of what they measure.
+/// </summary>
+public static class Benchmarks
+{
+    // Resolves through the static hosts, the last step of the engine's resolution, as DoH and DNS fail for it
+    public const string Host = "bench.invalid";
+
+    public static async Task<int> RunAsync(string[] args)
+    {
+        WebSocketClient.AddStaticHost(Host, "127.0.0.1");
+        switch (args.Length > 0 ? args[0] : "")
+        {
+            case "lanes":
+                await LaneBenchmark.RunAsync();
+                return 0;
+            case "batch":
+                await BatchSendBenchmark.RunAsync();
+                return 0;
+            case "soak":
+                await SoakBenchmark.RunAsync(args.Length > 1 ? int.Parse(args[1]) : 100_000);
+                return 0;
+            case "busypoll":
+                await BusyPollBenchmark.RunAsync();
+                return 0;
+            case "impair":
+                await ImpairmentBenchmark.RunAsync();
+                return 0;
+            default:
+                Console.WriteLine("usage: bench lanes|batch|soak [cycles]|busypoll|impair");
+                return 1;
+        }
+    }
+
+    public static string Uri(LoopbackServer server) => $"ws://{Host}:{server.Port}/";
+
+    /// <summary>
+    /// Connects a client whose log goes nowhere; fails when the connection does not open.
+    /// </summary>
+    public static async Task<WebSocketClient> ConnectAsync(string uri, Action<ArraySegment<byte>, WebSocketMessageType, long> onReceived, ConnectOptions? options = null, Action<WebSocketClient> configure = null)
+    {
+        var connected = new TaskCompletionSource(TaskCreationOptions.RunContinuationsAsynchronously);
+        var client = new WebSocketClient(
+            () => connected.TrySetResult(),
+            onReceived,
+            (code, error) => connected.TrySetException(new InvalidOperationException($"connect failed: {code} {error}")),
+            _ => { });
+        configure?.Invoke(client);
+        await client.ConnectAsync(uri, options);
+        await connected.Task.WaitAsync(TimeSpan.FromSeconds(30));
+        return client;
+    }
+
+    public static double TicksToMicros(long ticks) => ticks * 1_000_000.0 / Stopwatch.Frequency;
+
+    /// <summary>
+    /// "p50 .. p90 .. p99 .. max .." of samples in microseconds, printed in milliseconds.
+    /// </summary>
+    public static string Percentiles(List<double> micros)
+    {
+        if (micros.Count == 0)
+            return "no samples";
+
+        var sorted = micros.OrderBy(x => x).ToArray();
+        double At(double q) => sorted[Math.Min(sorted.Length - 1, (int)(q * sorted.Length))] / 1000;
+        return $"p50 {At(0.5):F2} ms, p90 {At(0.9):F2} ms, p99 {At(0.99):F2} ms, max {sorted[^1] / 1000:F2} ms ({sorted.Length} samples)";
+    }
+}
@@ -0,0 +1,75 @@
+using System;
+using System.Buffers.Binary;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Net.WebSockets;
+using System.Text.Json;
+using System.Threading;
+using System.Threading.Tasks;
+using WebSocketClientNativeLibrary;
+
+namespace WebSocketClientTest;
+
+/// <summary>
+/// Busy-poll receive (user-041): the server sends a 64-byte message stamped with the Stopwatch time about every
+/// millisecond, and the client records how long each took to reach onReceived, in the default mode and with the
+/// busy-poll thread at two spin budgets. The short budget parks between messages, the long one never does. Also
+/// prints the engine's socket-read-to-deliver p99 and the CPU each mode cost the process.
+/// </summary>
+public static class BusyPollBenchmark
+{
+    private const int Messages = 3000;
+
+    public static async Task RunAsync()
+    {
+        Console.WriteLine($"{Messages} messages, ~1 ms apart, {Environment.ProcessorCount} processors");
+        await RunModeAsync("default", 0);
+        await RunModeAsync("busy poll, spin 100 us", 100);
+        await RunModeAsync("busy poll, spin 2000 us", 2000);
+    }
+
+    private static async Task RunModeAsync(string name, int spinMicros)
+    {
+        var latencies = new List<double>(Messages);
+        var done = new TaskCompletionSource(TaskCreationOptions.RunContinuationsAsynchronously);
+        await using var server = new LoopbackServer(async socket =>
+        {
+            var message = new byte[64];
+            for (var i = 0; i < Messages; i++)
+            {
+                BinaryPrimitives.WriteInt64LittleEndian(message, Stopwatch.GetTimestamp());
+                await socket.SendAsync(message, WebSocketMessageType.Binary, true, CancellationToken.None);
+                await Task.Delay(1);
+            }
+
+            await done.Task;
+        });
+
+        var client = await Benchmarks.ConnectAsync(Benchmarks.Uri(server), (data, _, _) =>
+        {
+            var latency = Benchmarks.TicksToMicros(Stopwatch.GetTimestamp() - BinaryPrimitives.ReadInt64LittleEndian(data));
+            lock (latencies)
+            {
+                latencies.Add(latency);
+                if (latencies.Count == Messages)
+                    done.TrySetResult();
+            }
+        }, configure: c => c.SetBusyPoll(spinMicros, -1));
+
+        var cpu = Process.GetCurrentProcess().TotalProcessorTime;
+        var wall = Stopwatch.StartNew();
+        await done.Task.WaitAsync(TimeSpan.FromMinutes(2));
+        var cpuShare = (Process.GetCurrentProcess().TotalProcessorTime - cpu).TotalMilliseconds / wall.Elapsed.TotalMilliseconds;
+
+        using var stats = JsonDocument.Parse(client.GetIoStats());
+        var readToDeliverP99 = stats.RootElement.GetProperty("readToDeliver").GetProperty("p99").GetRawText();
+        client.Disconnect((int)WebSocketCloseStatus.NormalClosure);
+        client.Dispose();
+
+        lock (latencies)
+        {
+            Console.WriteLine($"  {name}: send to onReceived {Benchmarks.Percentiles(latencies)}");
+        }
+        Console.WriteLine($"    read to deliver p99 {readToDeliverP99} us, process CPU {cpuShare * 100:F0}% of one core");
+    }
+}
@@ -1,9 +1,14 @@
 ﻿using System;
 using WebSocketClientNativeLibrary;
+using WebSocketClientTest;
+
+// dotnet run -- bench <name> runs one of the engine benchmarks instead of the interactive client
+if (args.Length > 0 && args[0] == "bench")
+    return await Benchmarks.RunAsync(args[1..]);
 
 var client = new WebSocketClient(
     () => Console.WriteLine("connected"),
-    data => Console.WriteLine($"received message: {data}"),
+    (data, messageType, _) => Console.WriteLine($"received {messageType} message: {System.Text.Encoding.UTF8.GetString(data)}"),
     (closeCode, error) => Console.WriteLine($"io error: {closeCode} - {error}"),
     message => Console.WriteLine($"log: {message}")
 );
@@ -22,4 +27,6 @@ while (true)
     byte[] data = System.Text.Encoding.UTF8.GetBytes(message);
     
     client.Send(data);
-}
\ No newline at end of file
+}
+
+return 0;
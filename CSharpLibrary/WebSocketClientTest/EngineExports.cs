@@ -0,0 +1,84 @@
+using System;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using System.Threading;
+using WebSocketClientNativeLibrary;
+
+namespace WebSocketClientTest;
+
+/// <summary>
+/// Drives the engine through its csharpWebSocketLibrary_* exports, called through function pointers with native
+/// buffers and guid strings the way the shims call them, for benchmarks of the export layer itself.
+/// </summary>
+public static unsafe class EngineExports
+{
+    private static int _connects;
+    private static int _errors;
+
+    /// <summary>
+    /// Connect callbacks received so far, from any client.
+    /// </summary>
+    public static int Connects => Volatile.Read(ref _connects);
+
+    /// <summary>
+    /// I/O error callbacks received so far, from any client.
+    /// </summary>
+    public static int Errors => Volatile.Read(ref _errors);
+
+    [UnmanagedCallersOnly(CallConvs = [typeof(CallConvCdecl)])]
+    private static void OnConnect(IntPtr context) => Interlocked.Increment(ref _connects);
+
+    [UnmanagedCallersOnly(CallConvs = [typeof(CallConvCdecl)])]
+    private static void OnReceived(IntPtr context, IntPtr data, int length, int messageType, long receivedAgeNanos)
+    {
+    }
+
+    [UnmanagedCallersOnly(CallConvs = [typeof(CallConvCdecl)])]
+    private static void OnIoError(IntPtr context, int closeCode, IntPtr message) => Interlocked.Increment(ref _errors);
+
+    [UnmanagedCallersOnly(CallConvs = [typeof(CallConvCdecl)])]
+    private static void OnLog(IntPtr message)
+    {
+    }
+
+    [UnmanagedCallersOnly(CallConvs = [typeof(CallConvCdecl)])]
+    private static void OnStatus(IntPtr context, IntPtr code, IntPtr level)
+    {
+    }
+
+    public static void RegisterCallbacks()
+    {
+        ((delegate* unmanaged[Cdecl]<IntPtr, IntPtr, IntPtr, IntPtr, IntPtr, int>)&ExportFunctions.InitializerCallbacks)(
+            (IntPtr)(delegate* unmanaged[Cdecl]<IntPtr, void>)&OnConnect,
+            (IntPtr)(delegate* unmanaged[Cdecl]<IntPtr, IntPtr, int, int, long, void>)&OnReceived,
+            (IntPtr)(delegate* unmanaged[Cdecl]<IntPtr, int, IntPtr, void>)&OnIoError,
+            (IntPtr)(delegate* unmanaged[Cdecl]<IntPtr, void>)&OnLog,
+            (IntPtr)(delegate* unmanaged[Cdecl]<IntPtr, IntPtr, IntPtr, void>)&OnStatus);
+    }
+
+    /// <summary>
+    /// createWebSocketClient followed by connect; returns the client's guid string.
+    /// </summary>
+    public static IntPtr Open(string uri)
+    {
+        var guid = ((delegate* unmanaged[Cdecl]<IntPtr, IntPtr>)&ExportFunctions.CreateWebSocketClient)(IntPtr.Zero);
+        var uriPointer = Marshal.StringToCoTaskMemAnsi(uri);
+        ((delegate* unmanaged[Cdecl]<IntPtr, IntPtr, int>)&ExportFunctions.Connect)(guid, uriPointer);
+        Marshal.FreeCoTaskMem(uriPointer);
+        return guid;
+    }
+
+    public static void SetSendWatermarks(IntPtr guid, long low, long high)
+    {
+        ((delegate* unmanaged[Cdecl]<IntPtr, long, long, int>)&ExportFunctions.SetSendWatermarks)(guid, low, high);
+    }
+
+    /// <summary>
+    /// disconnect followed by destroyWebSocketClient, as the context finalizer does; guid is freed.
+    /// </summary>
+    public static void Close(IntPtr guid)
+    {
+        ((delegate* unmanaged[Cdecl]<IntPtr, int, int>)&ExportFunctions.Disconnect)(guid, 1000);
+        ((delegate* unmanaged[Cdecl]<IntPtr, int>)&ExportFunctions.DestroyWebSocketClient)(guid);
+    }
+}
@@ -0,0 +1,165 @@
+using System;
+using System.Buffers.Binary;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Net.WebSockets;
+using System.Text;
+using System.Text.Json;
+using System.Threading;
+using System.Threading.Tasks;
+using WebSocketClientNativeLibrary;
+
+namespace WebSocketClientTest;
+
+/// <summary>
+/// Network impairment (user-046): connect time when the first address of a host is blackholed, so the parallel
+/// connect has to fall through to the second after the attempt delay, and echo round trips and downlink throughput
+/// under mobile-like link profiles. The server listens on every loopback address; the impairment decides per address
+/// what the client sees. Draws are seeded, so runs repeat.
+/// </summary>
+public static class ImpairmentBenchmark
+{
+    private const string RaceHost = "race.invalid";
+    private const int Connects = 10;
+    private const int EchoSize = 64;
+    private static readonly TimeSpan Duration = TimeSpan.FromSeconds(3);
+
+    private static readonly (string Name, string Profile)[] Profiles =
+    {
+        ("wifi", "{\"latencyMs\":5,\"jitterMs\":2}"),
+        ("4g", "{\"latencyMs\":30,\"jitterMs\":10,\"downlinkBytesPerSecond\":4000000,\"uplinkBytesPerSecond\":1000000,\"lossPercent\":0.5}"),
+        ("lossy 3g", "{\"latencyMs\":100,\"jitterMs\":30,\"downlinkBytesPerSecond\":500000,\"uplinkBytesPerSecond\":200000,\"lossPercent\":2,\"stallPercent\":1,\"stallMs\":500}"),
+    };
+
+    public static async Task RunAsync()
+    {
+        // 127.0.0.2 sorts first, so it is always the first candidate the race tries
+        WebSocketClient.AddStaticHost(RaceHost, "127.0.0.2");
+        WebSocketClient.AddStaticHost(RaceHost, "127.0.0.3");
+        await using var server = new LoopbackServer(ServeAsync, "0.0.0.0");
+        try
+        {
+            Console.WriteLine($"Connect to {RaceHost} (127.0.0.2, 127.0.0.3), 20 ms one-way latency, {Connects} connects each");
+            await RunRaceAsync(server, "both reachable", blackholeFirst: false, attemptDelayMs: 250);
+            await RunRaceAsync(server, "127.0.0.2 blackholed, attempt delay 250 ms", blackholeFirst: true, attemptDelayMs: 250);
+            await RunRaceAsync(server, "127.0.0.2 blackholed, attempt delay 50 ms", blackholeFirst: true, attemptDelayMs: 50);
+
+            Console.WriteLine($"Echo round trips of {EchoSize} B every 20 ms and downlink throughput, {Duration.TotalSeconds:F0} s each");
+            await RunProfileAsync(server, "loopback", null);
+            foreach (var (name, profile) in Profiles)
+                await RunProfileAsync(server, name, profile);
+        }
+        finally
+        {
+            NetworkImpairment.Configure("");
+        }
+    }
+
+    // "echo" echoes every message, "push" sends 16 KB messages for Duration, anything else is read and dropped
+    private static async Task ServeAsync(WebSocket socket)
+    {
+        var buffer = new byte[64 * 1024];
+        var first = await socket.ReceiveAsync(buffer.AsMemory(), CancellationToken.None);
+        if (first.MessageType == WebSocketMessageType.Close)
+            return;
+
+        var mode = Encoding.ASCII.GetString(buffer, 0, first.Count);
+        if (mode == "push")
+        {
+            var message = new byte[16 * 1024];
+            var started = Stopwatch.StartNew();
+            while (started.Elapsed < Duration)
+                await socket.SendAsync(message, WebSocketMessageType.Binary, true, CancellationToken.None);
+        }
+
+        await LoopbackServer.ReceiveAllAsync(socket, (data, length, type) =>
+        {
+            if (mode == "echo")
+                socket.SendAsync(data.AsMemory(0, length), type, true, CancellationToken.None).AsTask().Wait();
+        }, CancellationToken.None);
+    }
+
+    private static async Task RunRaceAsync(LoopbackServer server, string name, bool blackholeFirst, int attemptDelayMs)
+    {
+        var first = blackholeFirst ? "{\"blackhole\":true}" : "{\"latencyMs\":20}";
+        NetworkImpairment.Configure($"{{\"seed\":1,\"addresses\":{{\"127.0.0.2\":{first},\"127.0.0.3\":{{\"latencyMs\":20}}}}}}");
+        var options = ConnectOptions.Default;
+        options.AttemptDelayMs = attemptDelayMs;
+
+        // The first connect warms up the JIT and is not counted
+        var times = new List<double>();
+        for (var i = 0; i <= Connects; i++)
+        {
+            var started = Stopwatch.GetTimestamp();
+            var client = await Benchmarks.ConnectAsync($"ws://{RaceHost}:{server.Port}/", (_, _, _) => { }, options);
+            if (i > 0)
+                times.Add(Benchmarks.TicksToMicros(Stopwatch.GetTimestamp() - started));
+            client.Disconnect((int)WebSocketCloseStatus.NormalClosure);
+            client.Dispose();
+        }
+
+        Console.WriteLine($"  {name}: connect {Benchmarks.Percentiles(times)}");
+    }
+
+    private static async Task RunProfileAsync(LoopbackServer server, string name, string profile)
+    {
+        NetworkImpairment.Configure(profile == null ? "" : $"{{\"seed\":1,\"default\":{profile}}}");
+        var uri = Benchmarks.Uri(server);
+
+        var latencies = new List<double>();
+        var echo = await Benchmarks.ConnectAsync(uri, (data, _, _) =>
+        {
+            var latency = Benchmarks.TicksToMicros(Stopwatch.GetTimestamp() - BinaryPrimitives.ReadInt64LittleEndian(data));
+            lock (latencies)
+                latencies.Add(latency);
+        });
+        echo.Send("echo"u8.ToArray());
+        var started = Stopwatch.StartNew();
+        while (started.Elapsed < Duration)
+        {
+            var probe = new byte[EchoSize];
+            BinaryPrimitives.WriteInt64LittleEndian(probe, Stopwatch.GetTimestamp());
+            echo.Send(probe);
+            await Task.Delay(20);
+        }
+
+        // Echoes still on the way are let in, so the slow tail is not cut off
+        await Task.Delay(1000);
+        echo.Disconnect((int)WebSocketCloseStatus.NormalClosure);
+        echo.Dispose();
+
+        long received = 0;
+        var firstByte = 0L;
+        var lastByte = 0L;
+        var push = await Benchmarks.ConnectAsync(uri, (data, _, _) =>
+        {
+            var now = Stopwatch.GetTimestamp();
+            Interlocked.CompareExchange(ref firstByte, now, 0);
+            Volatile.Write(ref lastByte, now);
+            Interlocked.Add(ref received, data.Count);
+        });
+        push.Send("push"u8.ToArray());
+        var pushing = Stopwatch.StartNew();
+
+        // The server stops pushing after Duration; what is queued behind the bandwidth cap keeps arriving for a while
+        var quiet = 0;
+        while (quiet < 10 && pushing.Elapsed < Duration * 4)
+        {
+            var before = Interlocked.Read(ref received);
+            await Task.Delay(100);
+            quiet = Interlocked.Read(ref received) == before && before > 0 ? quiet + 1 : 0;
+        }
+
+        var throughput = Interlocked.Read(ref received) / Benchmarks.TicksToMicros(Volatile.Read(ref lastByte) - Interlocked.Read(ref firstByte));
+        push.Disconnect((int)WebSocketCloseStatus.NormalClosure);
+        push.Dispose();
+
+        using var stats = JsonDocument.Parse(NetworkImpairment.GetStats());
+        lock (latencies)
+        {
+            Console.WriteLine($"  {name}: round trip {Benchmarks.Percentiles(latencies)}");
+        }
+        Console.WriteLine($"    downlink {throughput:F2} MB/s, {stats.RootElement.GetProperty("losses").GetInt64()} losses, " +
+                          $"{stats.RootElement.GetProperty("stalls").GetInt64()} stalls");
+    }
+}
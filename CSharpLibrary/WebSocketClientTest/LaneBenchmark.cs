@@ -0,0 +1,93 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Text.Json;
+using System.Threading;
+using System.Threading.Tasks;
+using WebSocketClientNativeLibrary;
+
+namespace WebSocketClientTest;
+
+/// <summary>
+/// Send lanes (user-027): 40-byte probes sent every 5 ms while bulk messages keep the uplink busy, with the probes'
+/// send-to-server latency compared between one FIFO lane and the control/bulk lanes, at two bulk message sizes. The
+/// uplink is capped at 25 MB/s through NetworkImpairment so a 2 MB message takes about 80 ms on the wire.
+/// </summary>
+public static class LaneBenchmark
+{
+    private const int ProbeSize = 40;
+    private const long UplinkBytesPerSecond = 25_000_000;
+    private static readonly TimeSpan Duration = TimeSpan.FromSeconds(4);
+
+    public static async Task RunAsync()
+    {
+        NetworkImpairment.Configure($"{{\"default\":{{\"uplinkBytesPerSecond\":{UplinkBytesPerSecond}}}}}");
+        try
+        {
+            Console.WriteLine($"Probe latency under bulk upload, uplink {UplinkBytesPerSecond / 1_000_000} MB/s");
+            await RunScenarioAsync("one FIFO lane, 2 MB bulk messages", 2 * 1024 * 1024, bulkLane: 1, probeLane: 1);
+            await RunScenarioAsync("control/bulk lanes, 2 MB bulk messages", 2 * 1024 * 1024, bulkLane: 2, probeLane: 0);
+            await RunScenarioAsync("control/bulk lanes, 64 KB bulk messages", 64 * 1024, bulkLane: 2, probeLane: 0);
+        }
+        finally
+        {
+            NetworkImpairment.Configure("");
+        }
+    }
+
+    private static async Task RunScenarioAsync(string name, int bulkSize, int bulkLane, int probeLane)
+    {
+        var latencies = new List<double>();
+        long bulkBytes = 0;
+        await using var server = new LoopbackServer(socket => LoopbackServer.ReceiveAllAsync(socket, (buffer, length, _) =>
+        {
+            if (length == ProbeSize)
+            {
+                var sentAt = BitConverter.ToInt64(buffer, 0);
+                lock (latencies)
+                    latencies.Add(Benchmarks.TicksToMicros(Stopwatch.GetTimestamp() - sentAt));
+            }
+            else
+            {
+                Interlocked.Add(ref bulkBytes, length);
+            }
+        }, CancellationToken.None));
+
+        var client = await Benchmarks.ConnectAsync(Benchmarks.Uri(server), (_, _, _) => { });
+        client.SetSendWatermarks(64L * 1024 * 1024, 256L * 1024 * 1024);
+
+        var bulk = new byte[bulkSize];
+        var started = Stopwatch.StartNew();
+        var bulkProducer = Task.Run(async () =>
+        {
+            while (started.Elapsed < Duration)
+            {
+                // Keep about 4 MB of bulk queued so the uplink never idles
+                while (client.BufferedAmount < 4 * 1024 * 1024)
+                    client.Send(bulk, bulkLane);
+                await Task.Delay(1);
+            }
+        });
+
+        while (started.Elapsed < Duration)
+        {
+            var probe = new byte[ProbeSize];
+            BitConverter.TryWriteBytes(probe, Stopwatch.GetTimestamp());
+            client.Send(probe, probeLane);
+            await Task.Delay(5);
+        }
+
+        await bulkProducer;
+        using var stats = JsonDocument.Parse(client.GetSendLaneStats());
+        var blocked = stats.RootElement.GetProperty("lanes")[probeLane].GetProperty("blockedBehindFragmented").GetInt64();
+        var throughput = Interlocked.Read(ref bulkBytes) / started.Elapsed.TotalSeconds / 1_000_000;
+        client.Disconnect((int)System.Net.WebSockets.WebSocketCloseStatus.NormalClosure);
+        client.Dispose();
+
+        lock (latencies)
+        {
+            Console.WriteLine($"  {name}: probes {Benchmarks.Percentiles(latencies)}");
+        }
+        Console.WriteLine($"    bulk {throughput:F1} MB/s received, probe lane blocked behind a fragmented message {blocked} times");
+    }
+}
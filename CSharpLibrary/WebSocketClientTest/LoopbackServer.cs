@@ -0,0 +1,137 @@
+using System;
+using System.IO;
+using System.Net;
+using System.Net.Sockets;
+using System.Net.WebSockets;
+using System.Security.Cryptography;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace WebSocketClientTest;
+
+/// <summary>
+/// Minimal WebSocket server for the benchmarks. It accepts on a loopback address and hands every upgraded connection
+/// to the handler, so a run needs neither the network nor a separate server process.
+/// </summary>
+public sealed class LoopbackServer : IAsyncDisposable
+{
+    private const string AcceptGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+    private readonly TcpListener _listener;
+    private readonly Func<WebSocket, Task> _handler;
+    private readonly CancellationTokenSource _stop = new();
+    private readonly Task _acceptLoop;
+
+    public LoopbackServer(Func<WebSocket, Task> handler, string address = "127.0.0.1")
+    {
+        _handler = handler;
+        _listener = new TcpListener(IPAddress.Parse(address), 0);
+        _listener.Start(1024);
+        _acceptLoop = AcceptLoopAsync();
+    }
+
+    public int Port => ((IPEndPoint)_listener.LocalEndpoint).Port;
+
+    public CancellationToken Stopping => _stop.Token;
+
+    /// <summary>
+    /// Reads whole messages until the peer closes, handing each one to onMessage in a buffer reused between calls.
+    /// </summary>
+    public static async Task ReceiveAllAsync(WebSocket socket, Action<byte[], int, WebSocketMessageType> onMessage, CancellationToken cancellationToken)
+    {
+        var buffer = new byte[64 * 1024];
+        while (socket.State == WebSocketState.Open)
+        {
+            var length = 0;
+            ValueWebSocketReceiveResult result;
+            do
+            {
+                if (length == buffer.Length)
+                    Array.Resize(ref buffer, buffer.Length * 2);
+                result = await socket.ReceiveAsync(buffer.AsMemory(length), cancellationToken);
+                if (result.MessageType == WebSocketMessageType.Close)
+                    return;
+                length += result.Count;
+            } while (!result.EndOfMessage);
+
+            onMessage(buffer, length, result.MessageType);
+        }
+    }
+
+    private async Task AcceptLoopAsync()
+    {
+        while (!_stop.IsCancellationRequested)
+        {
+            TcpClient client;
+            try
+            {
+                client = await _listener.AcceptTcpClientAsync(_stop.Token);
+            }
+            catch (Exception e) when (e is SocketException or OperationCanceledException or ObjectDisposedException)
+            {
+                return;
+            }
+
+            _ = ServeAsync(client);
+        }
+    }
+
+    private async Task ServeAsync(TcpClient client)
+    {
+        using (client)
+        {
+            client.NoDelay = true;
+            var stream = client.GetStream();
+            try
+            {
+                var key = await ReadUpgradeKeyAsync(stream);
+                if (key == null)
+                    return;
+
+                var accept = Convert.ToBase64String(SHA1.HashData(Encoding.ASCII.GetBytes(key + AcceptGuid)));
+                await stream.WriteAsync(Encoding.ASCII.GetBytes(
+                    $"HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: {accept}\r\n\r\n"), _stop.Token);
+
+                using var socket = WebSocket.CreateFromStream(stream, new WebSocketCreationOptions
+                {
+                    IsServer = true,
+                    KeepAliveInterval = Timeout.InfiniteTimeSpan
+                });
+                await _handler(socket);
+            }
+            catch (Exception e) when (e is IOException or WebSocketException or OperationCanceledException)
+            {
+                // Client went away or the server is stopping
+            }
+        }
+    }
+
+    // Reads the upgrade request a byte at a time, so nothing past the headers is consumed, and returns its key
+    private async Task<string> ReadUpgradeKeyAsync(NetworkStream stream)
+    {
+        var request = new StringBuilder();
+        var one = new byte[1];
+        while (!request.ToString().EndsWith("\r\n\r\n", StringComparison.Ordinal))
+        {
+            if (await stream.ReadAsync(one, _stop.Token) == 0 || request.Length > 16 * 1024)
+                return null;
+            request.Append((char)one[0]);
+        }
+
+        foreach (var line in request.ToString().Split("\r\n"))
+        {
+            if (line.StartsWith("Sec-WebSocket-Key:", StringComparison.OrdinalIgnoreCase))
+                return line.Substring("Sec-WebSocket-Key:".Length).Trim();
+        }
+
+        return null;
+    }
+
+    public async ValueTask DisposeAsync()
+    {
+        await _stop.CancelAsync();
+        _listener.Stop();
+        await _acceptLoop;
+    }
+}
@@ -0,0 +1,70 @@
+using System;
+using System.Diagnostics;
+using System.Text.Json;
+using System.Threading;
+using System.Threading.Tasks;
+using WebSocketClientNativeLibrary;
+
+namespace WebSocketClientTest;
+
+/// <summary>
+/// Connection lifecycle soak (user-039): create, connect, disconnect and destroy a client through the exports, as
+/// one AIR context does, for many cycles, and print the memory ledger with the managed heap and working set at every
+/// tenth of the run. Memory that is still growing in the last samples is a leak.
+/// </summary>
+public static class SoakBenchmark
+{
+    public static async Task RunAsync(int cycles)
+    {
+        EngineExports.RegisterCallbacks();
+        var serverConnections = 0;
+        await using var server = new LoopbackServer(async socket =>
+        {
+            Interlocked.Increment(ref serverConnections);
+            try
+            {
+                await LoopbackServer.ReceiveAllAsync(socket, (_, _, _) => { }, CancellationToken.None);
+            }
+            finally
+            {
+                Interlocked.Decrement(ref serverConnections);
+            }
+        });
+
+        var uri = Benchmarks.Uri(server);
+        Console.WriteLine($"{cycles} connect/close cycles");
+        var started = Stopwatch.StartNew();
+        for (var cycle = 1; cycle <= cycles; cycle++)
+        {
+            var connects = EngineExports.Connects;
+            var guid = EngineExports.Open(uri);
+            while (EngineExports.Connects == connects)
+            {
+                if (EngineExports.Errors > 0)
+                    throw new InvalidOperationException($"connect failed in cycle {cycle}");
+                await Task.Yield();
+            }
+
+            EngineExports.Close(guid);
+            if (cycle % Math.Max(1, cycles / 10) == 0)
+                Sample(cycle, started.Elapsed, serverConnections);
+        }
+
+        // Closes still in flight finish in the background; give them a moment before the final sample
+        await Task.Delay(2000);
+        Sample(cycles, started.Elapsed, serverConnections);
+    }
+
+    private static void Sample(int cycle, TimeSpan elapsed, int serverConnections)
+    {
+        GC.Collect();
+        GC.WaitForPendingFinalizers();
+        GC.Collect();
+        using var ledger = JsonDocument.Parse(MemoryLedger.GetStats());
+        long Count(string name) => ledger.RootElement.GetProperty(name).GetInt64();
+        Console.WriteLine($"  {cycle,7} cycles {elapsed.TotalSeconds,6:F0} s: heap {GC.GetTotalMemory(false) / 1024,5} KB, " +
+                          $"working set {Environment.WorkingSet / (1024 * 1024),4} MB, live clients {Count("liveClients")}, " +
+                          $"connections {Count("liveConnections")}, receive buffers {Count("receiveBuffers")}, " +
+                          $"send queue {Count("sendQueueBytes")} B, server connections {serverConnections}");
+    }
+}
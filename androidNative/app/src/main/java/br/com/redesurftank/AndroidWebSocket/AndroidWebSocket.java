@@ -2,8 +2,10 @@ package br.com.redesurftank.AndroidWebSocket;
 
 import android.net.TrafficStats;
 
+import org.java_websocket.WebSocket;
 import org.java_websocket.client.WebSocketClient;
 import org.java_websocket.drafts.Draft;
+import org.java_websocket.framing.Framedata;
 import org.java_websocket.handshake.ServerHandshake;
 
 import java.net.URI;
@@ -62,6 +64,10 @@ public class AndroidWebSocket extends WebSocketClient {
     @Override
     public void onOpen(ServerHandshake handshakedata) {
         AndroidWebSocketLogger.d(TAG, "Callback: onConnected");
+        AndroidWebSocketExtensionContext context = this._context;
+        if (context != null) {
+            context.restartKeepAlive();
+        }
         dispatchStatusEventAsync("connected", "");
 
     }
@@ -69,14 +75,33 @@ public class AndroidWebSocket extends WebSocketClient {
     @Override
     public void onMessage(String message) {
         AndroidWebSocketLogger.d(TAG, "Callback: onTextMessage");
+        AndroidWebSocketExtensionContext context = this._context;
+        if (context != null) {
+            context.onMessageReceived();
+        }
         dispatchStatusEventAsync("textMessage", message);
     }
 
     @Override
     public void onMessage(ByteBuffer bytes) {
         AndroidWebSocketLogger.d(TAG, "Callback: onBinaryMessage");
-        this._context.addByteBuffer(bytes.array());
+        AndroidWebSocketExtensionContext context = this._context;
+        if (context == null) {
+            AndroidWebSocketLogger.e(TAG, "Context is null");
+            return;
+        }
+        context.onMessageReceived();
+        context.addByteBuffer(bytes.array());
         dispatchStatusEventAsync("nextMessage", "");
+        context.awaitReceiveCapacity(this);
+    }
+
+    @Override
+    public void onWebsocketPong(WebSocket conn, Framedata f) {
+        AndroidWebSocketExtensionContext context = this._context;
+        if (context != null) {
+            context.onPongReceived(f.getPayloadData());
+        }
     }
 
     @Override
@@ -10,8 +10,14 @@ import com.adobe.fre.FREContext;
 import com.adobe.fre.FREFunction;
 import com.adobe.fre.FREObject;
 
+import org.java_websocket.WebSocketImpl;
 import org.java_websocket.client.DnsResolver;
 import org.java_websocket.drafts.Draft_6455;
+import org.java_websocket.extensions.IExtension;
+import org.java_websocket.framing.Framedata;
+import org.java_websocket.framing.PingFrame;
+import org.java_websocket.protocols.IProtocol;
+import org.java_websocket.protocols.Protocol;
 import org.xbill.DNS.DClass;
 import org.xbill.DNS.DohResolver;
 import org.xbill.DNS.Message;
@@ -29,7 +35,10 @@ import java.net.Socket;
 import java.net.SocketAddress;
 import java.net.URI;
 import java.net.UnknownHostException;
+import java.nio.ByteBuffer;
 import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Collections;
 import java.util.HashMap;
 import java.util.List;
 import java.util.Map;
@@ -39,6 +48,9 @@ import java.util.concurrent.CompletableFuture;
 import java.util.concurrent.ConcurrentLinkedQueue;
 import java.util.concurrent.ExecutorService;
 import java.util.concurrent.Executors;
+import java.util.concurrent.ScheduledExecutorService;
+import java.util.concurrent.ScheduledFuture;
+import java.util.concurrent.TimeUnit;
 
 public class AndroidWebSocketExtensionContext extends FREContext {
 
@@ -47,6 +59,45 @@ public class AndroidWebSocketExtensionContext extends FREContext {
     private AndroidWebSocket _socket;
     private final Queue<byte[]> _byteBufferQueue;
     private static final Map<String, List<String>> _staticHosts = new HashMap<>();
+    private static final ScheduledExecutorService _drainScheduler = Executors.newSingleThreadScheduledExecutor();
+
+    private final Object _receiveLock = new Object();
+    private long _receivedBytes;
+    private int _receivedMessages;
+    private long _receiveLowBytes = 4 * 1024 * 1024;
+    private long _receiveHighBytes = 16 * 1024 * 1024;
+    private int _receiveLowMessages = 1024;
+    private int _receiveHighMessages = 4096;
+
+    private long _sendLowWatermark = 1024 * 1024;
+    private long _sendHighWatermark = 4 * 1024 * 1024;
+    private boolean _drainScheduled;
+
+    private static final int RTT_SAMPLES = 1024;
+    // Java-WebSocket's own dead-peer check, the liveness check while the keepalive cycle is off
+    private static final int CONNECTION_LOST_TIMEOUT_SECONDS = 60;
+    // Used when only the keepAliveIntervalMs connect option turned keepalive on, as it carries no timeout
+    private static final int DEFAULT_KEEPALIVE_TIMEOUT_MS = 30000;
+    // Off until setKeepAlive or the keepAliveIntervalMs connect option turns it on, as on the other platforms
+    private int _keepAliveIntervalMs;
+    private int _keepAliveTimeoutMs;
+    private int _keepAliveStatusIntervalMs;
+    private ScheduledFuture<?> _keepAliveTask;
+    private long _pingId;
+    private long _pingSentAt;
+    private boolean _pongPending;
+    private volatile long _lastReceiveAt;
+    private long _lastStatusAt;
+    private double _smoothedRttMicros = -1;
+    private double _rttVarianceMicros;
+    private long _lastRttMicros;
+    private long _pingsSent;
+    private long _pongsReceived;
+    private long _keepAliveTimeouts;
+    private final long[] _rttSamples = new long[RTT_SAMPLES];
+    private long _rttSampleCount;
+    private long _rttSum;
+    private long _rttMax;
 
     public AndroidWebSocketExtensionContext(String extensionName) {
         this.tag = extensionName + "." + CTX_NAME;
@@ -59,9 +110,236 @@ public class AndroidWebSocketExtensionContext extends FREContext {
     }
 
     public boolean addByteBuffer(byte[] byteBuffer) {
+        synchronized (_receiveLock) {
+            _receivedBytes += byteBuffer.length;
+            _receivedMessages++;
+        }
         return _byteBufferQueue.add(byteBuffer);
     }
 
+    private byte[] pollByteBuffer() {
+        byte[] byteBuffer = _byteBufferQueue.poll();
+        if (byteBuffer != null) {
+            synchronized (_receiveLock) {
+                _receivedBytes -= byteBuffer.length;
+                _receivedMessages--;
+                if (_receivedBytes <= _receiveLowBytes && _receivedMessages <= _receiveLowMessages) {
+                    _receiveLock.notifyAll();
+                }
+            }
+        }
+        return byteBuffer;
+    }
+
+    /**
+     * Called on the socket read thread after a message was queued. While the queue is above its high watermark the
+     * read thread stops reading, so the kernel receive window fills up and TCP flow control pushes back on the server.
+     */
+    public void awaitReceiveCapacity(AndroidWebSocket socket) {
+        synchronized (_receiveLock) {
+            if (_receivedBytes < _receiveHighBytes && _receivedMessages < _receiveHighMessages) {
+                return;
+            }
+            AndroidWebSocketLogger.d(this.tag, "Receive queue above high watermark, pausing socket reads");
+            while (!socket.isClosing() && !socket.isClosed() && (_receivedBytes > _receiveLowBytes || _receivedMessages > _receiveLowMessages)) {
+                try {
+                    _receiveLock.wait(100);
+                } catch (InterruptedException e) {
+                    Thread.currentThread().interrupt();
+                    return;
+                }
+            }
+            AndroidWebSocketLogger.d(this.tag, "Receive queue drained, resuming socket reads");
+        }
+    }
+
+    private long getBufferedAmount() {
+        AndroidWebSocket socket = _socket;
+        if (socket == null || !(socket.getConnection() instanceof WebSocketImpl)) {
+            return 0;
+        }
+        long buffered = 0;
+        for (java.nio.ByteBuffer buffer : ((WebSocketImpl) socket.getConnection()).outQueue) {
+            buffered += buffer.remaining();
+        }
+        return buffered;
+    }
+
+    private synchronized void scheduleDrainCheck() {
+        if (_drainScheduled) {
+            return;
+        }
+        _drainScheduled = true;
+        _drainScheduler.schedule(this::checkDrain, 10, TimeUnit.MILLISECONDS);
+    }
+
+    private void checkDrain() {
+        long buffered = getBufferedAmount();
+        synchronized (this) {
+            if (buffered > _sendLowWatermark && _socket != null && _socket.isOpen()) {
+                _drainScheduler.schedule(this::checkDrain, 10, TimeUnit.MILLISECONDS);
+                return;
+            }
+            _drainScheduled = false;
+        }
+        try {
+            dispatchStatusEventAsync("drain", String.valueOf(buffered));
+        } catch (Exception e) {
+            AndroidWebSocketLogger.e(this.tag, "Error dispatching drain event", e);
+        }
+    }
+
+    /**
+     * Restarts the keepalive cycle for the current socket. Each cycle sends a ping carrying an id, then checks after
+     * the timeout whether the matching pong (or any other inbound message) arrived; if nothing did, the connection is
+     * considered dead and closed with 1006. While the cycle is off the library's connection-lost timer runs instead.
+     */
+    public synchronized void restartKeepAlive() {
+        if (_keepAliveTask != null) {
+            _keepAliveTask.cancel(false);
+            _keepAliveTask = null;
+        }
+        _pongPending = false;
+        if (_socket != null) {
+            _socket.setConnectionLostTimeout(connectionLostTimeoutSeconds());
+        }
+        if (_keepAliveIntervalMs > 0 && _socket != null) {
+            _keepAliveTask = _drainScheduler.scheduleWithFixedDelay(this::sendKeepAlivePing, _keepAliveIntervalMs, _keepAliveIntervalMs, TimeUnit.MILLISECONDS);
+        }
+    }
+
+    synchronized int connectionLostTimeoutSeconds() {
+        return _keepAliveIntervalMs > 0 ? 0 : CONNECTION_LOST_TIMEOUT_SECONDS;
+    }
+
+    private synchronized int keepAliveTimeoutMs() {
+        return _keepAliveTimeoutMs > 0 ? _keepAliveTimeoutMs : DEFAULT_KEEPALIVE_TIMEOUT_MS;
+    }
+
+    private void sendKeepAlivePing() {
+        AndroidWebSocket socket = _socket;
+        if (socket == null || !socket.isOpen()) {
+            return;
+        }
+        long id;
+        synchronized (this) {
+            id = ++_pingId;
+            _pingSentAt = System.nanoTime();
+            _pongPending = true;
+            _pingsSent++;
+        }
+        try {
+            PingFrame frame = new PingFrame();
+            ByteBuffer payload = ByteBuffer.allocate(8);
+            payload.putLong(id);
+            payload.flip();
+            frame.setPayload(payload);
+            socket.sendFrame(frame);
+        } catch (Exception e) {
+            AndroidWebSocketLogger.e(this.tag, "Error sending keepalive ping", e);
+            return;
+        }
+        _drainScheduler.schedule(() -> checkKeepAliveTimeout(socket, id), keepAliveTimeoutMs(), TimeUnit.MILLISECONDS);
+    }
+
+    private void checkKeepAliveTimeout(AndroidWebSocket socket, long id) {
+        synchronized (this) {
+            if (!_pongPending || id != _pingId || socket != _socket) {
+                return;
+            }
+            _pongPending = false;
+            if (_lastReceiveAt - _pingSentAt > 0) {
+                return; // Other traffic arrived, the pong is just queued behind it
+            }
+            _keepAliveTimeouts++;
+        }
+        AndroidWebSocketLogger.e(this.tag, "Keepalive timeout: no pong within " + keepAliveTimeoutMs() + " ms");
+        socket.closeConnection(1006, "Keepalive timeout");
+    }
+
+    /**
+     * Called on the socket read thread for every inbound message, used as a liveness signal.
+     */
+    public void onMessageReceived() {
+        _lastReceiveAt = System.nanoTime();
+    }
+
+    /**
+     * Called on the socket read thread for every pong with its payload.
+     */
+    public void onPongReceived(ByteBuffer payload) {
+        long receivedAt = System.nanoTime();
+        _lastReceiveAt = receivedAt;
+        boolean emitStatus = false;
+        synchronized (this) {
+            _pongsReceived++;
+            if (payload == null || payload.remaining() != 8 || payload.getLong(payload.position()) != _pingId || !_pongPending) {
+                return;
+            }
+            _pongPending = false;
+            recordRtt((receivedAt - _pingSentAt) / 1000);
+            if (_keepAliveStatusIntervalMs > 0 && (receivedAt - _lastStatusAt) / 1000000 >= _keepAliveStatusIntervalMs) {
+                _lastStatusAt = receivedAt;
+                emitStatus = true;
+            }
+        }
+        if (emitStatus) {
+            try {
+                dispatchStatusEventAsync("keepaliveStatus", getRttStats());
+            } catch (Exception e) {
+                AndroidWebSocketLogger.e(this.tag, "Error dispatching keepalive status", e);
+            }
+        }
+    }
+
+    // RFC 6298 smoothing; jitter is RTTVAR
+    private void recordRtt(long rttMicros) {
+        _lastRttMicros = rttMicros;
+        if (_smoothedRttMicros < 0) {
+            _smoothedRttMicros = rttMicros;
+            _rttVarianceMicros = rttMicros / 2.0;
+        } else {
+            _rttVarianceMicros = 0.75 * _rttVarianceMicros + 0.25 * Math.abs(_smoothedRttMicros - rttMicros);
+            _smoothedRttMicros = 0.875 * _smoothedRttMicros + 0.125 * rttMicros;
+        }
+        _rttSamples[(int) (_rttSampleCount % RTT_SAMPLES)] = rttMicros;
+        _rttSampleCount++;
+        _rttSum += rttMicros;
+        _rttMax = Math.max(_rttMax, rttMicros);
+    }
+
+    /**
+     * Same JSON shape as the native engines; percentiles are taken over the last RTT_SAMPLES pings.
+     */
+    private synchronized String getRttStats() {
+        int window = (int) Math.min(_rttSampleCount, RTT_SAMPLES);
+        long[] sorted = Arrays.copyOf(_rttSamples, window);
+        Arrays.sort(sorted);
+        return "{\"srtt\":" + (long) Math.max(_smoothedRttMicros, 0)
+                + ",\"jitter\":" + (long) _rttVarianceMicros
+                + ",\"lastRtt\":" + _lastRttMicros
+                + ",\"pingsSent\":" + _pingsSent
+                + ",\"pongsReceived\":" + _pongsReceived
+                + ",\"timeouts\":" + _keepAliveTimeouts
+                + ",\"interval\":" + _keepAliveIntervalMs
+                + ",\"timeout\":" + keepAliveTimeoutMs()
+                + ",\"histogram\":{\"count\":" + _rttSampleCount
+                + ",\"mean\":" + (_rttSampleCount == 0 ? 0 : _rttSum / _rttSampleCount)
+                + ",\"p50\":" + percentile(sorted, 50)
+                + ",\"p90\":" + percentile(sorted, 90)
+                + ",\"p99\":" + percentile(sorted, 99)
+                + ",\"p999\":" + percentile(sorted, 99.9)
+                + ",\"max\":" + _rttMax + "}}";
+    }
+
+    private static long percentile(long[] sorted, double percentile) {
+        if (sorted.length == 0) {
+            return 0;
+        }
+        int index = (int) Math.ceil(sorted.length * percentile / 100.0) - 1;
+        return sorted[Math.max(0, Math.min(index, sorted.length - 1))];
+    }
+
     @Override
     public Map<String, FREFunction> getFunctions() {
         AndroidWebSocketLogger.i(this.tag, "Creating function Map");
@@ -69,10 +347,17 @@ public class AndroidWebSocketExtensionContext extends FREContext {
         functionMap.put(SetDebugMode.KEY, new SetDebugMode());
         functionMap.put(ConnectFunction.KEY, new ConnectFunction());
         functionMap.put(SendMessageFunction.KEY, new SendMessageFunction());
+        functionMap.put(SendMessagesFunction.KEY, new SendMessagesFunction());
         functionMap.put(CloseFunction.KEY, new CloseFunction());
         functionMap.put(GetByteArrayMessage.KEY, new GetByteArrayMessage());
+        functionMap.put(ReadMessageInto.KEY, new ReadMessageInto());
         functionMap.put(AddStaticHost.KEY, new AddStaticHost());
         functionMap.put(RemoveStaticHost.KEY, new RemoveStaticHost());
+        functionMap.put(SetReceiveWatermarks.KEY, new SetReceiveWatermarks());
+        functionMap.put(SetSendWatermarks.KEY, new SetSendWatermarks());
+        functionMap.put(GetBufferedAmount.KEY, new GetBufferedAmount());
+        functionMap.put(SetKeepAlive.KEY, new SetKeepAlive());
+        functionMap.put(GetRttStats.KEY, new GetRttStats());
         return functionMap;
 
     }
@@ -103,18 +388,54 @@ public class AndroidWebSocketExtensionContext extends FREContext {
             }
             try {
                 String url = freObjects[0].getAsString();
+
+                // WebSocketConnectOptions from AS3 (freObjects[1] is the protocol list); 0 keeps the default
+                FREObject options = freObjects.length > 2 ? freObjects[2] : null;
+                int connectTimeoutMs = positiveOption(options, "connectTimeoutMs", 5000);
+                int probeTimeoutMs = positiveOption(options, "probeTimeoutMs", 1000);
+                int dnsTimeoutMs = positiveOption(options, "dnsTimeoutMs", 0);
+                int sendBufferSize = positiveOption(options, "sendBufferSize", 0);
+                int receiveBufferSize = positiveOption(options, "receiveBufferSize", 0);
+                int maxMessageSize = positiveOption(options, "maxMessageSize", Integer.MAX_VALUE);
+                int keepAliveIntervalMs = intOption(options, "keepAliveIntervalMs", -1);
+                boolean tcpNoDelay = boolOption(options, "tcpNoDelay", true);
+                if (keepAliveIntervalMs >= 0) {
+                    synchronized (context) {
+                        context._keepAliveIntervalMs = keepAliveIntervalMs;
+                    }
+                }
+
                 Map<String, String> headers = new HashMap<>();
                 // add default user agent from the context
                 String defaultWebViewUserAgent = WebSettings.getDefaultUserAgent(context.getActivity());
                 String appPackageName = context.getActivity().getPackageName();
                 String appVersion = context.getActivity().getPackageManager().getPackageInfo(appPackageName, 0).versionName;
                 headers.put("User-Agent", defaultWebViewUserAgent + " " + appPackageName + "/" + appVersion);
-                context._socket = new AndroidWebSocket(URI.create(url), new Draft_6455(), headers, 5000, context);
-                context._socket.setDnsResolver(new DnsResolver() {
+                Draft_6455 draft = maxMessageSize == Integer.MAX_VALUE ? new Draft_6455() : new Draft_6455(Collections.<IExtension>emptyList(), Collections.<IProtocol>singletonList(new Protocol("")), maxMessageSize);
+                AndroidWebSocket webSocket = new AndroidWebSocket(URI.create(url), draft, headers, connectTimeoutMs, context);
+                context._socket = webSocket;
+                webSocket.setTcpNoDelay(tcpNoDelay);
+                webSocket.setDnsResolver(new DnsResolver() {
                     @Override
                     public InetAddress resolve(URI uri) throws UnknownHostException {
                         List<InetAddress> addresses = new ArrayList<>();
 
+                        // The client asks for the address right before connecting its socket, the last point where
+                        // the buffer sizes still shape the window advertised in the handshake
+                        Socket connecting = webSocket.getSocket();
+                        if (connecting != null) {
+                            try {
+                                if (sendBufferSize > 0) {
+                                    connecting.setSendBufferSize(sendBufferSize);
+                                }
+                                if (receiveBufferSize > 0) {
+                                    connecting.setReceiveBufferSize(receiveBufferSize);
+                                }
+                            } catch (IOException e) {
+                                AndroidWebSocketLogger.e(TAG, "Could not set socket buffer sizes: " + e.getMessage());
+                            }
+                        }
+
                         int port = uri.getPort();
                         if (port == -1) {
                             port = uri.getScheme().equals("wss") ? 443 : 80;
@@ -124,7 +445,8 @@ public class AndroidWebSocketExtensionContext extends FREContext {
                             if (Build.VERSION.SDK_INT < Build.VERSION_CODES.N) {
                                 addresses.addAll(resolveDnsUsingThreadForLowApi(uri.getHost()));
                             } else {
-                                List<InetAddress> fromResolversResult = resolveWithDns(uri.getHost()).join();
+                                CompletableFuture<List<InetAddress>> resolving = resolveWithDns(uri.getHost());
+                                List<InetAddress> fromResolversResult = dnsTimeoutMs > 0 ? resolving.get(dnsTimeoutMs, TimeUnit.MILLISECONDS) : resolving.join();
                                 addresses.addAll(fromResolversResult);
                             }
                         } catch (Exception e) {
@@ -153,7 +475,7 @@ public class AndroidWebSocketExtensionContext extends FREContext {
                             for (InetAddress address : addresses) {
                                 SocketAddress socketAddress = new InetSocketAddress(address, port);
                                 try (Socket socket = new Socket()) {
-                                    socket.connect(socketAddress, 1000);
+                                    socket.connect(socketAddress, probeTimeoutMs);
                                     if (socket.isConnected()) {
                                         return address;
                                     }
@@ -166,7 +488,7 @@ public class AndroidWebSocketExtensionContext extends FREContext {
                         //check if the address is reachable and return
                         for (InetAddress address : InetAddress.getAllByName(uri.getHost())) {
                             try (Socket socket = new Socket()) {
-                                socket.connect(new InetSocketAddress(address, port), 1000);
+                                socket.connect(new InetSocketAddress(address, port), probeTimeoutMs);
                                 if (socket.isConnected()) {
                                     return address;
                                 }
@@ -177,7 +499,8 @@ public class AndroidWebSocketExtensionContext extends FREContext {
                         throw new UnknownHostException("Could not resolve address");
                     }
                 });
-                context._socket.connect();
+                webSocket.setConnectionLostTimeout(context.connectionLostTimeoutSeconds()); // 0 while the keepalive cycle replaces it
+                webSocket.connect();
             } catch (Exception e) {
                 AndroidWebSocketLogger.e(TAG, "Failure in connect() method: " + e.getMessage());
             }
@@ -190,6 +513,35 @@ public class AndroidWebSocketExtensionContext extends FREContext {
 
         }
 
+        private static int intOption(FREObject options, String name, int fallback) {
+            if (options == null) {
+                return fallback;
+            }
+            try {
+                FREObject value = options.getProperty(name);
+                return value != null ? value.getAsInt() : fallback;
+            } catch (Exception e) {
+                return fallback;
+            }
+        }
+
+        private static int positiveOption(FREObject options, String name, int fallback) {
+            int value = intOption(options, name, 0);
+            return value > 0 ? value : fallback;
+        }
+
+        private static boolean boolOption(FREObject options, String name, boolean fallback) {
+            if (options == null) {
+                return fallback;
+            }
+            try {
+                FREObject value = options.getProperty(name);
+                return value != null ? value.getAsBool() : fallback;
+            } catch (Exception e) {
+                return fallback;
+            }
+        }
+
         private InetAddress getByIpWithoutException(String ip) {
             try {
                 return InetAddress.getByName(ip);
@@ -384,8 +736,13 @@ public class AndroidWebSocketExtensionContext extends FREContext {
             boolean success = false;
             FREObject retVal = null;
             try {
-                AndroidWebSocket client = ((AndroidWebSocketExtensionContext) freContext)._socket;
-                if (client.isOpen()) {
+                AndroidWebSocketExtensionContext context = (AndroidWebSocketExtensionContext) freContext;
+                AndroidWebSocket client = context._socket;
+                long buffered = context.getBufferedAmount();
+                if (buffered > 0 && buffered >= context._sendHighWatermark) {
+                    AndroidWebSocketLogger.d(TAG, "Send queue full (" + buffered + " bytes buffered), message rejected");
+                    context.scheduleDrainCheck();
+                } else if (client.isOpen()) {
                     int opCode = freObjects[0].getAsInt();
                     if (freObjects[1] instanceof FREByteArray) {
                         AndroidWebSocketLogger.d(TAG, "Message is a byte array");
@@ -417,6 +774,59 @@ public class AndroidWebSocketExtensionContext extends FREContext {
         }
     }
 
+    public static class SendMessagesFunction implements FREFunction {
+        public static final String KEY = "sendMessages";
+        private static final String TAG = "AndroidWebSocketSendMessages";
+
+        @Override
+        public FREObject call(FREContext freContext, FREObject[] freObjects) {
+            int queued = 0;
+            try {
+                AndroidWebSocketExtensionContext context = (AndroidWebSocketExtensionContext) freContext;
+                AndroidWebSocket client = context._socket;
+                long buffered = context.getBufferedAmount();
+                if (buffered > 0 && buffered >= context._sendHighWatermark) {
+                    AndroidWebSocketLogger.d(TAG, "Send queue full (" + buffered + " bytes buffered), messages rejected");
+                    context.scheduleDrainCheck();
+                } else if (client != null && client.isOpen()) {
+                    FREByteArray records = (FREByteArray) freObjects[0];
+                    List<Framedata> frames = new ArrayList<>();
+                    records.acquire();
+                    try {
+                        ByteBuffer bytes = records.getBytes();
+                        while (bytes.remaining() >= 4) {
+                            int length = bytes.getInt();
+                            if (length < 0 || length > bytes.remaining()) {
+                                AndroidWebSocketLogger.e(TAG, "Malformed record");
+                                frames.clear();
+                                queued = 0;
+                                break;
+                            }
+                            byte[] message = new byte[length];
+                            bytes.get(message);
+                            frames.addAll(client.getDraft().createFrames(ByteBuffer.wrap(message), true));
+                            queued++;
+                        }
+                    } finally {
+                        records.release();
+                    }
+                    if (!frames.isEmpty()) {
+                        // One sendFrame call queues every frame together for the write thread
+                        client.sendFrame(frames);
+                    }
+                }
+            } catch (Exception e) {
+                AndroidWebSocketLogger.e(TAG, "Failure in sendMessages() method: ", e);
+            }
+            try {
+                return FREObject.newObject(queued);
+            } catch (Exception e2) {
+                AndroidWebSocketLogger.e(TAG, "Could not create return value: ", e2);
+            }
+            return null;
+        }
+    }
+
     public static class CloseFunction implements FREFunction {
         public static final String KEY = "close";
         private static final String TAG = "AndroidWebSocketClose";
@@ -451,7 +861,7 @@ public class AndroidWebSocketExtensionContext extends FREContext {
             AndroidWebSocketLogger.d(TAG, "Called getByteArrayMessage");
             try {
                 AndroidWebSocketExtensionContext context = (AndroidWebSocketExtensionContext) freContext;
-                byte[] byteBuffer = context._byteBufferQueue.poll();
+                byte[] byteBuffer = context.pollByteBuffer();
                 if (byteBuffer == null) {
                     return null;
                 }
@@ -467,6 +877,56 @@ public class AndroidWebSocketExtensionContext extends FREContext {
         }
     }
 
+    public static class ReadMessageInto implements FREFunction {
+        public static final String KEY = "readMessageInto";
+        private static final String TAG = "AndroidWebSocketReadMessageInto";
+
+        @Override
+        public FREObject call(FREContext freContext, FREObject[] freObjects) {
+            try {
+                AndroidWebSocketExtensionContext context = (AndroidWebSocketExtensionContext) freContext;
+                FREByteArray array = (FREByteArray) freObjects[0];
+                boolean prefixed = freObjects.length >= 2;
+                int maxMessages = prefixed ? freObjects[1].getAsInt() : 1;
+
+                // Only the FRE thread consumes the queue, so the messages sized here are the ones polled below
+                int count = 0;
+                long required = 0;
+                for (byte[] message : context._byteBufferQueue) {
+                    if (count == maxMessages) {
+                        break;
+                    }
+                    required += message.length + (prefixed ? 4 : 0);
+                    count++;
+                }
+
+                if (count > 0) {
+                    if (array.getLength() < required) {
+                        array.setProperty("length", FREObject.newObject((double) required));
+                    }
+                    array.acquire();
+                    try {
+                        ByteBuffer bytes = array.getBytes();
+                        for (int i = 0; i < count; i++) {
+                            byte[] message = context.pollByteBuffer();
+                            if (prefixed) {
+                                bytes.putInt(message.length);
+                            }
+                            bytes.put(message);
+                        }
+                    } finally {
+                        array.release();
+                    }
+                }
+
+                return FREObject.newObject((double) required);
+            } catch (Exception e) {
+                AndroidWebSocketLogger.e(TAG, "Failure in readMessageInto() method: ", e);
+            }
+            return null;
+        }
+    }
+
     public static class AddStaticHost implements FREFunction {
         public static final String KEY = "addStaticHost";
         private static final String TAG = "AndroidWebSocketAddStaticHost";
@@ -521,4 +981,134 @@ public class AndroidWebSocketExtensionContext extends FREContext {
             return null;
         }
     }
+
+    public static class SetReceiveWatermarks implements FREFunction {
+        public static final String KEY = "setReceiveWatermarks";
+        private static final String TAG = "AndroidWebSocketSetReceiveWatermarks";
+
+        @Override
+        public FREObject call(FREContext freContext, FREObject[] freObjects) {
+            try {
+                AndroidWebSocketExtensionContext context = (AndroidWebSocketExtensionContext) freContext;
+                long lowBytes = (long) freObjects[0].getAsDouble();
+                long highBytes = (long) freObjects[1].getAsDouble();
+                int lowMessages = freObjects[2].getAsInt();
+                int highMessages = freObjects[3].getAsInt();
+
+                if (lowBytes > highBytes || lowMessages > highMessages || highBytes <= 0 || highMessages <= 0) {
+                    AndroidWebSocketLogger.e(TAG, "Invalid receive watermarks");
+                    return FREObject.newObject(false);
+                }
+
+                synchronized (context._receiveLock) {
+                    context._receiveLowBytes = lowBytes;
+                    context._receiveHighBytes = highBytes;
+                    context._receiveLowMessages = lowMessages;
+                    context._receiveHighMessages = highMessages;
+                    context._receiveLock.notifyAll();
+                }
+
+                return FREObject.newObject(true);
+            } catch (Exception e) {
+                AndroidWebSocketLogger.e(TAG, "Error setting receive watermarks", e);
+            }
+
+            return null;
+        }
+    }
+
+    public static class SetSendWatermarks implements FREFunction {
+        public static final String KEY = "setSendWatermarks";
+        private static final String TAG = "AndroidWebSocketSetSendWatermarks";
+
+        @Override
+        public FREObject call(FREContext freContext, FREObject[] freObjects) {
+            try {
+                AndroidWebSocketExtensionContext context = (AndroidWebSocketExtensionContext) freContext;
+                long lowBytes = (long) freObjects[0].getAsDouble();
+                long highBytes = (long) freObjects[1].getAsDouble();
+
+                if (lowBytes < 0 || highBytes <= 0 || lowBytes > highBytes) {
+                    AndroidWebSocketLogger.e(TAG, "Invalid send watermarks");
+                    return FREObject.newObject(false);
+                }
+
+                synchronized (context) {
+                    context._sendLowWatermark = lowBytes;
+                    context._sendHighWatermark = highBytes;
+                }
+
+                return FREObject.newObject(true);
+            } catch (Exception e) {
+                AndroidWebSocketLogger.e(TAG, "Error setting send watermarks", e);
+            }
+
+            return null;
+        }
+    }
+
+    public static class GetBufferedAmount implements FREFunction {
+        public static final String KEY = "getBufferedAmount";
+        private static final String TAG = "AndroidWebSocketGetBufferedAmount";
+
+        @Override
+        public FREObject call(FREContext freContext, FREObject[] freObjects) {
+            try {
+                AndroidWebSocketExtensionContext context = (AndroidWebSocketExtensionContext) freContext;
+                return FREObject.newObject((double) context.getBufferedAmount());
+            } catch (Exception e) {
+                AndroidWebSocketLogger.e(TAG, "Error reading buffered amount", e);
+            }
+
+            return null;
+        }
+    }
+
+    public static class SetKeepAlive implements FREFunction {
+        public static final String KEY = "setKeepAlive";
+        private static final String TAG = "AndroidWebSocketSetKeepAlive";
+
+        @Override
+        public FREObject call(FREContext freContext, FREObject[] freObjects) {
+            try {
+                AndroidWebSocketExtensionContext context = (AndroidWebSocketExtensionContext) freContext;
+                int intervalMs = freObjects[0].getAsInt();
+                int timeoutMs = freObjects[1].getAsInt();
+                int statusIntervalMs = freObjects[2].getAsInt();
+
+                if (intervalMs < 0 || timeoutMs <= 0 || statusIntervalMs < 0) {
+                    AndroidWebSocketLogger.e(TAG, "Invalid keepalive settings");
+                    return null;
+                }
+
+                synchronized (context) {
+                    context._keepAliveIntervalMs = intervalMs;
+                    context._keepAliveTimeoutMs = timeoutMs;
+                    context._keepAliveStatusIntervalMs = statusIntervalMs;
+                }
+                context.restartKeepAlive();
+            } catch (Exception e) {
+                AndroidWebSocketLogger.e(TAG, "Error setting keepalive", e);
+            }
+
+            return null;
+        }
+    }
+
+    public static class GetRttStats implements FREFunction {
+        public static final String KEY = "getRttStats";
+        private static final String TAG = "AndroidWebSocketGetRttStats";
+
+        @Override
+        public FREObject call(FREContext freContext, FREObject[] freObjects) {
+            try {
+                AndroidWebSocketExtensionContext context = (AndroidWebSocketExtensionContext) freContext;
+                return FREObject.newObject(context.getRttStats());
+            } catch (Exception e) {
+                AndroidWebSocketLogger.e(TAG, "Error reading RTT stats", e);
+            }
+
+            return null;
+        }
+    }
 }
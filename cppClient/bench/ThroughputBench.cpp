@@ -0,0 +1,223 @@
+//
+//  ThroughputBench.cpp
+//  WebSocketAneClient
+//
+//  Echo round trips through the coroutine API against the same traffic driven straight through the engine's
+//  callback exports, as the ANE shims do: every connection keeps a window of messages in flight and sends the next
+//  one as each echo arrives, until it has sent its share.
+//
+//  WebSocketAneClientBench <echo server ws:// URL> [connections] [messages per connection] [size] [threads] [engine]
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Engine.hpp"
+#include "WebSocketAne/Client.hpp"
+
+using namespace WebSocketAne;
+
+namespace {
+
+constexpr int Window = 16;
+
+struct Settings {
+    std::string uri;
+    int connections = 100;
+    int messages = 1000;
+    int size = 64;
+    size_t threads = 2;
+    std::string enginePath;
+};
+
+// Counts connections down to zero and wakes the waiting main thread
+class Latch {
+public:
+    explicit Latch(int count) : m_count(count) {}
+
+    void countDown() {
+        std::lock_guard guard(m_mutex);
+        if (--m_count == 0) m_zero.notify_all();
+    }
+
+    void wait() {
+        std::unique_lock lock(m_mutex);
+        m_zero.wait(lock, [this] { return m_count <= 0; });
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_zero;
+    int m_count;
+};
+
+void report(const char *name, const Settings &settings, std::chrono::steady_clock::duration elapsed, int failed) {
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    double total = static_cast<double>(settings.connections) * settings.messages;
+    std::printf("  %-22s %10.0f round trips/s %8.2f us/round trip%s\n", name, total / seconds, seconds * 1e6 / total,
+                failed > 0 ? (" (" + std::to_string(failed) + " connections failed)").c_str() : "");
+}
+
+Task<void> echoLoop(Client &client, const Settings &settings, const std::vector<uint8_t> &payload, std::atomic<int> &failed, Latch &latch) {
+    try {
+        co_await client.connect(settings.uri);
+        int sent = 0;
+        for (; sent < std::min(Window, settings.messages); ++sent) {
+            co_await client.send(payload);
+        }
+        for (int received = 0; received < settings.messages; ++received) {
+            co_await client.receive();
+            if (sent < settings.messages) {
+                co_await client.send(payload);
+                ++sent;
+            }
+        }
+    } catch (const std::exception &) {
+        failed++;
+    }
+    latch.countDown();
+}
+
+void runCoroutines(const Settings &settings) {
+    std::vector<uint8_t> payload(settings.size, 0x42);
+    std::atomic<int> failed{0};
+    Latch latch(settings.connections);
+    ThreadPoolExecutor executor(settings.threads);
+    std::vector<std::unique_ptr<Client>> clients;
+    for (int i = 0; i < settings.connections; ++i) {
+        clients.push_back(std::make_unique<Client>(executor));
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    for (auto &client : clients) {
+        spawn(executor, echoLoop(*client, settings, payload, failed, latch));
+    }
+    latch.wait();
+    report("coroutine API", settings, std::chrono::steady_clock::now() - started, failed);
+    for (auto &client : clients) {
+        client->close();
+    }
+}
+
+// State of the callback run; the engine's ctx argument is the connection's index + 1
+struct Raw {
+    const detail::Engine *engine = nullptr;
+    const Settings *settings = nullptr;
+    std::vector<uint8_t> payload;
+    std::vector<char *> guids;
+    std::unique_ptr<std::atomic<int>[]> sent;
+    std::unique_ptr<std::atomic<int>[]> received;
+    std::atomic<int> failed{0};
+    std::atomic<int> closed{0};
+    Latch *latch = nullptr;
+};
+
+Raw raw;
+
+void sendNext(size_t index) {
+    // Retries while the engine's queue is full; with the default watermarks and a 16-message window it never is
+    while (!raw.engine->sendMessage(raw.guids[index], raw.payload.data(), static_cast<int>(raw.payload.size()), 1)) {
+        std::this_thread::yield();
+    }
+}
+
+void WEBSOCKET_ANE_CDECL onRawConnect(void *ctx) {
+    auto index = reinterpret_cast<uintptr_t>(ctx) - 1;
+    for (int i = 0; i < std::min(Window, raw.settings->messages); ++i) {
+        raw.sent[index]++;
+        sendNext(index);
+    }
+}
+
+void WEBSOCKET_ANE_CDECL onRawData(void *ctx, const uint8_t *, int, int, int64_t) {
+    auto index = reinterpret_cast<uintptr_t>(ctx) - 1;
+    if (raw.sent[index].fetch_add(1) < raw.settings->messages) {
+        sendNext(index);
+    }
+    if (++raw.received[index] == raw.settings->messages) raw.latch->countDown();
+}
+
+void WEBSOCKET_ANE_CDECL onRawDisconnect(void *ctx, int, const char *) {
+    auto index = reinterpret_cast<uintptr_t>(ctx) - 1;
+    if (raw.received[index] < raw.settings->messages) {
+        raw.failed++;
+        raw.received[index] = raw.settings->messages;
+        raw.latch->countDown();
+    }
+    raw.closed++;
+}
+
+void WEBSOCKET_ANE_CDECL onRawLog(const char *) {}
+
+void WEBSOCKET_ANE_CDECL onRawStatus(void *, const char *, const char *) {}
+
+// Replaces the coroutine library's callbacks, so it has to run after every Client is gone
+void runCallbacks(const Settings &settings) {
+    Latch latch(settings.connections);
+    raw.engine = detail::loadEngine(settings.enginePath);
+    raw.settings = &settings;
+    raw.payload.assign(settings.size, 0x42);
+    raw.sent = std::make_unique<std::atomic<int>[]>(settings.connections);
+    raw.received = std::make_unique<std::atomic<int>[]>(settings.connections);
+    raw.latch = &latch;
+    raw.engine->initializerCallbacks(reinterpret_cast<const void *>(&onRawConnect), reinterpret_cast<const void *>(&onRawData),
+                                     reinterpret_cast<const void *>(&onRawDisconnect), reinterpret_cast<const void *>(&onRawLog),
+                                     reinterpret_cast<const void *>(&onRawStatus));
+    for (int i = 0; i < settings.connections; ++i) {
+        raw.guids.push_back(raw.engine->createWebSocketClient(reinterpret_cast<const void *>(static_cast<uintptr_t>(i) + 1)));
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    for (auto guid : raw.guids) {
+        raw.engine->connect(guid, settings.uri.c_str());
+    }
+    latch.wait();
+    report("callback exports", settings, std::chrono::steady_clock::now() - started, raw.failed);
+
+    // Destroying a client silences it, but close callbacks already on their way still read raw, so wait for them
+    for (auto guid : raw.guids) {
+        raw.engine->disconnect(guid, 1000);
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (raw.closed < settings.connections && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    for (auto guid : raw.guids) {
+        raw.engine->destroyWebSocketClient(guid);
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::printf("usage: WebSocketAneClientBench <echo server ws:// URL> [connections] [messages per connection] [size] [threads] [engine]\n");
+        return 1;
+    }
+
+    Settings settings;
+    settings.uri = argv[1];
+    if (argc > 2) settings.connections = std::atoi(argv[2]);
+    if (argc > 3) settings.messages = std::atoi(argv[3]);
+    if (argc > 4) settings.size = std::atoi(argv[4]);
+    if (argc > 5) settings.threads = std::strtoul(argv[5], nullptr, 10);
+    if (argc > 6) settings.enginePath = argv[6];
+    if (!Client::loadEngine(settings.enginePath)) {
+        std::printf("engine library not found\n");
+        return 1;
+    }
+
+    std::printf("%d connections x %d round trips of %d B, window %d, %zu executor threads\n", settings.connections,
+                settings.messages, settings.size, Window, settings.threads);
+    runCoroutines(settings);
+    runCallbacks(settings);
+    return 0;
+}
@@ -0,0 +1,80 @@
+//
+//  Cancellation.hpp
+//  WebSocketAneClient
+//
+
+#ifndef WebSocketAne_Cancellation_hpp
+#define WebSocketAne_Cancellation_hpp
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+
+namespace WebSocketAne {
+
+namespace detail {
+struct CancellationState;
+}
+
+// Thrown by an operation whose token was cancelled before it completed
+class OperationCancelled : public std::runtime_error {
+public:
+    OperationCancelled() : std::runtime_error("operation cancelled") {}
+};
+
+// Unregisters its callback when destroyed; once the destructor returns the callback is not running and never will
+class CancellationRegistration {
+public:
+    CancellationRegistration() = default;
+
+    CancellationRegistration(std::shared_ptr<detail::CancellationState> state, uint64_t id);
+
+    CancellationRegistration(CancellationRegistration &&other) noexcept;
+
+    CancellationRegistration &operator=(CancellationRegistration &&other) noexcept;
+
+    ~CancellationRegistration();
+
+private:
+    void reset();
+
+    std::shared_ptr<detail::CancellationState> m_state;
+    uint64_t m_id = 0;
+};
+
+// Observes a CancellationSource. A default-constructed token is never cancelled
+class CancellationToken {
+public:
+    CancellationToken() = default;
+
+    bool cancelled() const;
+
+    // Runs callback once on cancellation, on the thread calling cancel(), or right away when already cancelled
+    [[nodiscard]] CancellationRegistration onCancel(std::function<void()> callback) const;
+
+private:
+    friend class CancellationSource;
+
+    explicit CancellationToken(std::shared_ptr<detail::CancellationState> state) : m_state(std::move(state)) {}
+
+    std::shared_ptr<detail::CancellationState> m_state;
+};
+
+class CancellationSource {
+public:
+    CancellationSource();
+
+    void cancel();
+
+    bool cancelled() const;
+
+    CancellationToken token() const { return CancellationToken(m_state); }
+
+private:
+    std::shared_ptr<detail::CancellationState> m_state;
+};
+
+} // namespace WebSocketAne
+
+#endif /* WebSocketAne_Cancellation_hpp */
@@ -0,0 +1,112 @@
+//
+//  Client.hpp
+//  WebSocketAneClient
+//
+
+#ifndef WebSocketAne_Client_hpp
+#define WebSocketAne_Client_hpp
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Cancellation.hpp"
+#include "Executor.hpp"
+#include "Task.hpp"
+
+namespace WebSocketAne {
+
+// Same fields and meaning as the AS3 WebSocketConnectOptions: 0 keeps the engine default, except tcpNoDelay (1 on,
+// 0 off) and keepAliveIntervalMs, where -1 keeps the current interval (0 turns keepalive off)
+struct ConnectOptions {
+    int32_t connectTimeoutMs = 0;
+    int32_t attemptDelayMs = 0;
+    int32_t dnsTimeoutMs = 0;
+    int32_t tcpNoDelay = 1;
+    int32_t sendBufferSize = 0;
+    int32_t receiveBufferSize = 0;
+    int32_t initialReceiveBufferSize = 0;
+    int32_t keepAliveIntervalMs = -1;
+    int32_t maxMessageSize = 0;
+};
+
+struct Message {
+    std::vector<uint8_t> data;
+    bool text = false;
+    // When the engine read the message's first frame off the socket
+    std::chrono::steady_clock::time_point receivedAt;
+};
+
+// The connection failed or closed; closeCode is the WebSocket close code the engine reported
+class WebSocketError : public std::runtime_error {
+public:
+    WebSocketError(int closeCode, const std::string &reason) : std::runtime_error(reason), m_closeCode(closeCode) {}
+
+    int closeCode() const { return m_closeCode; }
+
+private:
+    int m_closeCode;
+};
+
+// Awaitable client over the same native engine as the ANE's WebSocketClient, for C++ tools and bots. Every operation
+// resumes on the executor given at construction. At most one connect, one send and one receive may be pending at a
+// time, and none when the client is destroyed.
+class Client {
+public:
+    // Loads the engine library once per process; an empty path looks for WebSocketClientNativeLibrary next to the
+    // executable. Clients load it implicitly with the default path, so call this first to use another one
+    static bool loadEngine(const std::string &path = {});
+
+    // Receives the engine's log lines, from engine threads; by default they are dropped
+    static void setLogHandler(std::function<void(const char *)> handler);
+
+    // Impairs the connections the engine opens from now on (latency, jitter, bandwidth, loss, stalls, resets and
+    // blackholed addresses), for tests and benchmarks against a local server. config is the JSON documented in the
+    // engine's NetworkImpairment.cs; empty turns it off. Returns false when the engine rejected it
+    static bool setNetworkImpairment(const std::string &config);
+
+    // Impairment counters since the last setNetworkImpairment, as JSON
+    static std::string getNetworkImpairmentStats();
+
+    explicit Client(Executor &executor);
+
+    ~Client();
+
+    Client(const Client &) = delete;
+
+    Client &operator=(const Client &) = delete;
+
+    // Completes once the socket is open; throws WebSocketError when every attempt failed
+    Task<void> connect(std::string uri, CancellationToken cancel = {});
+
+    Task<void> connect(std::string uri, ConnectOptions options, CancellationToken cancel = {});
+
+    // Queues data on a send lane (0 control, 1 normal, 2 bulk), waiting while the engine's send queue is above its
+    // high watermark. data must stay valid until the returned task completes
+    Task<void> send(std::span<const uint8_t> data, int lane = 1, CancellationToken cancel = {});
+
+    // Next message; throws WebSocketError once the connection is closed and every received message was taken
+    Task<Message> receive(CancellationToken cancel = {});
+
+    void close(int closeCode = 1000);
+
+    int64_t bufferedAmount() const;
+
+    void setSendWatermarks(int64_t lowBytes, int64_t highBytes);
+
+    // Engine reads pause while more than highBytes of received messages wait to be taken, and resume under lowBytes
+    void setReceiveWatermarks(size_t lowBytes, size_t highBytes);
+
+    struct State;
+
+private:
+    std::shared_ptr<State> m_state;
+};
+
+} // namespace WebSocketAne
+
+#endif /* WebSocketAne_Client_hpp */
@@ -0,0 +1,74 @@
+//
+//  Executor.hpp
+//  WebSocketAneClient
+//
+
+#ifndef WebSocketAne_Executor_hpp
+#define WebSocketAne_Executor_hpp
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace WebSocketAne {
+
+// Where coroutines resume after an engine event. Engine callbacks arrive on the engine's own I/O threads and never
+// run user code there; they only post the continuation to the client's executor.
+class Executor {
+public:
+    virtual ~Executor() = default;
+
+    virtual void post(std::function<void()> work) = 0;
+};
+
+// A fixed set of threads draining one queue: the shared reactor many clients can resume on, so thousands of
+// connections need only a few threads. The destructor runs the work already queued, then joins.
+class ThreadPoolExecutor final : public Executor {
+public:
+    explicit ThreadPoolExecutor(size_t threads = std::thread::hardware_concurrency());
+
+    ~ThreadPoolExecutor() override;
+
+    ThreadPoolExecutor(const ThreadPoolExecutor &) = delete;
+
+    ThreadPoolExecutor &operator=(const ThreadPoolExecutor &) = delete;
+
+    void post(std::function<void()> work) override;
+
+private:
+    void workerLoop();
+
+    std::mutex m_mutex;
+    std::condition_variable m_available;
+    std::deque<std::function<void()>> m_queue;
+    std::vector<std::thread> m_threads;
+    bool m_stopping = false;
+};
+
+// Runs posted work on the thread that calls run(), for single-threaded tools
+class EventLoop final : public Executor {
+public:
+    void post(std::function<void()> work) override;
+
+    // Runs work until stop() is called
+    void run();
+
+    // Runs the work queued so far without waiting for more; returns how many items ran
+    size_t poll();
+
+    void stop();
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_available;
+    std::deque<std::function<void()>> m_queue;
+    bool m_stopped = false;
+};
+
+} // namespace WebSocketAne
+
+#endif /* WebSocketAne_Executor_hpp */
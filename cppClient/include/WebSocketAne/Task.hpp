@@ -0,0 +1,195 @@
+//
+//  Task.hpp
+//  WebSocketAneClient
+//
+
+#ifndef WebSocketAne_Task_hpp
+#define WebSocketAne_Task_hpp
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include "Executor.hpp"
+
+namespace WebSocketAne {
+
+template<typename T = void>
+class Task;
+
+namespace detail {
+
+struct PromiseBase {
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+
+        // Symmetric transfer to whoever awaited the task, so long await chains do not grow the stack
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            return handle.promise().continuation;
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() noexcept { exception = std::current_exception(); }
+
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr exception;
+};
+
+template<typename T>
+struct Promise : PromiseBase {
+    Task<T> get_return_object() noexcept;
+
+    template<typename U>
+    void return_value(U &&value) { result.emplace(std::forward<U>(value)); }
+
+    T take() {
+        if (exception) std::rethrow_exception(exception);
+        return std::move(*result);
+    }
+
+    std::optional<T> result;
+};
+
+template<>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+
+    void take() {
+        if (exception) std::rethrow_exception(exception);
+    }
+};
+
+// Fire-and-forget frame that starts at once and frees itself when done
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() noexcept { return {}; }
+
+        std::suspend_never initial_suspend() noexcept { return {}; }
+
+        std::suspend_never final_suspend() noexcept { return {}; }
+
+        void return_void() noexcept {}
+
+        // Like an exception escaping a std::thread
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+inline Detached runDetached(Task<void> task);
+
+} // namespace detail
+
+// Lazily started coroutine: nothing runs until it is awaited, spawned or passed to syncWait
+template<typename T>
+class [[nodiscard]] Task {
+public:
+    using promise_type = detail::Promise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept : m_handle(handle) {}
+
+    Task(Task &&other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            if (m_handle) m_handle.destroy();
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+
+    Task &operator=(const Task &) = delete;
+
+    ~Task() {
+        if (m_handle) m_handle.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        m_handle.promise().continuation = awaiting;
+        return m_handle;
+    }
+
+    T await_resume() { return m_handle.promise().take(); }
+
+private:
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+namespace detail {
+
+template<typename T>
+Task<T> Promise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+inline Detached runDetached(Task<void> task) {
+    co_await std::move(task);
+}
+
+} // namespace detail
+
+// Starts task on executor without waiting for it; the task owns everything it needs
+inline void spawn(Executor &executor, Task<void> task) {
+    auto shared = std::make_shared<Task<void>>(std::move(task));
+    executor.post([shared] { detail::runDetached(std::move(*shared)); });
+}
+
+// Runs task from the calling thread, blocking until it finishes on whatever executors it resumes on, and returns its
+// result or rethrows its exception. For main() and tests, never from an executor thread
+template<typename T>
+T syncWait(Task<T> task) {
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool done = false;
+    std::exception_ptr error;
+    std::optional<std::conditional_t<std::is_void_v<T>, bool, T>> result;
+
+    auto runner = [&]() -> detail::Detached {
+        try {
+            if constexpr (std::is_void_v<T>) {
+                co_await std::move(task);
+                result.emplace(true);
+            } else {
+                result.emplace(co_await std::move(task));
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        // Notify under the lock: the waiter returns, and destroys these locals, as soon as it sees done
+        std::lock_guard guard(mutex);
+        done = true;
+        finished.notify_one();
+    };
+    runner();
+
+    std::unique_lock lock(mutex);
+    finished.wait(lock, [&] { return done; });
+    if (error) std::rethrow_exception(error);
+    if constexpr (!std::is_void_v<T>) {
+        return std::move(*result);
+    }
+}
+
+} // namespace WebSocketAne
+
+#endif /* WebSocketAne_Task_hpp */
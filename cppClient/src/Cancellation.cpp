@@ -0,0 +1,113 @@
+//
+//  Cancellation.cpp
+//  WebSocketAneClient
+//
+
+#include "WebSocketAne/Cancellation.hpp"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace WebSocketAne::detail {
+
+struct CancellationState {
+    std::mutex mutex;
+    std::condition_variable callbackDone;
+    bool cancelled = false;
+    uint64_t nextId = 1;
+    std::unordered_map<uint64_t, std::function<void()>> callbacks;
+    // Set while cancel() runs a callback, so unregistering it can wait for it to return
+    uint64_t runningId = 0;
+    std::thread::id runningThread;
+};
+
+} // namespace WebSocketAne::detail
+
+namespace WebSocketAne {
+
+CancellationRegistration::CancellationRegistration(std::shared_ptr<detail::CancellationState> state, uint64_t id)
+    : m_state(std::move(state)), m_id(id) {}
+
+CancellationRegistration::CancellationRegistration(CancellationRegistration &&other) noexcept
+    : m_state(std::move(other.m_state)), m_id(std::exchange(other.m_id, 0)) {}
+
+CancellationRegistration &CancellationRegistration::operator=(CancellationRegistration &&other) noexcept {
+    if (this != &other) {
+        reset();
+        m_state = std::move(other.m_state);
+        m_id = std::exchange(other.m_id, 0);
+    }
+    return *this;
+}
+
+CancellationRegistration::~CancellationRegistration() {
+    reset();
+}
+
+void CancellationRegistration::reset() {
+    if (!m_state) return;
+
+    std::unique_lock lock(m_state->mutex);
+    m_state->callbacks.erase(m_id);
+    // A callback unregistering itself must not wait for itself
+    m_state->callbackDone.wait(lock, [this] {
+        return m_state->runningId != m_id || m_state->runningThread == std::this_thread::get_id();
+    });
+    lock.unlock();
+    m_state.reset();
+    m_id = 0;
+}
+
+bool CancellationToken::cancelled() const {
+    if (!m_state) return false;
+    std::lock_guard guard(m_state->mutex);
+    return m_state->cancelled;
+}
+
+CancellationRegistration CancellationToken::onCancel(std::function<void()> callback) const {
+    if (!m_state) return {};
+
+    {
+        std::lock_guard guard(m_state->mutex);
+        if (!m_state->cancelled) {
+            auto id = m_state->nextId++;
+            m_state->callbacks.emplace(id, std::move(callback));
+            return {m_state, id};
+        }
+    }
+    callback();
+    return {};
+}
+
+CancellationSource::CancellationSource() : m_state(std::make_shared<detail::CancellationState>()) {}
+
+void CancellationSource::cancel() {
+    std::unique_lock lock(m_state->mutex);
+    if (m_state->cancelled) return;
+    m_state->cancelled = true;
+
+    // Callbacks run outside the lock one at a time; each is removed first so it runs exactly once
+    while (!m_state->callbacks.empty()) {
+        auto entry = m_state->callbacks.begin();
+        auto id = entry->first;
+        auto callback = std::move(entry->second);
+        m_state->callbacks.erase(entry);
+        m_state->runningId = id;
+        m_state->runningThread = std::this_thread::get_id();
+        lock.unlock();
+        callback();
+        lock.lock();
+        m_state->runningId = 0;
+        m_state->runningThread = {};
+        m_state->callbackDone.notify_all();
+    }
+}
+
+bool CancellationSource::cancelled() const {
+    std::lock_guard guard(m_state->mutex);
+    return m_state->cancelled;
+}
+
+} // namespace WebSocketAne
@@ -0,0 +1,390 @@
+//
+//  Client.cpp
+//  WebSocketAneClient
+//
+
+#include "WebSocketAne/Client.hpp"
+#include <algorithm>
+#include <coroutine>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include "Engine.hpp"
+
+namespace WebSocketAne {
+
+struct Client::State {
+    enum class Phase {
+        Idle,
+        Connecting,
+        Open,
+        Closed
+    };
+
+    // One suspended operation; whoever takes the handle first (engine event or cancellation) resumes it
+    struct Waiter {
+        std::coroutine_handle<> handle;
+        bool cancelled = false;
+    };
+
+    explicit State(Executor &executor) : executor(executor) {}
+
+    // Hands the waiting coroutine back through the executor; call with mutex held
+    void wakeLocked(Waiter &waiter) {
+        if (auto handle = std::exchange(waiter.handle, {})) {
+            executor.post([handle] { handle.resume(); });
+        }
+    }
+
+    Executor &executor;
+    const detail::Engine *engine = nullptr;
+    uintptr_t id = 0;
+
+    std::mutex mutex;
+    // Engine client id; only used under mutex, null once the client is destroyed
+    char *guid = nullptr;
+    Phase phase = Phase::Idle;
+    int closeCode = 0;
+    std::string closeReason;
+    std::deque<Message> received;
+    size_t receivedBytes = 0;
+    size_t receiveLowBytes = 4 * 1024 * 1024;
+    size_t receiveHighBytes = 16 * 1024 * 1024;
+    bool receivePaused = false;
+    uint64_t drains = 0;
+    Waiter connectWaiter;
+    Waiter sendWaiter;
+    Waiter receiveWaiter;
+};
+
+namespace {
+
+using Phase = Client::State::Phase;
+
+// Engine callbacks carry an id rather than the State pointer, so a late callback for a destroyed client finds nothing
+std::mutex registryMutex;
+std::unordered_map<uintptr_t, std::weak_ptr<Client::State>> registry;
+uintptr_t nextId = 1;
+
+std::mutex logMutex;
+std::function<void(const char *)> logHandler;
+
+std::mutex engineMutex;
+std::string enginePath;
+
+std::shared_ptr<Client::State> findState(void *ctx) {
+    std::lock_guard guard(registryMutex);
+    auto entry = registry.find(reinterpret_cast<uintptr_t>(ctx));
+    return entry == registry.end() ? nullptr : entry->second.lock();
+}
+
+void WEBSOCKET_ANE_CDECL onConnect(void *ctx) {
+    auto state = findState(ctx);
+    if (!state) return;
+
+    std::lock_guard guard(state->mutex);
+    if (state->phase != Phase::Connecting) return;
+    state->phase = Phase::Open;
+    state->wakeLocked(state->connectWaiter);
+}
+
+void WEBSOCKET_ANE_CDECL onData(void *ctx, const uint8_t *data, int length, int messageType, int64_t receivedAgeNanos) {
+    auto state = findState(ctx);
+    if (!state) return;
+
+    Message message;
+    message.data.assign(data, data + std::max(length, 0));
+    message.text = messageType == 1;
+    message.receivedAt = std::chrono::steady_clock::now() - std::chrono::nanoseconds(std::max<int64_t>(receivedAgeNanos, 0));
+
+    std::lock_guard guard(state->mutex);
+    state->receivedBytes += message.data.size();
+    state->received.push_back(std::move(message));
+    if (!state->receivePaused && state->receivedBytes > state->receiveHighBytes && state->guid != nullptr) {
+        state->receivePaused = true;
+        state->engine->setReceivePaused(state->guid, 1);
+    }
+    state->wakeLocked(state->receiveWaiter);
+}
+
+void WEBSOCKET_ANE_CDECL onDisconnect(void *ctx, int closeCode, const char *reason) {
+    auto state = findState(ctx);
+    if (!state) return;
+
+    std::lock_guard guard(state->mutex);
+    state->phase = Phase::Closed;
+    state->closeCode = closeCode;
+    state->closeReason = reason != nullptr ? reason : "";
+    state->wakeLocked(state->connectWaiter);
+    state->wakeLocked(state->sendWaiter);
+    state->wakeLocked(state->receiveWaiter);
+}
+
+void WEBSOCKET_ANE_CDECL onLog(const char *message) {
+    std::lock_guard guard(logMutex);
+    if (logHandler) logHandler(message);
+}
+
+void WEBSOCKET_ANE_CDECL onStatus(void *ctx, const char *code, const char *) {
+    if (code == nullptr || std::strcmp(code, "drain") != 0) return;
+
+    auto state = findState(ctx);
+    if (!state) return;
+
+    std::lock_guard guard(state->mutex);
+    state->drains++;
+    state->wakeLocked(state->sendWaiter);
+}
+
+const detail::Engine *engine() {
+    static std::once_flag initialized;
+    std::string path;
+    {
+        std::lock_guard guard(engineMutex);
+        path = enginePath;
+    }
+
+    auto engine = detail::loadEngine(path);
+    if (engine != nullptr) {
+        std::call_once(initialized, [engine] {
+            engine->initializerCallbacks(reinterpret_cast<const void *>(&onConnect), reinterpret_cast<const void *>(&onData),
+                                         reinterpret_cast<const void *>(&onDisconnect), reinterpret_cast<const void *>(&onLog),
+                                         reinterpret_cast<const void *>(&onStatus));
+        });
+    }
+    return engine;
+}
+
+// Suspends until ready() holds, checked under the state mutex before suspending and again by whoever wakes the
+// waiter, or until cancel fires, in which case resuming throws OperationCancelled
+class WaitFor {
+public:
+    template<typename Ready>
+    WaitFor(Client::State &state, Client::State::Waiter &waiter, Ready ready, CancellationToken cancel)
+        : m_state(state), m_waiter(waiter), m_ready(std::move(ready)), m_cancel(std::move(cancel)) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        // Registered before the handle is published: a cancellation racing with it either finds the handle or is
+        // seen by the check below
+        m_registration = m_cancel.onCancel([&state = m_state, &waiter = m_waiter] {
+            std::lock_guard guard(state.mutex);
+            if (waiter.handle) {
+                waiter.cancelled = true;
+                state.wakeLocked(waiter);
+            }
+        });
+
+        std::lock_guard guard(m_state.mutex);
+        m_waiter.cancelled = false;
+        if (m_ready()) return false;
+        if (m_cancel.cancelled()) {
+            m_waiter.cancelled = true;
+            return false;
+        }
+        m_waiter.handle = handle;
+        return true;
+    }
+
+    void await_resume() {
+        m_registration = {};
+        std::lock_guard guard(m_state.mutex);
+        if (m_waiter.cancelled) {
+            m_waiter.cancelled = false;
+            throw OperationCancelled();
+        }
+    }
+
+private:
+    Client::State &m_state;
+    Client::State::Waiter &m_waiter;
+    std::function<bool()> m_ready;
+    CancellationToken m_cancel;
+    CancellationRegistration m_registration;
+};
+
+Task<void> connectTask(std::shared_ptr<Client::State> state, std::string uri, std::optional<ConnectOptions> options, CancellationToken cancel) {
+    {
+        std::lock_guard guard(state->mutex);
+        if (state->guid == nullptr) throw WebSocketError(1011, "Engine unavailable");
+        if (state->phase == Phase::Connecting || state->phase == Phase::Open) throw std::logic_error("Client already connected");
+
+        state->phase = Phase::Connecting;
+        state->closeCode = 0;
+        state->closeReason.clear();
+        state->received.clear();
+        state->receivedBytes = 0;
+        if (state->receivePaused) {
+            state->receivePaused = false;
+            state->engine->setReceivePaused(state->guid, 0);
+        }
+
+        // The engine connects in the background and answers through onConnect or onDisconnect
+        if (options) {
+            state->engine->connectWithOptions(state->guid, uri.c_str(), &*options);
+        } else {
+            state->engine->connect(state->guid, uri.c_str());
+        }
+    }
+
+    try {
+        co_await WaitFor(*state, state->connectWaiter, [&state] { return state->phase != Phase::Connecting; }, cancel);
+    } catch (const OperationCancelled &) {
+        std::lock_guard guard(state->mutex);
+        if (state->guid != nullptr) state->engine->disconnect(state->guid, 1000);
+        throw;
+    }
+
+    std::lock_guard guard(state->mutex);
+    if (state->phase != Phase::Open) throw WebSocketError(state->closeCode, state->closeReason);
+}
+
+Task<void> sendTask(std::shared_ptr<Client::State> state, std::span<const uint8_t> data, int lane, CancellationToken cancel) {
+    while (true) {
+        uint64_t drains;
+        {
+            std::lock_guard guard(state->mutex);
+            if (state->phase != Phase::Open || state->guid == nullptr) throw WebSocketError(state->closeCode, "Not connected");
+
+            // The engine refuses a message that would take its queue past the high watermark and reports "drain"
+            // once it is back under the low one
+            drains = state->drains;
+            if (state->engine->sendMessage(state->guid, data.data(), static_cast<int>(data.size()), lane)) co_return;
+        }
+
+        co_await WaitFor(*state, state->sendWaiter, [&state, drains] {
+            return state->drains != drains || state->phase != Phase::Open;
+        }, cancel);
+    }
+}
+
+Task<Message> receiveTask(std::shared_ptr<Client::State> state, CancellationToken cancel) {
+    co_await WaitFor(*state, state->receiveWaiter, [&state] {
+        return !state->received.empty() || state->phase == Phase::Closed;
+    }, cancel);
+
+    std::lock_guard guard(state->mutex);
+    if (state->received.empty()) throw WebSocketError(state->closeCode, state->closeReason);
+
+    auto message = std::move(state->received.front());
+    state->received.pop_front();
+    state->receivedBytes -= message.data.size();
+    if (state->receivePaused && state->receivedBytes <= state->receiveLowBytes && state->guid != nullptr) {
+        state->receivePaused = false;
+        state->engine->setReceivePaused(state->guid, 0);
+    }
+    co_return message;
+}
+
+} // namespace
+
+bool Client::loadEngine(const std::string &path) {
+    {
+        std::lock_guard guard(engineMutex);
+        enginePath = path;
+    }
+    return engine() != nullptr;
+}
+
+void Client::setLogHandler(std::function<void(const char *)> handler) {
+    std::lock_guard guard(logMutex);
+    logHandler = std::move(handler);
+}
+
+bool Client::setNetworkImpairment(const std::string &config) {
+    auto loaded = engine();
+    return loaded != nullptr && loaded->setNetworkImpairment(config.c_str()) == 1;
+}
+
+std::string Client::getNetworkImpairmentStats() {
+    auto loaded = engine();
+    if (loaded == nullptr) return {};
+
+    // The engine reports the size it needs, terminator included, when the buffer is short
+    std::string stats(256, '\0');
+    int required = loaded->getNetworkImpairmentStats(stats.data(), static_cast<int>(stats.size()));
+    if (required > static_cast<int>(stats.size())) {
+        stats.resize(static_cast<size_t>(required));
+        required = loaded->getNetworkImpairmentStats(stats.data(), required);
+    }
+    stats.resize(required > 0 ? static_cast<size_t>(required) - 1 : 0);
+    return stats;
+}
+
+Client::Client(Executor &executor) : m_state(std::make_shared<State>(executor)) {
+    m_state->engine = engine();
+    {
+        std::lock_guard guard(registryMutex);
+        m_state->id = nextId++;
+        registry.emplace(m_state->id, m_state);
+    }
+
+    if (m_state->engine != nullptr) {
+        m_state->guid = m_state->engine->createWebSocketClient(reinterpret_cast<const void *>(m_state->id));
+    }
+}
+
+Client::~Client() {
+    {
+        std::lock_guard guard(registryMutex);
+        registry.erase(m_state->id);
+    }
+
+    char *guid;
+    {
+        std::lock_guard guard(m_state->mutex);
+        guid = std::exchange(m_state->guid, nullptr);
+    }
+
+    // Silences the engine client and frees guid; callbacks already running hold the State, not the Client
+    if (guid != nullptr) {
+        m_state->engine->destroyWebSocketClient(guid);
+    }
+}
+
+Task<void> Client::connect(std::string uri, CancellationToken cancel) {
+    return connectTask(m_state, std::move(uri), std::nullopt, std::move(cancel));
+}
+
+Task<void> Client::connect(std::string uri, ConnectOptions options, CancellationToken cancel) {
+    return connectTask(m_state, std::move(uri), options, std::move(cancel));
+}
+
+Task<void> Client::send(std::span<const uint8_t> data, int lane, CancellationToken cancel) {
+    return sendTask(m_state, data, lane, std::move(cancel));
+}
+
+Task<Message> Client::receive(CancellationToken cancel) {
+    return receiveTask(m_state, std::move(cancel));
+}
+
+void Client::close(int closeCode) {
+    std::lock_guard guard(m_state->mutex);
+    if (m_state->guid != nullptr) {
+        m_state->engine->disconnect(m_state->guid, closeCode);
+    }
+}
+
+int64_t Client::bufferedAmount() const {
+    std::lock_guard guard(m_state->mutex);
+    return m_state->guid != nullptr ? m_state->engine->getBufferedAmount(m_state->guid) : 0;
+}
+
+void Client::setSendWatermarks(int64_t lowBytes, int64_t highBytes) {
+    std::lock_guard guard(m_state->mutex);
+    if (m_state->guid != nullptr) {
+        m_state->engine->setSendWatermarks(m_state->guid, lowBytes, highBytes);
+    }
+}
+
+void Client::setReceiveWatermarks(size_t lowBytes, size_t highBytes) {
+    std::lock_guard guard(m_state->mutex);
+    m_state->receiveLowBytes = std::min(lowBytes, highBytes);
+    m_state->receiveHighBytes = highBytes;
+}
+
+} // namespace WebSocketAne
@@ -0,0 +1,102 @@
+//
+//  Engine.cpp
+//  WebSocketAneClient
+//
+
+#include "Engine.hpp"
+#include <mutex>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <climits>
+#include <dlfcn.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <mach-o/dyld.h>
+#endif
+#endif
+
+namespace WebSocketAne::detail {
+
+namespace {
+
+#if defined(_WIN32)
+constexpr const char *LibraryName = "WebSocketClientNativeLibrary.dll";
+#elif defined(__APPLE__)
+constexpr const char *LibraryName = "WebSocketClientNativeLibrary.dylib";
+#else
+constexpr const char *LibraryName = "WebSocketClientNativeLibrary.so";
+#endif
+
+std::string executableDirectory() {
+    std::string path;
+#if defined(_WIN32)
+    char buffer[MAX_PATH];
+    DWORD length = GetModuleFileNameA(nullptr, buffer, MAX_PATH);
+    path.assign(buffer, length);
+#elif defined(__APPLE__)
+    char buffer[PATH_MAX];
+    uint32_t size = sizeof(buffer);
+    if (_NSGetExecutablePath(buffer, &size) == 0) path = buffer;
+#else
+    char buffer[PATH_MAX];
+    auto length = readlink("/proc/self/exe", buffer, sizeof(buffer));
+    if (length > 0) path.assign(buffer, static_cast<size_t>(length));
+#endif
+    auto separator = path.find_last_of("\\/");
+    return separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+}
+
+void *openLibrary(const std::string &path) {
+#ifdef _WIN32
+    return LoadLibraryA(path.c_str());
+#else
+    return dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+#endif
+}
+
+void *findSymbol(void *library, const char *name) {
+#ifdef _WIN32
+    return reinterpret_cast<void *>(GetProcAddress(static_cast<HMODULE>(library), name));
+#else
+    return dlsym(library, name);
+#endif
+}
+
+template<typename Function>
+bool resolve(void *library, const char *name, Function &function) {
+    function = reinterpret_cast<Function>(findSymbol(library, name));
+    return function != nullptr;
+}
+
+} // namespace
+
+const Engine *loadEngine(const std::string &path) {
+    static std::once_flag loaded;
+    static Engine engine;
+    static bool available = false;
+
+    std::call_once(loaded, [&path] {
+        // The library stays loaded for the life of the process, as in the ANE shims
+        void *library = openLibrary(path.empty() ? executableDirectory() + LibraryName : path);
+        if (library == nullptr) return;
+
+        available = resolve(library, "csharpWebSocketLibrary_initializerCallbacks", engine.initializerCallbacks) &&
+                    resolve(library, "csharpWebSocketLibrary_createWebSocketClient", engine.createWebSocketClient) &&
+                    resolve(library, "csharpWebSocketLibrary_destroyWebSocketClient", engine.destroyWebSocketClient) &&
+                    resolve(library, "csharpWebSocketLibrary_connect", engine.connect) &&
+                    resolve(library, "csharpWebSocketLibrary_connectWithOptions", engine.connectWithOptions) &&
+                    resolve(library, "csharpWebSocketLibrary_sendMessage", engine.sendMessage) &&
+                    resolve(library, "csharpWebSocketLibrary_disconnect", engine.disconnect) &&
+                    resolve(library, "csharpWebSocketLibrary_getBufferedAmount", engine.getBufferedAmount) &&
+                    resolve(library, "csharpWebSocketLibrary_setSendWatermarks", engine.setSendWatermarks) &&
+                    resolve(library, "csharpWebSocketLibrary_setReceivePaused", engine.setReceivePaused) &&
+                    resolve(library, "csharpWebSocketLibrary_setNetworkImpairment", engine.setNetworkImpairment) &&
+                    resolve(library, "csharpWebSocketLibrary_getNetworkImpairmentStats", engine.getNetworkImpairmentStats);
+    });
+
+    return available ? &engine : nullptr;
+}
+
+} // namespace WebSocketAne::detail
@@ -0,0 +1,49 @@
+//
+//  Engine.hpp
+//  WebSocketAneClient
+//
+
+#ifndef WebSocketAne_Engine_hpp
+#define WebSocketAne_Engine_hpp
+
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#define WEBSOCKET_ANE_CDECL __cdecl
+#else
+#define WEBSOCKET_ANE_CDECL
+#endif
+
+namespace WebSocketAne::detail {
+
+using ConnectCallback = void (WEBSOCKET_ANE_CDECL *)(void *ctx);
+using DataCallback = void (WEBSOCKET_ANE_CDECL *)(void *ctx, const uint8_t *data, int length, int messageType, int64_t receivedAgeNanos);
+using DisconnectCallback = void (WEBSOCKET_ANE_CDECL *)(void *ctx, int closeCode, const char *reason);
+using LogCallback = void (WEBSOCKET_ANE_CDECL *)(const char *message);
+using StatusCallback = void (WEBSOCKET_ANE_CDECL *)(void *ctx, const char *code, const char *level);
+
+// The csharpWebSocketLibrary_* exports this library uses, resolved from the engine library at load time. The same
+// exports the ANE shims declare in WebSocketNativeLibrary.h
+struct Engine {
+    int (WEBSOCKET_ANE_CDECL *initializerCallbacks)(const void *, const void *, const void *, const void *, const void *);
+    char *(WEBSOCKET_ANE_CDECL *createWebSocketClient)(const void *ctx);
+    int (WEBSOCKET_ANE_CDECL *destroyWebSocketClient)(const void *guid);
+    int (WEBSOCKET_ANE_CDECL *connect)(const void *guid, const char *url);
+    int (WEBSOCKET_ANE_CDECL *connectWithOptions)(const void *guid, const char *url, const void *options);
+    int (WEBSOCKET_ANE_CDECL *sendMessage)(const void *guid, const void *data, int length, int lane);
+    void (WEBSOCKET_ANE_CDECL *disconnect)(const void *guid, int closeCode);
+    int64_t (WEBSOCKET_ANE_CDECL *getBufferedAmount)(const void *guid);
+    int (WEBSOCKET_ANE_CDECL *setSendWatermarks)(const void *guid, int64_t low, int64_t high);
+    int (WEBSOCKET_ANE_CDECL *setReceivePaused)(const void *guid, int paused);
+    int (WEBSOCKET_ANE_CDECL *setNetworkImpairment)(const char *config);
+    int (WEBSOCKET_ANE_CDECL *getNetworkImpairmentStats)(char *buffer, int bufferLength);
+};
+
+// Loads the engine and resolves every export once; later calls return the first result. Null when the library or
+// one of the exports is missing
+const Engine *loadEngine(const std::string &path);
+
+} // namespace WebSocketAne::detail
+
+#endif /* WebSocketAne_Engine_hpp */
@@ -0,0 +1,97 @@
+//
+//  Executor.cpp
+//  WebSocketAneClient
+//
+
+#include "WebSocketAne/Executor.hpp"
+#include <algorithm>
+
+namespace WebSocketAne {
+
+ThreadPoolExecutor::ThreadPoolExecutor(size_t threads) {
+    threads = std::max<size_t>(threads, 1);
+    m_threads.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        m_threads.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPoolExecutor::~ThreadPoolExecutor() {
+    {
+        std::lock_guard guard(m_mutex);
+        m_stopping = true;
+    }
+    m_available.notify_all();
+    for (auto &thread : m_threads) {
+        thread.join();
+    }
+}
+
+void ThreadPoolExecutor::post(std::function<void()> work) {
+    {
+        std::lock_guard guard(m_mutex);
+        m_queue.push_back(std::move(work));
+    }
+    m_available.notify_one();
+}
+
+void ThreadPoolExecutor::workerLoop() {
+    while (true) {
+        std::function<void()> work;
+        {
+            std::unique_lock lock(m_mutex);
+            m_available.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) return;
+            work = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        work();
+    }
+}
+
+void EventLoop::post(std::function<void()> work) {
+    {
+        std::lock_guard guard(m_mutex);
+        m_queue.push_back(std::move(work));
+    }
+    m_available.notify_one();
+}
+
+void EventLoop::run() {
+    while (true) {
+        std::function<void()> work;
+        {
+            std::unique_lock lock(m_mutex);
+            m_available.wait(lock, [this] { return m_stopped || !m_queue.empty(); });
+            if (m_stopped) {
+                m_stopped = false;
+                return;
+            }
+            work = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        work();
+    }
+}
+
+size_t EventLoop::poll() {
+    std::deque<std::function<void()>> batch;
+    {
+        std::lock_guard guard(m_mutex);
+        batch.swap(m_queue);
+    }
+    for (auto &work : batch) {
+        work();
+    }
+    return batch.size();
+}
+
+void EventLoop::stop() {
+    {
+        std::lock_guard guard(m_mutex);
+        m_stopped = true;
+    }
+    m_available.notify_all();
+}
+
+} // namespace WebSocketAne
@@ -0,0 +1,86 @@
+//
+//  DecodePool.hpp
+//  WebSocketANE
+//
+
+#ifndef DecodePool_hpp
+#define DecodePool_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "LatencyHistogram.hpp"
+
+// CPU-heavy per-message stages the pool runs, each with its own queue and run time histograms
+enum class DecodeStage : size_t {
+    Amf3Index,
+    JsonIndex,
+    Count
+};
+
+// Work-stealing pool for the per-message decode stages, shared by every client so one large message no longer holds
+// up the engine thread that delivers the next message, or other connections behind it. There is one worker per
+// hardware thread, each with its own deque: a worker runs its oldest job first and, once its deque is empty, steals
+// the newest job of another. Jobs complete in any order; WebSocketClient puts messages back in connection order by
+// sequence number.
+class DecodePool {
+public:
+    // Created on first use with hardware_concurrency() workers and never destroyed: joining threads from a static
+    // destructor can deadlock while the runtime unloads the extension
+    static DecodePool& shared();
+
+    explicit DecodePool(size_t threads);
+    ~DecodePool();
+    DecodePool(const DecodePool&) = delete;
+    DecodePool& operator=(const DecodePool&) = delete;
+
+    void submit(DecodeStage stage, std::function<void()> job);
+    size_t threads() const { return m_workers.size(); }
+
+    // {"threads":..,"submitted":..,"steals":..,"stages":{"amf3Index":{"queued":{..},"run":{..}},"jsonIndex":..}}
+    // with the histograms in microseconds
+    std::string statsJson() const;
+
+private:
+    struct Job {
+        DecodeStage stage;
+        uint64_t submittedAt;
+        std::function<void()> run;
+    };
+
+    struct Worker {
+        std::mutex lock;
+        std::deque<Job> jobs;
+        std::thread thread;
+    };
+
+    struct StageStats {
+        LatencyHistogram queued;
+        LatencyHistogram run;
+    };
+
+    bool takeJob(size_t self, Job& job);
+    void workerLoop(size_t self);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<size_t> m_next_worker{0};
+    // Jobs submitted and not yet taken; workers sleep only while it is zero
+    std::atomic<size_t> m_pending{0};
+    std::atomic<size_t> m_sleeping{0};
+    std::mutex m_sleep_lock;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+    std::atomic<uint64_t> m_submitted{0};
+    std::atomic<uint64_t> m_steals{0};
+    StageStats m_stages[static_cast<size_t>(DecodeStage::Count)];
+};
+
+#endif /* DecodePool_hpp */
@@ -0,0 +1,186 @@
+//
+//  DeltaDecoder.cpp
+//  WebSocketANE
+//
+
+#include "DeltaDecoder.hpp"
+#include <algorithm>
+#include "Trace.hpp"
+
+static constexpr uint8_t KindSnapshot = 0;
+static constexpr uint8_t KindDelta = 1;
+static constexpr uint8_t OpCopy = 0x01;
+static constexpr uint8_t OpInsert = 0x02;
+
+static bool readVarint(const uint8_t *data, size_t length, size_t &position, uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && position < length; shift += 7) {
+        uint8_t byte = data[position++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void DeltaDecoder::configure(size_t maxBytes) {
+    std::lock_guard guard(m_lock);
+    m_max_bytes = maxBytes;
+    m_enabled.store(maxBytes > 0, std::memory_order_relaxed);
+    if (maxBytes == 0) {
+        m_bases.clear();
+        m_index.clear();
+        m_stored_bytes = 0;
+        return;
+    }
+    evictLocked();
+}
+
+bool DeltaDecoder::apply(const uint8_t *data, size_t length, WebSocketMessage &output, std::string &key, const char *&error) {
+    TRACE_SCOPE("deltaApply");
+    auto started = monotonicNanos();
+    std::lock_guard guard(m_lock);
+    m_wire_bytes += length;
+    key.clear();
+    if (!applyLocked(data, length, output, key, error)) {
+        m_errors++;
+        return false;
+    }
+    m_reconstructed_bytes += output.size();
+    m_apply_time.record((monotonicNanos() - started) / 1000);
+    return true;
+}
+
+bool DeltaDecoder::applyLocked(const uint8_t *data, size_t length, WebSocketMessage &output, std::string &key, const char *&error) {
+    if (length < 2 || data[0] > KindDelta || static_cast<size_t>(data[1]) > length - 2) {
+        error = "bad header";
+        return false;
+    }
+    key.assign(reinterpret_cast<const char *>(data + 2), data[1]);
+    size_t position = 2 + static_cast<size_t>(data[1]);
+
+    if (data[0] == KindSnapshot) {
+        auto &base = touchLocked(key);
+        m_stored_bytes -= base.payload.size();
+        base.payload.assign(data + position, data + length);
+        m_stored_bytes += base.payload.size();
+        m_snapshots++;
+        output = WebSocketMessage(base.payload.data(), base.payload.size());
+        evictLocked();
+        return true;
+    }
+
+    auto found = m_index.find(key);
+    if (found == m_index.end()) {
+        error = "no base";
+        return false;
+    }
+    const auto &base = found->second->payload;
+
+    // The base no longer matches what the server holds, so later deltas for the key fail until the next snapshot
+    auto fail = [this, &key, &error](const char *reason) {
+        error = reason;
+        forgetLocked(key);
+        return false;
+    };
+
+    uint64_t baseLength;
+    uint64_t targetLength;
+    if (!readVarint(data, length, position, baseLength) || !readVarint(data, length, position, targetLength)) {
+        return fail("bad header");
+    }
+    if (baseLength != base.size()) {
+        return fail("base mismatch");
+    }
+
+    // The target length comes off the wire, so it only sizes the reservation up to what the instructions could
+    // plausibly produce; the vector grows past that if it has to
+    std::vector<uint8_t> target;
+    target.reserve(static_cast<size_t>(std::min<uint64_t>(targetLength, base.size() + length)));
+    while (position < length) {
+        uint8_t op = data[position++];
+        uint64_t offset = 0;
+        uint64_t count;
+        if (op == OpCopy) {
+            if (!readVarint(data, length, position, offset) || !readVarint(data, length, position, count) ||
+                offset > base.size() || count > base.size() - offset) {
+                return fail("bad copy");
+            }
+        } else if (op == OpInsert) {
+            if (!readVarint(data, length, position, count) || count > length - position) {
+                return fail("bad insert");
+            }
+        } else {
+            return fail("bad instruction");
+        }
+
+        if (count > targetLength - target.size()) {
+            return fail("target overflow");
+        }
+
+        if (op == OpCopy) {
+            target.insert(target.end(), base.begin() + static_cast<ptrdiff_t>(offset), base.begin() + static_cast<ptrdiff_t>(offset + count));
+        } else {
+            target.insert(target.end(), data + position, data + position + count);
+            position += static_cast<size_t>(count);
+        }
+    }
+    if (target.size() != targetLength) {
+        return fail("target length mismatch");
+    }
+
+    auto &stored = touchLocked(key);
+    m_stored_bytes = m_stored_bytes - stored.payload.size() + target.size();
+    stored.payload.swap(target);
+    m_deltas++;
+    output = WebSocketMessage(stored.payload.data(), stored.payload.size());
+    evictLocked();
+    return true;
+}
+
+DeltaDecoder::Base &DeltaDecoder::touchLocked(const std::string &key) {
+    auto found = m_index.find(key);
+    if (found != m_index.end()) {
+        m_bases.splice(m_bases.begin(), m_bases, found->second);
+        return m_bases.front();
+    }
+    m_bases.push_front(Base{key, {}});
+    m_index.emplace(key, m_bases.begin());
+    return m_bases.front();
+}
+
+void DeltaDecoder::forgetLocked(const std::string &key) {
+    auto found = m_index.find(key);
+    if (found == m_index.end()) {
+        return;
+    }
+    m_stored_bytes -= found->second->payload.size();
+    m_bases.erase(found->second);
+    m_index.erase(found);
+}
+
+void DeltaDecoder::evictLocked() {
+    while (m_stored_bytes > m_max_bytes && m_bases.size() > 1) {
+        auto &oldest = m_bases.back();
+        m_stored_bytes -= oldest.payload.size();
+        m_index.erase(oldest.key);
+        m_bases.pop_back();
+        m_evictions++;
+    }
+}
+
+std::string DeltaDecoder::statsJson() {
+    std::lock_guard guard(m_lock);
+    return "{\"enabled\":" + std::string(m_enabled.load(std::memory_order_relaxed) ? "true" : "false") +
+           ",\"snapshots\":" + std::to_string(m_snapshots) +
+           ",\"deltas\":" + std::to_string(m_deltas) +
+           ",\"errors\":" + std::to_string(m_errors) +
+           ",\"wireBytes\":" + std::to_string(m_wire_bytes) +
+           ",\"reconstructedBytes\":" + std::to_string(m_reconstructed_bytes) +
+           ",\"keys\":" + std::to_string(m_bases.size()) +
+           ",\"storedBytes\":" + std::to_string(m_stored_bytes) +
+           ",\"maxBytes\":" + std::to_string(m_max_bytes) +
+           ",\"evictions\":" + std::to_string(m_evictions) +
+           ",\"apply\":" + m_apply_time.toJson() + "}";
+}
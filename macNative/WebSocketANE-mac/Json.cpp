@@ -0,0 +1,709 @@
+#include "Json.hpp"
+#include "Trace.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define JSON_SSE2 1
+#elif defined(_M_ARM64) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define JSON_NEON 1
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+    constexpr int MaxDepth = 256;
+    constexpr size_t BlockSize = 64;
+    constexpr uint64_t EvenBits = 0x5555555555555555ULL;
+
+    // Bit i of each mask is set when byte i of the 64-byte block matches
+    struct BlockMasks {
+        uint64_t quote;
+        uint64_t backslash;
+        uint64_t op;
+        uint64_t whitespace;
+    };
+
+#if JSON_SSE2
+    uint64_t movemask(__m128i matches, int chunk) {
+        return static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(matches))) << (chunk * 16);
+    }
+
+    BlockMasks classify(const uint8_t *block) {
+        BlockMasks masks{};
+        for (int chunk = 0; chunk < 4; chunk++) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + chunk * 16));
+            auto is = [bytes](char c) { return _mm_cmpeq_epi8(bytes, _mm_set1_epi8(c)); };
+            __m128i op = _mm_or_si128(_mm_or_si128(_mm_or_si128(is('{'), is('}')), _mm_or_si128(is('['), is(']'))),
+                                      _mm_or_si128(is(':'), is(',')));
+            __m128i whitespace = _mm_or_si128(_mm_or_si128(is(' '), is('\t')), _mm_or_si128(is('\n'), is('\r')));
+            masks.quote |= movemask(is('"'), chunk);
+            masks.backslash |= movemask(is('\\'), chunk);
+            masks.op |= movemask(op, chunk);
+            masks.whitespace |= movemask(whitespace, chunk);
+        }
+        return masks;
+    }
+#elif JSON_NEON
+    // NEON has no movemask: weight each lane by its bit and fold the four vectors with pairwise adds
+    uint64_t movemask(uint8x16_t m0, uint8x16_t m1, uint8x16_t m2, uint8x16_t m3) {
+        const uint8x16_t weights = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+        uint8x16_t sum0 = vpaddq_u8(vandq_u8(m0, weights), vandq_u8(m1, weights));
+        uint8x16_t sum1 = vpaddq_u8(vandq_u8(m2, weights), vandq_u8(m3, weights));
+        sum0 = vpaddq_u8(sum0, sum1);
+        sum0 = vpaddq_u8(sum0, sum0);
+        return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+    }
+
+    BlockMasks classify(const uint8_t *block) {
+        uint8x16_t bytes[4] = {vld1q_u8(block), vld1q_u8(block + 16), vld1q_u8(block + 32), vld1q_u8(block + 48)};
+        uint8x16_t quote[4], backslash[4], op[4], whitespace[4];
+        for (int chunk = 0; chunk < 4; chunk++) {
+            auto is = [&bytes, chunk](uint8_t c) { return vceqq_u8(bytes[chunk], vdupq_n_u8(c)); };
+            quote[chunk] = is('"');
+            backslash[chunk] = is('\\');
+            op[chunk] = vorrq_u8(vorrq_u8(vorrq_u8(is('{'), is('}')), vorrq_u8(is('['), is(']'))), vorrq_u8(is(':'), is(',')));
+            whitespace[chunk] = vorrq_u8(vorrq_u8(is(' '), is('\t')), vorrq_u8(is('\n'), is('\r')));
+        }
+        BlockMasks masks;
+        masks.quote = movemask(quote[0], quote[1], quote[2], quote[3]);
+        masks.backslash = movemask(backslash[0], backslash[1], backslash[2], backslash[3]);
+        masks.op = movemask(op[0], op[1], op[2], op[3]);
+        masks.whitespace = movemask(whitespace[0], whitespace[1], whitespace[2], whitespace[3]);
+        return masks;
+    }
+#else
+    BlockMasks classify(const uint8_t *block) {
+        BlockMasks masks{};
+        for (size_t i = 0; i < BlockSize; i++) {
+            uint64_t bit = 1ULL << i;
+            switch (block[i]) {
+                case '"':
+                    masks.quote |= bit;
+                    break;
+                case '\\':
+                    masks.backslash |= bit;
+                    break;
+                case '{':
+                case '}':
+                case '[':
+                case ']':
+                case ':':
+                case ',':
+                    masks.op |= bit;
+                    break;
+                case ' ':
+                case '\t':
+                case '\n':
+                case '\r':
+                    masks.whitespace |= bit;
+                    break;
+                default:
+                    break;
+            }
+        }
+        return masks;
+    }
+#endif
+
+    int trailingZeros(uint64_t bits) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, bits);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(bits);
+#endif
+    }
+
+    // Bit i becomes the XOR of bits 0..i: set from each opening quote up to its closing quote
+    uint64_t prefixXor(uint64_t bits) {
+        bits ^= bits << 1;
+        bits ^= bits << 2;
+        bits ^= bits << 4;
+        bits ^= bits << 8;
+        bits ^= bits << 16;
+        bits ^= bits << 32;
+        return bits;
+    }
+
+    bool isTerminator(uint8_t c) {
+        switch (c) {
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case ':':
+            case ',':
+            case '"':
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    int hexValue(uint8_t c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    // Length of the well-formed UTF-8 sequence starting with a non-ASCII byte at text, 0 if invalid
+    size_t utf8SequenceLength(const uint8_t *text, size_t available) {
+        uint8_t lead = text[0];
+        size_t length;
+        uint32_t codePoint;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+            codePoint = lead & 0x1F;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            codePoint = lead & 0x0F;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            codePoint = lead & 0x07;
+        } else {
+            return 0;
+        }
+        if (available < length) {
+            return 0;
+        }
+        for (size_t i = 1; i < length; i++) {
+            if ((text[i] & 0xC0) != 0x80) {
+                return 0;
+            }
+            codePoint = (codePoint << 6) | (text[i] & 0x3F);
+        }
+        // Overlong forms, surrogates and code points past U+10FFFF
+        if ((length == 3 && (codePoint < 0x800 || (codePoint >= 0xD800 && codePoint <= 0xDFFF))) ||
+            (length == 4 && (codePoint < 0x10000 || codePoint > 0x10FFFF))) {
+            return 0;
+        }
+        return length;
+    }
+
+    void appendUtf8(std::string &output, uint32_t codePoint) {
+        if (codePoint < 0x80) {
+            output.push_back(static_cast<char>(codePoint));
+        } else if (codePoint < 0x800) {
+            output.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+            output.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        } else if (codePoint < 0x10000) {
+            output.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+            output.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        } else {
+            output.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+            output.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+    }
+
+    uint32_t readHex4(const uint8_t *text) {
+        return (hexValue(text[0]) << 12) | (hexValue(text[1]) << 8) | (hexValue(text[2]) << 4) | hexValue(text[3]);
+    }
+
+    // Escapes were validated by the parser
+    void unescape(const uint8_t *text, size_t length, std::string &output) {
+        output.clear();
+        output.reserve(length);
+        for (size_t i = 0; i < length; i++) {
+            if (text[i] != '\\') {
+                output.push_back(static_cast<char>(text[i]));
+                continue;
+            }
+            uint8_t escape = text[++i];
+            switch (escape) {
+                case 'b': output.push_back('\b'); break;
+                case 'f': output.push_back('\f'); break;
+                case 'n': output.push_back('\n'); break;
+                case 'r': output.push_back('\r'); break;
+                case 't': output.push_back('\t'); break;
+                case 'u': {
+                    uint32_t codePoint = readHex4(text + i + 1);
+                    i += 4;
+                    if (codePoint >= 0xD800 && codePoint <= 0xDBFF && i + 6 < length && text[i + 1] == '\\' && text[i + 2] == 'u') {
+                        uint32_t low = readHex4(text + i + 3);
+                        if (low >= 0xDC00 && low <= 0xDFFF) {
+                            codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                            i += 6;
+                        }
+                    }
+                    // Unpaired surrogates cannot be written as UTF-8
+                    appendUtf8(output, codePoint >= 0xD800 && codePoint <= 0xDFFF ? 0xFFFD : codePoint);
+                    break;
+                }
+                default:
+                    output.push_back(static_cast<char>(escape));
+                    break;
+            }
+        }
+    }
+
+    // Stage 1: offsets of every structural character outside strings, every opening quote and the first byte of
+    // every other scalar (numbers, true/false/null, and garbage the grammar pass will reject)
+    bool findStructurals(const uint8_t *data, size_t length, std::vector<uint32_t> &structurals) {
+        uint64_t prevEscaped = 0;
+        uint64_t prevInString = 0;
+        uint64_t prevScalar = 0;
+        uint8_t tail[BlockSize];
+
+        for (size_t base = 0; base < length; base += BlockSize) {
+            const uint8_t *block = data + base;
+            if (length - base < BlockSize) {
+                std::memset(tail, ' ', BlockSize);
+                std::memcpy(tail, block, length - base);
+                block = tail;
+            }
+            auto masks = classify(block);
+
+            // Characters preceded by an odd run of backslashes, runs carried across blocks
+            uint64_t backslash = masks.backslash & ~prevEscaped;
+            uint64_t followsEscape = (backslash << 1) | prevEscaped;
+            uint64_t oddSequenceStarts = backslash & ~EvenBits & ~followsEscape;
+            uint64_t sequencesStartingOnEvenBits = oddSequenceStarts + backslash;
+            prevEscaped = sequencesStartingOnEvenBits < backslash ? 1 : 0;
+            uint64_t escaped = (EvenBits ^ (sequencesStartingOnEvenBits << 1)) & followsEscape;
+
+            uint64_t quote = masks.quote & ~escaped;
+            uint64_t inString = prefixXor(quote) ^ prevInString;
+            prevInString = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+
+            uint64_t scalar = ~(masks.op | masks.whitespace | quote) & ~inString;
+            uint64_t scalarStart = scalar & ~((scalar << 1) | prevScalar);
+            prevScalar = scalar >> 63;
+
+            uint64_t structural = (masks.op & ~inString) | (quote & inString) | scalarStart;
+            while (structural != 0) {
+                structurals.push_back(static_cast<uint32_t>(base + trailingZeros(structural)));
+                structural &= structural - 1;
+            }
+        }
+
+        // Unterminated string
+        return prevInString == 0;
+    }
+
+    // Stage 2: walks the structural offsets checking the grammar and writing the tape
+    class JsonParser {
+    public:
+        JsonParser(const uint8_t *data, size_t length, const std::vector<uint32_t> &structurals, std::vector<JsonNode> &nodes)
+            : m_data(data), m_length(length), m_structurals(structurals), m_nodes(nodes) {
+        }
+
+        bool parse() {
+            return parseValue(0) && m_next == m_structurals.size();
+        }
+
+    private:
+        size_t push(JsonKind kind) {
+            JsonNode node{};
+            node.kind = kind;
+            node.next = static_cast<uint32_t>(m_nodes.size() + 1);
+            m_nodes.push_back(node);
+            return m_nodes.size() - 1;
+        }
+
+        bool nextCharacter(uint8_t &c) {
+            if (m_next >= m_structurals.size()) {
+                return false;
+            }
+            c = m_data[m_structurals[m_next++]];
+            return true;
+        }
+
+        uint8_t peekCharacter() const {
+            return m_next < m_structurals.size() ? m_data[m_structurals[m_next]] : 0;
+        }
+
+        bool endsScalar(size_t position) const {
+            return position == m_length || isTerminator(m_data[position]);
+        }
+
+        bool parseValue(int depth) {
+            if (depth > MaxDepth || m_next >= m_structurals.size()) {
+                return false;
+            }
+            uint32_t offset = m_structurals[m_next++];
+            switch (m_data[offset]) {
+                case '{':
+                    return parseObject(depth);
+                case '[':
+                    return parseArray(depth);
+                case '"':
+                    return parseString(offset);
+                case 't':
+                    return parseLiteral(offset, "true", JsonKind::True);
+                case 'f':
+                    return parseLiteral(offset, "false", JsonKind::False);
+                case 'n':
+                    return parseLiteral(offset, "null", JsonKind::Null);
+                default:
+                    return parseNumber(offset);
+            }
+        }
+
+        bool parseObject(int depth) {
+            size_t node = push(JsonKind::Object);
+            uint32_t members = 0;
+            if (peekCharacter() == '}') {
+                m_next++;
+            } else {
+                while (true) {
+                    uint8_t c;
+                    if (peekCharacter() != '"' || !parseString(m_structurals[m_next++]) ||
+                        !nextCharacter(c) || c != ':' || !parseValue(depth + 1) || !nextCharacter(c)) {
+                        return false;
+                    }
+                    members++;
+                    if (c == '}') {
+                        break;
+                    }
+                    if (c != ',') {
+                        return false;
+                    }
+                }
+            }
+            m_nodes[node].count = members;
+            m_nodes[node].next = static_cast<uint32_t>(m_nodes.size());
+            return true;
+        }
+
+        bool parseArray(int depth) {
+            size_t node = push(JsonKind::Array);
+            uint32_t elements = 0;
+            if (peekCharacter() == ']') {
+                m_next++;
+            } else {
+                while (true) {
+                    uint8_t c;
+                    if (!parseValue(depth + 1) || !nextCharacter(c)) {
+                        return false;
+                    }
+                    elements++;
+                    if (c == ']') {
+                        break;
+                    }
+                    if (c != ',') {
+                        return false;
+                    }
+                }
+            }
+            m_nodes[node].count = elements;
+            m_nodes[node].next = static_cast<uint32_t>(m_nodes.size());
+            return true;
+        }
+
+        bool parseString(uint32_t offset) {
+            constexpr uint64_t Ones = 0x0101010101010101ULL;
+            constexpr uint64_t Highs = 0x8080808080808080ULL;
+
+            size_t position = offset + 1;
+            bool escaped = false;
+            while (true) {
+                // Skip eight plain ASCII bytes at a time
+                while (m_length - position >= 8) {
+                    uint64_t word;
+                    std::memcpy(&word, m_data + position, sizeof(word));
+                    uint64_t quote = word ^ (Ones * '"');
+                    uint64_t backslash = word ^ (Ones * '\\');
+                    uint64_t special = (word & Highs) | ((word - Ones * 0x20) & ~word & Highs) |
+                                       ((quote - Ones) & ~quote & Highs) | ((backslash - Ones) & ~backslash & Highs);
+                    if (special != 0) {
+                        break;
+                    }
+                    position += 8;
+                }
+
+                if (position >= m_length) {
+                    return false;
+                }
+                uint8_t c = m_data[position];
+                if (c == '"') {
+                    break;
+                }
+                if (c == '\\') {
+                    if (m_length - position < 2) {
+                        return false;
+                    }
+                    uint8_t escape = m_data[position + 1];
+                    if (escape == 'u') {
+                        if (m_length - position < 6) {
+                            return false;
+                        }
+                        for (size_t i = 2; i < 6; i++) {
+                            if (hexValue(m_data[position + i]) < 0) {
+                                return false;
+                            }
+                        }
+                        position += 6;
+                    } else if (escape == '"' || escape == '\\' || escape == '/' || escape == 'b' || escape == 'f' ||
+                               escape == 'n' || escape == 'r' || escape == 't') {
+                        position += 2;
+                    } else {
+                        return false;
+                    }
+                    escaped = true;
+                } else if (c < 0x20) {
+                    return false;
+                } else if (c < 0x80) {
+                    position++;
+                } else {
+                    size_t sequence = utf8SequenceLength(m_data + position, m_length - position);
+                    if (sequence == 0) {
+                        return false;
+                    }
+                    position += sequence;
+                }
+            }
+
+            size_t node = push(JsonKind::String);
+            m_nodes[node].escaped = escaped;
+            m_nodes[node].range = {offset + 1, static_cast<uint32_t>(position - offset - 1)};
+            return true;
+        }
+
+        bool parseLiteral(uint32_t offset, const char *literal, JsonKind kind) {
+            size_t length = std::strlen(literal);
+            if (m_length - offset < length || std::memcmp(m_data + offset, literal, length) != 0 || !endsScalar(offset + length)) {
+                return false;
+            }
+            push(kind);
+            return true;
+        }
+
+        bool parseNumber(uint32_t offset) {
+            auto isDigit = [this](size_t position) { return position < m_length && m_data[position] >= '0' && m_data[position] <= '9'; };
+
+            size_t position = offset;
+            bool negative = m_data[position] == '-';
+            if (negative) {
+                position++;
+            }
+
+            size_t integerStart = position;
+            if (position < m_length && m_data[position] == '0') {
+                position++;
+            } else if (isDigit(position)) {
+                while (isDigit(position)) position++;
+            } else {
+                return false;
+            }
+            size_t integerDigits = position - integerStart;
+
+            bool integral = true;
+            if (position < m_length && m_data[position] == '.') {
+                position++;
+                if (!isDigit(position)) return false;
+                while (isDigit(position)) position++;
+                integral = false;
+            }
+            if (position < m_length && (m_data[position] == 'e' || m_data[position] == 'E')) {
+                position++;
+                if (position < m_length && (m_data[position] == '+' || m_data[position] == '-')) position++;
+                if (!isDigit(position)) return false;
+                while (isDigit(position)) position++;
+                integral = false;
+            }
+            if (!endsScalar(position)) {
+                return false;
+            }
+
+            size_t node = push(JsonKind::Double);
+            if (integral && integerDigits <= 15) {
+                // Exact without going through strtod
+                int64_t value = 0;
+                for (size_t i = integerStart; i < position; i++) {
+                    value = value * 10 + (m_data[i] - '0');
+                }
+                if (negative) {
+                    value = -value;
+                }
+                // -0 stays a Number, as with JSON.parse
+                bool fitsInt = value >= INT32_MIN && value <= INT32_MAX && !(negative && value == 0);
+                m_nodes[node].kind = fitsInt ? JsonKind::Integer : JsonKind::Double;
+                m_nodes[node].number = negative && value == 0 ? -0.0 : static_cast<double>(value);
+            } else {
+                std::string text(reinterpret_cast<const char *>(m_data + offset), position - offset);
+                m_nodes[node].number = std::strtod(text.c_str(), nullptr);
+            }
+            return true;
+        }
+
+        const uint8_t *m_data;
+        size_t m_length;
+        const std::vector<uint32_t> &m_structurals;
+        std::vector<JsonNode> &m_nodes;
+        size_t m_next = 0;
+    };
+
+    // FRE strings are passed NUL-terminated, as everywhere else in the shim
+    FREObject newString(const uint8_t *text, size_t length) {
+        static thread_local std::string buffer;
+        buffer.assign(reinterpret_cast<const char *>(text), length);
+        FREObject result = nullptr;
+        FRENewObjectFromUTF8(static_cast<uint32_t>(buffer.size()), reinterpret_cast<const uint8_t *>(buffer.c_str()), &result);
+        return result;
+    }
+
+    void stringValue(const JsonNode &node, const uint8_t *data, std::string &output) {
+        if (node.escaped) {
+            unescape(data + node.range.offset, node.range.length, output);
+        } else {
+            output.assign(reinterpret_cast<const char *>(data + node.range.offset), node.range.length);
+        }
+    }
+
+    FREObject materialize(const std::vector<JsonNode> &nodes, const uint8_t *data, size_t index) {
+        const auto &node = nodes[index];
+        FREObject result = nullptr;
+        switch (node.kind) {
+            case JsonKind::Null:
+                return nullptr;
+            case JsonKind::False:
+            case JsonKind::True:
+                FRENewObjectFromBool(node.kind == JsonKind::True, &result);
+                return result;
+            case JsonKind::Integer:
+                FRENewObjectFromInt32(static_cast<int32_t>(node.number), &result);
+                return result;
+            case JsonKind::Double:
+                FRENewObjectFromDouble(node.number, &result);
+                return result;
+            case JsonKind::String: {
+                if (!node.escaped) {
+                    return newString(data + node.range.offset, node.range.length);
+                }
+                std::string text;
+                unescape(data + node.range.offset, node.range.length, text);
+                return newString(reinterpret_cast<const uint8_t *>(text.data()), text.size());
+            }
+            case JsonKind::Array: {
+                FRENewObject(reinterpret_cast<const uint8_t *>("Array"), 0, nullptr, &result, nullptr);
+                FRESetArrayLength(result, node.count);
+                size_t child = index + 1;
+                for (uint32_t i = 0; i < node.count; i++) {
+                    FRESetArrayElementAt(result, i, materialize(nodes, data, child));
+                    child = nodes[child].next;
+                }
+                return result;
+            }
+            case JsonKind::Object: {
+                FRENewObject(reinterpret_cast<const uint8_t *>("Object"), 0, nullptr, &result, nullptr);
+                std::string key;
+                size_t child = index + 1;
+                for (uint32_t i = 0; i < node.count; i++) {
+                    stringValue(nodes[child], data, key);
+                    FRESetObjectProperty(result, reinterpret_cast<const uint8_t *>(key.c_str()), materialize(nodes, data, child + 1), nullptr);
+                    child = nodes[child + 1].next;
+                }
+                return result;
+            }
+        }
+        return nullptr;
+    }
+}
+
+std::shared_ptr<const JsonIndex> JsonIndex::build(const uint8_t *data, size_t length) {
+    if (length == 0 || length > UINT32_MAX) {
+        return nullptr;
+    }
+
+    // Reused by each network thread across messages
+    static thread_local std::vector<uint32_t> structurals;
+    structurals.clear();
+    if (!findStructurals(data, length, structurals)) {
+        return nullptr;
+    }
+
+    auto index = std::make_shared<JsonIndex>();
+    index->m_nodes.reserve(structurals.size() / 2 + 1);
+    JsonParser parser(data, length, structurals, index->m_nodes);
+    if (!parser.parse()) {
+        return nullptr;
+    }
+    return index;
+}
+
+int64_t JsonIndex::find(const uint8_t *data, const std::string &path) const {
+    size_t node = 0;
+    size_t start = 0;
+    std::string key;
+    while (!path.empty()) {
+        size_t end = path.find('.', start);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+        std::string_view segment(path.data() + start, end - start);
+
+        const auto &current = m_nodes[node];
+        if (current.kind == JsonKind::Object) {
+            size_t child = node + 1;
+            bool found = false;
+            for (uint32_t i = 0; i < current.count && !found; i++) {
+                const auto &keyNode = m_nodes[child];
+                if (keyNode.escaped) {
+                    stringValue(keyNode, data, key);
+                    found = key == segment;
+                } else {
+                    found = keyNode.range.length == segment.size() &&
+                            std::memcmp(data + keyNode.range.offset, segment.data(), segment.size()) == 0;
+                }
+                if (found) {
+                    node = child + 1;
+                } else {
+                    child = m_nodes[child + 1].next;
+                }
+            }
+            if (!found) {
+                return -1;
+            }
+        } else if (current.kind == JsonKind::Array) {
+            if (segment.empty() || segment.size() > 9) {
+                return -1;
+            }
+            uint32_t position = 0;
+            for (char c : segment) {
+                if (c < '0' || c > '9') {
+                    return -1;
+                }
+                position = position * 10 + (c - '0');
+            }
+            if (position >= current.count) {
+                return -1;
+            }
+            size_t child = node + 1;
+            for (uint32_t i = 0; i < position; i++) {
+                child = m_nodes[child].next;
+            }
+            node = child;
+        } else {
+            return -1;
+        }
+
+        if (end == path.size()) {
+            break;
+        }
+        start = end + 1;
+    }
+    return static_cast<int64_t>(node);
+}
+
+FREObject jsonMaterialize(const JsonIndex &index, const uint8_t *data, size_t node) {
+    TRACE_SCOPE("jsonMaterialize");
+    if (node >= index.nodes().size()) {
+        return nullptr;
+    }
+    return materialize(index.nodes(), data, node);
+}
@@ -0,0 +1,65 @@
+//
+//  Json.hpp
+//  WebSocketANE
+//
+
+#ifndef Json_hpp
+#define Json_hpp
+
+#include <FlashRuntimeExtensions.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "WebSocketMessage.hpp"
+
+enum class JsonKind : uint8_t {
+    Null,
+    False,
+    True,
+    Integer,
+    Double,
+    String,
+    Array,
+    Object
+};
+
+struct JsonRange {
+    uint32_t offset;
+    uint32_t length;
+};
+
+// One value of the tape. Containers are followed by their children in document order, an Object by key String
+// nodes each followed by its value; next lets lookups skip a whole subtree without walking it.
+struct JsonNode {
+    JsonKind kind;
+    bool escaped;                  // String: contains backslash escapes, so it cannot be handed to FRE as is
+    uint32_t count;                // Array: elements, Object: members
+    uint32_t next;                 // Index of the first node after this value and its children
+    union {
+        double number;             // Integer, Double
+        JsonRange range;           // String: the bytes between the quotes
+    };
+};
+
+// Validated JSON text flattened into a tape, simdjson style: a SIMD pass (SSE2 or NEON, scalar elsewhere) marks
+// the structural characters of each 64-byte block outside strings, then one pass over those positions checks the
+// grammar, strings (escapes, UTF-8) and numbers while writing the tape. Strings point back into the message.
+class JsonIndex : public MessageIndex {
+public:
+    // Returns nullptr unless data is exactly one valid JSON value (surrounding whitespace allowed)
+    static std::shared_ptr<const JsonIndex> build(const uint8_t *data, size_t length);
+
+    const std::vector<JsonNode> &nodes() const { return m_nodes; }
+
+    // Node index of the value at path, keys and array indices separated by '.', e.g. "items.0.price"; -1 if absent
+    int64_t find(const uint8_t *data, const std::string &path) const;
+
+private:
+    std::vector<JsonNode> m_nodes;
+};
+
+// Creates the AS3 value of node (0 for the whole document) the way JSON.parse would. Main thread only
+FREObject jsonMaterialize(const JsonIndex &index, const uint8_t *data, size_t node = 0);
+
+#endif /* Json_hpp */
@@ -0,0 +1,75 @@
+//
+//  LatencyHistogram.cpp
+//  WebSocketANE
+//
+
+#include "LatencyHistogram.hpp"
+#include <algorithm>
+#include <cmath>
+
+void LatencyHistogram::record(uint64_t micros) {
+    m_buckets[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(micros, std::memory_order_relaxed);
+
+    uint64_t max = m_max.load(std::memory_order_relaxed);
+    while (micros > max && !m_max.compare_exchange_weak(max, micros, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::percentile(double percentile) const {
+    uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+
+    auto target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(total * percentile / 100.0)));
+    uint64_t max = m_max.load(std::memory_order_relaxed);
+    uint64_t seen = 0;
+    for (int i = 0; i < BucketCount; i++) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            return std::min(bucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+std::string LatencyHistogram::toJson() const {
+    uint64_t total = count();
+    uint64_t mean = total == 0 ? 0 : m_sum.load(std::memory_order_relaxed) / total;
+    return "{\"count\":" + std::to_string(total) +
+           ",\"mean\":" + std::to_string(mean) +
+           ",\"p50\":" + std::to_string(percentile(50)) +
+           ",\"p90\":" + std::to_string(percentile(90)) +
+           ",\"p99\":" + std::to_string(percentile(99)) +
+           ",\"p999\":" + std::to_string(percentile(99.9)) +
+           ",\"max\":" + std::to_string(m_max.load(std::memory_order_relaxed)) + "}";
+}
+
+int LatencyHistogram::bucketIndex(uint64_t value) {
+    if (value < LinearLimit) {
+        return static_cast<int>(value);
+    }
+
+    int exponent = 0;
+    for (uint64_t rest = value, shift = 32; shift > 0; shift >>= 1) {
+        if (rest >> shift) {
+            rest >>= shift;
+            exponent += static_cast<int>(shift);
+        }
+    }
+    int subBucket = static_cast<int>(value >> (exponent - SubBucketBits)) & (SubBuckets - 1);
+    return static_cast<int>(LinearLimit) + (exponent - SubBucketBits - 1) * SubBuckets + subBucket;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int index) {
+    if (index < static_cast<int>(LinearLimit)) {
+        return static_cast<uint64_t>(index);
+    }
+
+    int exponent = (index - static_cast<int>(LinearLimit)) / SubBuckets + SubBucketBits + 1;
+    int subBucket = (index - static_cast<int>(LinearLimit)) % SubBuckets;
+    uint64_t lower = (uint64_t{1} << exponent) + (static_cast<uint64_t>(subBucket) << (exponent - SubBucketBits));
+    return lower + (uint64_t{1} << (exponent - SubBucketBits)) - 1;
+}
@@ -0,0 +1,284 @@
+#include "MessageCapture.hpp"
+#include "Trace.hpp"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "log.hpp"
+
+static constexpr char CaptureMagic[8] = {'W', 'S', 'A', 'N', 'E', 'C', 'A', 'P'};
+static constexpr uint32_t CaptureVersion = 1;
+static constexpr size_t DataGrowth = 16 * 1024 * 1024;
+static constexpr size_t IndexGrowth = 1024 * 1024;
+
+static size_t alignRecord(size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+MappedFile::~MappedFile() {
+    close(m_size);
+}
+
+bool MappedFile::open(const std::string &path, bool writable, size_t initialSize) {
+    m_writable = writable;
+    m_fd = ::open(path.c_str(), writable ? O_RDWR | O_CREAT | O_TRUNC : O_RDONLY, 0644);
+    if (m_fd < 0) {
+        return false;
+    }
+
+    if (writable) {
+        return resize(initialSize);
+    }
+
+    struct stat fileStat{};
+    if (fstat(m_fd, &fileStat) != 0 || fileStat.st_size == 0) {
+        close();
+        return false;
+    }
+    m_size = static_cast<size_t>(fileStat.st_size);
+    if (!map()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::resize(size_t size) {
+    unmap();
+
+    if (ftruncate(m_fd, static_cast<off_t>(size)) != 0) {
+        return false;
+    }
+    m_size = size;
+    return map();
+}
+
+void MappedFile::close(size_t finalSize) {
+    unmap();
+    if (m_fd >= 0) {
+        if (m_writable) {
+            ftruncate(m_fd, static_cast<off_t>(finalSize));
+        }
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_size = 0;
+}
+
+bool MappedFile::map() {
+    void *view = mmap(nullptr, m_size, m_writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m_fd, 0);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+    m_view = static_cast<uint8_t *>(view);
+    return true;
+}
+
+void MappedFile::unmap() {
+    if (m_view != nullptr) {
+        munmap(m_view, m_size);
+        m_view = nullptr;
+    }
+}
+
+bool MessageCapture::open(const std::string &path) {
+    std::lock_guard guard(m_lock);
+    if (m_open.load()) {
+        return false;
+    }
+
+    if (!m_data.open(path, true, DataGrowth) || !m_index.open(path + ".idx", true, IndexGrowth)) {
+        writeLog("Could not create capture files");
+        m_data.close();
+        m_index.close();
+        return false;
+    }
+
+    CaptureFileHeader header{};
+    std::memcpy(header.magic, CaptureMagic, sizeof(CaptureMagic));
+    header.version = CaptureVersion;
+    header.headerSize = sizeof(CaptureFileHeader);
+    header.startUnixNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    header.dataEnd = alignRecord(sizeof(CaptureFileHeader));
+    std::memcpy(m_data.data(), &header, sizeof(header));
+
+    m_start = std::chrono::steady_clock::now();
+    m_lastTimestampNs = 0;
+    m_open.store(true, std::memory_order_release);
+    return true;
+}
+
+void MessageCapture::record(CaptureDirection direction, const uint8_t *data, size_t length, bool text) {
+    if (!isOpen()) {
+        return;
+    }
+
+    auto timestampNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - m_start).count());
+
+    std::lock_guard guard(m_lock);
+    if (!m_open.load()) {
+        return;
+    }
+
+    CaptureFileHeader header;
+    std::memcpy(&header, m_data.data(), sizeof(header));
+
+    auto recordSize = alignRecord(sizeof(CaptureRecordHeader) + length);
+    auto offset = static_cast<size_t>(header.dataEnd);
+    if (offset + recordSize > m_data.size() &&
+        !m_data.resize(std::max(m_data.size() * 2, offset + recordSize + DataGrowth))) {
+        writeLog("Capture data file could not grow, stopping capture");
+        m_open.store(false);
+        return;
+    }
+
+    auto indexOffset = static_cast<size_t>(header.recordCount) * sizeof(uint64_t);
+    if (indexOffset + sizeof(uint64_t) > m_index.size() && !m_index.resize(m_index.size() * 2)) {
+        writeLog("Capture index file could not grow, stopping capture");
+        m_open.store(false);
+        return;
+    }
+
+    // Timestamps stay monotonic even when two threads race between reading the clock and taking the lock
+    timestampNs = std::max(timestampNs, m_lastTimestampNs);
+    m_lastTimestampNs = timestampNs;
+
+    CaptureRecordHeader recordHeader{};
+    recordHeader.timestampNs = timestampNs;
+    recordHeader.length = static_cast<uint32_t>(length);
+    recordHeader.direction = static_cast<uint8_t>(direction);
+    recordHeader.flags = text ? CaptureFlagText : 0;
+    std::memcpy(m_data.data() + offset, &recordHeader, sizeof(recordHeader));
+    if (length > 0) {
+        std::memcpy(m_data.data() + offset + sizeof(recordHeader), data, length);
+    }
+
+    uint64_t recordOffset = offset;
+    std::memcpy(m_index.data() + indexOffset, &recordOffset, sizeof(recordOffset));
+
+    header.recordCount++;
+    header.dataEnd = offset + recordSize;
+    std::memcpy(m_data.data(), &header, sizeof(header));
+}
+
+std::string MessageCapture::close() {
+    std::lock_guard guard(m_lock);
+    if (!m_data.isOpen()) {
+        return "{}";
+    }
+
+    m_open.store(false);
+
+    CaptureFileHeader header;
+    std::memcpy(&header, m_data.data(), sizeof(header));
+
+    m_data.close(static_cast<size_t>(header.dataEnd));
+    m_index.close(static_cast<size_t>(header.recordCount) * sizeof(uint64_t));
+
+    return "{\"records\":" + std::to_string(header.recordCount) +
+           ",\"bytes\":" + std::to_string(header.dataEnd) +
+           ",\"durationNs\":" + std::to_string(m_lastTimestampNs) + "}";
+}
+
+MessageReplay::~MessageReplay() {
+    stop();
+}
+
+bool MessageReplay::start(const std::string &path, bool realtime, double speed, Deliver deliver, Complete complete, Paused paused) {
+    stop();
+
+    if (!m_data.open(path, false, 0) || !m_index.open(path + ".idx", false, 0) || m_data.size() < sizeof(CaptureFileHeader)) {
+        writeLog("Could not open capture for replay");
+        m_data.close();
+        m_index.close();
+        return false;
+    }
+
+    CaptureFileHeader header;
+    std::memcpy(&header, m_data.data(), sizeof(header));
+    if (std::memcmp(header.magic, CaptureMagic, sizeof(CaptureMagic)) != 0 || header.version != CaptureVersion) {
+        writeLog("Not a capture file");
+        m_data.close();
+        m_index.close();
+        return false;
+    }
+
+    m_deliver = std::move(deliver);
+    m_complete = std::move(complete);
+    m_paused = std::move(paused);
+    m_stop = false;
+    m_running = true;
+    m_thread = std::thread(&MessageReplay::run, this, realtime, speed > 0 ? speed : 1.0);
+    return true;
+}
+
+void MessageReplay::stop() {
+    m_stop = true;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    m_data.close();
+    m_index.close();
+}
+
+void MessageReplay::run(bool realtime, double speed) {
+    TRACE_THREAD_NAME("replay");
+    CaptureFileHeader header;
+    std::memcpy(&header, m_data.data(), sizeof(header));
+
+    auto recordCount = std::min<uint64_t>(header.recordCount, m_index.size() / sizeof(uint64_t));
+    auto start = std::chrono::steady_clock::now();
+    uint64_t delivered = 0;
+    uint64_t deliveredBytes = 0;
+    uint64_t firstTimestampNs = 0;
+    bool haveFirst = false;
+
+    for (uint64_t i = 0; i < recordCount && !m_stop; i++) {
+        uint64_t offset;
+        std::memcpy(&offset, m_index.data() + i * sizeof(uint64_t), sizeof(offset));
+        if (offset + sizeof(CaptureRecordHeader) > m_data.size()) {
+            break;
+        }
+
+        CaptureRecordHeader record;
+        std::memcpy(&record, m_data.data() + offset, sizeof(record));
+        if (record.direction != static_cast<uint8_t>(CaptureDirection::Inbound) ||
+            offset + sizeof(record) + record.length > m_data.size()) {
+            continue;
+        }
+
+        if (realtime) {
+            if (!haveFirst) {
+                firstTimestampNs = record.timestampNs;
+                haveFirst = true;
+            }
+            auto due = start + std::chrono::nanoseconds(static_cast<int64_t>((record.timestampNs - firstTimestampNs) / speed));
+            while (!m_stop && std::chrono::steady_clock::now() < due) {
+                std::this_thread::sleep_until(std::min(due, std::chrono::steady_clock::now() + std::chrono::milliseconds(50)));
+            }
+        }
+
+        while (!m_stop && m_paused && m_paused()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (m_stop) {
+            break;
+        }
+
+        m_deliver(m_data.data() + offset + sizeof(record), record.length, (record.flags & CaptureFlagText) != 0);
+        delivered++;
+        deliveredBytes += record.length;
+    }
+
+    auto elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    m_running = false;
+    if (m_complete) {
+        m_complete("{\"messages\":" + std::to_string(delivered) +
+                   ",\"bytes\":" + std::to_string(deliveredBytes) +
+                   ",\"elapsedNs\":" + std::to_string(elapsedNs) +
+                   ",\"completed\":" + (m_stop ? "false" : "true") + "}");
+    }
+}
@@ -0,0 +1,127 @@
+//
+//  Trace.cpp
+//  WebSocketANE
+//
+
+#include "Trace.hpp"
+
+#ifdef WEBSOCKET_ANE_TRACING
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "WebSocketNativeLibrary.h"
+
+namespace {
+    std::mutex ringsMutex;
+    std::vector<std::unique_ptr<TraceRing>> rings;
+
+    struct CopiedEvent {
+        const char *name;
+        uint64_t start;
+        uint64_t duration;
+    };
+
+    // The OS thread id, which the engine uses as well, so spans of both land on the same track when the engine
+    // calls into the shim
+    uint64_t currentThreadId() {
+#ifdef _WIN32
+        return GetCurrentThreadId();
+#else
+        uint64_t threadId = 0;
+        pthread_threadid_np(nullptr, &threadId);
+        return threadId;
+#endif
+    }
+
+    void appendEvent(std::string &json, const char *name, uint64_t threadId, uint64_t start, uint64_t duration) {
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer), R"({"name":"%s","cat":"shim","ph":"X","pid":1,"tid":%llu,"ts":%.3f,"dur":%.3f},)",
+                 name, static_cast<unsigned long long>(threadId), start / 1000.0, duration / 1000.0);
+        json += buffer;
+    }
+}
+
+TraceRing *traceThreadRing() {
+    static thread_local TraceRing *ring = nullptr;
+    if (ring == nullptr) {
+        auto created = std::make_unique<TraceRing>();
+        created->threadId = currentThreadId();
+        ring = created.get();
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings.push_back(std::move(created));
+    }
+    return ring;
+}
+
+std::string traceDump() {
+    std::string json = R"({"displayTimeUnit":"ns","traceEvents":[)";
+    std::vector<CopiedEvent> events;
+
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (const auto &ring : rings) {
+            const char *threadName = ring->threadName.load(std::memory_order_relaxed);
+            if (threadName != nullptr) {
+                char buffer[160];
+                snprintf(buffer, sizeof(buffer), R"({"name":"thread_name","ph":"M","pid":1,"tid":%llu,"args":{"name":"%s"}},)",
+                         static_cast<unsigned long long>(ring->threadId), threadName);
+                json += buffer;
+            }
+
+            // Read seqlock-style: the owner keeps writing while we copy, so written is read again after the copy and
+            // every slot the owner may have started to reuse meanwhile is dropped. Once written is n, the owner may
+            // be storing event n over event n - Capacity
+            uint64_t written = ring->written.load(std::memory_order_acquire);
+            uint64_t first = written > TraceRing::Capacity ? written - TraceRing::Capacity : 0;
+            events.clear();
+            for (uint64_t i = first; i < written; i++) {
+                const TraceEvent &event = ring->events[i & (TraceRing::Capacity - 1)];
+                events.push_back(CopiedEvent{event.name.load(std::memory_order_relaxed),
+                                             event.start.load(std::memory_order_relaxed),
+                                             event.duration.load(std::memory_order_relaxed)});
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t rewritten = ring->written.load(std::memory_order_relaxed);
+            uint64_t valid = rewritten + 1 > TraceRing::Capacity ? rewritten + 1 - TraceRing::Capacity : 0;
+            for (uint64_t i = std::max(first, valid); i < written; i++) {
+                const auto &event = events[i - first];
+                appendEvent(json, event.name, ring->threadId, event.start, event.duration);
+            }
+        }
+    }
+
+    // The engine shifts its timestamps onto our clock using the time we pass; it reports the size it needs when the
+    // buffer is short, which may have grown again by the next call
+    std::string engine(64 * 1024, '\0');
+    for (int attempt = 0; attempt < 3; attempt++) {
+        int required = csharpWebSocketLibrary_getTraceEvents(traceNow() / 1000.0, engine.data(), static_cast<int>(engine.size()));
+        if (required <= static_cast<int>(engine.size())) {
+            engine.resize(required > 0 ? required - 1 : 0);
+            json += engine;
+            break;
+        }
+        engine.assign(required + required / 4, '\0');
+    }
+
+    if (json.back() == ',') {
+        json.pop_back();
+    }
+    json += "]}";
+    return json;
+}
+
+#else
+
+std::string traceDump() {
+    return R"({"traceEvents":[]})";
+}
+
+#endif
@@ -0,0 +1,131 @@
+#include "WebSocketMessage.hpp"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <utility>
+
+WebSocketMessage::WebSocketMessage(const uint8_t *data, size_t length) : m_size(length) {
+    if (isInline()) {
+        if (length > 0) {
+            std::memcpy(m_inline, data, length);
+        }
+    } else {
+        m_heap = allocateHeap(length);
+        std::memcpy(m_heap->bytes, data, length);
+    }
+}
+
+WebSocketMessage::WebSocketMessage(const WebSocketMessage &other)
+        : m_size(other.m_size), m_received_at(other.m_received_at), m_enqueued_at(other.m_enqueued_at), m_index(other.m_index) {
+    if (isInline()) {
+        std::memcpy(m_inline, other.m_inline, m_size);
+    } else {
+        m_heap = other.m_heap;
+        m_heap->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+WebSocketMessage::WebSocketMessage(WebSocketMessage &&other) noexcept
+        : m_size(other.m_size), m_received_at(other.m_received_at), m_enqueued_at(other.m_enqueued_at), m_index(std::move(other.m_index)) {
+    if (isInline()) {
+        std::memcpy(m_inline, other.m_inline, m_size);
+    } else {
+        m_heap = other.m_heap;
+    }
+    other.m_size = 0;
+}
+
+WebSocketMessage &WebSocketMessage::operator=(const WebSocketMessage &other) {
+    if (this != &other) {
+        WebSocketMessage copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+WebSocketMessage &WebSocketMessage::operator=(WebSocketMessage &&other) noexcept {
+    if (this != &other) {
+        release();
+        m_size = other.m_size;
+        m_received_at = other.m_received_at;
+        m_enqueued_at = other.m_enqueued_at;
+        m_index = std::move(other.m_index);
+        if (isInline()) {
+            std::memcpy(m_inline, other.m_inline, m_size);
+        } else {
+            m_heap = other.m_heap;
+        }
+        other.m_size = 0;
+    }
+    return *this;
+}
+
+WebSocketMessage::~WebSocketMessage() {
+    release();
+}
+
+void WebSocketMessage::reset() {
+    release();
+    m_size = 0;
+    m_received_at = 0;
+    m_enqueued_at = 0;
+    m_index.reset();
+}
+
+WebSocketMessage::HeapBlock *WebSocketMessage::allocateHeap(size_t length) {
+    void *memory = ::operator new(offsetof(HeapBlock, bytes) + length);
+    auto *block = static_cast<HeapBlock *>(memory);
+    new(&block->refs) std::atomic<uint32_t>(1);
+    return block;
+}
+
+void WebSocketMessage::release() {
+    if (!isInline() && m_heap->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        m_heap->refs.~atomic();
+        ::operator delete(m_heap);
+    }
+}
+
+WebSocketMessageQueue::WebSocketMessageQueue(size_t initialCapacity) {
+    size_t capacity = 1;
+    while (capacity < initialCapacity) {
+        capacity <<= 1;
+    }
+    m_slots.resize(capacity);
+    m_initial_capacity = capacity;
+}
+
+void WebSocketMessageQueue::push_back(WebSocketMessage &&message) {
+    if (m_count == m_slots.size()) {
+        resize(m_slots.size() * 2);
+    }
+    m_slots[(m_head + m_count) & (m_slots.size() - 1)] = std::move(message);
+    m_count++;
+    m_peak = std::max(m_peak, m_count);
+}
+
+void WebSocketMessageQueue::pop_front() {
+    m_slots[m_head].reset();
+    m_head = (m_head + 1) & (m_slots.size() - 1);
+    m_count--;
+
+    if (m_count == 0) {
+        size_t capacity = m_initial_capacity;
+        while (capacity < m_peak * 2) {
+            capacity <<= 1;
+        }
+        if (capacity < m_slots.size()) {
+            resize(capacity);
+        }
+        m_peak = 0;
+    }
+}
+
+void WebSocketMessageQueue::resize(size_t capacity) {
+    std::vector<WebSocketMessage> slots(capacity);
+    for (size_t i = 0; i < m_count; i++) {
+        slots[i] = std::move((*this)[i]);
+    }
+    m_slots.swap(slots);
+    m_head = 0;
+}
@@ -0,0 +1,128 @@
+//
+//  WebSocketMessage.hpp
+//  WebSocketANE
+//
+
+#ifndef WebSocketMessage_hpp
+#define WebSocketMessage_hpp
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Monotonic nanoseconds on the steady clock, the clock of the receive and enqueue timestamps
+inline uint64_t monotonicNanos() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Decoded form of a payload built on the network thread (see Amf3.hpp), so the main thread does not have to parse
+class MessageIndex {
+public:
+    virtual ~MessageIndex() = default;
+};
+
+// Received message payload. Payloads up to InlineCapacity bytes live inside the object, so the common small
+// message costs no allocation; larger ones share one ref-counted heap block between copies.
+class WebSocketMessage {
+public:
+    static constexpr size_t InlineCapacity = 256;
+
+    WebSocketMessage() = default;
+
+    WebSocketMessage(const uint8_t* data, size_t length);
+
+    WebSocketMessage(const WebSocketMessage& other);
+
+    WebSocketMessage(WebSocketMessage &&other) noexcept;
+
+    WebSocketMessage& operator=(const WebSocketMessage& other);
+
+    WebSocketMessage& operator=(WebSocketMessage &&other) noexcept;
+
+    ~WebSocketMessage();
+
+    const uint8_t* data() const { return isInline() ? m_inline : m_heap->bytes; }
+
+    uint8_t* data() { return isInline() ? m_inline : m_heap->bytes; }
+
+    size_t size() const { return m_size; }
+
+    bool empty() const { return m_size == 0; }
+
+    bool isInline() const { return m_size <= InlineCapacity; }
+
+    // Shared between copies, like the heap block
+    const std::shared_ptr<const MessageIndex>& index() const { return m_index; }
+
+    void setIndex(std::shared_ptr<const MessageIndex> index) { m_index = std::move(index); }
+
+    // When the engine read the message off the socket, and when it entered the receive queue (monotonicNanos)
+    uint64_t receivedAt() const { return m_received_at; }
+
+    uint64_t enqueuedAt() const { return m_enqueued_at; }
+
+    void setTimestamps(uint64_t receivedAt, uint64_t enqueuedAt) {
+        m_received_at = receivedAt;
+        m_enqueued_at = enqueuedAt;
+    }
+
+    void reset();
+
+private:
+    struct HeapBlock {
+        std::atomic<uint32_t> refs;
+        uint8_t bytes[1];
+    };
+
+    static HeapBlock* allocateHeap(size_t length);
+
+    void release();
+
+    size_t m_size = 0;
+    uint64_t m_received_at = 0;
+    uint64_t m_enqueued_at = 0;
+    std::shared_ptr<const MessageIndex> m_index;
+    union {
+        uint8_t m_inline[InlineCapacity];
+        HeapBlock* m_heap;
+    };
+};
+
+// FIFO of messages stored in one contiguous ring of slots, so draining walks sequential memory and steady-state
+// traffic never allocates queue nodes. The ring doubles when full; each time it empties it is cut to twice the largest
+// backlog since it last did, never below the initial capacity, so a one-off burst does not keep its footprint (a slot
+// is about 300 bytes) while bursts that keep coming keep their ring.
+class WebSocketMessageQueue {
+public:
+    explicit WebSocketMessageQueue(size_t initialCapacity = 64);
+
+    void push_back(WebSocketMessage &&message);
+
+    WebSocketMessage& front() { return m_slots[m_head]; }
+
+    WebSocketMessage& operator[](size_t index) { return m_slots[(m_head + index) & (m_slots.size() - 1)]; }
+
+    void pop_front();
+
+    size_t size() const { return m_count; }
+
+    bool empty() const { return m_count == 0; }
+
+    // Slots in the ring, at least size()
+    size_t capacity() const { return m_slots.size(); }
+
+private:
+    void resize(size_t capacity);
+
+    std::vector<WebSocketMessage> m_slots;
+    size_t m_initial_capacity;
+    size_t m_peak = 0; // Largest size() since the queue was last empty
+    size_t m_head = 0;
+    size_t m_count = 0;
+};
+
+#endif /* WebSocketMessage_hpp */
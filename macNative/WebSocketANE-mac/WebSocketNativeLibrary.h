@@ -7,14 +7,51 @@
 
 #ifndef WebSocketNativeLibrary_h
 #define WebSocketNativeLibrary_h
+#include <cstdint>
+
+// Per-connection tuning for csharpWebSocketLibrary_connectWithOptions, laid out like ConnectOptions in the engine.
+// Zero selects the engine default for every field except tcpNoDelay (1 on, 0 off) and keepAliveIntervalMs, where -1
+// keeps the current interval (0 turns keepalive off)
+struct WebSocketConnectOptions {
+    int32_t connectTimeoutMs;
+    int32_t attemptDelayMs;
+    int32_t dnsTimeoutMs;
+    int32_t tcpNoDelay;
+    int32_t sendBufferSize;
+    int32_t receiveBufferSize;
+    int32_t initialReceiveBufferSize;
+    int32_t keepAliveIntervalMs;
+    int32_t maxMessageSize;
+};
+
 extern "C" {
-    __cdecl int csharpWebSocketLibrary_initializerCallbacks(const void* callBackConnect, const void *callBackData, const void *callBackDisconnect, const void *callBackLog);
+    __cdecl int csharpWebSocketLibrary_initializerCallbacks(const void* callBackConnect, const void *callBackData, const void *callBackDisconnect, const void *callBackLog, const void *callBackStatus);
     __cdecl char* csharpWebSocketLibrary_createWebSocketClient(const void* ctx);
+    __cdecl int csharpWebSocketLibrary_destroyWebSocketClient(const void* guidPointer);
     __cdecl int csharpWebSocketLibrary_connect(const void* guidPointer, const char* url);
-    __cdecl void csharpWebSocketLibrary_sendMessage(const void* guidPointer, const void* data, int length);
+    __cdecl int csharpWebSocketLibrary_connectShared(const void* guidPointer, const char* url);
+    __cdecl int csharpWebSocketLibrary_connectWithOptions(const void* guidPointer, const char* url, const WebSocketConnectOptions* options);
+    __cdecl int csharpWebSocketLibrary_sendMessage(const void* guidPointer, const void* data, int length, int lane);
+    __cdecl int csharpWebSocketLibrary_sendMessages(const void* guidPointer, const void* data, int length, int lane);
     __cdecl void csharpWebSocketLibrary_disconnect(const void* guidPointer, int closeCode);
+    __cdecl int64_t csharpWebSocketLibrary_getBufferedAmount(const void* guidPointer);
+    __cdecl int csharpWebSocketLibrary_setSendWatermarks(const void* guidPointer, int64_t lowWatermark, int64_t highWatermark);
+    __cdecl int csharpWebSocketLibrary_setReceivePaused(const void* guidPointer, int paused);
+    __cdecl int csharpWebSocketLibrary_setFragmentSize(const void* guidPointer, int fragmentSize);
+    __cdecl int csharpWebSocketLibrary_getSendLaneStats(const void* guidPointer, char* buffer, int bufferLength);
+    __cdecl int csharpWebSocketLibrary_setKeepAlive(const void* guidPointer, int intervalMs, int timeoutMs, int statusIntervalMs);
+    __cdecl int csharpWebSocketLibrary_getRttStats(const void* guidPointer, char* buffer, int bufferLength);
+    __cdecl int csharpWebSocketLibrary_setBusyPoll(const void* guidPointer, int spinMicros, int core);
+    __cdecl int csharpWebSocketLibrary_getIoStats(const void* guidPointer, char* buffer, int bufferLength);
     __cdecl void csharpWebSocketLibrary_addStaticHost(const char* host, const char* ip);
     __cdecl void csharpWebSocketLibrary_removeStaticHost(const char* host);
+    __cdecl void csharpWebSocketLibrary_addHostHint(const char* host);
+    __cdecl int csharpWebSocketLibrary_warmUp();
+    __cdecl int csharpWebSocketLibrary_getStartupTimings(char* buffer, int bufferLength);
+    __cdecl int csharpWebSocketLibrary_getTraceEvents(double nowMicros, char* buffer, int bufferLength);
+    __cdecl int csharpWebSocketLibrary_getMemoryStats(char* buffer, int bufferLength);
+    __cdecl int csharpWebSocketLibrary_setNetworkImpairment(const char* config);
+    __cdecl int csharpWebSocketLibrary_getNetworkImpairmentStats(char* buffer, int bufferLength);
 }
 
 #endif /* WebSocketNativeLibrary_h */
@@ -1,15 +1,32 @@
 #include "WebSocketClient.hpp"
 #include "WebSocketNativeLibrary.h"
+#include "Amf3.hpp"
+#include "Json.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
 #include <cstdio>
+#include <cstring>
 #include "log.hpp"
 
 static bool alreadyInitialized = false;
-static FRENamedFunction* exportedFunctions = new FRENamedFunction[7];
-static std::unordered_map<FREContext, WebSocketClient*> wsClientMap;
+static std::once_flag engineInitialized;
+static std::once_flag warmUpStarted;
+// Startup phase durations in milliseconds, see getStartupTimings
+static std::mutex startupTimingsMutex;
+static std::vector<std::pair<const char *, double>> startupTimings;
+static FRENamedFunction* exportedFunctions = new FRENamedFunction[43];
+// The map owns the clients; whoever looks one up shares ownership until done with it, so a client outlives the
+// context finalizer while a callback still uses it
+static std::unordered_map<FREContext, std::shared_ptr<WebSocketClient>> wsClientMap;
 static std::mutex wsClientMapMutex;
 
 // Helper function to safely retrieve WebSocketClient from the map
-static WebSocketClient* getWebSocketClient(FREContext ctx) {
+static std::shared_ptr<WebSocketClient> getWebSocketClient(FREContext ctx) {
     std::lock_guard<std::mutex> guard(wsClientMapMutex);
     auto it = wsClientMap.find(ctx);
     if (it != wsClientMap.end()) {
@@ -19,43 +36,86 @@ static WebSocketClient* getWebSocketClient(FREContext ctx) {
 }
 
 // Helper function to safely insert WebSocketClient into the map
-static void setWebSocketClient(FREContext ctx, WebSocketClient* wsClient) {
+static void setWebSocketClient(FREContext ctx, std::shared_ptr<WebSocketClient> wsClient) {
     std::lock_guard<std::mutex> guard(wsClientMapMutex);
-    wsClientMap[ctx] = wsClient;
+    wsClientMap[ctx] = std::move(wsClient);
 }
 
-// Helper function to safely remove WebSocketClient from the map
-static void removeWebSocketClient(FREContext ctx) {
+// Helper function to safely remove WebSocketClient from the map, handing its reference to the caller
+static std::shared_ptr<WebSocketClient> removeWebSocketClient(FREContext ctx) {
     std::lock_guard<std::mutex> guard(wsClientMapMutex);
-    wsClientMap.erase(ctx);
+    auto it = wsClientMap.find(ctx);
+    if (it == wsClientMap.end()) {
+        return nullptr;
+    }
+    auto wsClient = std::move(it->second);
+    wsClientMap.erase(it);
+    return wsClient;
 }
 
+// Engine callbacks run on engine threads and may race the context finalizer. The scope holds the context's client
+// and counts as in flight, which the finalizer waits out before the context goes away; a callback whose scope has no
+// client returns without touching the context
+class CallbackScope {
+public:
+    explicit CallbackScope(FREContext ctx) : m_client(getWebSocketClient(ctx)) {
+        if (m_client != nullptr && !m_client->enterCallback()) {
+            m_client.reset();
+        }
+    }
+    ~CallbackScope() {
+        if (m_client != nullptr) {
+            m_client->leaveCallback();
+        }
+    }
+    CallbackScope(const CallbackScope&) = delete;
+    CallbackScope& operator=(const CallbackScope&) = delete;
+    WebSocketClient* client() const { return m_client.get(); }
+private:
+    std::shared_ptr<WebSocketClient> m_client;
+};
+
 __cdecl static void connectCallback(void* ctx) {
     writeLog("connectCallback called");
+
+    CallbackScope scope(ctx);
+    if(scope.client() == nullptr){
+        writeLog("wsClient not found");
+        return;
+    }
+
     FREDispatchStatusEventAsync(ctx, reinterpret_cast<const uint8_t *>("connected"), reinterpret_cast<const uint8_t *>(""));
 }
 
-__cdecl static void dataCallback(void* ctx, const uint8_t *data, int length) {
+// receivedAgeNanos is how long ago the engine read the message off the socket, measured on its own clock
+__cdecl static void dataCallback(void* ctx, const uint8_t *data, int length, int messageType, int64_t receivedAgeNanos) {
+    TRACE_SCOPE("dataCallback");
+    uint64_t receivedAt = monotonicNanos() - static_cast<uint64_t>(std::max<int64_t>(receivedAgeNanos, 0));
     writeLog("dataCallback called");
     
-    WebSocketClient* wsClient = getWebSocketClient(ctx);
+    CallbackScope scope(ctx);
+    WebSocketClient* wsClient = scope.client();
     
     if(wsClient == nullptr){
         writeLog("wsClient not found");
         return;
     }
     
-    auto dataCopyVector = std::vector<uint8_t>();
-    dataCopyVector.resize(length);
-    std::copy_n(data, length, dataCopyVector.begin());
-    wsClient->enqueueMessage(dataCopyVector);
+    // messageType is 1 for text messages, 0 for binary
+    bool text = messageType == 1;
 
-    FREDispatchStatusEventAsync(ctx, reinterpret_cast<const uint8_t *>("nextMessage"), data);
+    wsClient->receiveMessage(data, static_cast<size_t>(length), text, receivedAt);
 }
 
 __cdecl static void ioErrorCallback(void* ctx, int closeCode, const char *reason) {
     writeLog("disconnectCallback called");
 
+    CallbackScope scope(ctx);
+    if(scope.client() == nullptr){
+        writeLog("wsClient not found");
+        return;
+    }
+
     auto closeCodeReason = std::to_string(closeCode) + ";" + std::string(reason);
 
     writeLog(closeCodeReason.c_str());
@@ -67,6 +127,54 @@ static void writeLogCallback(const char *message) {
     writeLog(message);
 }
 
+__cdecl static void statusCallback(void* ctx, const char *code, const char *level) {
+    writeLog("statusCallback called");
+
+    CallbackScope scope(ctx);
+    if(scope.client() == nullptr){
+        writeLog("wsClient not found");
+        return;
+    }
+
+    FREDispatchStatusEventAsync(ctx, reinterpret_cast<const uint8_t *>(code), reinterpret_cast<const uint8_t *>(level));
+}
+
+// Reads an AS3 WebSocketConnectOptions; properties that are missing or null keep their engine default
+static bool readConnectOptions(FREObject object, WebSocketConnectOptions &options) {
+    FREObjectType type;
+    if (object == nullptr || FREGetObjectType(object, &type) != FRE_OK || type != FRE_TYPE_OBJECT) return false;
+
+    options = {};
+    options.tcpNoDelay = 1;
+    options.keepAliveIntervalMs = -1;
+
+    const std::pair<const char *, int32_t *> fields[] = {
+        {"connectTimeoutMs", &options.connectTimeoutMs},
+        {"attemptDelayMs", &options.attemptDelayMs},
+        {"dnsTimeoutMs", &options.dnsTimeoutMs},
+        {"sendBufferSize", &options.sendBufferSize},
+        {"receiveBufferSize", &options.receiveBufferSize},
+        {"initialReceiveBufferSize", &options.initialReceiveBufferSize},
+        {"keepAliveIntervalMs", &options.keepAliveIntervalMs},
+        {"maxMessageSize", &options.maxMessageSize},
+    };
+    for (const auto &[name, field] : fields) {
+        FREObject value = nullptr;
+        if (FREGetObjectProperty(object, reinterpret_cast<const uint8_t *>(name), &value, nullptr) == FRE_OK && value != nullptr) {
+            FREGetObjectAsInt32(value, field);
+        }
+    }
+
+    FREObject noDelay = nullptr;
+    uint32_t noDelayValue;
+    if (FREGetObjectProperty(object, reinterpret_cast<const uint8_t *>("tcpNoDelay"), &noDelay, nullptr) == FRE_OK && noDelay != nullptr &&
+        FREGetObjectAsBool(noDelay, &noDelayValue) == FRE_OK) {
+        options.tcpNoDelay = noDelayValue ? 1 : 0;
+    }
+
+    return true;
+}
+
 // Exported functions:
 static FREObject connectWebSocket(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
     writeLog("connectWebSocket called");
@@ -81,15 +189,19 @@ static FREObject connectWebSocket(FREContext ctx, void *funcData, uint32_t argc,
     writeLog("Calling connect to uri: ");
     writeLog(uriChar);
 
-    WebSocketClient* wsClient = getWebSocketClient(ctx);
+    auto wsClient = getWebSocketClient(ctx);
     
     if(wsClient == nullptr){
         writeLog("wsClient not found");
         return nullptr;
     }
 
-    if (wsClient != nullptr) {
-        wsClient->connect(reinterpret_cast<const char *>(uri));
+    // argv[1] is the protocol list, argv[2] the optional WebSocketConnectOptions
+    WebSocketConnectOptions options;
+    if (argc > 2 && readConnectOptions(argv[2], options)) {
+        wsClient->connect(uriChar, &options);
+    } else {
+        wsClient->connect(uriChar);
     }
 
     return nullptr;
@@ -128,22 +240,31 @@ static FREObject sendMessageWebSocket(FREContext ctx, void *funcData, uint32_t a
     FREObjectType objectType;
     FREGetObjectType(argv[1], &objectType);
 
+    // Optional send lane: 0 = control/input, 1 = normal (default), 2 = bulk
+    uint32_t lane = 1;
+    if (argc > 2) {
+        FREGetObjectAsUint32(argv[2], &lane);
+    }
+
+    bool accepted = false;
     if (objectType == FRE_TYPE_STRING) {
         //TODO: Implement string message
     } else if (objectType == FRE_TYPE_BYTEARRAY) {
         FREByteArray byteArray;
         FREAcquireByteArray(argv[1], &byteArray);
 
-        wsClient->sendMessage(byteArray.bytes, static_cast<int>(byteArray.length));
+        accepted = wsClient->sendMessage(byteArray.bytes, static_cast<int>(byteArray.length), static_cast<int>(lane));
 
         FREReleaseByteArray(argv[1]);
     }
 
-
-    return nullptr;
+    FREObject result = nullptr;
+    FRENewObjectFromBool(accepted, &result);
+    return result;
 }
 
 static FREObject getByteArrayMessage(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    TRACE_SCOPE("getByteArrayMessage");
     writeLog("getByteArrayMessage called");
 
     WebSocketClient* wsClient = nullptr;
@@ -156,23 +277,775 @@ static FREObject getByteArrayMessage(FREContext ctx, void *funcData, uint32_t ar
         return nullptr;
     }
 
-    auto vectorData = nextMessageResult.value();
+    auto &message = nextMessageResult.value();
 
-    if (vectorData.empty()) {
+    if (message.empty()) {
         writeLog("message it's empty");
         return nullptr;
     }
     
     FREObject byteArrayObject = nullptr;
     FREByteArray byteArray;
-    byteArray.length = vectorData.size();
-    byteArray.bytes = vectorData.data();
+    byteArray.length = static_cast<uint32_t>(message.size());
+    byteArray.bytes = message.data();
 
     FRENewByteArray(&byteArray, &byteArrayObject);
 
     return byteArrayObject;
 }
 
+static FREObject setReceiveWatermarks(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    writeLog("setReceiveWatermarks called");
+    if (argc < 4) return nullptr;
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    uint32_t lowBytes, highBytes, lowMessages, highMessages;
+    FREGetObjectAsUint32(argv[0], &lowBytes);
+    FREGetObjectAsUint32(argv[1], &highBytes);
+    FREGetObjectAsUint32(argv[2], &lowMessages);
+    FREGetObjectAsUint32(argv[3], &highMessages);
+
+    wsClient->setReceiveWatermarks(lowBytes, highBytes, lowMessages, highMessages);
+    return nullptr;
+}
+
+static FREObject setSendWatermarks(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    writeLog("setSendWatermarks called");
+    if (argc < 2) return nullptr;
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    double lowBytes, highBytes;
+    FREGetObjectAsDouble(argv[0], &lowBytes);
+    FREGetObjectAsDouble(argv[1], &highBytes);
+
+    wsClient->setSendWatermarks(static_cast<int64_t>(lowBytes), static_cast<int64_t>(highBytes));
+    return nullptr;
+}
+
+static FREObject getBufferedAmount(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    FREObject result = nullptr;
+    FRENewObjectFromDouble(static_cast<double>(wsClient->getBufferedAmount()), &result);
+    return result;
+}
+
+static FREObject setFragmentSize(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    writeLog("setFragmentSize called");
+    if (argc < 1) return nullptr;
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    uint32_t fragmentSize;
+    FREGetObjectAsUint32(argv[0], &fragmentSize);
+
+    wsClient->setFragmentSize(static_cast<int>(fragmentSize));
+    return nullptr;
+}
+
+static FREObject getSendLaneStats(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    auto stats = wsClient->getSendLaneStats();
+
+    FREObject result = nullptr;
+    FRENewObjectFromUTF8(static_cast<uint32_t>(stats.size()), reinterpret_cast<const uint8_t *>(stats.c_str()), &result);
+    return result;
+}
+
+static FREObject setKeepAlive(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    writeLog("setKeepAlive called");
+    if (argc < 3) return nullptr;
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    uint32_t intervalMs;
+    uint32_t timeoutMs;
+    uint32_t statusIntervalMs;
+    FREGetObjectAsUint32(argv[0], &intervalMs);
+    FREGetObjectAsUint32(argv[1], &timeoutMs);
+    FREGetObjectAsUint32(argv[2], &statusIntervalMs);
+
+    wsClient->setKeepAlive(static_cast<int>(intervalMs), static_cast<int>(timeoutMs), static_cast<int>(statusIntervalMs));
+    return nullptr;
+}
+
+static FREObject getRttStats(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    auto stats = wsClient->getRttStats();
+
+    FREObject result = nullptr;
+    FRENewObjectFromUTF8(static_cast<uint32_t>(stats.size()), reinterpret_cast<const uint8_t *>(stats.c_str()), &result);
+    return result;
+}
+
+// Writes queued messages into a caller-owned ByteArray, growing it only when it is too short, and returns the
+// number of bytes written. Without maxMessages one message is written as-is; with it, up to maxMessages messages
+// are written back to back, each preceded by its length as a big-endian uint32.
+static FREObject readMessageInto(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    TRACE_SCOPE("readMessageInto");
+    if (argc < 1) return nullptr;
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    uint32_t maxMessages = 1;
+    bool prefixed = argc >= 2;
+    if (prefixed) {
+        FREGetObjectAsUint32(argv[1], &maxMessages);
+    }
+
+    // A conflated update can replace a queued message with a larger one between the peek and the read, so the read
+    // stops at what fits and, when not even the first message did, the ByteArray is grown again
+    size_t written = 0;
+    while (true) {
+        size_t count = 0;
+        size_t required = wsClient->peekMessagesSize(maxMessages, prefixed, count);
+        if (count == 0) {
+            break;
+        }
+
+        FREByteArray byteArray;
+        if (FREAcquireByteArray(argv[0], &byteArray) != FRE_OK) {
+            writeLog("readMessageInto: could not acquire ByteArray");
+            return nullptr;
+        }
+
+        if (byteArray.length < required) {
+            // Setting length is not allowed while the ByteArray is acquired
+            FREReleaseByteArray(argv[0]);
+
+            FREObject length = nullptr;
+            FRENewObjectFromUint32(static_cast<uint32_t>(required), &length);
+            if (FRESetObjectProperty(argv[0], reinterpret_cast<const uint8_t *>("length"), length, nullptr) != FRE_OK ||
+                FREAcquireByteArray(argv[0], &byteArray) != FRE_OK) {
+                writeLog("readMessageInto: could not grow ByteArray");
+                return nullptr;
+            }
+        }
+
+        size_t read = 0;
+        written = wsClient->readMessagesInto(count, prefixed, byteArray.bytes, byteArray.length, read);
+        FREReleaseByteArray(argv[0]);
+        if (read > 0) {
+            break;
+        }
+    }
+
+    FREObject result = nullptr;
+    FRENewObjectFromUint32(static_cast<uint32_t>(written), &result);
+    return result;
+}
+
+// Sends every [uint32 big-endian length][payload] record of one ByteArray as its own message with a single engine
+// call; returns how many messages were queued (0 when rejected by the send high watermark or malformed)
+static FREObject sendMessages(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    if (argc < 1) return nullptr;
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    uint32_t lane = 1;
+    if (argc > 1) {
+        FREGetObjectAsUint32(argv[1], &lane);
+    }
+
+    FREByteArray byteArray;
+    if (FREAcquireByteArray(argv[0], &byteArray) != FRE_OK) {
+        writeLog("sendMessages: could not acquire ByteArray");
+        return nullptr;
+    }
+
+    int queued = wsClient->sendMessages(byteArray.bytes, static_cast<int>(byteArray.length), static_cast<int>(lane));
+
+    FREReleaseByteArray(argv[0]);
+
+    FREObject result = nullptr;
+    FRENewObjectFromUint32(static_cast<uint32_t>(queued), &result);
+    return result;
+}
+
+static FREObject startCapture(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    writeLog("startCapture called");
+    if (argc < 1) return nullptr;
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    uint32_t pathLength;
+    const uint8_t *path;
+    FREGetObjectAsUTF8(argv[0], &pathLength, &path);
+
+    FREObject result = nullptr;
+    FRENewObjectFromBool(wsClient->startCapture(std::string(reinterpret_cast<const char *>(path), pathLength)), &result);
+    return result;
+}
+
+static FREObject stopCapture(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    writeLog("stopCapture called");
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    auto stats = wsClient->stopCapture();
+
+    FREObject result = nullptr;
+    FRENewObjectFromUTF8(static_cast<uint32_t>(stats.size()), reinterpret_cast<const uint8_t *>(stats.c_str()), &result);
+    return result;
+}
+
+static FREObject startReplay(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    writeLog("startReplay called");
+    if (argc < 3) return nullptr;
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    uint32_t pathLength;
+    const uint8_t *path;
+    FREGetObjectAsUTF8(argv[0], &pathLength, &path);
+
+    uint32_t realtime;
+    double speed;
+    FREGetObjectAsBool(argv[1], &realtime);
+    FREGetObjectAsDouble(argv[2], &speed);
+
+    FREObject result = nullptr;
+    FRENewObjectFromBool(wsClient->startReplay(std::string(reinterpret_cast<const char *>(path), pathLength), realtime != 0, speed), &result);
+    return result;
+}
+
+static FREObject stopReplay(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    writeLog("stopReplay called");
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    wsClient->stopReplay();
+    return nullptr;
+}
+
+static FREObject setConflationKey(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    writeLog("setConflationKey called");
+    if (argc < 3) return nullptr;
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    uint32_t offset, length;
+    int32_t delimiter;
+    FREGetObjectAsUint32(argv[0], &offset);
+    FREGetObjectAsUint32(argv[1], &length);
+    FREGetObjectAsInt32(argv[2], &delimiter);
+
+    wsClient->setConflationKey(offset, length, delimiter);
+    return nullptr;
+}
+
+static FREObject getConflationStats(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    auto stats = wsClient->getConflationStats();
+
+    FREObject result = nullptr;
+    FRENewObjectFromUTF8(static_cast<uint32_t>(stats.size()), reinterpret_cast<const uint8_t *>(stats.c_str()), &result);
+    return result;
+}
+
+static FREObject setAmf3Decoding(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    writeLog("setAmf3Decoding called");
+    if (argc < 1) return nullptr;
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    uint32_t enabled;
+    FREGetObjectAsBool(argv[0], &enabled);
+
+    wsClient->setAmf3Decoding(enabled != 0);
+    return nullptr;
+}
+
+// Returns the next message materialized from its AMF3 index. Messages that were not indexed are copied into the
+// ByteArray argument instead and that same ByteArray is returned, for AS3 to read with readObject. The message is
+// consumed only once handed over, so one that cannot be copied stays queued for the next call
+static FREObject getAmf3Message(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    TRACE_SCOPE("getAmf3Message");
+    FREObjectType scratchType;
+    if (argc < 1 || argv[0] == nullptr || FREGetObjectType(argv[0], &scratchType) != FRE_OK || scratchType != FRE_TYPE_BYTEARRAY) {
+        writeLog("getAmf3Message: argument is not a ByteArray");
+        return nullptr;
+    }
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    // A conflated update replacing the message while it is copied out is picked up by going around again
+    while (true) {
+        uint64_t version = 0;
+        auto nextMessageResult = wsClient->peekNextMessage(version);
+
+        if (!nextMessageResult.has_value()) {
+            writeLog("no messages found");
+            return nullptr;
+        }
+
+        auto &message = nextMessageResult.value();
+
+        FREObject result = argv[0];
+        if (auto index = std::dynamic_pointer_cast<const Amf3Index>(message.index())) {
+            result = amf3Materialize(*index, message.data());
+        } else {
+            FREObject length = nullptr;
+            FRENewObjectFromUint32(static_cast<uint32_t>(message.size()), &length);
+            FREByteArray byteArray;
+            if (FRESetObjectProperty(argv[0], reinterpret_cast<const uint8_t *>("length"), length, nullptr) != FRE_OK ||
+                FREAcquireByteArray(argv[0], &byteArray) != FRE_OK) {
+                writeLog("getAmf3Message: could not resize ByteArray");
+                return nullptr;
+            }
+            if (!message.empty()) {
+                std::memcpy(byteArray.bytes, message.data(), message.size());
+            }
+            FREReleaseByteArray(argv[0]);
+        }
+
+        if (wsClient->popNextMessage(version)) {
+            return result;
+        }
+    }
+}
+
+// Encodes argv[0] natively and sends it as one binary message. argv[2] provides amf3Keys (see Amf3.hpp).
+// Returns 1 when sent, 0 when rejected by the send high watermark and -1 when AS3 has to encode the value
+static FREObject sendAmf3(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    if (argc < 3) return nullptr;
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    uint32_t lane;
+    FREGetObjectAsUint32(argv[1], &lane);
+
+    int32_t status = -1;
+    std::vector<uint8_t> payload;
+    if (amf3Encode(argv[0], argv[2], payload)) {
+        status = wsClient->sendMessage(payload.data(), static_cast<int>(payload.size()), static_cast<int>(lane)) ? 1 : 0;
+    }
+
+    FREObject result = nullptr;
+    FRENewObjectFromInt32(status, &result);
+    return result;
+}
+
+static FREObject setJsonDecoding(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    writeLog("setJsonDecoding called");
+    if (argc < 1) return nullptr;
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    uint32_t enabled;
+    FREGetObjectAsBool(argv[0], &enabled);
+
+    wsClient->setJsonDecoding(enabled != 0);
+    return nullptr;
+}
+
+// Returns the next message built from its JSON index: the whole value or, when an Array of paths is passed, an
+// Array with the value at each path (null when absent). Messages that were not indexed come back as a ByteArray
+static FREObject getJsonMessage(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    TRACE_SCOPE("getJsonMessage");
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    auto nextMessageResult = wsClient->getNextMessage();
+
+    if (!nextMessageResult.has_value()) {
+        writeLog("no messages found");
+        return nullptr;
+    }
+
+    auto &message = nextMessageResult.value();
+
+    auto index = std::dynamic_pointer_cast<const JsonIndex>(message.index());
+    if (!index) {
+        FREObject byteArrayObject = nullptr;
+        FREByteArray byteArray;
+        byteArray.length = static_cast<uint32_t>(message.size());
+        byteArray.bytes = message.data();
+        FRENewByteArray(&byteArray, &byteArrayObject);
+        return byteArrayObject;
+    }
+
+    FREObjectType pathsType = FRE_TYPE_NULL;
+    if (argc < 1 || argv[0] == nullptr || FREGetObjectType(argv[0], &pathsType) != FRE_OK || pathsType != FRE_TYPE_ARRAY) {
+        return jsonMaterialize(*index, message.data());
+    }
+
+    uint32_t pathCount = 0;
+    FREGetArrayLength(argv[0], &pathCount);
+
+    FREObject fields = nullptr;
+    FRENewObject(reinterpret_cast<const uint8_t *>("Array"), 0, nullptr, &fields, nullptr);
+    FRESetArrayLength(fields, pathCount);
+    for (uint32_t i = 0; i < pathCount; i++) {
+        FREObject pathObject = nullptr;
+        uint32_t pathLength;
+        const uint8_t *path;
+        if (FREGetArrayElementAt(argv[0], i, &pathObject) != FRE_OK || FREGetObjectAsUTF8(pathObject, &pathLength, &path) != FRE_OK) {
+            continue;
+        }
+        auto node = index->find(message.data(), std::string(reinterpret_cast<const char *>(path), pathLength));
+        if (node >= 0) {
+            FRESetArrayElementAt(fields, i, jsonMaterialize(*index, message.data(), static_cast<size_t>(node)));
+        }
+    }
+    return fields;
+}
+
+// Chrome trace-event JSON of the recorded spans of the shim and the engine; empty unless built with
+// WEBSOCKET_ANE_TRACING
+static FREObject getTraceEvents(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    auto trace = traceDump();
+
+    FREObject result = nullptr;
+    FRENewObjectFromUTF8(static_cast<uint32_t>(trace.size()), reinterpret_cast<const uint8_t *>(trace.c_str()), &result);
+    return result;
+}
+
+static FREObject addHostHint(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    writeLog("addHostHint called");
+    if (argc < 1) return nullptr;
+
+    uint32_t hostLength;
+    const uint8_t *host;
+    FREGetObjectAsUTF8(argv[0], &hostLength, &host);
+
+    csharpWebSocketLibrary_addHostHint(reinterpret_cast<const char *>(host));
+    return nullptr;
+}
+
+// {"shim":{phase:ms,...},"engine":{phase:ms,...}}; phases that did not run yet are absent
+static FREObject getStartupTimings(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    std::string timings = R"({"shim":{)";
+    {
+        std::lock_guard<std::mutex> guard(startupTimingsMutex);
+        for (size_t i = 0; i < startupTimings.size(); i++) {
+            char buffer[96];
+            snprintf(buffer, sizeof(buffer), R"(%s"%s":%.3f)", i > 0 ? "," : "", startupTimings[i].first, startupTimings[i].second);
+            timings += buffer;
+        }
+    }
+    auto engine = WebSocketClient::getEngineStartupTimings();
+    timings += R"(},"engine":)";
+    timings += engine.empty() ? "{}" : engine;
+    timings += "}";
+
+    FREObject result = nullptr;
+    FRENewObjectFromUTF8(static_cast<uint32_t>(timings.size()), reinterpret_cast<const uint8_t *>(timings.c_str()), &result);
+    return result;
+}
+
+static FREObject connectShared(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    writeLog("connectShared called");
+    if (argc < 1) return nullptr;
+
+    uint32_t uriLength;
+    const uint8_t *uri;
+    FREGetObjectAsUTF8(argv[0], &uriLength, &uri);
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    wsClient->connectShared(reinterpret_cast<const char *>(uri));
+    return nullptr;
+}
+
+// {"shim":{"contexts":n,"liveClients":n,"receiveQueueMessages":n,"receiveQueueBytes":n},"engine":{...}}, the engine
+// part being its memory ledger. liveClients above contexts means finalized clients still held by a callback
+static FREObject getMemoryStats(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    std::vector<std::shared_ptr<WebSocketClient>> clients;
+    {
+        std::lock_guard<std::mutex> guard(wsClientMapMutex);
+        for (const auto &entry : wsClientMap) {
+            clients.push_back(entry.second);
+        }
+    }
+
+    size_t queuedMessages = 0;
+    size_t queuedBytes = 0;
+    for (const auto &client : clients) {
+        size_t messages = 0;
+        size_t bytes = 0;
+        client->getReceiveQueueUsage(messages, bytes);
+        queuedMessages += messages;
+        queuedBytes += bytes;
+    }
+
+    char buffer[192];
+    snprintf(buffer, sizeof(buffer), R"({"shim":{"contexts":%zu,"liveClients":%zu,"receiveQueueMessages":%zu,"receiveQueueBytes":%zu},"engine":)",
+             clients.size(), WebSocketClient::liveClients(), queuedMessages, queuedBytes);
+    std::string stats = buffer;
+    auto engine = WebSocketClient::getEngineMemoryStats();
+    stats += engine.empty() ? "{}" : engine;
+    stats += "}";
+
+    FREObject result = nullptr;
+    FRENewObjectFromUTF8(static_cast<uint32_t>(stats.size()), reinterpret_cast<const uint8_t *>(stats.c_str()), &result);
+    return result;
+}
+
+static FREObject getLastMessageTimestamp(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    FREObject result = nullptr;
+    FRENewObjectFromDouble(wsClient->getLastMessageTimestamp(), &result);
+    return result;
+}
+
+static FREObject getQueueDelayStats(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    auto stats = wsClient->getQueueDelayStats();
+
+    FREObject result = nullptr;
+    FRENewObjectFromUTF8(static_cast<uint32_t>(stats.size()), reinterpret_cast<const uint8_t *>(stats.c_str()), &result);
+    return result;
+}
+
+static FREObject setBusyPoll(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    writeLog("setBusyPoll called");
+    if (argc < 2) return nullptr;
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    uint32_t spinMicros;
+    int32_t core;
+    FREGetObjectAsUint32(argv[0], &spinMicros);
+    FREGetObjectAsInt32(argv[1], &core);
+
+    wsClient->setBusyPoll(static_cast<int>(spinMicros), core);
+    return nullptr;
+}
+
+static FREObject getIoStats(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    auto stats = wsClient->getIoStats();
+
+    FREObject result = nullptr;
+    FRENewObjectFromUTF8(static_cast<uint32_t>(stats.size()), reinterpret_cast<const uint8_t *>(stats.c_str()), &result);
+    return result;
+}
+
+static FREObject setDecodeOffload(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    writeLog("setDecodeOffload called");
+    if (argc < 1) return nullptr;
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    uint32_t enabled;
+    FREGetObjectAsBool(argv[0], &enabled);
+
+    wsClient->setDecodeOffload(enabled != 0);
+    return nullptr;
+}
+
+static FREObject getDecodeStats(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    auto stats = wsClient->getDecodeStats();
+
+    FREObject result = nullptr;
+    FRENewObjectFromUTF8(static_cast<uint32_t>(stats.size()), reinterpret_cast<const uint8_t *>(stats.c_str()), &result);
+    return result;
+}
+
+static FREObject setDeltaDecoding(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    writeLog("setDeltaDecoding called");
+    if (argc < 1) return nullptr;
+
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    uint32_t maxBytes;
+    FREGetObjectAsUint32(argv[0], &maxBytes);
+
+    wsClient->setDeltaDecoding(maxBytes);
+    return nullptr;
+}
+
+static FREObject getDeltaStats(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    auto wsClient = getWebSocketClient(ctx);
+
+    if (wsClient == nullptr) {
+        writeLog("wsClient not found");
+        return nullptr;
+    }
+
+    auto stats = wsClient->getDeltaStats();
+
+    FREObject result = nullptr;
+    FRENewObjectFromUTF8(static_cast<uint32_t>(stats.size()), reinterpret_cast<const uint8_t *>(stats.c_str()), &result);
+    return result;
+}
+
+// argv[0] is the engine's impairment configuration as JSON (see NetworkImpairment.cs), null or empty to turn it off.
+// Process-wide, for testing against a local server; returns false when the engine rejected the configuration
+static FREObject setNetworkImpairment(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    writeLog("setNetworkImpairment called");
+
+    uint32_t configLength = 0;
+    const uint8_t *config = nullptr;
+    if (argc < 1 || FREGetObjectAsUTF8(argv[0], &configLength, &config) != FRE_OK) {
+        config = reinterpret_cast<const uint8_t *>("");
+    }
+
+    int applied = csharpWebSocketLibrary_setNetworkImpairment(reinterpret_cast<const char *>(config));
+
+    FREObject result = nullptr;
+    FRENewObjectFromBool(applied == 1, &result);
+    return result;
+}
+
+static FREObject getNetworkImpairmentStats(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
+    auto stats = WebSocketClient::getEngineNetworkImpairmentStats();
+
+    FREObject result = nullptr;
+    FRENewObjectFromUTF8(static_cast<uint32_t>(stats.size()), reinterpret_cast<const uint8_t *>(stats.c_str()), &result);
+    return result;
+}
+
 static FREObject setDebugMode(FREContext ctx, void *funcData, uint32_t argc, FREObject argv[]) {
     writeLog("setDebugMode called");
     if (argc < 1) return nullptr;
@@ -225,6 +1098,42 @@ static FREObject removeStaticHost(FREContext ctx, void *funcData, uint32_t argc,
     return nullptr;
 }
 
+static void recordStartupPhase(const char *name, std::chrono::steady_clock::time_point start) {
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::lock_guard<std::mutex> guard(startupTimingsMutex);
+    startupTimings.emplace_back(name, milliseconds);
+}
+
+// Loads the engine (Windows), starts its runtime and registers the callbacks, once, on whichever thread gets here first
+static void initializeEngine() {
+    std::call_once(engineInitialized, [] {
+        auto start = std::chrono::steady_clock::now();
+        csharpWebSocketLibrary_initializerCallbacks((void*)&connectCallback, (void*)&dataCallback, (void*)&ioErrorCallback, (void*)&writeLogCallback, (void*)&statusCallback);
+        recordStartupPhase("engineInit", start);
+    });
+}
+
+// Started by the warmUp call, or from InitExtension when built with WEBSOCKET_ANE_WARMUP, so the engine start, TLS
+// setup and resolution of the hinted hosts overlap with the application's own startup instead of landing in its first
+// connect
+static void warmUp() {
+    TRACE_THREAD_NAME("warm-up");
+    initializeEngine();
+    auto start = std::chrono::steady_clock::now();
+    csharpWebSocketLibrary_warmUp();
+    recordStartupPhase("engineWarmUp", start);
+}
+
+static void startWarmUp() {
+    std::call_once(warmUpStarted, [] { std::thread(warmUp).detach(); });
+}
+
+static FREObject warmUpEngine(FREContext ctx, void* funcData, uint32_t argc, FREObject argv[]) {
+    writeLog("warmUp called");
+    startWarmUp();
+    return nullptr;
+}
+
 static void WebSocketSupportContextInitializer(
         void* extData,
         const uint8_t* ctxType,
@@ -232,6 +1141,7 @@ static void WebSocketSupportContextInitializer(
         uint32_t* numFunctionsToSet,
         const FRENamedFunction** functionsToSet
 ) {
+    TRACE_THREAD_NAME("AIR main");
     if(!alreadyInitialized){
         alreadyInitialized = true;
         exportedFunctions[0].name = (const uint8_t*)"connect";
@@ -248,21 +1158,103 @@ static void WebSocketSupportContextInitializer(
         exportedFunctions[5].function = addStaticHost;
         exportedFunctions[6].name = (const uint8_t*)"removeStaticHost";
         exportedFunctions[6].function = removeStaticHost;
-        csharpWebSocketLibrary_initializerCallbacks((void*)&connectCallback, (void*)&dataCallback, (void*)&ioErrorCallback, (void*)&writeLogCallback);
+        exportedFunctions[7].name = (const uint8_t*)"setReceiveWatermarks";
+        exportedFunctions[7].function = setReceiveWatermarks;
+        exportedFunctions[8].name = (const uint8_t*)"setSendWatermarks";
+        exportedFunctions[8].function = setSendWatermarks;
+        exportedFunctions[9].name = (const uint8_t*)"getBufferedAmount";
+        exportedFunctions[9].function = getBufferedAmount;
+        exportedFunctions[10].name = (const uint8_t*)"setFragmentSize";
+        exportedFunctions[10].function = setFragmentSize;
+        exportedFunctions[11].name = (const uint8_t*)"getSendLaneStats";
+        exportedFunctions[11].function = getSendLaneStats;
+        exportedFunctions[12].name = (const uint8_t*)"setKeepAlive";
+        exportedFunctions[12].function = setKeepAlive;
+        exportedFunctions[13].name = (const uint8_t*)"getRttStats";
+        exportedFunctions[13].function = getRttStats;
+        exportedFunctions[14].name = (const uint8_t*)"readMessageInto";
+        exportedFunctions[14].function = readMessageInto;
+        exportedFunctions[15].name = (const uint8_t*)"sendMessages";
+        exportedFunctions[15].function = sendMessages;
+        exportedFunctions[16].name = (const uint8_t*)"startCapture";
+        exportedFunctions[16].function = startCapture;
+        exportedFunctions[17].name = (const uint8_t*)"stopCapture";
+        exportedFunctions[17].function = stopCapture;
+        exportedFunctions[18].name = (const uint8_t*)"startReplay";
+        exportedFunctions[18].function = startReplay;
+        exportedFunctions[19].name = (const uint8_t*)"stopReplay";
+        exportedFunctions[19].function = stopReplay;
+        exportedFunctions[20].name = (const uint8_t*)"setConflationKey";
+        exportedFunctions[20].function = setConflationKey;
+        exportedFunctions[21].name = (const uint8_t*)"getConflationStats";
+        exportedFunctions[21].function = getConflationStats;
+        exportedFunctions[22].name = (const uint8_t*)"setAmf3Decoding";
+        exportedFunctions[22].function = setAmf3Decoding;
+        exportedFunctions[23].name = (const uint8_t*)"getAmf3Message";
+        exportedFunctions[23].function = getAmf3Message;
+        exportedFunctions[24].name = (const uint8_t*)"sendAmf3";
+        exportedFunctions[24].function = sendAmf3;
+        exportedFunctions[25].name = (const uint8_t*)"setJsonDecoding";
+        exportedFunctions[25].function = setJsonDecoding;
+        exportedFunctions[26].name = (const uint8_t*)"getJsonMessage";
+        exportedFunctions[26].function = getJsonMessage;
+        exportedFunctions[27].name = (const uint8_t*)"getTraceEvents";
+        exportedFunctions[27].function = getTraceEvents;
+        exportedFunctions[28].name = (const uint8_t*)"addHostHint";
+        exportedFunctions[28].function = addHostHint;
+        exportedFunctions[29].name = (const uint8_t*)"getStartupTimings";
+        exportedFunctions[29].function = getStartupTimings;
+        exportedFunctions[30].name = (const uint8_t*)"connectShared";
+        exportedFunctions[30].function = connectShared;
+        exportedFunctions[31].name = (const uint8_t*)"getMemoryStats";
+        exportedFunctions[31].function = getMemoryStats;
+        exportedFunctions[32].name = (const uint8_t*)"getLastMessageTimestamp";
+        exportedFunctions[32].function = getLastMessageTimestamp;
+        exportedFunctions[33].name = (const uint8_t*)"getQueueDelayStats";
+        exportedFunctions[33].function = getQueueDelayStats;
+        exportedFunctions[34].name = (const uint8_t*)"setBusyPoll";
+        exportedFunctions[34].function = setBusyPoll;
+        exportedFunctions[35].name = (const uint8_t*)"getIoStats";
+        exportedFunctions[35].function = getIoStats;
+        exportedFunctions[36].name = (const uint8_t*)"setDecodeOffload";
+        exportedFunctions[36].function = setDecodeOffload;
+        exportedFunctions[37].name = (const uint8_t*)"getDecodeStats";
+        exportedFunctions[37].function = getDecodeStats;
+        exportedFunctions[38].name = (const uint8_t*)"setDeltaDecoding";
+        exportedFunctions[38].function = setDeltaDecoding;
+        exportedFunctions[39].name = (const uint8_t*)"getDeltaStats";
+        exportedFunctions[39].function = getDeltaStats;
+        exportedFunctions[40].name = (const uint8_t*)"setNetworkImpairment";
+        exportedFunctions[40].function = setNetworkImpairment;
+        exportedFunctions[41].name = (const uint8_t*)"getNetworkImpairmentStats";
+        exportedFunctions[41].function = getNetworkImpairmentStats;
+        exportedFunctions[42].name = (const uint8_t*)"warmUp";
+        exportedFunctions[42].function = warmUpEngine;
+    }
+
+    // Waits for the warm-up thread when it is still starting the engine
+    static bool firstContext = true;
+    auto engineWait = std::chrono::steady_clock::now();
+    initializeEngine();
+    if (firstContext) {
+        firstContext = false;
+        recordStartupPhase("firstContextEngineWait", engineWait);
     }
-    WebSocketClient* wsClient = new WebSocketClient(ctx);
-    FRESetContextNativeData(ctx, wsClient);
+
+    auto wsClient = std::make_shared<WebSocketClient>(ctx);
+    FRESetContextNativeData(ctx, wsClient.get());
     setWebSocketClient(ctx, wsClient);
-    if (numFunctionsToSet) *numFunctionsToSet = 5;
+    if (numFunctionsToSet) *numFunctionsToSet = 43;
     if (functionsToSet) *functionsToSet = exportedFunctions;
 }
 
 static void WebSocketSupportContextFinalizer(FREContext ctx) {
-    WebSocketClient* wsClient = nullptr;
-    if (FRE_OK == FREGetContextNativeData(ctx, reinterpret_cast<void**>(&wsClient))) {
-        delete wsClient;
+    // Callbacks starting from now find no client; the ones already running finish before the engine client goes.
+    // The object itself is freed with the last reference, possibly by one of those callbacks
+    auto wsClient = removeWebSocketClient(ctx);
+    if (wsClient != nullptr) {
+        wsClient->shutdown();
     }
-    removeWebSocketClient(ctx);
 }
 
 extern "C" {
@@ -273,6 +1265,9 @@ void InitExtension(void** extDataToSet, FREContextInitializer* ctxInitializerToS
     if (extDataToSet) *extDataToSet = nullptr;
     if (ctxInitializerToSet) *ctxInitializerToSet = WebSocketSupportContextInitializer;
     if (ctxFinalizerToSet) *ctxFinalizerToSet = WebSocketSupportContextFinalizer;
+#ifdef WEBSOCKET_ANE_WARMUP
+    startWarmUp();
+#endif
     writeLog("InitExtension completed");
 }
 
@@ -0,0 +1,27 @@
+package br.com.redesurftank {
+import flash.events.Event;
+
+/**
+ * Dispatched by AndroidWebSocket instead of websocketData for binary messages while AMF3 decoding is on.
+ * value is the message as ByteArray.readObject would have returned it.
+ */
+public class Amf3MessageEvent extends Event {
+
+    public static const AMF3_MESSAGE:String = "amf3Message";
+
+    private var _value:*;
+
+    public function Amf3MessageEvent(type:String, value:*, bubbles:Boolean = false, cancelable:Boolean = false) {
+        super(type, bubbles, cancelable);
+        _value = value;
+    }
+
+    public function get value():* {
+        return _value;
+    }
+
+    override public function clone():Event {
+        return new Amf3MessageEvent(type, _value, bubbles, cancelable);
+    }
+}
+}
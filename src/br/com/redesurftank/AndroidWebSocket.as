@@ -1,6 +1,7 @@
 package br.com.redesurftank {
 import air.net.WebSocket;
 
+import flash.events.DataEvent;
 import flash.events.Event;
 import flash.events.IOErrorEvent;
 import flash.events.StatusEvent;
@@ -12,6 +13,17 @@ import flash.utils.ByteArray;
 
 public class AndroidWebSocket extends WebSocket {
 
+    /**
+     * Send lane for small latency-critical messages (input, heartbeats); drained first at every message boundary. A
+     * lower-lane message already being sent in fragments is finished first, so keep bulk messages small when this
+     * lane's latency matters.
+     */
+    public static const LANE_CONTROL:uint = 0;
+    /** Default send lane. */
+    public static const LANE_NORMAL:uint = 1;
+    /** Send lane for large uploads; only drained when the other lanes are empty. */
+    public static const LANE_BULK:uint = 2;
+
     private var extContext:ExtensionContext = null;
 
     private var fallback:WebSocket = null;
@@ -20,6 +32,25 @@ public class AndroidWebSocket extends WebSocket {
 
     private var _debugMode:Boolean;
 
+    private var _amf3Decoding:Boolean;
+
+    private var _amf3Scratch:ByteArray = new ByteArray();
+
+    private var _jsonDecoding:Boolean;
+
+    private var _jsonPaths:Array;
+
+    /**
+     * When false, binary messages are not dispatched as websocketData events and stay queued until read with
+     * readMessageInto/readMessagesInto, e.g. once per frame into a reused ByteArray.
+     */
+    public var autoReceive:Boolean = true;
+
+    /**
+     * Timeouts, socket options and buffer sizes applied by the next connect; null uses the backend defaults.
+     */
+    public var connectOptions:WebSocketConnectOptions;
+
     public function AndroidWebSocket() {
         super();
         initContext();
@@ -41,6 +72,11 @@ public class AndroidWebSocket extends WebSocket {
         }
     }
 
+    private static function get isNativeEngine():Boolean {
+        var plataform:String = Capabilities.version.substr(0, 3);
+        return plataform == "WIN" || plataform == "MAC" || plataform == "IOS";
+    }
+
     override public function startServer(param1:Socket):void {
         throw new Error("AndroidWebSocket cannot take over an existing AS3 Socket object");
     }
@@ -62,6 +98,396 @@ public class AndroidWebSocket extends WebSocket {
         }
     }
 
+    /**
+     * Same as sendMessage, but queued on the given send lane (LANE_CONTROL, LANE_NORMAL or LANE_BULK).
+     * Returns false when the message was rejected because bufferedAmount is above the send high watermark.
+     * Lanes are only honoured by the Windows/macOS/iOS engine; Android sends in call order.
+     */
+    public function sendMessageOnLane(type:uint, data:*, lane:uint):Boolean {
+        if (fallback) {
+            fallback.sendMessage(type, data);
+            return true;
+        }
+        if (extContext) {
+            return extContext.call("sendMessage", type, data, lane) as Boolean;
+        }
+        return false;
+    }
+
+    /**
+     * Sends every record of records ([uint length, big-endian][payload bytes], repeated) as its own binary message
+     * with a single native call; on Windows/macOS/iOS the frames also go out as one socket write. Returns how many
+     * messages were queued, 0 when records is malformed or bufferedAmount is above the send high watermark.
+     */
+    public function sendMessages(records:ByteArray, lane:uint = LANE_NORMAL):uint {
+        if (fallback) {
+            var sent:uint = 0;
+            records.position = 0;
+            while (records.bytesAvailable >= 4) {
+                var length:uint = records.readUnsignedInt();
+                var message:ByteArray = new ByteArray();
+                records.readBytes(message, 0, length);
+                fallback.sendMessage(WebSocket.fmtBINARY, message);
+                sent++;
+            }
+            return sent;
+        }
+        if (extContext) {
+            return extContext.call("sendMessages", records, lane) as uint;
+        }
+        return 0;
+    }
+
+    /**
+     * Messages larger than this many bytes are sent as several WebSocket frames so pings, pongs and close frames
+     * are not held back by a large upload. Messages on higher lanes still wait for the fragmented message to finish;
+     * getSendLaneStats counts those waits as blockedBehindFragmented.
+     */
+    public function setFragmentSize(bytes:uint):void {
+        if (extContext && isNativeEngine) {
+            extContext.call("setFragmentSize", bytes);
+        }
+    }
+
+    /**
+     * Queue-to-wire latency percentiles (microseconds) and blockedBehindFragmented counts per send lane, or null when
+     * not supported by the platform.
+     */
+    public function getSendLaneStats():Object {
+        if (extContext && isNativeEngine) {
+            var stats:String = extContext.call("getSendLaneStats") as String;
+            if (stats) {
+                return JSON.parse(stats);
+            }
+        }
+        return null;
+    }
+
+    /**
+     * Pings the server every intervalMs (0, the default, disables) and closes the connection with an ioError when
+     * nothing at all is received within timeoutMs of a ping, which should allow for the app being backgrounded.
+     * When statusIntervalMs is above 0 a "keepaliveStatus" DataEvent with the getRttStats() JSON is dispatched at
+     * most that often.
+     */
+    public function setKeepAlive(intervalMs:uint, timeoutMs:uint, statusIntervalMs:uint = 0):void {
+        if (extContext) {
+            extContext.call("setKeepAlive", intervalMs, timeoutMs, statusIntervalMs);
+        }
+    }
+
+    /**
+     * Smoothed RTT, jitter and RTT percentiles (microseconds) measured by the keepalive pings, or null when unavailable.
+     */
+    public function getRttStats():Object {
+        if (extContext) {
+            var stats:String = extContext.call("getRttStats") as String;
+            if (stats) {
+                return JSON.parse(stats);
+            }
+        }
+        return null;
+    }
+
+    /**
+     * Low-latency receive mode for the next connect: the engine reads on a dedicated thread that spins for up to
+     * spinMicros waiting for data before parking, pinned to core when it is 0 or above (Windows only). It costs up to
+     * a full core while the connection is open; spinMicros 0 restores the default mode. Ignored without the native
+     * engine and by shared connections.
+     */
+    public function setBusyPoll(spinMicros:uint, core:int = -1):void {
+        if (extContext && isNativeEngine) {
+            extContext.call("setBusyPoll", spinMicros, core);
+        }
+    }
+
+    /**
+     * Receive-path cost and latency: the busy-poll thread's spin/park counts, CPU and wall time when that mode is
+     * used, and in both modes the socket-read-to-delivery percentiles (microseconds). Null without the native engine.
+     */
+    public function getIoStats():Object {
+        if (extContext && isNativeEngine) {
+            var stats:String = extContext.call("getIoStats") as String;
+            if (stats) {
+                return JSON.parse(stats);
+            }
+        }
+        return null;
+    }
+
+    /**
+     * Hot-path spans of the native shim and engine as Chrome trace-event JSON, to save to a .json file and open in
+     * chrome://tracing or ui.perfetto.dev. Spans are only recorded by builds with WEBSOCKET_ANE_TRACING; null on
+     * platforms without the native engine.
+     */
+    public function getTraceEvents():String {
+        if (extContext && isNativeEngine) {
+            return extContext.call("getTraceEvents") as String;
+        }
+        return null;
+    }
+
+    /**
+     * Writes the next queued binary message into buffer from offset 0, growing buffer only when it is too short,
+     * and returns the message length (0 when nothing is queued). buffer.length and position are left alone otherwise.
+     */
+    public function readMessageInto(buffer:ByteArray):uint {
+        if (extContext && !fallback) {
+            return extContext.call("readMessageInto", buffer) as uint;
+        }
+        return 0;
+    }
+
+    /**
+     * Like readMessageInto, but drains up to maxMessages messages in one call. Each message is written as a
+     * big-endian uint (readUnsignedInt) length followed by its bytes; returns the total number of bytes written.
+     */
+    public function readMessagesInto(buffer:ByteArray, maxMessages:uint):uint {
+        if (extContext && !fallback) {
+            return extContext.call("readMessageInto", buffer, maxMessages) as uint;
+        }
+        return 0;
+    }
+
+    /**
+     * Turns on latest-value conflation of binary messages: a message whose key matches one still waiting in the
+     * receive queue replaces it in place instead of being appended. The key is length bytes at offset or, with
+     * length 0, the bytes from offset up to the first delimiter byte (e.g. 0x3A for "topic:payload"). Messages
+     * without a key are queued normally. Windows/macOS/iOS only.
+     */
+    public function setConflationKey(offset:uint, length:uint, delimiter:int = -1):void {
+        if (extContext && isNativeEngine) {
+            extContext.call("setConflationKey", offset, length, delimiter);
+        }
+    }
+
+    public function disableConflation():void {
+        if (extContext && isNativeEngine) {
+            extContext.call("setConflationKey", 0, 0, -1);
+        }
+    }
+
+    /**
+     * {enabled, conflated, conflatedBytes, queued, queuedBytes, keys}, or null when not supported by the platform.
+     */
+    public function getConflationStats():Object {
+        if (extContext && isNativeEngine) {
+            var stats:String = extContext.call("getConflationStats") as String;
+            if (stats) {
+                return JSON.parse(stats);
+            }
+        }
+        return null;
+    }
+
+    /**
+     * When enabled, binary messages are dispatched as Amf3MessageEvent with the decoded value instead of
+     * websocketData. On Windows/macOS/iOS each payload is validated and indexed as AMF3 on the network thread, so the
+     * main thread only creates the objects; typed objects are created from their class alias, which therefore has to
+     * be the qualified class name. Payloads the native decoder does not handle (IExternalizable, Vector, Dictionary)
+     * and other platforms go through ByteArray.readObject.
+     */
+    public function setAmf3Decoding(enabled:Boolean):void {
+        _amf3Decoding = enabled;
+        if (extContext && isNativeEngine) {
+            extContext.call("setAmf3Decoding", enabled);
+        }
+    }
+
+    /**
+     * When enabled, text messages are dispatched as JsonMessageEvent with the parsed value instead of websocketData.
+     * On Windows/macOS/iOS each message is validated and indexed on the network thread, so the main thread only
+     * creates the objects. With paths (dot-separated keys and array indices, e.g. "items.0.price") only those values
+     * are created, as an Array in the same order. Text that is not valid JSON is still dispatched as websocketData.
+     */
+    public function setJsonDecoding(enabled:Boolean, paths:Array = null):void {
+        _jsonDecoding = enabled;
+        _jsonPaths = paths;
+        if (extContext && isNativeEngine) {
+            extContext.call("setJsonDecoding", enabled);
+        }
+    }
+
+    /**
+     * Moves the AMF3 and JSON indexing enabled by setAmf3Decoding and setJsonDecoding off the network thread onto a
+     * native pool with one worker per hardware thread, shared by every connection. Messages are still dispatched in
+     * the order they were received. Helps when large payloads or many connections make indexing slow down receiving;
+     * costs a thread hop per message otherwise. Windows/macOS/iOS only.
+     */
+    public function setDecodeOffload(enabled:Boolean):void {
+        if (extContext && isNativeEngine) {
+            extContext.call("setDecodeOffload", enabled);
+        }
+    }
+
+    /**
+     * Decode offload counters of this connection: offloaded messages, reorderPending and reorderMax (messages that
+     * finished decoding ahead of an earlier one) and reorderWait, plus pool with the pool's threads, submitted and
+     * steals counts and, per stage (amf3Index, jsonIndex), histograms of the time jobs were queued and ran.
+     * Histograms are in microseconds. Null on platforms without the native engine.
+     */
+    public function getDecodeStats():Object {
+        if (extContext && isNativeEngine) {
+            var stats:String = extContext.call("getDecodeStats") as String;
+            if (stats) {
+                return JSON.parse(stats);
+            }
+        }
+        return null;
+    }
+
+    /**
+     * Rebuilds binary messages the server sends as deltas against the previous payload of the same key, on the
+     * network thread, so websocketData and getByteArrayMessage carry the full payload. Every binary message must then
+     * be framed as a snapshot or a delta (the format is documented in the native DeltaDecoder.hpp). maxBytes bounds the
+     * previous payloads kept, least recently used keys being dropped first; 0 turns it off. A message that cannot be
+     * rebuilt (unknown key, base mismatch, malformed delta) is dropped and dispatches a "deltaError" DataEvent with
+     * "key;reason", and the key waits for its next snapshot. Windows/macOS/iOS only.
+     */
+    public function setDeltaDecoding(enabled:Boolean, maxBytes:uint = 16777216):void {
+        if (extContext && isNativeEngine) {
+            extContext.call("setDeltaDecoding", enabled ? maxBytes : 0);
+        }
+    }
+
+    /**
+     * Delta decoding counters: snapshots, deltas and errors, wireBytes against reconstructedBytes, keys and
+     * storedBytes held against maxBytes, evictions, and apply, a histogram of the time to rebuild a message in
+     * microseconds. Null on platforms without the native engine.
+     */
+    public function getDeltaStats():Object {
+        if (extContext && isNativeEngine) {
+            var stats:String = extContext.call("getDeltaStats") as String;
+            if (stats) {
+                return JSON.parse(stats);
+            }
+        }
+        return null;
+    }
+
+    private function jsonSelect(value:*):Array {
+        var fields:Array = [];
+        for each (var path:String in _jsonPaths) {
+            var node:* = value;
+            for each (var key:String in path.split(".")) {
+                if (node === null || typeof node != "object" || !node.hasOwnProperty(key)) {
+                    node = null;
+                    break;
+                }
+                node = node[key];
+            }
+            fields.push(node);
+        }
+        return fields;
+    }
+
+    /**
+     * Decodes the next queued binary message as AMF3, for use with autoReceive off.
+     */
+    public function readAmf3Message():* {
+        if (!extContext || fallback) {
+            return undefined;
+        }
+        var bytes:ByteArray;
+        if (isNativeEngine) {
+            var value:* = extContext.call("getAmf3Message", _amf3Scratch);
+            // The scratch buffer comes back only for messages that were not indexed
+            if (value !== _amf3Scratch) {
+                return value;
+            }
+            bytes = _amf3Scratch;
+        } else {
+            bytes = extContext.call("getByteArrayMessage") as ByteArray;
+            if (!bytes) {
+                return undefined;
+            }
+        }
+        bytes.position = 0;
+        return bytes.length > 0 ? bytes.readObject() : undefined;
+    }
+
+    /**
+     * Sends value as one AMF3 binary message, like writeObject followed by sendMessageOnLane. On Windows/macOS/iOS
+     * null, Boolean, Number, String, ByteArray, dense Arrays and plain Objects are encoded natively; anything else is
+     * encoded with ByteArray.writeObject. Returns false when rejected by the send high watermark.
+     */
+    public function sendAmf3(value:*, lane:uint = LANE_NORMAL):Boolean {
+        if (extContext && isNativeEngine && !fallback) {
+            var status:int = extContext.call("sendAmf3", value, lane, this) as int;
+            if (status >= 0) {
+                return status == 1;
+            }
+        }
+        var bytes:ByteArray = new ByteArray();
+        bytes.writeObject(value);
+        return sendMessageOnLane(WebSocket.fmtBINARY, bytes, lane);
+    }
+
+    /**
+     * Called by the native AMF3 encoder: the dynamic property names of a plain Object, an empty Array for a dense
+     * Array, or null when value has to be encoded by ByteArray.writeObject. Not meant to be called directly.
+     */
+    public function amf3Keys(value:Object):Array {
+        var keys:Array = [];
+        var key:String;
+        if (value is Array) {
+            var count:uint = 0;
+            for (key in value) {
+                count++;
+            }
+            // Holes and non-index properties need writeObject's associative part
+            return count == (value as Array).length ? keys : null;
+        }
+        if (value.constructor !== Object) {
+            return null;
+        }
+        for (key in value) {
+            keys.push(key);
+        }
+        return keys;
+    }
+
+    /**
+     * Starts appending every inbound and outbound message, with nanosecond timestamps, to a memory-mapped capture
+     * at nativePath (plus nativePath + ".idx"). Windows/macOS/iOS only.
+     */
+    public function startCapture(nativePath:String):Boolean {
+        if (extContext && isNativeEngine) {
+            return extContext.call("startCapture", nativePath) as Boolean;
+        }
+        return false;
+    }
+
+    /**
+     * Stops the capture and returns {records, bytes, durationNs}, or null when not supported by the platform.
+     */
+    public function stopCapture():Object {
+        if (extContext && isNativeEngine) {
+            var stats:String = extContext.call("stopCapture") as String;
+            if (stats) {
+                return JSON.parse(stats);
+            }
+        }
+        return null;
+    }
+
+    /**
+     * Plays the inbound messages of a capture back as websocketData events, with the recorded spacing divided by
+     * speed when realtime is true or as fast as the receive queue accepts them otherwise. A "replayComplete"
+     * DataEvent carrying {messages, bytes, elapsedNs, completed} is dispatched at the end.
+     */
+    public function startReplay(nativePath:String, realtime:Boolean = true, speed:Number = 1):Boolean {
+        if (extContext && isNativeEngine) {
+            return extContext.call("startReplay", nativePath, realtime, speed) as Boolean;
+        }
+        return false;
+    }
+
+    public function stopReplay():void {
+        if (extContext && isNativeEngine) {
+            extContext.call("stopReplay");
+        }
+    }
+
     override public function close(param1:uint = 1000):void {
         if (fallback) {
             fallback.close(param1);
@@ -82,8 +508,22 @@ public class AndroidWebSocket extends WebSocket {
             throw new Error("TODO: implement support for sending a protocol list");
         }
         if (extContext) {
-            extContext.call("connect", param1, param2);
+            extContext.call("connect", param1, param2, connectOptions);
+        }
+    }
+
+    /**
+     * Like connect, but every AndroidWebSocket calling connectShared with the same url shares one native connection,
+     * each as a logical channel with its own send and receive queues, scheduled fairly against the others. The server
+     * has to understand the channel framing, e.g. through the MultiplexDemuxServer reference demultiplexer in
+     * CSharpLibrary. Platforms without the native engine open a connection of their own, as with connect.
+     */
+    public function connectShared(url:String):void {
+        if (extContext && isNativeEngine && !fallback) {
+            extContext.call("connectShared", url);
+            return;
         }
+        connect(url);
     }
 
     override public function get protocol():String {
@@ -111,6 +551,34 @@ public class AndroidWebSocket extends WebSocket {
         }
     }
 
+    /**
+     * Bytes accepted by sendMessage that were not yet written to the socket.
+     * While it is above the send high watermark new messages are rejected; a "drain" event fires once it falls back
+     * under the low watermark.
+     */
+    public function get bufferedAmount():Number {
+        if (extContext) {
+            return extContext.call("getBufferedAmount") as Number;
+        }
+        return 0;
+    }
+
+    /**
+     * Socket reads pause when the native receive queue reaches highBytes or highMessages and resume once it is back
+     * under both low marks, letting TCP flow control push back on the server while the main thread catches up.
+     */
+    public function setReceiveWatermarks(lowBytes:uint, highBytes:uint, lowMessages:uint, highMessages:uint):void {
+        if (extContext) {
+            extContext.call("setReceiveWatermarks", lowBytes, highBytes, lowMessages, highMessages);
+        }
+    }
+
+    public function setSendWatermarks(lowBytes:Number, highBytes:Number):void {
+        if (extContext) {
+            extContext.call("setSendWatermarks", lowBytes, highBytes);
+        }
+    }
+
     public function addStaticHost(host:String, ip:String):void {
         extContext.call("addStaticHost", host, ip);
     }
@@ -119,6 +587,116 @@ public class AndroidWebSocket extends WebSocket {
         extContext.call("removeStaticHost", host);
     }
 
+    /**
+     * Hints a host that will be connected to, so the native engine resolves it (and opens its DoH connection) ahead
+     * of the first connect: during warmUp(), or right away when the warm-up already started. Ignored on platforms
+     * without the native engine.
+     */
+    public function addHostHint(host:String):void {
+        if (extContext && isNativeEngine) {
+            extContext.call("addHostHint", host);
+        }
+    }
+
+    /**
+     * Starts the native engine, its TLS and WebSocket stacks and the resolution of the hinted and static hosts on a
+     * background thread, so the first connect does not pay for them. Only the first call in the process does
+     * anything; ignored on platforms without the native engine.
+     */
+    public function warmUp():void {
+        if (extContext && isNativeEngine) {
+            extContext.call("warmUp");
+        }
+    }
+
+    /**
+     * Durations in milliseconds of the native startup phases: shim.engineInit (engine load and runtime start),
+     * shim.engineWarmUp, shim.firstContextEngineWait and the engine's own phases, including engine.firstConnect.
+     * Null on platforms without the native engine.
+     */
+    public function getStartupTimings():Object {
+        if (extContext && isNativeEngine) {
+            var timings:String = extContext.call("getStartupTimings") as String;
+            if (timings) {
+                return JSON.parse(timings);
+            }
+        }
+        return null;
+    }
+
+    /**
+     * Receive time of the message most recently read (websocketData, AMF3 and JSON events, readMessageInto), in
+     * milliseconds on the native monotonic clock: when the engine read its first frame off the socket. Compare it
+     * with getQueueDelayStats().now. NaN on platforms without the native engine.
+     */
+    public function get lastMessageTimestamp():Number {
+        if (extContext && isNativeEngine) {
+            return extContext.call("getLastMessageTimestamp") as Number;
+        }
+        return NaN;
+    }
+
+    /**
+     * Histograms, in microseconds, of the time received messages waited in the native receive queue before AS3 read
+     * them (queued) and since the engine received them (sinceReceive), plus now, the native monotonic time in
+     * milliseconds. Null on platforms without the native engine.
+     */
+    public function getQueueDelayStats():Object {
+        if (extContext && isNativeEngine) {
+            var stats:String = extContext.call("getQueueDelayStats") as String;
+            if (stats) {
+                return JSON.parse(stats);
+            }
+        }
+        return null;
+    }
+
+    /**
+     * Memory held by the native side, to check that it stays flat over many connect/close cycles.
+     * shim: contexts, liveClients (more than contexts while a finalized context's callback is still running),
+     * receiveQueueMessages and receiveQueueBytes. engine: liveClients, clientsCreated, liveConnections,
+     * connectionsOpened, sendQueueBytes, receiveBuffers, receiveBufferBytes and managedHeapBytes.
+     * Null on platforms without the native engine.
+     */
+    public function getMemoryStats():Object {
+        if (extContext && isNativeEngine) {
+            var stats:String = extContext.call("getMemoryStats") as String;
+            if (stats) {
+                return JSON.parse(stats);
+            }
+        }
+        return null;
+    }
+
+    /**
+     * Impairs the connections the engine opens from now on, for testing reconnects, the parallel connect and
+     * backpressure against a local server: config is {seed, default, addresses}, where default and each entry of
+     * addresses (keyed by IP, e.g. "127.0.0.2") hold latencyMs, jitterMs, downlinkBytesPerSecond,
+     * uplinkBytesPerSecond, lossPercent, retransmitMs, stallPercent, stallMs, resetAfterBytes, resetAfterMs, blackhole
+     * and windowBytes. Null turns it off. Process-wide; returns false when the engine rejected the configuration or
+     * on platforms without the native engine.
+     */
+    public function setNetworkImpairment(config:Object):Boolean {
+        if (extContext && isNativeEngine) {
+            return extContext.call("setNetworkImpairment", config ? JSON.stringify(config) : "") as Boolean;
+        }
+        return false;
+    }
+
+    /**
+     * Impairment counters since the last setNetworkImpairment: connections, blackholed, losses, stalls, resets,
+     * bytesDown and bytesUp. Null on platforms without the native engine.
+     */
+    public function getNetworkImpairmentStats():Object {
+        if (extContext && isNativeEngine) {
+            var stats:String = extContext.call("getNetworkImpairmentStats") as String;
+            if (stats) {
+                return JSON.parse(stats);
+            }
+        }
+        return null;
+    }
+
     public function get debugMode():Boolean {
         return _debugMode;
     }
@@ -147,22 +725,59 @@ public class AndroidWebSocket extends WebSocket {
                 dispatchEvent(new Event("connect"));
                 break;
             case "textMessage":
+                if (_jsonDecoding) {
+                    try {
+                        var parsed:* = JSON.parse(param1.level);
+                        dispatchEvent(new JsonMessageEvent(JsonMessageEvent.JSON_MESSAGE, _jsonPaths ? jsonSelect(parsed) : parsed));
+                        break;
+                    } catch (e:SyntaxError) {
+                    }
+                }
                 _loc2_ = new ByteArray();
                 _loc2_.writeUTFBytes(param1.level);
                 dispatchEvent(new WebSocketEvent("websocketData", WebSocket.fmtTEXT, _loc2_));
                 break;
             case "nextMessage":
-                var bytes:ByteArray = extContext.call("getByteArrayMessage") as ByteArray;
+                if (!autoReceive)
+                    break;
+                var text:Boolean = param1.level == "text";
+                var bytes:ByteArray;
+                if (text && _jsonDecoding) {
+                    var value:* = extContext.call("getJsonMessage", _jsonPaths);
+                    // Messages that are not valid JSON come back as their bytes
+                    if (!(value is ByteArray)) {
+                        dispatchEvent(new JsonMessageEvent(JsonMessageEvent.JSON_MESSAGE, value));
+                        break;
+                    }
+                    bytes = value as ByteArray;
+                } else if (!text && _amf3Decoding) {
+                    dispatchEvent(new Amf3MessageEvent(Amf3MessageEvent.AMF3_MESSAGE, readAmf3Message()));
+                    break;
+                } else {
+                    bytes = extContext.call("getByteArrayMessage") as ByteArray;
+                }
                 if (!bytes)
                     break;
                 bytes.position = 0;
-                dispatchEvent(new WebSocketEvent("websocketData", WebSocket.fmtBINARY, bytes));
+                dispatchEvent(new WebSocketEvent("websocketData", text ? WebSocket.fmtTEXT : WebSocket.fmtBINARY, bytes));
                 break;
             case "disconnected":
                 var parameters:Array = param1.level.split(";");
                 _closeReason = int(parameters[0]);
                 dispatchEvent(new Event("close"));
                 break;
+            case "drain":
+                dispatchEvent(new Event("drain"));
+                break;
+            case "keepaliveStatus":
+                dispatchEvent(new DataEvent("keepaliveStatus", false, false, param1.level));
+                break;
+            case "replayComplete":
+                dispatchEvent(new DataEvent("replayComplete", false, false, param1.level));
+                break;
+            case "deltaError":
+                dispatchEvent(new DataEvent("deltaError", false, false, param1.level));
+                break;
             case "error":
                 dispatchEvent(new IOErrorEvent("ioError", false, false, param1.level));
                 break;
@@ -0,0 +1,28 @@
+package br.com.redesurftank {
+import flash.events.Event;
+
+/**
+ * Dispatched by AndroidWebSocket instead of websocketData for text messages while JSON decoding is on.
+ * value is the message as JSON.parse would have returned it or, when paths were given to setJsonDecoding, an Array
+ * with the value at each path (null when absent).
+ */
+public class JsonMessageEvent extends Event {
+
+    public static const JSON_MESSAGE:String = "jsonMessage";
+
+    private var _value:*;
+
+    public function JsonMessageEvent(type:String, value:*, bubbles:Boolean = false, cancelable:Boolean = false) {
+        super(type, bubbles, cancelable);
+        _value = value;
+    }
+
+    public function get value():* {
+        return _value;
+    }
+
+    override public function clone():Event {
+        return new JsonMessageEvent(type, _value, bubbles, cancelable);
+    }
+}
+}
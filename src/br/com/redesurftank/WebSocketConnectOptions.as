@@ -0,0 +1,43 @@
+package br.com.redesurftank {
+
+/**
+ * Per-connection tuning for AndroidWebSocket.connect, set through AndroidWebSocket.connectOptions. A value of 0
+ * keeps the backend default, except for tcpNoDelay and keepAliveIntervalMs (-1 keeps the interval set with
+ * setKeepAlive, 0 turns keepalive off). Ignored by the pure AS3 fallback.
+ */
+public class WebSocketConnectOptions {
+
+    /** Whole connect, resolve to handshake (default 10000 ms, 5000 ms on Android). */
+    public var connectTimeoutMs:uint = 0;
+
+    /** Delay before racing the next resolved address (default 250 ms). Native engine only. */
+    public var attemptDelayMs:uint = 0;
+
+    /** DNS lookup timeout (default 250 ms per system resolver query, unbounded on Android). */
+    public var dnsTimeoutMs:uint = 0;
+
+    /** Timeout of the reachability probe sent to each resolved address (default 1000 ms). Android only. */
+    public var probeTimeoutMs:uint = 0;
+
+    /** TCP_NODELAY: send small messages immediately instead of coalescing them (Nagle). */
+    public var tcpNoDelay:Boolean = true;
+
+    /** SO_SNDBUF in bytes (default: the OS). */
+    public var sendBufferSize:uint = 0;
+
+    /** SO_RCVBUF in bytes (default: the OS), set before the TCP handshake so it can shape the receive window. */
+    public var receiveBufferSize:uint = 0;
+
+    /** Receive buffer a message is first read into, doubled as needed (default 1024 bytes). Native engine only. */
+    public var initialReceiveBufferSize:uint = 0;
+
+    /** Keepalive ping interval for this connection, see AndroidWebSocket.setKeepAlive. */
+    public var keepAliveIntervalMs:int = -1;
+
+    /** Largest message accepted; a bigger one closes the connection with 1009 (default: no limit). */
+    public var maxMessageSize:uint = 0;
+
+    public function WebSocketConnectOptions() {
+    }
+}
+}
@@ -0,0 +1,199 @@
+//
+//  Amf3Bench.cpp
+//  WebSocketANE
+//
+//  AMF3 indexing: what Amf3Index::build costs the network thread per message, and the size of the index it keeps
+//  next to the payload. Runs on the inbound binary messages of a capture (startCapture) when one is given, otherwise
+//  on generated payloads shaped like ours. The main-thread side, amf3Materialize against ByteArray.readObject, needs
+//  the AIR runtime and is measured from AS3.
+//
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Amf3.hpp"
+#include "Bench.hpp"
+
+namespace {
+    // Writes the subset of AMF3 the generated payloads use: anonymous dynamic objects, dense arrays, integers,
+    // doubles and strings, with the string reference table like ByteArray.writeObject
+    class Amf3Writer {
+    public:
+        std::vector<uint8_t> bytes;
+
+        void integer(int32_t value) {
+            bytes.push_back(0x04);
+            u29(static_cast<uint32_t>(value) & 0x1FFFFFFF);
+        }
+
+        void number(double value) {
+            bytes.push_back(0x05);
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            for (int shift = 56; shift >= 0; shift -= 8) {
+                bytes.push_back(static_cast<uint8_t>(bits >> shift));
+            }
+        }
+
+        void string(const std::string &value) {
+            bytes.push_back(0x06);
+            stringBody(value);
+        }
+
+        void beginArray(uint32_t count) {
+            bytes.push_back(0x09);
+            u29(count << 1 | 1);
+            bytes.push_back(0x01);
+        }
+
+        void beginObject() {
+            bytes.push_back(0x0A);
+            bytes.push_back(0x0B); // Dynamic, no sealed members
+            bytes.push_back(0x01); // Anonymous
+        }
+
+        // Followed by the member's value
+        void key(const std::string &name) { stringBody(name); }
+
+        void endObject() { bytes.push_back(0x01); }
+
+    private:
+        void u29(uint32_t value) {
+            if (value < 0x80) {
+                bytes.push_back(static_cast<uint8_t>(value));
+            } else if (value < 0x4000) {
+                bytes.push_back(static_cast<uint8_t>(value >> 7 | 0x80));
+                bytes.push_back(static_cast<uint8_t>(value & 0x7F));
+            } else if (value < 0x200000) {
+                bytes.push_back(static_cast<uint8_t>(value >> 14 | 0x80));
+                bytes.push_back(static_cast<uint8_t>(value >> 7 | 0x80));
+                bytes.push_back(static_cast<uint8_t>(value & 0x7F));
+            } else {
+                bytes.push_back(static_cast<uint8_t>(value >> 22 | 0x80));
+                bytes.push_back(static_cast<uint8_t>(value >> 15 | 0x80));
+                bytes.push_back(static_cast<uint8_t>(value >> 8 | 0x80));
+                bytes.push_back(static_cast<uint8_t>(value));
+            }
+        }
+
+        void stringBody(const std::string &value) {
+            for (size_t i = 0; i < m_strings.size() && !value.empty(); i++) {
+                if (m_strings[i] == value) {
+                    u29(static_cast<uint32_t>(i) << 1);
+                    return;
+                }
+            }
+            u29(static_cast<uint32_t>(value.size()) << 1 | 1);
+            bytes.insert(bytes.end(), value.begin(), value.end());
+            if (!value.empty()) {
+                m_strings.push_back(value);
+            }
+        }
+
+        std::vector<std::string> m_strings;
+    };
+
+    void writeTick(Amf3Writer &writer, int i) {
+        writer.beginObject();
+        writer.key("type");
+        writer.string("tick");
+        writer.key("symbol");
+        writer.string("SYM" + std::to_string(i % 50));
+        writer.key("price");
+        writer.number(100.25 + i * 0.01);
+        writer.key("quantity");
+        writer.integer(i % 1000);
+        writer.key("time");
+        writer.number(1.7e12 + i);
+        writer.endObject();
+    }
+
+    std::vector<uint8_t> tick() {
+        Amf3Writer writer;
+        writeTick(writer, 7);
+        return writer.bytes;
+    }
+
+    std::vector<uint8_t> textHeavy(int count) {
+        Amf3Writer writer;
+        writer.beginArray(count);
+        for (int i = 0; i < count; i++) {
+            writer.beginObject();
+            writer.key("id");
+            writer.integer(i);
+            writer.key("author");
+            writer.string("player" + std::to_string(i % 200));
+            writer.key("text");
+            writer.string("message " + std::to_string(i) + std::string(120, 'x'));
+            writer.endObject();
+        }
+        return writer.bytes;
+    }
+
+    void measure(const char *name, const std::vector<std::vector<uint8_t>> &messages) {
+        size_t bytes = 0;
+        for (const auto &message: messages) {
+            bytes += message.size();
+        }
+        // Repeat the set until about 256 MB have been indexed
+        size_t rounds = std::max<size_t>(1, (size_t{256} << 20) / std::max<size_t>(1, bytes));
+        size_t nodes = 0;
+        size_t failed = 0;
+        for (const auto &message: messages) {
+            auto index = Amf3Index::build(message.data(), message.size());
+            if (index) {
+                nodes += index->nodes().size();
+            } else {
+                failed++;
+            }
+        }
+
+        uint64_t allocations = benchAllocations.load(std::memory_order_relaxed);
+        uint64_t started = benchNow();
+        for (size_t round = 0; round < rounds; round++) {
+            for (const auto &message: messages) {
+                benchKeep(Amf3Index::build(message.data(), message.size()) != nullptr);
+            }
+        }
+        double seconds = (benchNow() - started) / 1e9;
+        double count = static_cast<double>(rounds * messages.size());
+        std::printf("%-30s %7zu msgs %9.0f B avg  %8.0f MB/s %9.2f us/msg %6.1f allocs/msg  index %4.2fx payload%s\n",
+                    name, messages.size(), static_cast<double>(bytes) / messages.size(), rounds * bytes / seconds / 1e6,
+                    seconds * 1e6 / count, (benchAllocations.load(std::memory_order_relaxed) - allocations) / count,
+                    static_cast<double>(nodes * sizeof(Amf3Node)) / bytes,
+                    failed > 0 ? (" (" + std::to_string(failed) + " not indexable)").c_str() : "");
+    }
+}
+
+std::vector<uint8_t> benchAmf3Snapshot(int ticks) {
+    Amf3Writer writer;
+    writer.beginObject();
+    writer.key("type");
+    writer.string("snapshot");
+    writer.key("ticks");
+    writer.beginArray(ticks);
+    for (int i = 0; i < ticks; i++) {
+        writeTick(writer, i);
+    }
+    writer.endObject();
+    return writer.bytes;
+}
+
+int runAmf3Bench(const char *capturePath) {
+    if (capturePath != nullptr) {
+        std::vector<std::vector<uint8_t>> messages;
+        if (!benchReadCapture(capturePath, false, messages) || messages.empty()) {
+            std::printf("no inbound binary messages in %s\n", capturePath);
+            return 1;
+        }
+        measure(capturePath, messages);
+        return 0;
+    }
+
+    measure("tick object", {tick()});
+    measure("snapshot of 100 ticks", {benchAmf3Snapshot(100)});
+    measure("snapshot of 10000 ticks", {benchAmf3Snapshot(10000)});
+    measure("1000 chat lines", {textHeavy(1000)});
+    return 0;
+}
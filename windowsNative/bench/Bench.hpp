@@ -0,0 +1,51 @@
+//
+//  Bench.hpp
+//  WebSocketANE
+//
+
+#ifndef Bench_hpp
+#define Bench_hpp
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Heap allocations made so far by the process, counted by the operator new replacement in main.cpp
+extern std::atomic<uint64_t> benchAllocations;
+
+inline uint64_t benchNow() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Keeps the optimizer from dropping work whose result is otherwise unused
+inline void benchKeep(uint64_t value) {
+    static volatile uint64_t sink;
+    sink = sink + value;
+}
+
+// Appends the inbound records of a capture file (startCapture, see MessageCapture.hpp for the layout) to messages:
+// the text ones when text is set, the binary ones otherwise. False when path is not a capture
+bool benchReadCapture(const char *path, bool text, std::vector<std::vector<uint8_t>> &messages);
+
+// AMF3 object {type: "snapshot", ticks: [..]} holding the given number of tick objects, about 34 bytes each
+std::vector<uint8_t> benchAmf3Snapshot(int ticks);
+
+int runMessageQueueBench();
+
+// capturePath may be null
+int runAmf3Bench(const char *capturePath);
+
+// capturePath may be null
+int runJsonBench(const char *capturePath);
+
+// maxThreads 0 goes up to the hardware's thread count
+int runDecodePoolBench(size_t maxThreads);
+
+int runDeltaDecoderBench();
+
+int runTraceBench();
+
+#endif /* Bench_hpp */
@@ -0,0 +1,88 @@
+//
+//  DecodePoolBench.cpp
+//  WebSocketANE
+//
+//  Decode pool scaling: AMF3 indexing jobs for a burst of messages run inline on one thread, as the engine thread did
+//  before the pool, then on DecodePool with 1, 2, 4 .. threads up to the hardware's. Prints throughput, speedup over
+//  inline, steals and the time jobs waited in the pool's queues.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include "Amf3.hpp"
+#include "Bench.hpp"
+#include "DecodePool.hpp"
+
+namespace {
+    struct Workload {
+        const char *name;
+        std::vector<uint8_t> payload;
+        size_t jobs;
+    };
+
+    // Value of "field" in the first object after "after" in a stats JSON, or -1
+    long long jsonNumber(const std::string &json, const char *after, const char *field) {
+        size_t position = json.find(after);
+        if (position == std::string::npos || (position = json.find(std::string("\"") + field + "\":", position)) == std::string::npos) {
+            return -1;
+        }
+        return std::atoll(json.c_str() + position + std::strlen(field) + 3);
+    }
+
+    double runInline(const Workload &workload) {
+        uint64_t started = benchNow();
+        for (size_t i = 0; i < workload.jobs; i++) {
+            benchKeep(Amf3Index::build(workload.payload.data(), workload.payload.size()) != nullptr);
+        }
+        return workload.jobs / ((benchNow() - started) / 1e9);
+    }
+
+    double runPool(const Workload &workload, size_t threads, std::string &stats) {
+        DecodePool pool(threads);
+        std::atomic<size_t> done{0};
+        uint64_t started = benchNow();
+        for (size_t i = 0; i < workload.jobs; i++) {
+            pool.submit(DecodeStage::Amf3Index, [&]() {
+                benchKeep(Amf3Index::build(workload.payload.data(), workload.payload.size()) != nullptr);
+                done.fetch_add(1, std::memory_order_release);
+            });
+        }
+        while (done.load(std::memory_order_acquire) < workload.jobs) {
+            std::this_thread::yield();
+        }
+        double rate = workload.jobs / ((benchNow() - started) / 1e9);
+        stats = pool.statsJson();
+        return rate;
+    }
+}
+
+int runDecodePoolBench(size_t maxThreads) {
+    if (maxThreads == 0) {
+        maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+    Workload workloads[] = {
+            {"3.6 KB snapshots", benchAmf3Snapshot(100), 20000},
+            {"339 KB snapshots", benchAmf3Snapshot(10000), 400},
+    };
+    for (const auto &workload: workloads) {
+        runInline(workload);
+        double inlineRate = runInline(workload);
+        std::printf("%s, %zu jobs: inline %.0f jobs/s\n", workload.name, workload.jobs, inlineRate);
+        for (size_t threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+            std::string stats;
+            double rate = runPool(workload, threads, stats);
+            std::printf("  %3zu threads %10.0f jobs/s %5.2fx  steals %6lld  queued p50 %7lld us p99 %7lld us\n", threads, rate,
+                        rate / inlineRate, jsonNumber(stats, "\"steals\"", "steals"),
+                        jsonNumber(stats, "\"amf3Index\":{\"queued\"", "p50"), jsonNumber(stats, "\"amf3Index\":{\"queued\"", "p99"));
+            if (threads == maxThreads) {
+                break;
+            }
+        }
+    }
+    return 0;
+}
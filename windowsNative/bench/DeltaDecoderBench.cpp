@@ -0,0 +1,188 @@
+//
+//  DeltaDecoderBench.cpp
+//  WebSocketANE
+//
+//  Delta decoding: a server updating each of 100 keys 50 times, with a few small edits per update, sent as full
+//  snapshots to a shim without delta decoding (the normal receive copy), as snapshots through DeltaDecoder, and as
+//  copy/insert deltas through DeltaDecoder. Prints bytes on the wire, reconstruction time and the memory the decoder
+//  keeps for its bases.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include "Bench.hpp"
+#include "DeltaDecoder.hpp"
+
+namespace {
+    constexpr int Keys = 100;
+    constexpr int Rounds = 50;
+    constexpr int Edits = 8;
+    constexpr size_t EditLength = 16;
+
+    void writeVarint(std::vector<uint8_t> &out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    void writeHeader(std::vector<uint8_t> &out, uint8_t kind, const std::string &key) {
+        out.push_back(kind);
+        out.push_back(static_cast<uint8_t>(key.size()));
+        out.insert(out.end(), key.begin(), key.end());
+    }
+
+    std::vector<uint8_t> snapshot(const std::string &key, const std::vector<uint8_t> &payload) {
+        std::vector<uint8_t> out;
+        writeHeader(out, 0, key);
+        out.insert(out.end(), payload.begin(), payload.end());
+        return out;
+    }
+
+    // Copies everything but the edited ranges from the base and inserts the edited bytes; starts must be sorted
+    std::vector<uint8_t> delta(const std::string &key, const std::vector<uint8_t> &target, const std::vector<size_t> &starts) {
+        std::vector<uint8_t> out;
+        writeHeader(out, 1, key);
+        writeVarint(out, target.size());
+        writeVarint(out, target.size());
+        size_t position = 0;
+        for (size_t start: starts) {
+            if (start < position) {
+                start = position;
+            }
+            size_t end = std::min(target.size(), start + EditLength);
+            if (start >= end) {
+                continue;
+            }
+            if (start > position) {
+                out.push_back(0x01);
+                writeVarint(out, position);
+                writeVarint(out, start - position);
+            }
+            out.push_back(0x02);
+            writeVarint(out, end - start);
+            out.insert(out.end(), target.begin() + start, target.begin() + end);
+            position = end;
+        }
+        if (position < target.size()) {
+            out.push_back(0x01);
+            writeVarint(out, position);
+            writeVarint(out, target.size() - position);
+        }
+        return out;
+    }
+
+    struct Stream {
+        std::vector<std::vector<uint8_t>> snapshots;
+        std::vector<std::vector<uint8_t>> deltas; // First round as snapshots
+        size_t payloadBytes = 0;
+    };
+
+    Stream generate(size_t payloadSize) {
+        std::mt19937 random(45);
+        std::uniform_int_distribution<size_t> position(0, payloadSize - 1);
+        std::uniform_int_distribution<int> byte(0, 255);
+        Stream stream;
+        std::vector<std::vector<uint8_t>> payloads(Keys, std::vector<uint8_t>(payloadSize));
+        for (int round = 0; round < Rounds; round++) {
+            for (int k = 0; k < Keys; k++) {
+                std::string key = "book." + std::to_string(k);
+                auto &payload = payloads[k];
+                std::vector<size_t> starts;
+                if (round == 0) {
+                    for (auto &b: payload) {
+                        b = static_cast<uint8_t>(byte(random));
+                    }
+                } else {
+                    for (int e = 0; e < Edits; e++) {
+                        starts.push_back(position(random));
+                    }
+                    std::sort(starts.begin(), starts.end());
+                    for (size_t start: starts) {
+                        for (size_t i = start; i < std::min(payloadSize, start + EditLength); i++) {
+                            payload[i] = static_cast<uint8_t>(byte(random));
+                        }
+                    }
+                }
+                stream.snapshots.push_back(snapshot(key, payload));
+                stream.deltas.push_back(round == 0 ? snapshot(key, payload) : delta(key, payload, starts));
+                stream.payloadBytes += payload.size();
+            }
+        }
+        return stream;
+    }
+
+    size_t wireBytes(const std::vector<std::vector<uint8_t>> &messages) {
+        size_t bytes = 0;
+        for (const auto &message: messages) {
+            bytes += message.size();
+        }
+        return bytes;
+    }
+
+    void report(const char *name, const Stream &stream, const std::vector<std::vector<uint8_t>> &messages, uint64_t elapsed,
+                uint64_t allocations, size_t storedBytes) {
+        double count = static_cast<double>(messages.size());
+        std::printf("  %-26s %8.0f B/msg on the wire %8.2f us/msg %7.0f MB/s rebuilt %6.2f allocs/msg  bases %6.1f MB\n",
+                    name, wireBytes(messages) / count, elapsed / 1e3 / count, stream.payloadBytes / (elapsed / 1e9) / 1e6,
+                    allocations / count, storedBytes / 1e6);
+    }
+
+    // Receive copy only, as the shim does with delta decoding off
+    void runPlain(const Stream &stream) {
+        uint64_t allocations = benchAllocations.load(std::memory_order_relaxed);
+        uint64_t started = benchNow();
+        for (const auto &message: stream.snapshots) {
+            size_t header = 2 + message[1];
+            WebSocketMessage output(message.data() + header, message.size() - header);
+            benchKeep(output.data()[output.size() / 2]);
+        }
+        report("snapshots, decoding off", stream, stream.snapshots, benchNow() - started,
+               benchAllocations.load(std::memory_order_relaxed) - allocations, 0);
+    }
+
+    // name null runs without printing
+    void runDecoder(const char *name, const Stream &stream, const std::vector<std::vector<uint8_t>> &messages) {
+        DeltaDecoder decoder;
+        decoder.configure(size_t{1} << 30);
+        std::string key;
+        const char *error = nullptr;
+        uint64_t allocations = benchAllocations.load(std::memory_order_relaxed);
+        uint64_t started = benchNow();
+        for (const auto &message: messages) {
+            WebSocketMessage output;
+            if (!decoder.apply(message.data(), message.size(), output, key, error)) {
+                std::printf("  %s: %s for %s\n", name ? name : "warm-up", error, key.c_str());
+                return;
+            }
+            benchKeep(output.data()[output.size() / 2]);
+        }
+        uint64_t elapsed = benchNow() - started;
+        if (name == nullptr) {
+            return;
+        }
+        uint64_t allocated = benchAllocations.load(std::memory_order_relaxed) - allocations;
+        std::string stats = decoder.statsJson();
+        size_t position = stats.find("\"storedBytes\":");
+        size_t stored = position == std::string::npos ? 0 : std::strtoull(stats.c_str() + position + 14, nullptr, 10);
+        report(name, stream, messages, elapsed, allocated, stored);
+    }
+}
+
+int runDeltaDecoderBench() {
+    for (size_t payloadSize: {size_t{4} * 1024, size_t{64} * 1024}) {
+        Stream stream = generate(payloadSize);
+        std::printf("%d keys x %d updates of %zu KB, %d edits of %zu B per update\n", Keys, Rounds, payloadSize / 1024,
+                    Edits, EditLength);
+        // Untimed run first, so the allocator has warmed up for every measured one
+        runDecoder(nullptr, stream, stream.deltas);
+        runPlain(stream);
+        runDecoder("snapshots through decoder", stream, stream.snapshots);
+        runDecoder("deltas through decoder", stream, stream.deltas);
+    }
+    return 0;
+}
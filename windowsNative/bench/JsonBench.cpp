@@ -0,0 +1,113 @@
+//
+//  JsonBench.cpp
+//  WebSocketANE
+//
+//  JSON indexing: what JsonIndex::build costs the network thread per text message, the size of the tape it keeps
+//  next to the payload, and a path lookup on the built index. Runs on the inbound text messages of a capture
+//  (startCapture) when one is given, otherwise on generated payloads shaped like ours. The main-thread side,
+//  jsonMaterialize against AS3 JSON.parse, needs the AIR runtime and is measured from AS3.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "Bench.hpp"
+#include "Json.hpp"
+
+namespace {
+    std::string tick(int i) {
+        char buffer[160];
+        std::snprintf(buffer, sizeof(buffer), R"({"type":"tick","symbol":"SYM%d","price":%.2f,"quantity":%d,"time":%.0f})",
+                      i % 50, 100.25 + i * 0.01, i % 1000, 1.7e12 + i);
+        return buffer;
+    }
+
+    std::vector<uint8_t> bytes(const std::string &text) {
+        return {text.begin(), text.end()};
+    }
+
+    std::vector<uint8_t> snapshot(int ticks) {
+        std::string text = R"({"type":"snapshot","ticks":[)";
+        for (int i = 0; i < ticks; i++) {
+            text += (i > 0 ? "," : "") + tick(i);
+        }
+        return bytes(text + "]}");
+    }
+
+    // Chat lines with escaped quotes and non-ASCII text, so string validation carries most of the work
+    std::vector<uint8_t> textHeavy(int count) {
+        std::string text = "[";
+        for (int i = 0; i < count; i++) {
+            text += (i > 0 ? "," : "") + std::string(R"({"id":)") + std::to_string(i) + R"(,"author":"player)" +
+                    std::to_string(i % 200) + R"(","text":"message )" + std::to_string(i) +
+                    R"( \"quoted\" naïve café )" + std::string(100, 'x') + "\"}";
+        }
+        return bytes(text + "]");
+    }
+
+    void measure(const char *name, const std::vector<std::vector<uint8_t>> &messages, const char *path) {
+        size_t bytes = 0;
+        for (const auto &message: messages) {
+            bytes += message.size();
+        }
+        // Repeat the set until about 256 MB have been indexed
+        size_t rounds = std::max<size_t>(1, (size_t{256} << 20) / std::max<size_t>(1, bytes));
+        size_t nodes = 0;
+        size_t failed = 0;
+        std::vector<std::shared_ptr<const JsonIndex>> indexes;
+        for (const auto &message: messages) {
+            auto index = JsonIndex::build(message.data(), message.size());
+            if (index) {
+                nodes += index->nodes().size();
+            } else {
+                failed++;
+            }
+            indexes.push_back(std::move(index));
+        }
+
+        uint64_t allocations = benchAllocations.load(std::memory_order_relaxed);
+        uint64_t started = benchNow();
+        for (size_t round = 0; round < rounds; round++) {
+            for (const auto &message: messages) {
+                benchKeep(JsonIndex::build(message.data(), message.size()) != nullptr);
+            }
+        }
+        double seconds = (benchNow() - started) / 1e9;
+        double count = static_cast<double>(rounds * messages.size());
+        std::printf("%-30s %7zu msgs %9.0f B avg  %8.0f MB/s %9.2f us/msg %6.1f allocs/msg  index %4.2fx payload%s\n",
+                    name, messages.size(), static_cast<double>(bytes) / messages.size(), rounds * bytes / seconds / 1e6,
+                    seconds * 1e6 / count, (benchAllocations.load(std::memory_order_relaxed) - allocations) / count,
+                    static_cast<double>(nodes * sizeof(JsonNode)) / bytes,
+                    failed > 0 ? (" (" + std::to_string(failed) + " not valid JSON)").c_str() : "");
+
+        if (path == nullptr || indexes.empty() || !indexes[0]) {
+            return;
+        }
+        const std::string lookup = path;
+        size_t lookups = std::max<size_t>(1000, rounds * 100);
+        started = benchNow();
+        for (size_t i = 0; i < lookups; i++) {
+            benchKeep(static_cast<uint64_t>(indexes[0]->find(messages[0].data(), lookup)));
+        }
+        std::printf("%-30s find(\"%s\") %.0f ns\n", "", path, static_cast<double>(benchNow() - started) / lookups);
+    }
+}
+
+int runJsonBench(const char *capturePath) {
+    if (capturePath != nullptr) {
+        std::vector<std::vector<uint8_t>> messages;
+        if (!benchReadCapture(capturePath, true, messages) || messages.empty()) {
+            std::printf("no inbound text messages in %s\n", capturePath);
+            return 1;
+        }
+        measure(capturePath, messages, nullptr);
+        return 0;
+    }
+
+    measure("tick object", {bytes(tick(7))}, "price");
+    measure("snapshot of 100 ticks", {snapshot(100)}, "ticks.99.price");
+    measure("snapshot of 10000 ticks", {snapshot(10000)}, "ticks.9999.price");
+    measure("1000 chat lines", {textHeavy(1000)}, "999.text");
+    return 0;
+}
@@ -0,0 +1,139 @@
+//
+//  MessageQueueBench.cpp
+//  WebSocketANE
+//
+//  Receive queue: the std::queue<std::vector<uint8_t>> the shim used before, against WebSocketMessageQueue. Each
+//  message is copied in from an engine-owned buffer, as the data callback does, and drained in bursts with its bytes
+//  read, as readMessage does, across message size distributions.
+//
+
+#include <cstdio>
+#include <queue>
+#include <random>
+#include <vector>
+#include "Bench.hpp"
+#include "WebSocketMessage.hpp"
+
+namespace {
+    struct Distribution {
+        const char *name;
+        // Fills sizes with count message sizes
+        void (*generate)(std::mt19937 &random, std::vector<size_t> &sizes, size_t count);
+    };
+
+    void fixedSize(std::vector<size_t> &sizes, size_t count, size_t size) {
+        sizes.assign(count, size);
+    }
+
+    const Distribution distributions[] = {
+            {"64 B", [](std::mt19937 &, std::vector<size_t> &sizes, size_t count) { fixedSize(sizes, count, 64); }},
+            {"mixed: 90% 16-256 B, 9% 1-4 KB, 1% 64 KB", [](std::mt19937 &random, std::vector<size_t> &sizes, size_t count) {
+                std::uniform_int_distribution<int> bucket(0, 99);
+                std::uniform_int_distribution<size_t> small(16, 256);
+                std::uniform_int_distribution<size_t> medium(1024, 4096);
+                sizes.resize(count);
+                for (auto &size: sizes) {
+                    int b = bucket(random);
+                    size = b < 90 ? small(random) : b < 99 ? medium(random) : 64 * 1024;
+                }
+            }},
+            {"1 KB", [](std::mt19937 &, std::vector<size_t> &sizes, size_t count) { fixedSize(sizes, count, 1024); }},
+            {"16 KB", [](std::mt19937 &, std::vector<size_t> &sizes, size_t count) { fixedSize(sizes, count, 16 * 1024); }},
+    };
+
+    struct Result {
+        double nanosPerMessage;
+        double allocationsPerMessage;
+    };
+
+    template<typename Push, typename Drain>
+    Result measure(const std::vector<size_t> &sizes, size_t burst, Push push, Drain drain) {
+        static std::vector<uint8_t> source(64 * 1024, 0x5a);
+        uint64_t allocations = benchAllocations.load(std::memory_order_relaxed);
+        uint64_t started = benchNow();
+        for (size_t i = 0; i < sizes.size(); i += burst) {
+            size_t end = std::min(sizes.size(), i + burst);
+            for (size_t j = i; j < end; j++) {
+                push(source.data(), sizes[j]);
+            }
+            drain();
+        }
+        uint64_t elapsed = benchNow() - started;
+        return Result{static_cast<double>(elapsed) / sizes.size(),
+                      static_cast<double>(benchAllocations.load(std::memory_order_relaxed) - allocations) / sizes.size()};
+    }
+
+    Result runVectorQueue(const std::vector<size_t> &sizes, size_t burst) {
+        std::queue<std::vector<uint8_t>> queue;
+        return measure(sizes, burst, [&](const uint8_t *data, size_t length) {
+            queue.emplace(data, data + length);
+        }, [&]() {
+            uint64_t sum = 0;
+            while (!queue.empty()) {
+                auto &message = queue.front();
+                sum += message.size() + message[message.size() / 2];
+                queue.pop();
+            }
+            benchKeep(sum);
+        });
+    }
+
+    Result runMessageQueue(const std::vector<size_t> &sizes, size_t burst) {
+        WebSocketMessageQueue queue;
+        return measure(sizes, burst, [&](const uint8_t *data, size_t length) {
+            queue.push_back(WebSocketMessage(data, length));
+        }, [&]() {
+            uint64_t sum = 0;
+            while (!queue.empty()) {
+                auto &message = queue.front();
+                sum += message.size() + message.data()[message.size() / 2];
+                queue.pop_front();
+            }
+            benchKeep(sum);
+        });
+    }
+}
+
+int runMessageQueueBench() {
+    std::printf("%-42s %6s  %28s  %28s\n", "sizes", "burst", "std::queue<std::vector>", "WebSocketMessageQueue");
+    for (const auto &distribution: distributions) {
+        std::mt19937 random(31);
+        std::vector<size_t> sizes;
+        distribution.generate(random, sizes, 1000);
+        size_t total = 0;
+        for (size_t size: sizes) {
+            total += size;
+        }
+        // About 1 GB copied per run, at least 100k messages
+        size_t count = std::max<size_t>(100000, (size_t{1} << 30) / (total / sizes.size()));
+        distribution.generate(random, sizes, count);
+
+        for (size_t burst: {size_t{32}, size_t{4096}}) {
+            // Untimed pass first so page faults of the first touch land in neither column
+            runVectorQueue(sizes, burst);
+            runMessageQueue(sizes, burst);
+            Result before = runVectorQueue(sizes, burst);
+            Result after = runMessageQueue(sizes, burst);
+            std::printf("%-42s %6zu  %9.1f ns %6.3f allocs/msg  %9.1f ns %6.3f allocs/msg\n", distribution.name, burst,
+                        before.nanosPerMessage, before.allocationsPerMessage, after.nanosPerMessage, after.allocationsPerMessage);
+        }
+    }
+
+    // What a one-off burst leaves behind: the ring keeps its size through the drain that follows the burst and is cut
+    // back at the next one, once messages are read as they come
+    WebSocketMessageQueue queue;
+    const uint8_t payload[64] = {};
+    for (int i = 0; i < 4096; i++) {
+        queue.push_back(WebSocketMessage(payload, sizeof(payload)));
+    }
+    size_t peak = queue.capacity();
+    while (!queue.empty()) {
+        queue.pop_front();
+    }
+    queue.push_back(WebSocketMessage(payload, sizeof(payload)));
+    queue.pop_front();
+    std::printf("WebSocketMessageQueue ring: %zu slots (%zu KB) after a 4096-message burst, %zu slots (%zu KB) once back to "
+                "single messages\n", peak, peak * sizeof(WebSocketMessage) / 1024, queue.capacity(),
+                queue.capacity() * sizeof(WebSocketMessage) / 1024);
+    return 0;
+}
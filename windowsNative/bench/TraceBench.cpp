@@ -0,0 +1,71 @@
+//
+//  TraceBench.cpp
+//  WebSocketANE
+//
+//  Tracing overhead: the cost of one TRACE_SCOPE around a trivial body, net of the same loop without it, next to the
+//  clock read it makes twice, and how long traceDump takes over a full ring. Spans only exist when
+//  WEBSOCKET_ANE_TRACING is defined, so a default build times the disabled span and a -DWEBSOCKET_ANE_TRACING=ON build
+//  the enabled one; the engine is not loaded, so the dump holds the shim's spans only.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include "Bench.hpp"
+#include "Trace.hpp"
+
+namespace {
+    constexpr uint64_t Spans = 20000000;
+
+    // A span reads the clock twice, which on some machines is most of its cost
+    double clockNs() {
+        uint64_t started = benchNow();
+        for (uint64_t i = 0; i < Spans; i++) {
+            benchKeep(benchNow());
+        }
+        return static_cast<double>(benchNow() - started) / Spans;
+    }
+
+    double loopNs(bool traced) {
+        // Best of five, so a preemption on a busy machine does not land in the result
+        double best = 1e9;
+        for (int attempt = 0; attempt < 5; attempt++) {
+            uint64_t started = benchNow();
+            if (traced) {
+                for (uint64_t i = 0; i < Spans; i++) {
+                    TRACE_SCOPE("bench.span");
+                    benchKeep(i);
+                }
+            } else {
+                for (uint64_t i = 0; i < Spans; i++) {
+                    benchKeep(i);
+                }
+            }
+            best = std::min(best, static_cast<double>(benchNow() - started) / Spans);
+        }
+        return best;
+    }
+}
+
+int runTraceBench() {
+    double baseline = loopNs(false);
+    double traced = loopNs(true);
+#ifdef WEBSOCKET_ANE_TRACING
+    const char *mode = "enabled";
+#else
+    const char *mode = "disabled (compiled out)";
+#endif
+    std::printf("%-30s %7.1f ns/span (loop %.1f ns, with span %.1f ns)\n", mode, std::max(0.0, traced - baseline),
+                baseline, traced);
+    std::printf("%-30s %7.1f ns\n", "steady_clock read", clockNs());
+
+#ifdef WEBSOCKET_ANE_TRACING
+    // The loops above filled this thread's ring
+    uint64_t allocations = benchAllocations.load(std::memory_order_relaxed);
+    uint64_t started = benchNow();
+    std::string json = traceDump();
+    std::printf("%-30s %7.2f ms for %llu spans, %zu KB of JSON, %llu allocs\n", "traceDump", (benchNow() - started) / 1e6,
+                static_cast<unsigned long long>(TraceRing::Capacity), json.size() / 1024,
+                static_cast<unsigned long long>(benchAllocations.load(std::memory_order_relaxed) - allocations));
+#endif
+    return 0;
+}
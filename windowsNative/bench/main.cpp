@@ -0,0 +1,97 @@
+//
+//  main.cpp
+//  WebSocketANE
+//
+//  Micro-benchmarks of the shim's parts that do not call into the AIR runtime or the engine, so they run without
+//  either: AneWebSocketBench <name>. Build with -DWEBSOCKET_ANE_BENCHMARKS=ON in Release.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include "Bench.hpp"
+#ifdef WEBSOCKET_ANE_TRACING
+#include "WebSocketNativeLibrary.h"
+#endif
+
+std::atomic<uint64_t> benchAllocations{0};
+
+void *operator new(size_t size) {
+    benchAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+    std::free(memory);
+}
+
+#ifdef WEBSOCKET_ANE_TRACING
+// traceDump asks the engine for its spans too; the benchmark runs without the engine, so there are none
+int __cdecl csharpWebSocketLibrary_getTraceEvents(double nowMicros, char *buffer, int bufferLength) {
+    return 0;
+}
+#endif
+
+bool benchReadCapture(const char *path, bool text, std::vector<std::vector<uint8_t>> &messages) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    constexpr size_t FileHeaderSize = 40;
+    constexpr size_t RecordHeaderSize = 16;
+    if (bytes.size() < FileHeaderSize || std::memcmp(bytes.data(), "WSANECAP", 8) != 0) {
+        return false;
+    }
+    uint32_t headerSize;
+    uint64_t dataEnd;
+    std::memcpy(&headerSize, bytes.data() + 12, sizeof(headerSize));
+    std::memcpy(&dataEnd, bytes.data() + 32, sizeof(dataEnd));
+    size_t position = headerSize;
+    while (position + RecordHeaderSize <= std::min<size_t>(dataEnd, bytes.size())) {
+        uint32_t length;
+        std::memcpy(&length, bytes.data() + position + 8, sizeof(length));
+        uint8_t direction = bytes[position + 12];
+        uint8_t flags = bytes[position + 13];
+        const uint8_t *payload = bytes.data() + position + RecordHeaderSize;
+        if (position + RecordHeaderSize + length > bytes.size()) {
+            break;
+        }
+        if (direction == 0 && ((flags & 1) != 0) == text) {
+            messages.emplace_back(payload, payload + length);
+        }
+        position += (RecordHeaderSize + length + 7) & ~static_cast<size_t>(7);
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const char *name = argc > 1 ? argv[1] : "";
+    if (std::strcmp(name, "queue") == 0) {
+        return runMessageQueueBench();
+    }
+    if (std::strcmp(name, "amf3") == 0) {
+        return runAmf3Bench(argc > 2 ? argv[2] : nullptr);
+    }
+    if (std::strcmp(name, "json") == 0) {
+        return runJsonBench(argc > 2 ? argv[2] : nullptr);
+    }
+    if (std::strcmp(name, "pool") == 0) {
+        return runDecodePoolBench(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 0);
+    }
+    if (std::strcmp(name, "delta") == 0) {
+        return runDeltaDecoderBench();
+    }
+    if (std::strcmp(name, "trace") == 0) {
+        return runTraceBench();
+    }
+    std::printf("usage: AneWebSocketBench queue | amf3 [capture] | json [capture] | pool [max threads] | delta | trace\n");
+    return 1;
+}
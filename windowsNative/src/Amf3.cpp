@@ -0,0 +1,693 @@
+#include "Amf3.hpp"
+#include "Trace.hpp"
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+namespace {
+    constexpr int MaxDepth = 128;
+    constexpr uint32_t MaxU29 = 0x1FFFFFFF;
+    constexpr uint32_t MaxInlineLength = 0x0FFFFFFF;
+
+    enum Amf3Marker : uint8_t {
+        MarkerUndefined = 0x00,
+        MarkerNull = 0x01,
+        MarkerFalse = 0x02,
+        MarkerTrue = 0x03,
+        MarkerInteger = 0x04,
+        MarkerDouble = 0x05,
+        MarkerString = 0x06,
+        MarkerXmlDocument = 0x07,
+        MarkerDate = 0x08,
+        MarkerArray = 0x09,
+        MarkerObject = 0x0A,
+        MarkerXml = 0x0B,
+        MarkerByteArray = 0x0C
+    };
+
+    class Amf3Parser {
+    public:
+        Amf3Parser(const uint8_t *data, size_t length, std::vector<Amf3Node> &nodes)
+            : m_data(data), m_length(length), m_nodes(nodes) {
+        }
+
+        bool parse() {
+            return readValue(0) && m_position == m_length;
+        }
+
+    private:
+        struct Traits {
+            Amf3Range alias;
+            bool dynamic;
+            std::vector<Amf3Range> sealed;
+        };
+
+        bool readByte(uint8_t &value) {
+            if (m_position >= m_length) {
+                return false;
+            }
+            value = m_data[m_position++];
+            return true;
+        }
+
+        bool readU29(uint32_t &value) {
+            value = 0;
+            for (int i = 0; i < 4; i++) {
+                uint8_t byte;
+                if (!readByte(byte)) {
+                    return false;
+                }
+                if (i == 3) {
+                    value = (value << 8) | byte;
+                    return true;
+                }
+                value = (value << 7) | (byte & 0x7F);
+                if ((byte & 0x80) == 0) {
+                    return true;
+                }
+            }
+            return true;
+        }
+
+        bool readDouble(double &value) {
+            if (m_length - m_position < 8) {
+                return false;
+            }
+            uint64_t bits = 0;
+            for (int i = 0; i < 8; i++) {
+                bits = (bits << 8) | m_data[m_position++];
+            }
+            std::memcpy(&value, &bits, sizeof(value));
+            return true;
+        }
+
+        bool readBytes(uint32_t length, Amf3Range &range) {
+            if (m_length - m_position < length) {
+                return false;
+            }
+            range = {static_cast<uint32_t>(m_position), length};
+            m_position += length;
+            return true;
+        }
+
+        bool readString(Amf3Range &range) {
+            uint32_t header;
+            if (!readU29(header)) {
+                return false;
+            }
+            if ((header & 1) == 0) {
+                if ((header >> 1) >= m_strings.size()) {
+                    return false;
+                }
+                range = m_strings[header >> 1];
+                return true;
+            }
+            if (!readBytes(header >> 1, range)) {
+                return false;
+            }
+            // The empty string is never sent by reference
+            if (range.length > 0) {
+                m_strings.push_back(range);
+            }
+            return true;
+        }
+
+        // Reads a U29 that is either an object reference (pushed as a Reference node, returns true with inline
+        // false) or an inline value header
+        bool readObjectHeader(uint32_t &header, bool &isInline) {
+            if (!readU29(header)) {
+                return false;
+            }
+            isInline = (header & 1) != 0;
+            if (!isInline) {
+                if ((header >> 1) >= m_objects) {
+                    return false;
+                }
+                Amf3Node node{};
+                node.kind = Amf3Kind::Reference;
+                node.count = header >> 1;
+                m_nodes.push_back(node);
+            }
+            return true;
+        }
+
+        bool pushString(Amf3Kind kind) {
+            Amf3Node node{};
+            node.kind = kind;
+            if (!readString(node.range)) {
+                return false;
+            }
+            m_nodes.push_back(node);
+            return true;
+        }
+
+        // Member names are String nodes; the empty name ends associative and dynamic member lists
+        bool readMember() {
+            return pushString(Amf3Kind::String);
+        }
+
+        bool readValue(int depth) {
+            if (depth > MaxDepth) {
+                return false;
+            }
+
+            uint8_t marker;
+            if (!readByte(marker)) {
+                return false;
+            }
+
+            Amf3Node node{};
+            uint32_t header;
+            bool isInline;
+            switch (marker) {
+                case MarkerUndefined:
+                    node.kind = Amf3Kind::Undefined;
+                    m_nodes.push_back(node);
+                    return true;
+                case MarkerNull:
+                    node.kind = Amf3Kind::Null;
+                    m_nodes.push_back(node);
+                    return true;
+                case MarkerFalse:
+                    node.kind = Amf3Kind::False;
+                    m_nodes.push_back(node);
+                    return true;
+                case MarkerTrue:
+                    node.kind = Amf3Kind::True;
+                    m_nodes.push_back(node);
+                    return true;
+                case MarkerInteger: {
+                    uint32_t value;
+                    if (!readU29(value)) {
+                        return false;
+                    }
+                    // 29-bit two's complement
+                    node.kind = Amf3Kind::Integer;
+                    node.number = (value & 0x10000000) != 0
+                                      ? static_cast<double>(static_cast<int32_t>(value) - 0x20000000)
+                                      : static_cast<double>(value);
+                    m_nodes.push_back(node);
+                    return true;
+                }
+                case MarkerDouble:
+                    node.kind = Amf3Kind::Double;
+                    if (!readDouble(node.number)) {
+                        return false;
+                    }
+                    m_nodes.push_back(node);
+                    return true;
+                case MarkerString:
+                    return pushString(Amf3Kind::String);
+                case MarkerXmlDocument:
+                case MarkerXml:
+                case MarkerByteArray:
+                    if (!readObjectHeader(header, isInline)) {
+                        return false;
+                    }
+                    if (!isInline) {
+                        return true;
+                    }
+                    node.kind = marker == MarkerXmlDocument ? Amf3Kind::XmlDocument : marker == MarkerXml ? Amf3Kind::Xml : Amf3Kind::ByteArray;
+                    if (!readBytes(header >> 1, node.range)) {
+                        return false;
+                    }
+                    m_objects++;
+                    m_nodes.push_back(node);
+                    return true;
+                case MarkerDate:
+                    if (!readObjectHeader(header, isInline)) {
+                        return false;
+                    }
+                    if (!isInline) {
+                        return true;
+                    }
+                    node.kind = Amf3Kind::Date;
+                    if (!readDouble(node.number)) {
+                        return false;
+                    }
+                    m_objects++;
+                    m_nodes.push_back(node);
+                    return true;
+                case MarkerArray:
+                    if (!readObjectHeader(header, isInline)) {
+                        return false;
+                    }
+                    return !isInline || readArray(header >> 1, depth);
+                case MarkerObject:
+                    if (!readObjectHeader(header, isInline)) {
+                        return false;
+                    }
+                    return !isInline || readObject(header, depth);
+                default:
+                    // Vector, Dictionary and unknown markers
+                    return false;
+            }
+        }
+
+        bool readArray(uint32_t denseLength, int depth) {
+            // Every value takes at least one byte, which also bounds the loop below on hostile lengths
+            if (denseLength > m_length - m_position) {
+                return false;
+            }
+
+            size_t nodeIndex = m_nodes.size();
+            Amf3Node node{};
+            node.kind = Amf3Kind::Array;
+            node.count = denseLength;
+            m_nodes.push_back(node);
+            m_objects++;
+
+            uint32_t associative = 0;
+            while (true) {
+                size_t keyIndex = m_nodes.size();
+                if (!readMember()) {
+                    return false;
+                }
+                if (m_nodes[keyIndex].range.length == 0) {
+                    m_nodes.pop_back();
+                    break;
+                }
+                if (!readValue(depth + 1)) {
+                    return false;
+                }
+                associative++;
+            }
+            m_nodes[nodeIndex].associative = associative;
+
+            for (uint32_t i = 0; i < denseLength; i++) {
+                if (!readValue(depth + 1)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool readObject(uint32_t header, int depth) {
+            size_t nodeIndex = m_nodes.size();
+            Amf3Node node{};
+            node.kind = Amf3Kind::Object;
+            m_nodes.push_back(node);
+            m_objects++;
+
+            size_t traitsIndex;
+            if ((header & 2) == 0) {
+                traitsIndex = header >> 2;
+                if (traitsIndex >= m_traits.size()) {
+                    return false;
+                }
+            } else {
+                if ((header & 4) != 0) {
+                    // IExternalizable needs the AS3 class to read itself
+                    return false;
+                }
+                Traits traits;
+                traits.dynamic = (header & 8) != 0;
+                uint32_t sealedCount = header >> 4;
+                if (sealedCount > m_length - m_position || !readString(traits.alias)) {
+                    return false;
+                }
+                traits.sealed.resize(sealedCount);
+                for (auto &name : traits.sealed) {
+                    if (!readString(name)) {
+                        return false;
+                    }
+                }
+                traitsIndex = m_traits.size();
+                m_traits.push_back(std::move(traits));
+            }
+
+            // Copied out: nested objects may add traits and move the table
+            auto alias = m_traits[traitsIndex].alias;
+            auto dynamic = m_traits[traitsIndex].dynamic;
+            auto sealedCount = m_traits[traitsIndex].sealed.size();
+
+            uint32_t members = 0;
+            for (size_t i = 0; i < sealedCount; i++) {
+                Amf3Node key{};
+                key.kind = Amf3Kind::String;
+                key.range = m_traits[traitsIndex].sealed[i];
+                m_nodes.push_back(key);
+                if (!readValue(depth + 1)) {
+                    return false;
+                }
+                members++;
+            }
+
+            while (dynamic) {
+                size_t keyIndex = m_nodes.size();
+                if (!readMember()) {
+                    return false;
+                }
+                if (m_nodes[keyIndex].range.length == 0) {
+                    m_nodes.pop_back();
+                    break;
+                }
+                if (!readValue(depth + 1)) {
+                    return false;
+                }
+                members++;
+            }
+
+            m_nodes[nodeIndex].count = members;
+            m_nodes[nodeIndex].range = alias;
+            return true;
+        }
+
+        const uint8_t *m_data;
+        size_t m_length;
+        size_t m_position = 0;
+        std::vector<Amf3Node> &m_nodes;
+        std::vector<Amf3Range> m_strings;
+        std::vector<Traits> m_traits;
+        uint32_t m_objects = 0;
+    };
+
+    class Amf3Materializer {
+    public:
+        Amf3Materializer(const std::vector<Amf3Node> &nodes, const uint8_t *data) : m_nodes(nodes), m_data(data) {
+        }
+
+        FREObject next() {
+            const auto &node = m_nodes[m_next++];
+            FREObject result = nullptr;
+            FREObject argument = nullptr;
+            switch (node.kind) {
+                case Amf3Kind::Undefined:
+                case Amf3Kind::Null:
+                    return nullptr;
+                case Amf3Kind::False:
+                case Amf3Kind::True:
+                    FRENewObjectFromBool(node.kind == Amf3Kind::True, &result);
+                    return result;
+                case Amf3Kind::Integer:
+                    FRENewObjectFromInt32(static_cast<int32_t>(node.number), &result);
+                    return result;
+                case Amf3Kind::Double:
+                    FRENewObjectFromDouble(node.number, &result);
+                    return result;
+                case Amf3Kind::String:
+                    return newString(node.range);
+                case Amf3Kind::XmlDocument:
+                case Amf3Kind::Xml:
+                    argument = newString(node.range);
+                    FRENewObject(reinterpret_cast<const uint8_t *>(node.kind == Amf3Kind::Xml ? "XML" : "flash.xml.XMLDocument"),
+                                 1, &argument, &result, nullptr);
+                    m_objects.push_back(result);
+                    return result;
+                case Amf3Kind::Date:
+                    FRENewObjectFromDouble(node.number, &argument);
+                    FRENewObject(reinterpret_cast<const uint8_t *>("Date"), 1, &argument, &result, nullptr);
+                    m_objects.push_back(result);
+                    return result;
+                case Amf3Kind::ByteArray: {
+                    FREByteArray byteArray;
+                    byteArray.length = node.range.length;
+                    byteArray.bytes = const_cast<uint8_t *>(m_data + node.range.offset);
+                    FRENewByteArray(&byteArray, &result);
+                    m_objects.push_back(result);
+                    return result;
+                }
+                case Amf3Kind::Array:
+                    return nextArray(node);
+                case Amf3Kind::Object:
+                    return nextObject(node);
+                case Amf3Kind::Reference:
+                    return node.count < m_objects.size() ? m_objects[node.count] : nullptr;
+            }
+            return nullptr;
+        }
+
+    private:
+        // FRENewObjectFromUTF8 expects a NUL-terminated string, which a slice of the payload is not
+        FREObject newString(const Amf3Range &range) {
+            m_text.assign(reinterpret_cast<const char *>(m_data + range.offset), range.length);
+            FREObject result = nullptr;
+            FRENewObjectFromUTF8(range.length, reinterpret_cast<const uint8_t *>(m_text.c_str()), &result);
+            return result;
+        }
+
+        std::string nextKey() {
+            const auto &key = m_nodes[m_next++];
+            return std::string(reinterpret_cast<const char *>(m_data + key.range.offset), key.range.length);
+        }
+
+        FREObject nextArray(const Amf3Node &node) {
+            FREObject array = nullptr;
+            FRENewObject(reinterpret_cast<const uint8_t *>("Array"), 0, nullptr, &array, nullptr);
+            // Registered before the children so they can reference it
+            m_objects.push_back(array);
+            FRESetArrayLength(array, node.count);
+
+            for (uint32_t i = 0; i < node.associative; i++) {
+                auto key = nextKey();
+                FRESetObjectProperty(array, reinterpret_cast<const uint8_t *>(key.c_str()), next(), nullptr);
+            }
+            for (uint32_t i = 0; i < node.count; i++) {
+                FRESetArrayElementAt(array, i, next());
+            }
+            return array;
+        }
+
+        FREObject nextObject(const Amf3Node &node) {
+            FREObject object = nullptr;
+            if (node.range.length > 0) {
+                // Typed objects: works when the class alias is the class name, as with registerClassAlias(getQualifiedClassName(C), C)
+                std::string alias(reinterpret_cast<const char *>(m_data + node.range.offset), node.range.length);
+                if (FRENewObject(reinterpret_cast<const uint8_t *>(alias.c_str()), 0, nullptr, &object, nullptr) != FRE_OK) {
+                    object = nullptr;
+                }
+            }
+            if (object == nullptr) {
+                FRENewObject(reinterpret_cast<const uint8_t *>("Object"), 0, nullptr, &object, nullptr);
+            }
+            m_objects.push_back(object);
+
+            for (uint32_t i = 0; i < node.count; i++) {
+                auto key = nextKey();
+                FRESetObjectProperty(object, reinterpret_cast<const uint8_t *>(key.c_str()), next(), nullptr);
+            }
+            return object;
+        }
+
+        const std::vector<Amf3Node> &m_nodes;
+        const uint8_t *m_data;
+        size_t m_next = 0;
+        std::vector<FREObject> m_objects;
+        std::string m_text;
+    };
+
+    class Amf3Encoder {
+    public:
+        Amf3Encoder(FREObject keysProvider, std::vector<uint8_t> &output) : m_keysProvider(keysProvider), m_output(output) {
+        }
+
+        bool writeValue(FREObject value, int depth) {
+            // Also stops cycles, which plain FREObject handles cannot detect
+            if (depth > MaxDepth) {
+                return false;
+            }
+
+            FREObjectType type;
+            if (value == nullptr) {
+                type = FRE_TYPE_NULL;
+            } else if (FREGetObjectType(value, &type) != FRE_OK) {
+                return false;
+            }
+
+            switch (type) {
+                case FRE_TYPE_NULL:
+                    m_output.push_back(MarkerNull);
+                    return true;
+                case FRE_TYPE_BOOLEAN: {
+                    uint32_t flag;
+                    FREGetObjectAsBool(value, &flag);
+                    m_output.push_back(flag ? MarkerTrue : MarkerFalse);
+                    return true;
+                }
+                case FRE_TYPE_NUMBER: {
+                    double number;
+                    FREGetObjectAsDouble(value, &number);
+                    writeNumber(number);
+                    return true;
+                }
+                case FRE_TYPE_STRING: {
+                    uint32_t length;
+                    const uint8_t *text;
+                    if (FREGetObjectAsUTF8(value, &length, &text) != FRE_OK) {
+                        return false;
+                    }
+                    m_output.push_back(MarkerString);
+                    return writeString(text, length);
+                }
+                case FRE_TYPE_BYTEARRAY: {
+                    FREByteArray byteArray;
+                    if (FREAcquireByteArray(value, &byteArray) != FRE_OK) {
+                        return false;
+                    }
+                    bool written = byteArray.length <= MaxInlineLength;
+                    if (written) {
+                        m_output.push_back(MarkerByteArray);
+                        writeU29((byteArray.length << 1) | 1);
+                        m_output.insert(m_output.end(), byteArray.bytes, byteArray.bytes + byteArray.length);
+                    }
+                    FREReleaseByteArray(value);
+                    return written;
+                }
+                case FRE_TYPE_ARRAY:
+                    return writeArray(value, depth);
+                case FRE_TYPE_OBJECT:
+                    return writeObject(value, depth);
+                default:
+                    // Vector, BitmapData
+                    return false;
+            }
+        }
+
+    private:
+        bool dynamicKeys(FREObject value, FREObject &keys) {
+            keys = nullptr;
+            FREObjectType type;
+            return FRECallObjectMethod(m_keysProvider, reinterpret_cast<const uint8_t *>("amf3Keys"), 1, &value, &keys, nullptr) == FRE_OK &&
+                   keys != nullptr && FREGetObjectType(keys, &type) == FRE_OK && type == FRE_TYPE_ARRAY;
+        }
+
+        bool writeArray(FREObject value, int depth) {
+            FREObject keys;
+            uint32_t length;
+            if (!dynamicKeys(value, keys) || FREGetArrayLength(value, &length) != FRE_OK || length > MaxInlineLength) {
+                return false;
+            }
+
+            m_output.push_back(MarkerArray);
+            writeU29((length << 1) | 1);
+            writeString(nullptr, 0);
+            for (uint32_t i = 0; i < length; i++) {
+                FREObject element = nullptr;
+                if (FREGetArrayElementAt(value, i, &element) != FRE_OK || !writeValue(element, depth + 1)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool writeObject(FREObject value, int depth) {
+            FREObject keys;
+            uint32_t count;
+            if (!dynamicKeys(value, keys) || FREGetArrayLength(keys, &count) != FRE_OK) {
+                return false;
+            }
+
+            // Anonymous dynamic object with inline traits and no sealed members
+            m_output.push_back(MarkerObject);
+            writeU29(0x0B);
+            writeString(nullptr, 0);
+            for (uint32_t i = 0; i < count; i++) {
+                FREObject key = nullptr;
+                uint32_t keyLength;
+                const uint8_t *keyText;
+                if (FREGetArrayElementAt(keys, i, &key) != FRE_OK || FREGetObjectAsUTF8(key, &keyLength, &keyText) != FRE_OK ||
+                    keyLength == 0) {
+                    return false;
+                }
+                writeString(keyText, keyLength);
+
+                FREObject member = nullptr;
+                if (FREGetObjectProperty(value, keyText, &member, nullptr) != FRE_OK || !writeValue(member, depth + 1)) {
+                    return false;
+                }
+            }
+            writeString(nullptr, 0);
+            return true;
+        }
+
+        void writeNumber(double number) {
+            // Same choice as writeObject: integral values in 29-bit range go out as integer
+            if (number >= -268435456.0 && number <= 268435455.0 && std::floor(number) == number && !(number == 0 && std::signbit(number))) {
+                m_output.push_back(MarkerInteger);
+                writeU29(static_cast<uint32_t>(static_cast<int32_t>(number)) & MaxU29);
+                return;
+            }
+
+            m_output.push_back(MarkerDouble);
+            uint64_t bits;
+            std::memcpy(&bits, &number, sizeof(bits));
+            for (int shift = 56; shift >= 0; shift -= 8) {
+                m_output.push_back(static_cast<uint8_t>(bits >> shift));
+            }
+        }
+
+        bool writeString(const uint8_t *text, uint32_t length) {
+            if (length == 0) {
+                m_output.push_back(0x01);
+                return true;
+            }
+            if (length > MaxInlineLength) {
+                return false;
+            }
+
+            std::string key(reinterpret_cast<const char *>(text), length);
+            auto found = m_strings.find(key);
+            if (found != m_strings.end()) {
+                writeU29(found->second << 1);
+                return true;
+            }
+            m_strings.emplace(std::move(key), static_cast<uint32_t>(m_strings.size()));
+
+            writeU29((length << 1) | 1);
+            m_output.insert(m_output.end(), text, text + length);
+            return true;
+        }
+
+        void writeU29(uint32_t value) {
+            value &= MaxU29;
+            if (value < 0x80) {
+                m_output.push_back(static_cast<uint8_t>(value));
+            } else if (value < 0x4000) {
+                m_output.push_back(static_cast<uint8_t>((value >> 7) | 0x80));
+                m_output.push_back(static_cast<uint8_t>(value & 0x7F));
+            } else if (value < 0x200000) {
+                m_output.push_back(static_cast<uint8_t>((value >> 14) | 0x80));
+                m_output.push_back(static_cast<uint8_t>(((value >> 7) & 0x7F) | 0x80));
+                m_output.push_back(static_cast<uint8_t>(value & 0x7F));
+            } else {
+                m_output.push_back(static_cast<uint8_t>((value >> 22) | 0x80));
+                m_output.push_back(static_cast<uint8_t>(((value >> 15) & 0x7F) | 0x80));
+                m_output.push_back(static_cast<uint8_t>(((value >> 8) & 0x7F) | 0x80));
+                m_output.push_back(static_cast<uint8_t>(value & 0xFF));
+            }
+        }
+
+        FREObject m_keysProvider;
+        std::vector<uint8_t> &m_output;
+        std::unordered_map<std::string, uint32_t> m_strings;
+    };
+}
+
+std::shared_ptr<const Amf3Index> Amf3Index::build(const uint8_t *data, size_t length) {
+    if (length == 0 || length > UINT32_MAX) {
+        return nullptr;
+    }
+
+    auto index = std::make_shared<Amf3Index>();
+    index->m_nodes.reserve(length / 8 + 1);
+    Amf3Parser parser(data, length, index->m_nodes);
+    if (!parser.parse()) {
+        return nullptr;
+    }
+    return index;
+}
+
+FREObject amf3Materialize(const Amf3Index &index, const uint8_t *data) {
+    TRACE_SCOPE("amf3Materialize");
+    if (index.nodes().empty()) {
+        return nullptr;
+    }
+    Amf3Materializer materializer(index.nodes(), data);
+    return materializer.next();
+}
+
+bool amf3Encode(FREObject value, FREObject keysProvider, std::vector<uint8_t> &output) {
+    Amf3Encoder encoder(keysProvider, output);
+    return encoder.writeValue(value, 0);
+}
@@ -0,0 +1,71 @@
+//
+//  Amf3.hpp
+//  WebSocketANE
+//
+
+#ifndef Amf3_hpp
+#define Amf3_hpp
+
+#include <FlashRuntimeExtensions.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "WebSocketMessage.hpp"
+
+enum class Amf3Kind : uint8_t {
+    Undefined,
+    Null,
+    False,
+    True,
+    Integer,
+    Double,
+    String,
+    XmlDocument,
+    Date,
+    Array,
+    Object,
+    Xml,
+    ByteArray,
+    Reference
+};
+
+struct Amf3Range {
+    uint32_t offset;
+    uint32_t length;
+};
+
+// One decoded value. Containers are followed by their children in wire order: an Array by `associative` key/value
+// pairs then `count` dense values, an Object by `count` key/value pairs (sealed members first). Keys are String nodes.
+struct Amf3Node {
+    Amf3Kind kind;
+    uint32_t count;                // Array: dense length, Object: members, Reference: object table index
+    union {
+        double number;             // Integer, Double, Date
+        Amf3Range range;           // String, XmlDocument, Xml, ByteArray: payload bytes; Object: class alias
+        uint32_t associative;      // Array
+    };
+};
+
+// Validated AMF3 payload flattened into nodes whose strings and byte arrays point back into the message, so
+// building it costs no copies and reading it needs no bounds or reference-table checks.
+class Amf3Index : public MessageIndex {
+public:
+    // Returns nullptr unless data is exactly one AMF3 value of the kinds above (no IExternalizable, Vector or
+    // Dictionary), so callers can fall back to ByteArray.readObject
+    static std::shared_ptr<const Amf3Index> build(const uint8_t *data, size_t length);
+
+    const std::vector<Amf3Node> &nodes() const { return m_nodes; }
+
+private:
+    std::vector<Amf3Node> m_nodes;
+};
+
+// Creates the AS3 value described by index; data is the payload the index was built from. Main thread only
+FREObject amf3Materialize(const Amf3Index &index, const uint8_t *data);
+
+// Encodes value the way ByteArray.writeObject would, for null, Boolean, Number, String, ByteArray, dense Arrays
+// and plain Objects. keysProvider.amf3Keys(value) is called for every Array and Object and must return its dynamic
+// property names, or null when the value has to be encoded by AS3. Returns false when anything could not be encoded
+bool amf3Encode(FREObject value, FREObject keysProvider, std::vector<uint8_t> &output);
+
+#endif /* Amf3_hpp */
@@ -0,0 +1,122 @@
+//
+//  DecodePool.cpp
+//  WebSocketANE
+//
+
+#include "DecodePool.hpp"
+#include <algorithm>
+#include "Trace.hpp"
+#include "WebSocketMessage.hpp"
+
+static const char *const StageNames[] = {"amf3Index", "jsonIndex"};
+
+DecodePool &DecodePool::shared() {
+    static auto *pool = new DecodePool(std::max(std::thread::hardware_concurrency(), 1u));
+    return *pool;
+}
+
+DecodePool::DecodePool(size_t threads) {
+    threads = std::max<size_t>(threads, 1);
+    m_workers.reserve(threads);
+    for (size_t i = 0; i < threads; i++) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    // Started once every deque exists, since any worker may steal from any other
+    for (size_t i = 0; i < threads; i++) {
+        m_workers[i]->thread = std::thread([this, i] { workerLoop(i); });
+    }
+}
+
+DecodePool::~DecodePool() {
+    {
+        std::lock_guard guard(m_sleep_lock);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto &worker : m_workers) {
+        worker->thread.join();
+    }
+}
+
+void DecodePool::submit(DecodeStage stage, std::function<void()> job) {
+    // Round-robin over the deques; idle workers even the load out by stealing
+    auto &worker = *m_workers[m_next_worker.fetch_add(1, std::memory_order_relaxed) % m_workers.size()];
+    {
+        std::lock_guard guard(worker.lock);
+        worker.jobs.push_back(Job{stage, monotonicNanos(), std::move(job)});
+    }
+    m_submitted.fetch_add(1, std::memory_order_relaxed);
+
+    // Pairs with the sleeping count a worker raises before checking m_pending: one of the two sees the other
+    m_pending.fetch_add(1);
+    if (m_sleeping.load() > 0) {
+        std::lock_guard guard(m_sleep_lock);
+        m_wake.notify_one();
+    }
+}
+
+bool DecodePool::takeJob(size_t self, Job &job) {
+    {
+        auto &own = *m_workers[self];
+        std::lock_guard guard(own.lock);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.front());
+            own.jobs.pop_front();
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < m_workers.size(); i++) {
+        auto &victim = *m_workers[(self + i) % m_workers.size()];
+        std::lock_guard guard(victim.lock);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.back());
+            victim.jobs.pop_back();
+            m_steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void DecodePool::workerLoop(size_t self) {
+    TRACE_THREAD_NAME("decodeWorker");
+    while (true) {
+        Job job;
+        if (takeJob(self, job)) {
+            m_pending.fetch_sub(1);
+            auto &stats = m_stages[static_cast<size_t>(job.stage)];
+            auto started = monotonicNanos();
+            stats.queued.record((started - job.submittedAt) / 1000);
+            {
+                TRACE_SCOPE("decodeJob");
+                job.run();
+            }
+            stats.run.record((monotonicNanos() - started) / 1000);
+            continue;
+        }
+
+        std::unique_lock lock(m_sleep_lock);
+        m_sleeping.fetch_add(1);
+        m_wake.wait(lock, [this] { return m_stopping || m_pending.load() > 0; });
+        m_sleeping.fetch_sub(1);
+        if (m_stopping) {
+            return;
+        }
+    }
+}
+
+std::string DecodePool::statsJson() const {
+    std::string json = "{\"threads\":" + std::to_string(m_workers.size()) +
+                       ",\"submitted\":" + std::to_string(m_submitted.load(std::memory_order_relaxed)) +
+                       ",\"steals\":" + std::to_string(m_steals.load(std::memory_order_relaxed)) +
+                       ",\"stages\":{";
+    for (size_t i = 0; i < static_cast<size_t>(DecodeStage::Count); i++) {
+        if (i > 0) {
+            json += ",";
+        }
+        json += "\"" + std::string(StageNames[i]) + "\":{\"queued\":" + m_stages[i].queued.toJson() +
+                ",\"run\":" + m_stages[i].run.toJson() + "}";
+    }
+    return json + "}}";
+}
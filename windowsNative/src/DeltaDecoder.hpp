@@ -0,0 +1,78 @@
+//
+//  DeltaDecoder.hpp
+//  WebSocketANE
+//
+
+#ifndef DeltaDecoder_hpp
+#define DeltaDecoder_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "LatencyHistogram.hpp"
+#include "WebSocketMessage.hpp"
+
+// Rebuilds binary messages sent as deltas against the previous payload of the same key. With delta decoding on,
+// every binary message is framed as
+//
+//   [kind u8][key length u8][key bytes]
+//   kind 0, snapshot: the rest of the message is the payload, and becomes the key's base
+//   kind 1, delta:    [base length varint][target length varint] followed by instructions up to the end:
+//                       0x01 [offset varint][length varint]   copy bytes of the base
+//                       0x02 [length varint][bytes]           insert literal bytes
+//                     the result becomes the key's new base
+//
+// Varints are unsigned LEB128. The instructions are VCDIFF's (RFC 3284) COPY and ADD without its address caches or
+// secondary compression, so a server can translate any copy/insert encoder's output. Bases are kept in an LRU bounded
+// by bytes; the base just stored is always kept, even when it alone is over the bound.
+class DeltaDecoder {
+public:
+    // maxBytes bounds the stored bases; 0 turns decoding off and drops them
+    void configure(size_t maxBytes);
+
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    // Reconstructs the framed message into output. On failure returns false with key (when it could be read) and
+    // error set, and drops the key's base so later deltas fail too until the next snapshot
+    bool apply(const uint8_t *data, size_t length, WebSocketMessage &output, std::string &key, const char *&error);
+
+    // {"enabled":..,"snapshots":..,"deltas":..,"errors":..,"wireBytes":..,"reconstructedBytes":..,"keys":..,
+    // "storedBytes":..,"maxBytes":..,"evictions":..,"apply":{histogram, microseconds}}
+    std::string statsJson();
+
+private:
+    struct Base {
+        std::string key;
+        std::vector<uint8_t> payload;
+    };
+
+    bool applyLocked(const uint8_t *data, size_t length, WebSocketMessage &output, std::string &key, const char *&error);
+
+    // Moves the key's base to the front of the LRU, creating an empty one when missing
+    Base &touchLocked(const std::string &key);
+
+    void forgetLocked(const std::string &key);
+
+    void evictLocked();
+
+    std::atomic<bool> m_enabled{false};
+    std::mutex m_lock;
+    std::list<Base> m_bases; // Most recently used first
+    std::unordered_map<std::string, std::list<Base>::iterator> m_index;
+    size_t m_stored_bytes = 0;
+    size_t m_max_bytes = 0;
+    uint64_t m_snapshots = 0;
+    uint64_t m_deltas = 0;
+    uint64_t m_errors = 0;
+    uint64_t m_wire_bytes = 0;
+    uint64_t m_reconstructed_bytes = 0;
+    uint64_t m_evictions = 0;
+    LatencyHistogram m_apply_time;
+};
+
+#endif /* DeltaDecoder_hpp */
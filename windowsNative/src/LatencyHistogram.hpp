@@ -0,0 +1,44 @@
+//
+//  LatencyHistogram.hpp
+//  WebSocketANE
+//
+
+#ifndef LatencyHistogram_hpp
+#define LatencyHistogram_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Lock-free log-linear histogram of durations in microseconds (8 sub-buckets per power of two, ~12% resolution),
+// laid out like the engine's LatencyHistogram so both report the same percentiles. Recording is a few relaxed
+// atomic adds, so it can sit on the receive and read paths.
+class LatencyHistogram {
+public:
+    void record(uint64_t micros);
+
+    uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+
+    // Upper bound, in microseconds, of the bucket holding the given percentile (0-100)
+    uint64_t percentile(double percentile) const;
+
+    // {"count":..,"mean":..,"p50":..,"p90":..,"p99":..,"p999":..,"max":..} (microseconds)
+    std::string toJson() const;
+
+private:
+    static constexpr int SubBucketBits = 3;
+    static constexpr int SubBuckets = 1 << SubBucketBits;
+    static constexpr uint64_t LinearLimit = 2 * SubBuckets;
+    static constexpr int BucketCount = LinearLimit + (64 - SubBucketBits - 1) * SubBuckets;
+
+    static int bucketIndex(uint64_t value);
+
+    static uint64_t bucketUpperBound(int index);
+
+    std::atomic<uint64_t> m_buckets[BucketCount]{};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum{0};
+    std::atomic<uint64_t> m_max{0};
+};
+
+#endif /* LatencyHistogram_hpp */
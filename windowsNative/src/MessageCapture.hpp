@@ -0,0 +1,140 @@
+//
+//  MessageCapture.hpp
+//  WebSocketANE
+//
+
+#ifndef MessageCapture_hpp
+#define MessageCapture_hpp
+
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Capture file layout (little-endian):
+//   <path>      CaptureFileHeader, then records: CaptureRecordHeader + payload, each padded to 8 bytes
+//   <path>.idx  one uint64 file offset per record, in record order
+// The header is rewritten after every record, so a capture cut short by a crash is still readable up to the last
+// complete record.
+
+// CaptureRecordHeader::flags
+constexpr uint8_t CaptureFlagText = 1;
+
+enum class CaptureDirection : uint8_t {
+    Inbound = 0,
+    Outbound = 1
+};
+
+#pragma pack(push, 1)
+struct CaptureFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t startUnixNs;
+    uint64_t recordCount;
+    uint64_t dataEnd;
+};
+
+struct CaptureRecordHeader {
+    uint64_t timestampNs; // Since the start of the capture
+    uint32_t length;
+    uint8_t direction;
+    uint8_t flags;
+    uint8_t reserved[2];
+};
+#pragma pack(pop)
+
+// Growable memory-mapped file
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile();
+
+    bool open(const std::string &path, bool writable, size_t initialSize);
+
+    // Writable files only; remaps, so previously returned pointers are invalidated
+    bool resize(size_t size);
+
+    // Writable files are truncated to finalSize
+    void close(size_t finalSize = 0);
+
+    uint8_t *data() const { return m_view; }
+
+    size_t size() const { return m_size; }
+
+    bool isOpen() const { return m_file != INVALID_HANDLE_VALUE; }
+
+private:
+    bool map();
+
+    void unmap();
+
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+    uint8_t *m_view = nullptr;
+    size_t m_size = 0;
+    bool m_writable = false;
+};
+
+// Appends every message that crosses the shim, from any thread
+class MessageCapture {
+public:
+    bool open(const std::string &path);
+
+    void record(CaptureDirection direction, const uint8_t *data, size_t length, bool text = false);
+
+    // Returns {"records":..,"bytes":..,"durationNs":..}
+    std::string close();
+
+    bool isOpen() const { return m_open.load(std::memory_order_acquire); }
+
+private:
+    std::mutex m_lock;
+    std::atomic<bool> m_open{false};
+    MappedFile m_data;
+    MappedFile m_index;
+    std::chrono::steady_clock::time_point m_start;
+    uint64_t m_lastTimestampNs = 0;
+};
+
+// Plays the inbound side of a capture back on its own thread
+class MessageReplay {
+public:
+    using Deliver = std::function<void(const uint8_t *data, size_t length, bool text)>;
+    using Complete = std::function<void(const std::string &statsJson)>;
+    using Paused = std::function<bool()>;
+
+    ~MessageReplay();
+
+    // realtime keeps the recorded spacing scaled by 1/speed, otherwise messages are delivered as fast as the
+    // receive queue accepts them (paused() returning true holds delivery, like socket reads under backpressure)
+    bool start(const std::string &path, bool realtime, double speed, Deliver deliver, Complete complete, Paused paused);
+
+    void stop();
+
+    bool isRunning() const { return m_running.load(std::memory_order_acquire); }
+
+private:
+    void run(bool realtime, double speed);
+
+    MappedFile m_data;
+    MappedFile m_index;
+    std::thread m_thread;
+    std::atomic<bool> m_stop{false};
+    std::atomic<bool> m_running{false};
+    Deliver m_deliver;
+    Complete m_complete;
+    Paused m_paused;
+};
+
+#endif /* MessageCapture_hpp */
@@ -0,0 +1,88 @@
+//
+//  Trace.hpp
+//  WebSocketANE
+//
+
+#ifndef Trace_hpp
+#define Trace_hpp
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Scoped spans around the hot path, compiled in only when WEBSOCKET_ANE_TRACING is defined (CMake option of the
+// same name on Windows, GCC_PREPROCESSOR_DEFINITIONS in Xcode). Each thread records into its own ring of the last
+// TraceRing::Capacity spans with two clock reads and a store, no locks; traceDump collects every ring, plus the
+// engine's spans, as Chrome trace-event JSON that chrome://tracing and Perfetto open directly.
+
+#ifdef WEBSOCKET_ANE_TRACING
+
+// Relaxed atomics, so traceDump can copy a slot while its owner rewrites it; the copy is checked against written
+struct TraceEvent {
+    std::atomic<const char *> name;    // String literal, recorded by pointer
+    std::atomic<uint64_t> start;       // Steady clock, ns
+    std::atomic<uint64_t> duration;
+};
+
+struct TraceRing {
+    static constexpr uint64_t Capacity = 8192;
+
+    std::atomic<uint64_t> written{0};
+    uint64_t threadId = 0;
+    std::atomic<const char *> threadName{nullptr};
+    TraceEvent events[Capacity];
+};
+
+// Ring of the calling thread, created on first use. Rings are never freed, so spans of finished threads still dump
+TraceRing *traceThreadRing();
+
+inline uint64_t traceNow() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+inline void traceRecord(const char *name, uint64_t start, uint64_t end) {
+    static thread_local TraceRing *ring = traceThreadRing();
+    uint64_t written = ring->written.load(std::memory_order_relaxed);
+    // Keeps the slot's stores after the previous store of written, which traceDump relies on to spot a reused slot
+    std::atomic_thread_fence(std::memory_order_release);
+    TraceEvent &event = ring->events[written & (TraceRing::Capacity - 1)];
+    event.name.store(name, std::memory_order_relaxed);
+    event.start.store(start, std::memory_order_relaxed);
+    event.duration.store(end - start, std::memory_order_relaxed);
+    ring->written.store(written + 1, std::memory_order_release);
+}
+
+class TraceScope {
+public:
+    explicit TraceScope(const char *name) : m_name(name), m_start(traceNow()) {}
+
+    ~TraceScope() { traceRecord(m_name, m_start, traceNow()); }
+
+    TraceScope(const TraceScope &) = delete;
+
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *m_name;
+    uint64_t m_start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) traceThreadRing()->threadName.store(name, std::memory_order_relaxed)
+
+#else
+
+#define TRACE_SCOPE(name) ((void) 0)
+#define TRACE_THREAD_NAME(name) ((void) 0)
+
+#endif
+
+// {"traceEvents":[...]} with the spans of every thread of the shim and the engine; an empty list when tracing is
+// compiled out
+std::string traceDump();
+
+#endif /* Trace_hpp */
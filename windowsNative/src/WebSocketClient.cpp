@@ -1,41 +1,631 @@
 #include "WebSocketClient.hpp"
+#include <algorithm>
+#include <cstdio>
+#include "Amf3.hpp"
+#include "Json.hpp"
+#include "Trace.hpp"
 #include "WebSocketNativeLibrary.h"
 #include "log.h"
 
-WebSocketClient::WebSocketClient(FREContext ctx) {
+// Engine calls that return text fill a caller-owned buffer and report the size they need, retry once if it was short
+template<typename Read>
+static std::string readEngineString(Read &&read) {
+    std::string result(1024, '\0');
+    int required = read(result.data(), static_cast<int>(result.size()));
+    if (required > static_cast<int>(result.size())) {
+        result.resize(required);
+        required = read(result.data(), required);
+    }
+    result.resize(required > 0 ? required - 1 : 0);
+    return result;
+}
+
+static std::atomic<size_t> liveClientCount{0};
+
+WebSocketClient::WebSocketClient(FREContext ctx) : m_ctx(ctx) {
     writeLog("WebSocketClient created");
+    liveClientCount++;
     m_guidPointer = csharpWebSocketLibrary_createWebSocketClient(ctx);
     writeLog(m_guidPointer);
 }
 
-WebSocketClient::~WebSocketClient() = default;
+WebSocketClient::~WebSocketClient() {
+    shutdown();
+    liveClientCount--;
+}
+
+bool WebSocketClient::enterCallback() {
+    std::lock_guard guard(m_callback_lock);
+    if (m_shut_down) {
+        return false;
+    }
+    m_callbacks_in_flight++;
+    return true;
+}
+
+void WebSocketClient::leaveCallback() {
+    std::lock_guard guard(m_callback_lock);
+    if (--m_callbacks_in_flight == 0) {
+        m_callbacks_done.notify_all();
+    }
+}
+
+void WebSocketClient::shutdown() {
+    {
+        std::unique_lock<std::mutex> lock(m_callback_lock);
+        if (m_shut_down) {
+            return;
+        }
+        m_shut_down = true;
+        m_callbacks_done.wait(lock, [this] { return m_callbacks_in_flight == 0; });
+    }
+
+    // The replay thread dispatches to the context as well
+    m_replay.stop();
+    m_capture.close();
+
+    // The engine frees the guid string along with the client
+    csharpWebSocketLibrary_destroyWebSocketClient(m_guidPointer);
+    m_guidPointer = nullptr;
+}
+
+void WebSocketClient::getReceiveQueueUsage(size_t &messages, size_t &bytes) {
+    std::lock_guard guard(m_lock_receive_queue);
+    messages = m_received_message_queue.size();
+    bytes = m_received_bytes;
+}
+
+size_t WebSocketClient::liveClients() {
+    return liveClientCount.load();
+}
+
+std::string WebSocketClient::getEngineMemoryStats() {
+    return readEngineString([](char *buffer, int length) {
+        return csharpWebSocketLibrary_getMemoryStats(buffer, length);
+    });
+}
+
+void WebSocketClient::connect(const char* uri, const WebSocketConnectOptions *options) const {
+    if (options != nullptr) {
+        csharpWebSocketLibrary_connectWithOptions(m_guidPointer, uri, options);
+        return;
+    }
 
-void WebSocketClient::connect(const char* uri) const {
     csharpWebSocketLibrary_connect(m_guidPointer, uri);
 }
 
+void WebSocketClient::connectShared(const char* uri) const {
+    csharpWebSocketLibrary_connectShared(m_guidPointer, uri);
+}
+
 void WebSocketClient::close(uint32_t closeCode) const {
     csharpWebSocketLibrary_disconnect(m_guidPointer, static_cast<int>(closeCode));
 }
 
-void WebSocketClient::sendMessage(uint8_t* bytes, int lenght) const {
-    csharpWebSocketLibrary_sendMessage(m_guidPointer, bytes, lenght);
+bool WebSocketClient::sendMessage(uint8_t* bytes, int lenght, int lane) {
+    TRACE_SCOPE("sendMessage");
+    bool accepted = csharpWebSocketLibrary_sendMessage(m_guidPointer, bytes, lenght, lane) == 1;
+    if (accepted && m_capture.isOpen()) {
+        m_capture.record(CaptureDirection::Outbound, bytes, static_cast<size_t>(lenght));
+    }
+    return accepted;
 }
 
-std::optional<std::vector<uint8_t> > WebSocketClient::getNextMessage() {
+int WebSocketClient::sendMessages(const uint8_t *records, int length, int lane) {
+    TRACE_SCOPE("sendMessages");
+    int queued = csharpWebSocketLibrary_sendMessages(m_guidPointer, records, length, lane);
+    if (queued > 0 && m_capture.isOpen()) {
+        for (int offset = 0; offset + 4 <= length;) {
+            auto recordLength = static_cast<int>(static_cast<uint32_t>(records[offset]) << 24 | static_cast<uint32_t>(records[offset + 1]) << 16 |
+                                                 static_cast<uint32_t>(records[offset + 2]) << 8 | records[offset + 3]);
+            if (recordLength < 0 || recordLength > length - offset - 4) {
+                break;
+            }
+            m_capture.record(CaptureDirection::Outbound, records + offset + 4, static_cast<size_t>(recordLength));
+            offset += 4 + recordLength;
+        }
+    }
+    return queued;
+}
+
+std::optional<WebSocketMessage> WebSocketClient::getNextMessage() {
+    TRACE_SCOPE("getNextMessage");
+    bool resume = false;
+    WebSocketMessage message;
+    {
+        std::lock_guard guard(m_lock_receive_queue);
+        if (m_received_message_queue.empty()) {
+            return std::nullopt;
+        }
+
+        // Pega a próxima mensagem da fila
+        message = std::move(m_received_message_queue.front());
+        popFrontLocked(message);
+
+        if (m_receive_paused && m_received_bytes <= m_receive_low_bytes && m_received_message_queue.size() <= m_receive_low_messages) {
+            m_receive_paused = false;
+            resume = true;
+        }
+    }
+
+    if (resume) {
+        syncReceivePaused();
+    }
+
+    return message;
+}
+
+std::optional<WebSocketMessage> WebSocketClient::peekNextMessage(uint64_t &version) {
     std::lock_guard guard(m_lock_receive_queue);
     if (m_received_message_queue.empty()) {
         return std::nullopt;
     }
 
-    // Pega a próxima mensagem da fila
-    std::vector<uint8_t> message = std::move(m_received_message_queue.front());
-    m_received_message_queue.pop();
+    version = m_front_replaced;
+    return m_received_message_queue.front();
+}
 
-    return message;
+bool WebSocketClient::popNextMessage(uint64_t version) {
+    TRACE_SCOPE("popNextMessage");
+    bool resume = false;
+    {
+        std::lock_guard guard(m_lock_receive_queue);
+        if (m_received_message_queue.empty() || m_front_replaced != version) {
+            return false;
+        }
+
+        popFrontLocked(m_received_message_queue.front());
+
+        if (m_receive_paused && m_received_bytes <= m_receive_low_bytes && m_received_message_queue.size() <= m_receive_low_messages) {
+            m_receive_paused = false;
+            resume = true;
+        }
+    }
+
+    if (resume) {
+        syncReceivePaused();
+    }
+
+    return true;
+}
+
+size_t WebSocketClient::peekMessagesSize(size_t maxMessages, bool prefixed, size_t &count) {
+    std::lock_guard guard(m_lock_receive_queue);
+    count = std::min(maxMessages, m_received_message_queue.size());
+    size_t total = prefixed ? count * 4 : 0;
+    for (size_t i = 0; i < count; i++) {
+        total += m_received_message_queue[i].size();
+    }
+    return total;
+}
+
+size_t WebSocketClient::readMessagesInto(size_t maxMessages, bool prefixed, uint8_t *destination, size_t capacity, size_t &count) {
+    TRACE_SCOPE("readMessagesInto");
+    bool resume = false;
+    size_t written = 0;
+    count = 0;
+    {
+        std::lock_guard guard(m_lock_receive_queue);
+        // Capacity is checked under the lock: conflation may have swapped a queued message for a larger one since
+        // peekMessagesSize
+        while (count < maxMessages && !m_received_message_queue.empty()) {
+            const auto &message = m_received_message_queue.front();
+            auto length = message.size();
+            if ((prefixed ? 4 : 0) + length > capacity - written) {
+                break;
+            }
+            if (prefixed) {
+                destination[0] = static_cast<uint8_t>(length >> 24);
+                destination[1] = static_cast<uint8_t>(length >> 16);
+                destination[2] = static_cast<uint8_t>(length >> 8);
+                destination[3] = static_cast<uint8_t>(length);
+                destination += 4;
+            }
+            std::copy_n(message.data(), length, destination);
+            destination += length;
+            written += (prefixed ? 4 : 0) + length;
+            count++;
+            popFrontLocked(message);
+        }
+
+        if (m_receive_paused && m_received_bytes <= m_receive_low_bytes && m_received_message_queue.size() <= m_receive_low_messages) {
+            m_receive_paused = false;
+            resume = true;
+        }
+    }
+
+    if (resume) {
+        syncReceivePaused();
+    }
+
+    return written;
+}
+
+void WebSocketClient::receiveMessage(const uint8_t *data, size_t length, bool text, uint64_t receivedAt) {
+    TRACE_SCOPE("receiveMessage");
+    if (m_capture.isOpen()) {
+        m_capture.record(CaptureDirection::Inbound, data, length, text);
+    }
+
+    // Deltas are applied here, in receive order, before anything else sees the payload; the capture keeps the wire form
+    WebSocketMessage message;
+    if (!text && m_delta.enabled()) {
+        std::string key;
+        const char *error = "";
+        if (!m_delta.apply(data, length, message, key, error)) {
+            auto detail = key + ";" + error;
+            writeLog(("Could not apply delta: " + detail).c_str());
+            FREDispatchStatusEventAsync(m_ctx, reinterpret_cast<const uint8_t *>("deltaError"), reinterpret_cast<const uint8_t *>(detail.c_str()));
+            return;
+        }
+    } else {
+        message = WebSocketMessage(data, length);
+    }
+    message.setTimestamps(receivedAt, 0);
+
+    // Payloads that fail validation stay unindexed and are decoded by AS3 instead
+    std::optional<DecodeStage> stage;
+    if (text) {
+        if (m_decode_json.load(std::memory_order_relaxed)) {
+            stage = DecodeStage::JsonIndex;
+        }
+    } else if (m_decode_amf3.load(std::memory_order_relaxed)) {
+        stage = DecodeStage::Amf3Index;
+    }
+
+    bool offload = stage && m_decode_offload.load(std::memory_order_relaxed);
+    uint64_t sequence;
+    {
+        std::lock_guard guard(m_decode_lock);
+        sequence = m_decode_sequence++;
+        if (offload) {
+            m_decode_offloaded++;
+        }
+    }
+
+    // The job counts as a callback, so shutdown waits for it before the client and its context go away
+    if (offload && enterCallback()) {
+        DecodePool::shared().submit(*stage, [this, stage = *stage, sequence, text, message = std::move(message)]() mutable {
+            if (stage == DecodeStage::JsonIndex) {
+                message.setIndex(JsonIndex::build(message.data(), message.size()));
+            } else {
+                message.setIndex(Amf3Index::build(message.data(), message.size()));
+            }
+            commitMessage(sequence, std::move(message), text);
+            leaveCallback();
+        });
+        return;
+    }
+
+    if (stage == DecodeStage::JsonIndex) {
+        TRACE_SCOPE("jsonIndex");
+        message.setIndex(JsonIndex::build(message.data(), message.size()));
+    } else if (stage == DecodeStage::Amf3Index) {
+        TRACE_SCOPE("amf3Index");
+        message.setIndex(Amf3Index::build(message.data(), message.size()));
+    }
+    commitMessage(sequence, std::move(message), text);
+}
+
+void WebSocketClient::commitMessage(uint64_t sequence, WebSocketMessage &&message, bool text) {
+    std::lock_guard guard(m_decode_lock);
+    if (sequence != m_decode_committed) {
+        m_decode_reorder.emplace(sequence, DecodedMessage{std::move(message), text, monotonicNanos()});
+        m_decode_reorder_max = std::max(m_decode_reorder_max, m_decode_reorder.size());
+        return;
+    }
+
+    deliverLocked(std::move(message), text);
+    m_decode_committed++;
+
+    // Release the messages that finished decoding while this one was still in the pool
+    while (!m_decode_reorder.empty() && m_decode_reorder.begin()->first == m_decode_committed) {
+        auto &decoded = m_decode_reorder.begin()->second;
+        m_decode_reorder_wait.record((monotonicNanos() - decoded.decodedAt) / 1000);
+        deliverLocked(std::move(decoded.message), decoded.text);
+        m_decode_reorder.erase(m_decode_reorder.begin());
+        m_decode_committed++;
+    }
+}
+
+void WebSocketClient::deliverLocked(WebSocketMessage &&message, bool text) {
+    // A message conflated into one already queued is picked up by that message's pending event
+    if (!enqueueMessage(std::move(message))) {
+        return;
+    }
+
+    TRACE_SCOPE("dispatchNextMessage");
+    FREDispatchStatusEventAsync(m_ctx, reinterpret_cast<const uint8_t *>("nextMessage"), reinterpret_cast<const uint8_t *>(text ? "text" : ""));
+}
+
+bool WebSocketClient::enqueueMessage(WebSocketMessage &&message) {
+    TRACE_SCOPE("enqueueMessage");
+    auto length = message.size();
+
+    bool pause = false;
+    bool conflated = false;
+    {
+        std::lock_guard guard(m_lock_receive_queue);
+
+        message.setTimestamps(message.receivedAt(), monotonicNanos());
+
+        std::string key;
+        if (m_conflate && conflationKey(message.data(), length, key)) {
+            auto found = m_conflation_index.find(key);
+            if (found != m_conflation_index.end()) {
+                // Latest value wins: overwrite the queued update in place, keeping its position
+                auto &queued = m_received_message_queue[static_cast<size_t>(found->second - m_popped_sequence)];
+                m_conflated_messages++;
+                m_conflated_bytes += queued.size();
+                m_received_bytes = m_received_bytes - queued.size() + length;
+                queued = std::move(message);
+                if (found->second == m_popped_sequence) {
+                    m_front_replaced++;
+                }
+                conflated = true;
+            } else {
+                m_conflation_index.emplace(std::move(key), m_pushed_sequence);
+            }
+        }
+
+        if (!conflated) {
+            m_received_message_queue.push_back(std::move(message));
+            m_pushed_sequence++;
+            m_received_bytes += length;
+        }
+
+        // A larger replacement grows the buffered bytes too, so it is held to the same watermark as an append
+        if (!m_receive_paused && (m_received_bytes >= m_receive_high_bytes || m_received_message_queue.size() >= m_receive_high_messages)) {
+            m_receive_paused = true;
+            pause = true;
+        }
+    }
+
+    if (pause) {
+        syncReceivePaused();
+    }
+
+    return !conflated;
+}
+
+void WebSocketClient::setConflationKey(size_t offset, size_t length, int delimiter) {
+    std::lock_guard guard(m_lock_receive_queue);
+    m_conflation_offset = offset;
+    m_conflation_length = length;
+    m_conflation_delimiter = delimiter;
+    m_conflate = length > 0 || delimiter >= 0;
+
+    // Keys of messages already queued were taken with the previous extractor
+    m_conflation_index.clear();
+}
+
+std::string WebSocketClient::getConflationStats() {
+    std::lock_guard guard(m_lock_receive_queue);
+    return "{\"enabled\":" + std::string(m_conflate ? "true" : "false") +
+           ",\"conflated\":" + std::to_string(m_conflated_messages) +
+           ",\"conflatedBytes\":" + std::to_string(m_conflated_bytes) +
+           ",\"queued\":" + std::to_string(m_received_message_queue.size()) +
+           ",\"queuedBytes\":" + std::to_string(m_received_bytes) +
+           ",\"keys\":" + std::to_string(m_conflation_index.size()) + "}";
 }
 
-void WebSocketClient::enqueueMessage(const std::vector<uint8_t> &message) {
+double WebSocketClient::getLastMessageTimestamp() {
     std::lock_guard guard(m_lock_receive_queue);
-    m_received_message_queue.push(message);
+    return m_last_received_at / 1e6;
+}
+
+std::string WebSocketClient::getQueueDelayStats() {
+    std::lock_guard guard(m_lock_receive_queue);
+    char now[32];
+    snprintf(now, sizeof(now), "%.3f", monotonicNanos() / 1e6);
+    return "{\"now\":" + std::string(now) +
+           ",\"queued\":" + m_queue_delay.toJson() +
+           ",\"sinceReceive\":" + m_receive_delay.toJson() + "}";
+}
+
+void WebSocketClient::setAmf3Decoding(bool enabled) {
+    m_decode_amf3.store(enabled, std::memory_order_relaxed);
+}
+
+void WebSocketClient::setJsonDecoding(bool enabled) {
+    m_decode_json.store(enabled, std::memory_order_relaxed);
+}
+
+void WebSocketClient::setDecodeOffload(bool enabled) {
+    m_decode_offload.store(enabled, std::memory_order_relaxed);
+}
+
+void WebSocketClient::setDeltaDecoding(size_t maxBytes) {
+    m_delta.configure(maxBytes);
+}
+
+std::string WebSocketClient::getDeltaStats() {
+    return m_delta.statsJson();
+}
+
+std::string WebSocketClient::getDecodeStats() {
+    std::lock_guard guard(m_decode_lock);
+    return "{\"offload\":" + std::string(m_decode_offload.load(std::memory_order_relaxed) ? "true" : "false") +
+           ",\"offloaded\":" + std::to_string(m_decode_offloaded) +
+           ",\"reorderPending\":" + std::to_string(m_decode_reorder.size()) +
+           ",\"reorderMax\":" + std::to_string(m_decode_reorder_max) +
+           ",\"reorderWait\":" + m_decode_reorder_wait.toJson() +
+           ",\"pool\":" + DecodePool::shared().statsJson() + "}";
+}
+
+bool WebSocketClient::conflationKey(const uint8_t *data, size_t length, std::string &key) const {
+    if (m_conflation_offset >= length) {
+        return false;
+    }
+
+    auto begin = data + m_conflation_offset;
+    auto available = length - m_conflation_offset;
+    if (m_conflation_length > 0) {
+        if (available < m_conflation_length) {
+            return false;
+        }
+        key.assign(reinterpret_cast<const char *>(begin), m_conflation_length);
+        return true;
+    }
+
+    auto end = std::find(begin, begin + available, static_cast<uint8_t>(m_conflation_delimiter));
+    if (end == begin + available) {
+        return false;
+    }
+    key.assign(reinterpret_cast<const char *>(begin), static_cast<size_t>(end - begin));
+    return true;
+}
+
+void WebSocketClient::popFrontLocked(const WebSocketMessage &message) {
+    if (m_conflate && !m_conflation_index.empty()) {
+        std::string key;
+        if (conflationKey(message.data(), message.size(), key)) {
+            auto found = m_conflation_index.find(key);
+            if (found != m_conflation_index.end() && found->second == m_popped_sequence) {
+                m_conflation_index.erase(found);
+            }
+        }
+    }
+
+    uint64_t now = monotonicNanos();
+    m_queue_delay.record((now - message.enqueuedAt()) / 1000);
+    m_receive_delay.record((now - message.receivedAt()) / 1000);
+    m_last_received_at = message.receivedAt();
+
+    m_received_bytes -= message.size();
+    m_received_message_queue.pop_front();
+    m_popped_sequence++;
+}
+
+void WebSocketClient::setReceiveWatermarks(size_t lowBytes, size_t highBytes, size_t lowMessages, size_t highMessages) {
+    if (lowBytes > highBytes || lowMessages > highMessages || highBytes == 0 || highMessages == 0) {
+        writeLog("Invalid receive watermarks");
+        return;
+    }
+
+    bool pause = false;
+    bool resume = false;
+    {
+        std::lock_guard guard(m_lock_receive_queue);
+        m_receive_low_bytes = lowBytes;
+        m_receive_high_bytes = highBytes;
+        m_receive_low_messages = lowMessages;
+        m_receive_high_messages = highMessages;
+
+        auto count = m_received_message_queue.size();
+        if (!m_receive_paused && (m_received_bytes >= highBytes || count >= highMessages)) {
+            m_receive_paused = pause = true;
+        } else if (m_receive_paused && m_received_bytes <= lowBytes && count <= lowMessages) {
+            m_receive_paused = false;
+            resume = true;
+        }
+    }
+
+    if (pause || resume) {
+        syncReceivePaused();
+    }
+}
+
+void WebSocketClient::setSendWatermarks(int64_t lowBytes, int64_t highBytes) const {
+    csharpWebSocketLibrary_setSendWatermarks(m_guidPointer, lowBytes, highBytes);
+}
+
+int64_t WebSocketClient::getBufferedAmount() const {
+    return csharpWebSocketLibrary_getBufferedAmount(m_guidPointer);
+}
+
+void WebSocketClient::setFragmentSize(int fragmentSize) const {
+    csharpWebSocketLibrary_setFragmentSize(m_guidPointer, fragmentSize);
+}
+
+std::string WebSocketClient::getSendLaneStats() const {
+    return readEngineString([this](char *buffer, int length) {
+        return csharpWebSocketLibrary_getSendLaneStats(m_guidPointer, buffer, length);
+    });
+}
+
+void WebSocketClient::setKeepAlive(int intervalMs, int timeoutMs, int statusIntervalMs) const {
+    csharpWebSocketLibrary_setKeepAlive(m_guidPointer, intervalMs, timeoutMs, statusIntervalMs);
+}
+
+std::string WebSocketClient::getRttStats() const {
+    return readEngineString([this](char *buffer, int length) {
+        return csharpWebSocketLibrary_getRttStats(m_guidPointer, buffer, length);
+    });
+}
+
+void WebSocketClient::setBusyPoll(int spinMicros, int core) const {
+    csharpWebSocketLibrary_setBusyPoll(m_guidPointer, spinMicros, core);
+}
+
+std::string WebSocketClient::getIoStats() const {
+    return readEngineString([this](char *buffer, int length) {
+        return csharpWebSocketLibrary_getIoStats(m_guidPointer, buffer, length);
+    });
+}
+
+std::string WebSocketClient::getEngineStartupTimings() {
+    return readEngineString([](char *buffer, int length) {
+        return csharpWebSocketLibrary_getStartupTimings(buffer, length);
+    });
+}
+
+std::string WebSocketClient::getEngineNetworkImpairmentStats() {
+    return readEngineString([](char *buffer, int length) {
+        return csharpWebSocketLibrary_getNetworkImpairmentStats(buffer, length);
+    });
+}
+
+bool WebSocketClient::startCapture(const std::string &path) {
+    if (m_replay.isRunning()) {
+        writeLog("Cannot capture while a replay is running");
+        return false;
+    }
+    return m_capture.open(path);
+}
+
+std::string WebSocketClient::stopCapture() {
+    return m_capture.close();
+}
+
+bool WebSocketClient::startReplay(const std::string &path, bool realtime, double speed) {
+    if (m_capture.isOpen()) {
+        writeLog("Cannot replay while capturing");
+        return false;
+    }
+
+    FREContext ctx = m_ctx;
+    return m_replay.start(path, realtime, speed,
+                          [this](const uint8_t *data, size_t length, bool text) {
+                              receiveMessage(data, length, text, monotonicNanos());
+                          },
+                          [ctx](const std::string &stats) {
+                              FREDispatchStatusEventAsync(ctx, reinterpret_cast<const uint8_t *>("replayComplete"), reinterpret_cast<const uint8_t *>(stats.c_str()));
+                          },
+                          [this]() {
+                              std::lock_guard guard(m_lock_receive_queue);
+                              return m_receive_paused;
+                          });
+}
+
+void WebSocketClient::stopReplay() {
+    m_replay.stop();
+}
+
+void WebSocketClient::syncReceivePaused() {
+    // Decisions are made under the queue lock but reach the engine after it is released, so a pause from the network
+    // thread and a resume from the main thread could arrive swapped and leave reads paused for good. Calls are
+    // serialized here and each one sends the latest decision, skipping it when the engine already has it
+    std::lock_guard guard(m_lock_receive_pause);
+    bool paused;
+    {
+        std::lock_guard queueGuard(m_lock_receive_queue);
+        paused = m_receive_paused;
+    }
+    if (paused == m_engine_receive_paused) {
+        return;
+    }
+    m_engine_receive_paused = paused;
+    writeLog(paused ? "Receive queue above high watermark, pausing socket reads" : "Receive queue drained, resuming socket reads");
+    csharpWebSocketLibrary_setReceivePaused(m_guidPointer, paused ? 1 : 0);
 }
@@ -10,10 +10,21 @@
 
 #include <windows.h>
 #include <FlashRuntimeExtensions.h>
-#include <queue>
 #include <vector>
+#include <atomic>
+#include <condition_variable>
+#include <map>
 #include <mutex>
 #include <optional>
+#include <string>
+#include <unordered_map>
+#include "DecodePool.hpp"
+#include "DeltaDecoder.hpp"
+#include "LatencyHistogram.hpp"
+#include "MessageCapture.hpp"
+#include "WebSocketMessage.hpp"
+
+struct WebSocketConnectOptions;
 
 class WebSocketClient {
 public:
@@ -21,19 +32,196 @@ public:
 
     ~WebSocketClient();
 
-    void connect(const char *uri) const;
+    // Engine callbacks bracket their use of the client with these; enterCallback fails once shutdown has begun, and
+    // the callback must then leave the client and its context alone
+    bool enterCallback();
+
+    void leaveCallback();
+
+    // Run by the context finalizer once the client is out of the context map: waits for the callbacks in flight,
+    // stops replay and capture and destroys the engine client. Later engine calls on this client are no-ops
+    void shutdown();
+
+    // Messages and bytes waiting in the receive queue
+    void getReceiveQueueUsage(size_t &messages, size_t &bytes);
+
+    // Clients alive in the process, including finalized ones a callback still holds
+    static size_t liveClients();
+
+    // Engine-side memory ledger (JSON object); not tied to a connection
+    static std::string getEngineMemoryStats();
+
+    // Without options the engine defaults apply
+    void connect(const char *uri, const WebSocketConnectOptions *options = nullptr) const;
+
+    // Joins the connection shared by every context calling connectShared with the same uri, as one logical channel
+    void connectShared(const char *uri) const;
 
     void close(uint32_t closeCode) const;
 
-    void sendMessage(uint8_t *bytes, int lenght) const;
+    bool sendMessage(uint8_t *bytes, int lenght, int lane);
+
+    // records holds [uint32 big-endian length][payload]...; returns how many messages were queued
+    int sendMessages(const uint8_t *records, int length, int lane);
+
+    std::optional<WebSocketMessage> getNextMessage();
+
+    // Copy of the next message, left queued for a caller that may still fail to hand it over; cheap, as large payloads
+    // and the index are shared. version goes to popNextMessage. Main thread only
+    std::optional<WebSocketMessage> peekNextMessage(uint64_t &version);
+
+    // Removes the message peekNextMessage returned with version; false, leaving it queued, when a conflated update has
+    // replaced it since
+    bool popNextMessage(uint64_t version);
+
+    // Records, indexes and queues a received message, then dispatches "nextMessage" unless it was conflated into a
+    // queued one. receivedAt is when the engine read the message (monotonicNanos). With decode offload on, indexing
+    // runs on the DecodePool and the message is queued once every message received before it has been
+    void receiveMessage(const uint8_t *data, size_t length, bool text, uint64_t receivedAt);
+
+    // Bytes needed to read up to maxMessages queued messages, plus a 4-byte length per message when prefixed
+    size_t peekMessagesSize(size_t maxMessages, bool prefixed, size_t &count);
+
+    // Moves up to maxMessages queued messages into destination, stopping at the first one that does not fit in
+    // capacity bytes, and returns the bytes written with the number of messages in count. Main thread only
+    size_t readMessagesInto(size_t maxMessages, bool prefixed, uint8_t *destination, size_t capacity, size_t &count);
+
+    // Socket reads pause once the queue reaches either high mark and resume when both are back under the low marks
+    void setReceiveWatermarks(size_t lowBytes, size_t highBytes, size_t lowMessages, size_t highMessages);
+
+    void setSendWatermarks(int64_t lowBytes, int64_t highBytes) const;
+
+    int64_t getBufferedAmount() const;
+
+    void setFragmentSize(int fragmentSize) const;
+
+    std::string getSendLaneStats() const;
+
+    // Engine pings every intervalMs and reports a dead peer after timeoutMs of silence; statusIntervalMs > 0 enables "keepaliveStatus" events
+    void setKeepAlive(int intervalMs, int timeoutMs, int statusIntervalMs) const;
+
+    std::string getRttStats() const;
+
+    // Engine receives on a dedicated thread spinning up to spinMicros before parking, pinned to core when core >= 0; 0 turns it off
+    void setBusyPoll(int spinMicros, int core) const;
 
-    std::optional<std::vector<uint8_t> > getNextMessage();
+    std::string getIoStats() const;
 
-    void enqueueMessage(const std::vector<uint8_t> &message);
+    // Engine startup phase durations (JSON object, milliseconds); not tied to a connection
+    static std::string getEngineStartupTimings();
+
+    // Engine network impairment counters (JSON object); not tied to a connection
+    static std::string getEngineNetworkImpairmentStats();
+
+    // Latest-value conflation: the key is length bytes at offset, or when length is 0 the bytes from offset up to
+    // the first delimiter byte. Length 0 and delimiter -1 turn conflation off
+    void setConflationKey(size_t offset, size_t length, int delimiter);
+
+    std::string getConflationStats();
+
+    // Receive time, in milliseconds on the monotonic clock, of the message most recently read out of the queue
+    double getLastMessageTimestamp();
+
+    // Time messages spent in the receive queue before being read ("queued") and since the engine received them
+    // ("sinceReceive"), as histograms in microseconds, plus the current monotonic time in milliseconds
+    std::string getQueueDelayStats();
+
+    // Validates and indexes each received message as AMF3 on the network thread (see Amf3.hpp)
+    void setAmf3Decoding(bool enabled);
+
+    // Validates and indexes each received text message as JSON on the network thread (see Json.hpp)
+    void setJsonDecoding(bool enabled);
+
+    // Moves AMF3 and JSON indexing off the network thread onto the shared DecodePool
+    void setDecodeOffload(bool enabled);
+
+    // This client's offload counters and reorder wait histogram (microseconds), with the pool's per-stage stats
+    std::string getDecodeStats();
+
+    // Rebuilds binary messages framed as snapshots and deltas (see DeltaDecoder.hpp), keeping up to maxBytes of
+    // previous payloads; 0 turns it off. Messages that cannot be rebuilt are dropped with a "deltaError" event
+    void setDeltaDecoding(size_t maxBytes);
+
+    std::string getDeltaStats();
+
+    // Appends every inbound and outbound message to a memory-mapped capture at path (see MessageCapture.hpp)
+    bool startCapture(const std::string &path);
+
+    std::string stopCapture();
+
+    // Feeds the inbound messages of a capture through receiveMessage, then
+    // dispatches "replayComplete" with the replay stats
+    bool startReplay(const std::string &path, bool realtime, double speed);
+
+    void stopReplay();
 
 private:
+    struct DecodedMessage {
+        WebSocketMessage message;
+        bool text;
+        uint64_t decodedAt;
+    };
+
+    // Queues message once every message with a lower sequence has been queued, holding it in m_decode_reorder until then
+    void commitMessage(uint64_t sequence, WebSocketMessage &&message, bool text);
+
+    void deliverLocked(WebSocketMessage &&message, bool text);
+
+    // Returns false when the message replaced a queued one with the same conflation key instead of being appended.
+    // The enqueue time is stamped here
+    bool enqueueMessage(WebSocketMessage &&message);
+
+    bool conflationKey(const uint8_t *data, size_t length, std::string &key) const;
+
+    // Drops the front message (already moved or copied out), keeping byte counts and the conflation index in step
+    void popFrontLocked(const WebSocketMessage &message);
+
+    // Brings the engine in line with m_receive_paused
+    void syncReceivePaused();
+
+    // Lock order: m_lock_receive_pause, then m_lock_receive_queue
+    std::mutex m_lock_receive_pause;
+    bool m_engine_receive_paused = false; // Last state sent to the engine
     std::mutex m_lock_receive_queue;
-    std::queue<std::vector<uint8_t> > m_received_message_queue;
+    WebSocketMessageQueue m_received_message_queue;
+    size_t m_received_bytes = 0;
+    size_t m_receive_low_bytes = 4 * 1024 * 1024;
+    size_t m_receive_high_bytes = 16 * 1024 * 1024;
+    size_t m_receive_low_messages = 1024;
+    size_t m_receive_high_messages = 4096;
+    bool m_receive_paused = false;
+    bool m_conflate = false;
+    size_t m_conflation_offset = 0;
+    size_t m_conflation_length = 0;
+    int m_conflation_delimiter = -1;
+    std::unordered_map<std::string, uint64_t> m_conflation_index; // Key -> sequence of the queued message holding it
+    uint64_t m_pushed_sequence = 0;
+    uint64_t m_popped_sequence = 0;
+    uint64_t m_front_replaced = 0; // Conflated updates written over the front message, see popNextMessage
+    uint64_t m_conflated_messages = 0;
+    uint64_t m_conflated_bytes = 0;
+    uint64_t m_last_received_at = 0;
+    LatencyHistogram m_queue_delay;
+    LatencyHistogram m_receive_delay;
+    std::atomic<bool> m_decode_amf3{false};
+    std::atomic<bool> m_decode_json{false};
+    DeltaDecoder m_delta;
+    std::atomic<bool> m_decode_offload{false};
+    // Lock order: m_decode_lock, then m_lock_receive_pause, then m_lock_receive_queue
+    std::mutex m_decode_lock;
+    uint64_t m_decode_sequence = 0;   // Next sequence handed to a received message
+    uint64_t m_decode_committed = 0;  // Sequence of the next message to queue
+    std::map<uint64_t, DecodedMessage> m_decode_reorder;
+    size_t m_decode_reorder_max = 0;
+    uint64_t m_decode_offloaded = 0;
+    LatencyHistogram m_decode_reorder_wait;
+    MessageCapture m_capture;
+    MessageReplay m_replay;
+    std::mutex m_callback_lock;
+    std::condition_variable m_callbacks_done;
+    int m_callbacks_in_flight = 0;
+    bool m_shut_down = false;
+    FREContext m_ctx;
     char *m_guidPointer;
 };
 
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <Windows.h>
 #include <log.h>
@@ -35,9 +36,11 @@ std::string GetLibraryLocation(int argc, char *argv[]) {
     return baseDirectory + R"(\META-INF\ANE\Windows-x86\WebSocketClientNativeLibrary.dll)";
 }
 
+// Called from the warm-up thread and the main thread, whichever needs the engine first
 bool loadNativeLibrary() {
+    static std::mutex loadMutex;
+    std::lock_guard<std::mutex> lock(loadMutex);
     if (library) {
-        std::cerr << "Library is already loaded." << std::endl;
         return true;
     }
 
@@ -56,8 +59,9 @@ bool loadNativeLibrary() {
     return true;
 }
 
+// Each wrapper below resolves its export once and keeps the pointer in a function-local static
 void *getFunctionPointer(const char *functionName) {
-    if (!library && !loadNativeLibrary()) {
+    if (!loadNativeLibrary()) {
         return nullptr;
     }
 
@@ -72,17 +76,17 @@ void *getFunctionPointer(const char *functionName) {
     return func;
 }
 
-int __cdecl csharpWebSocketLibrary_initializerCallbacks(const void *callBackConnect, const void *callBackData, const void *callBackDisconnect, const void *callBackLog) {
+int __cdecl csharpWebSocketLibrary_initializerCallbacks(const void *callBackConnect, const void *callBackData, const void *callBackDisconnect, const void *callBackLog, const void *callBackStatus) {
     writeLog("initializerCallbacks called");
-    using InitializerFunc = int (__cdecl *)(const void *, const void *, const void *, const void *);
-    auto func = reinterpret_cast<InitializerFunc>(getFunctionPointer("csharpWebSocketLibrary_initializerCallbacks"));
+    using InitializerFunc = int (__cdecl *)(const void *, const void *, const void *, const void *, const void *);
+    static auto func = reinterpret_cast<InitializerFunc>(getFunctionPointer("csharpWebSocketLibrary_initializerCallbacks"));
 
     if (!func) {
         writeLog("Could not load initializerCallbacks function");
         return -1;
     }
 
-    int result = func(callBackConnect, callBackData, callBackDisconnect, callBackLog);
+    int result = func(callBackConnect, callBackData, callBackDisconnect, callBackLog, callBackStatus);
     writeLog(("initializerCallbacks result: " + std::to_string(result)).c_str());
     return result;
 }
@@ -90,7 +94,7 @@ int __cdecl csharpWebSocketLibrary_initializerCallbacks(const void *callBackConn
 char* __cdecl csharpWebSocketLibrary_createWebSocketClient(void const * ctx) {
     writeLog("createWebSocketClient called");
     using CreateWebSocketClientFunc = char *(__cdecl *)(const void *);
-    auto func = reinterpret_cast<CreateWebSocketClientFunc>(getFunctionPointer("csharpWebSocketLibrary_createWebSocketClient"));
+    static auto func = reinterpret_cast<CreateWebSocketClientFunc>(getFunctionPointer("csharpWebSocketLibrary_createWebSocketClient"));
 
     if (!func) {
         writeLog("Could not load createWebSocketClient function");
@@ -103,10 +107,23 @@ char* __cdecl csharpWebSocketLibrary_createWebSocketClient(void const * ctx) {
     return result;
 }
 
+int __cdecl csharpWebSocketLibrary_destroyWebSocketClient(const void *guidPointer) {
+    writeLog("destroyWebSocketClient called");
+    using DestroyWebSocketClientFunc = int (__cdecl *)(const void *);
+    static auto func = reinterpret_cast<DestroyWebSocketClientFunc>(getFunctionPointer("csharpWebSocketLibrary_destroyWebSocketClient"));
+
+    if (!func) {
+        writeLog("Could not load destroyWebSocketClient function");
+        return 0;
+    }
+
+    return func(guidPointer);
+}
+
 int __cdecl csharpWebSocketLibrary_connect(const void *guidPointer, const char *url) {
     writeLog("connect called");
     using ConnectFunc = int (__cdecl *)(const void *, const char *);
-    auto func = reinterpret_cast<ConnectFunc>(getFunctionPointer("csharpWebSocketLibrary_connect"));
+    static auto func = reinterpret_cast<ConnectFunc>(getFunctionPointer("csharpWebSocketLibrary_connect"));
 
     if (!func) {
         writeLog("Could not load connect function");
@@ -118,23 +135,65 @@ int __cdecl csharpWebSocketLibrary_connect(const void *guidPointer, const char *
     return result;
 }
 
-void __cdecl csharpWebSocketLibrary_sendMessage(const void *guidPointer, const void *data, int length) {
+int __cdecl csharpWebSocketLibrary_connectShared(const void *guidPointer, const char *url) {
+    writeLog("connectShared called");
+    using ConnectSharedFunc = int (__cdecl *)(const void *, const char *);
+    static auto func = reinterpret_cast<ConnectSharedFunc>(getFunctionPointer("csharpWebSocketLibrary_connectShared"));
+
+    if (!func) {
+        writeLog("Could not load connectShared function");
+        return -1;
+    }
+
+    auto result = func(guidPointer, url);
+    writeLog(("connectShared result: " + std::to_string(result)).c_str());
+    return result;
+}
+
+int __cdecl csharpWebSocketLibrary_connectWithOptions(const void *guidPointer, const char *url, const WebSocketConnectOptions *options) {
+    writeLog("connectWithOptions called");
+    using ConnectWithOptionsFunc = int (__cdecl *)(const void *, const char *, const WebSocketConnectOptions *);
+    static auto func = reinterpret_cast<ConnectWithOptionsFunc>(getFunctionPointer("csharpWebSocketLibrary_connectWithOptions"));
+
+    if (!func) {
+        writeLog("Could not load connectWithOptions function");
+        return -1;
+    }
+
+    auto result = func(guidPointer, url, options);
+    writeLog(("connectWithOptions result: " + std::to_string(result)).c_str());
+    return result;
+}
+
+int __cdecl csharpWebSocketLibrary_sendMessage(const void *guidPointer, const void *data, int length, int lane) {
     writeLog("sendMessage called");
-    using SendMessageFunc = void (__cdecl *)(const void *, const void *, int);
-    auto func = reinterpret_cast<SendMessageFunc>(getFunctionPointer("csharpWebSocketLibrary_sendMessage"));
+    using SendMessageFunc = int (__cdecl *)(const void *, const void *, int, int);
+    static auto func = reinterpret_cast<SendMessageFunc>(getFunctionPointer("csharpWebSocketLibrary_sendMessage"));
 
     if (!func) {
         writeLog("Could not load sendMessage function");
-        return;
+        return 0;
+    }
+
+    return func(guidPointer, data, length, lane);
+}
+
+int __cdecl csharpWebSocketLibrary_sendMessages(const void *guidPointer, const void *data, int length, int lane) {
+    using SendMessagesFunc = int (__cdecl *)(const void *, const void *, int, int);
+    static auto func = reinterpret_cast<SendMessagesFunc>(getFunctionPointer("csharpWebSocketLibrary_sendMessages"));
+
+    if (!func) {
+        writeLog("Could not load sendMessages function");
+        return 0;
     }
 
-    func(guidPointer, data, length);
+    return func(guidPointer, data, length, lane);
 }
 
 void __cdecl csharpWebSocketLibrary_disconnect(const void *guidPointer, int closeCode) {
     writeLog("disconnect called");
     using DisconnectFunc = void (__cdecl *)(const void *, int);
-    auto func = reinterpret_cast<DisconnectFunc>(getFunctionPointer("csharpWebSocketLibrary_disconnect"));
+    static auto func = reinterpret_cast<DisconnectFunc>(getFunctionPointer("csharpWebSocketLibrary_disconnect"));
 
     if (!func) {
         writeLog("Could not load disconnect function");
@@ -144,10 +203,123 @@ void __cdecl csharpWebSocketLibrary_disconnect(const void *guidPointer, int clos
     func(guidPointer, closeCode);
 }
 
+int64_t __cdecl csharpWebSocketLibrary_getBufferedAmount(const void *guidPointer) {
+    using GetBufferedAmountFunc = int64_t (__cdecl *)(const void *);
+    static auto func = reinterpret_cast<GetBufferedAmountFunc>(getFunctionPointer("csharpWebSocketLibrary_getBufferedAmount"));
+
+    if (!func) {
+        writeLog("Could not load getBufferedAmount function");
+        return 0;
+    }
+
+    return func(guidPointer);
+}
+
+int __cdecl csharpWebSocketLibrary_setSendWatermarks(const void *guidPointer, int64_t lowWatermark, int64_t highWatermark) {
+    writeLog("setSendWatermarks called");
+    using SetSendWatermarksFunc = int (__cdecl *)(const void *, int64_t, int64_t);
+    static auto func = reinterpret_cast<SetSendWatermarksFunc>(getFunctionPointer("csharpWebSocketLibrary_setSendWatermarks"));
+
+    if (!func) {
+        writeLog("Could not load setSendWatermarks function");
+        return 0;
+    }
+
+    return func(guidPointer, lowWatermark, highWatermark);
+}
+
+int __cdecl csharpWebSocketLibrary_setReceivePaused(const void *guidPointer, int paused) {
+    writeLog("setReceivePaused called");
+    using SetReceivePausedFunc = int (__cdecl *)(const void *, int);
+    static auto func = reinterpret_cast<SetReceivePausedFunc>(getFunctionPointer("csharpWebSocketLibrary_setReceivePaused"));
+
+    if (!func) {
+        writeLog("Could not load setReceivePaused function");
+        return 0;
+    }
+
+    return func(guidPointer, paused);
+}
+
+int __cdecl csharpWebSocketLibrary_setFragmentSize(const void *guidPointer, int fragmentSize) {
+    writeLog("setFragmentSize called");
+    using SetFragmentSizeFunc = int (__cdecl *)(const void *, int);
+    static auto func = reinterpret_cast<SetFragmentSizeFunc>(getFunctionPointer("csharpWebSocketLibrary_setFragmentSize"));
+
+    if (!func) {
+        writeLog("Could not load setFragmentSize function");
+        return 0;
+    }
+
+    return func(guidPointer, fragmentSize);
+}
+
+int __cdecl csharpWebSocketLibrary_getSendLaneStats(const void *guidPointer, char *buffer, int bufferLength) {
+    using GetSendLaneStatsFunc = int (__cdecl *)(const void *, char *, int);
+    static auto func = reinterpret_cast<GetSendLaneStatsFunc>(getFunctionPointer("csharpWebSocketLibrary_getSendLaneStats"));
+
+    if (!func) {
+        writeLog("Could not load getSendLaneStats function");
+        return 0;
+    }
+
+    return func(guidPointer, buffer, bufferLength);
+}
+
+int __cdecl csharpWebSocketLibrary_setKeepAlive(const void *guidPointer, int intervalMs, int timeoutMs, int statusIntervalMs) {
+    writeLog("setKeepAlive called");
+    using SetKeepAliveFunc = int (__cdecl *)(const void *, int, int, int);
+    static auto func = reinterpret_cast<SetKeepAliveFunc>(getFunctionPointer("csharpWebSocketLibrary_setKeepAlive"));
+
+    if (!func) {
+        writeLog("Could not load setKeepAlive function");
+        return 0;
+    }
+
+    return func(guidPointer, intervalMs, timeoutMs, statusIntervalMs);
+}
+
+int __cdecl csharpWebSocketLibrary_getRttStats(const void *guidPointer, char *buffer, int bufferLength) {
+    using GetRttStatsFunc = int (__cdecl *)(const void *, char *, int);
+    static auto func = reinterpret_cast<GetRttStatsFunc>(getFunctionPointer("csharpWebSocketLibrary_getRttStats"));
+
+    if (!func) {
+        writeLog("Could not load getRttStats function");
+        return 0;
+    }
+
+    return func(guidPointer, buffer, bufferLength);
+}
+
+int __cdecl csharpWebSocketLibrary_setBusyPoll(const void *guidPointer, int spinMicros, int core) {
+    writeLog("setBusyPoll called");
+    using SetBusyPollFunc = int (__cdecl *)(const void *, int, int);
+    static auto func = reinterpret_cast<SetBusyPollFunc>(getFunctionPointer("csharpWebSocketLibrary_setBusyPoll"));
+
+    if (!func) {
+        writeLog("Could not load setBusyPoll function");
+        return 0;
+    }
+
+    return func(guidPointer, spinMicros, core);
+}
+
+int __cdecl csharpWebSocketLibrary_getIoStats(const void *guidPointer, char *buffer, int bufferLength) {
+    using GetIoStatsFunc = int (__cdecl *)(const void *, char *, int);
+    static auto func = reinterpret_cast<GetIoStatsFunc>(getFunctionPointer("csharpWebSocketLibrary_getIoStats"));
+
+    if (!func) {
+        writeLog("Could not load getIoStats function");
+        return 0;
+    }
+
+    return func(guidPointer, buffer, bufferLength);
+}
+
 void __cdecl csharpWebSocketLibrary_addStaticHost(const char *host, const char *ip) {
     writeLog("addStaticHost called");
     using AddStaticHostFunc = void (__cdecl *)(const char *, const char *);
-    auto func = reinterpret_cast<AddStaticHostFunc>(getFunctionPointer("csharpWebSocketLibrary_addStaticHost"));
+    static auto func = reinterpret_cast<AddStaticHostFunc>(getFunctionPointer("csharpWebSocketLibrary_addStaticHost"));
 
     if (!func) {
         writeLog("Could not load addStaticHost function");
@@ -160,7 +332,7 @@ void __cdecl csharpWebSocketLibrary_addStaticHost(const char *host, const char *
 void __cdecl csharpWebSocketLibrary_removeStaticHost(const char *host) {
     writeLog("removeStaticHost called");
     using RemoveStaticHostFunc = void (__cdecl *)(const char *);
-    auto func = reinterpret_cast<RemoveStaticHostFunc>(getFunctionPointer("csharpWebSocketLibrary_removeStaticHost"));
+    static auto func = reinterpret_cast<RemoveStaticHostFunc>(getFunctionPointer("csharpWebSocketLibrary_removeStaticHost"));
 
     if (!func) {
         writeLog("Could not load removeStaticHost function");
@@ -168,4 +340,88 @@ void __cdecl csharpWebSocketLibrary_removeStaticHost(const char *host) {
     }
 
     func(host);
-}
\ No newline at end of file
+}
+
+int __cdecl csharpWebSocketLibrary_getTraceEvents(double nowMicros, char *buffer, int bufferLength) {
+    using GetTraceEventsFunc = int (__cdecl *)(double, char *, int);
+    static auto func = reinterpret_cast<GetTraceEventsFunc>(getFunctionPointer("csharpWebSocketLibrary_getTraceEvents"));
+
+    if (!func) {
+        writeLog("Could not load getTraceEvents function");
+        return 0;
+    }
+
+    return func(nowMicros, buffer, bufferLength);
+}
+
+void __cdecl csharpWebSocketLibrary_addHostHint(const char *host) {
+    using AddHostHintFunc = void (__cdecl *)(const char *);
+    static auto func = reinterpret_cast<AddHostHintFunc>(getFunctionPointer("csharpWebSocketLibrary_addHostHint"));
+
+    if (!func) {
+        writeLog("Could not load addHostHint function");
+        return;
+    }
+
+    func(host);
+}
+
+int __cdecl csharpWebSocketLibrary_warmUp() {
+    using WarmUpFunc = int (__cdecl *)();
+    static auto func = reinterpret_cast<WarmUpFunc>(getFunctionPointer("csharpWebSocketLibrary_warmUp"));
+
+    if (!func) {
+        writeLog("Could not load warmUp function");
+        return 0;
+    }
+
+    return func();
+}
+
+int __cdecl csharpWebSocketLibrary_getStartupTimings(char *buffer, int bufferLength) {
+    using GetStartupTimingsFunc = int (__cdecl *)(char *, int);
+    static auto func = reinterpret_cast<GetStartupTimingsFunc>(getFunctionPointer("csharpWebSocketLibrary_getStartupTimings"));
+
+    if (!func) {
+        writeLog("Could not load getStartupTimings function");
+        return 0;
+    }
+
+    return func(buffer, bufferLength);
+}
+
+int __cdecl csharpWebSocketLibrary_getMemoryStats(char *buffer, int bufferLength) {
+    using GetMemoryStatsFunc = int (__cdecl *)(char *, int);
+    static auto func = reinterpret_cast<GetMemoryStatsFunc>(getFunctionPointer("csharpWebSocketLibrary_getMemoryStats"));
+
+    if (!func) {
+        writeLog("Could not load getMemoryStats function");
+        return 0;
+    }
+
+    return func(buffer, bufferLength);
+}
+
+int __cdecl csharpWebSocketLibrary_setNetworkImpairment(const char *config) {
+    using SetNetworkImpairmentFunc = int (__cdecl *)(const char *);
+    static auto func = reinterpret_cast<SetNetworkImpairmentFunc>(getFunctionPointer("csharpWebSocketLibrary_setNetworkImpairment"));
+
+    if (!func) {
+        writeLog("Could not load setNetworkImpairment function");
+        return 0;
+    }
+
+    return func(config);
+}
+
+int __cdecl csharpWebSocketLibrary_getNetworkImpairmentStats(char *buffer, int bufferLength) {
+    using GetNetworkImpairmentStatsFunc = int (__cdecl *)(char *, int);
+    static auto func = reinterpret_cast<GetNetworkImpairmentStatsFunc>(getFunctionPointer("csharpWebSocketLibrary_getNetworkImpairmentStats"));
+
+    if (!func) {
+        writeLog("Could not load getNetworkImpairmentStats function");
+        return 0;
+    }
+
+    return func(buffer, bufferLength);
+}
@@ -7,12 +7,49 @@
 
 #ifndef WebSocketNativeLibrary_h
 #define WebSocketNativeLibrary_h
-int __cdecl csharpWebSocketLibrary_initializerCallbacks(const void* callBackConnect, const void *callBackData, const void *callBackDisconnect, const void *callBackLog);
+#include <cstdint>
+
+// Per-connection tuning for csharpWebSocketLibrary_connectWithOptions, laid out like ConnectOptions in the engine.
+// Zero selects the engine default for every field except tcpNoDelay (1 on, 0 off) and keepAliveIntervalMs, where -1
+// keeps the current interval (0 turns keepalive off)
+struct WebSocketConnectOptions {
+    int32_t connectTimeoutMs;
+    int32_t attemptDelayMs;
+    int32_t dnsTimeoutMs;
+    int32_t tcpNoDelay;
+    int32_t sendBufferSize;
+    int32_t receiveBufferSize;
+    int32_t initialReceiveBufferSize;
+    int32_t keepAliveIntervalMs;
+    int32_t maxMessageSize;
+};
+
+int __cdecl csharpWebSocketLibrary_initializerCallbacks(const void* callBackConnect, const void *callBackData, const void *callBackDisconnect, const void *callBackLog, const void *callBackStatus);
 char* __cdecl csharpWebSocketLibrary_createWebSocketClient(const void* ctx);
+int __cdecl csharpWebSocketLibrary_destroyWebSocketClient(const void* guidPointer);
 int __cdecl csharpWebSocketLibrary_connect(const void* guidPointer, const char* url);
-void __cdecl csharpWebSocketLibrary_sendMessage(const void* guidPointer, const void* data, int length);
+int __cdecl csharpWebSocketLibrary_connectShared(const void* guidPointer, const char* url);
+int __cdecl csharpWebSocketLibrary_connectWithOptions(const void* guidPointer, const char* url, const WebSocketConnectOptions* options);
+int __cdecl csharpWebSocketLibrary_sendMessage(const void* guidPointer, const void* data, int length, int lane);
+int __cdecl csharpWebSocketLibrary_sendMessages(const void* guidPointer, const void* data, int length, int lane);
 void __cdecl csharpWebSocketLibrary_disconnect(const void* guidPointer, int closeCode);
+int64_t __cdecl csharpWebSocketLibrary_getBufferedAmount(const void* guidPointer);
+int __cdecl csharpWebSocketLibrary_setSendWatermarks(const void* guidPointer, int64_t lowWatermark, int64_t highWatermark);
+int __cdecl csharpWebSocketLibrary_setReceivePaused(const void* guidPointer, int paused);
+int __cdecl csharpWebSocketLibrary_setFragmentSize(const void* guidPointer, int fragmentSize);
+int __cdecl csharpWebSocketLibrary_getSendLaneStats(const void* guidPointer, char* buffer, int bufferLength);
+int __cdecl csharpWebSocketLibrary_setKeepAlive(const void* guidPointer, int intervalMs, int timeoutMs, int statusIntervalMs);
+int __cdecl csharpWebSocketLibrary_getRttStats(const void* guidPointer, char* buffer, int bufferLength);
+int __cdecl csharpWebSocketLibrary_setBusyPoll(const void* guidPointer, int spinMicros, int core);
+int __cdecl csharpWebSocketLibrary_getIoStats(const void* guidPointer, char* buffer, int bufferLength);
 void __cdecl csharpWebSocketLibrary_addStaticHost(const char* host, const char* ip);
 void __cdecl csharpWebSocketLibrary_removeStaticHost(const char* host);
+void __cdecl csharpWebSocketLibrary_addHostHint(const char* host);
+int __cdecl csharpWebSocketLibrary_warmUp();
+int __cdecl csharpWebSocketLibrary_getStartupTimings(char* buffer, int bufferLength);
+int __cdecl csharpWebSocketLibrary_getTraceEvents(double nowMicros, char* buffer, int bufferLength);
+int __cdecl csharpWebSocketLibrary_getMemoryStats(char* buffer, int bufferLength);
+int __cdecl csharpWebSocketLibrary_setNetworkImpairment(const char* config);
+int __cdecl csharpWebSocketLibrary_getNetworkImpairmentStats(char* buffer, int bufferLength);
 
 #endif /* WebSocketNativeLibrary_h */